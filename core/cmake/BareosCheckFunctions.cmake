@@ -38,7 +38,9 @@ check_function_exists(extattr_string_to_namespace
                       HAVE_EXTATTR_STRING_TO_NAMESPACE)
 check_function_exists(fchownat HAVE_FCHOWNAT)
 check_function_exists(fdatasync HAVE_FDATASYNC)
+check_function_exists(fdopendir HAVE_FDOPENDIR)
 check_function_exists(fseeko HAVE_FSEEKO)
+check_function_exists(fstatat HAVE_FSTATAT)
 check_function_exists(futimens HAVE_FUTIMENS)
 check_function_exists(futimes HAVE_FUTIMES)
 check_function_exists(futimesat HAVE_FUTIMESAT)
@@ -81,6 +83,7 @@ check_function_exists(setxattr HAVE_SETXATTR)
 check_function_exists(hl_loa HAVE_HL_LOA)
 check_function_exists(sizeof_proplist_entry HAVE_SIZEOF_PROPLIST_ENTRY)
 check_function_exists(sqlite3_threadsafe HAVE_SQLITE3_THREADSAFE)
+check_function_exists(statx HAVE_STATX)
 check_function_exists(unlinkat HAVE_UNLINKAT)
 check_function_exists(utimes HAVE_UTIMES)
 
@@ -473,7 +473,7 @@ Requires:   %{name}-database-common = %{version}
 Provides:   %{name}-dbtools
 
 %package    tools
-Summary:    Bareos CLI tools (bcopy, bextract, bls, bregex, bwild)
+Summary:    Bareos CLI tools (bcopy, bextract, bls, bregex, bsdbench, bwild)
 Group:      Productivity/Archiving/Backup
 Requires:   %{name}-common = %{version}
 
@@ -1037,6 +1037,7 @@ for F in  \
     %{_mandir}/man8/bpluginfo.8.gz \
     %{_mandir}/man8/bscan.8.gz \
     %{_mandir}/man8/bscrypto.8.gz \
+    %{_mandir}/man8/bsdbench.8.gz \
     %{_mandir}/man8/btape.8.gz \
     %{_sysconfdir}/logrotate.d/bareos-dir \
     %{_sysconfdir}/rc.d/init.d/bareos-dir \
@@ -1511,6 +1512,7 @@ mkdir -p %{?buildroot}/%{_libdir}/bareos/plugins/vmware_plugin
 %{_sbindir}/bcopy
 %{_sbindir}/bextract
 %{_sbindir}/bls
+%{_sbindir}/bsdbench
 %{_sbindir}/bregex
 %{_sbindir}/bwild
 %{_sbindir}/bpluginfo
@@ -1520,6 +1522,7 @@ mkdir -p %{?buildroot}/%{_libdir}/bareos/plugins/vmware_plugin
 %{_mandir}/man8/bextract.8.gz
 %{_mandir}/man8/bls.8.gz
 %{_mandir}/man8/bpluginfo.8.gz
+%{_mandir}/man8/bsdbench.8.gz
 
 %if 0%{?build_qt_monitor}
 %files traymonitor
@@ -519,6 +519,10 @@ bool DoNativeBackup(JobControlRecord* jcr)
     SendBwlimitToFd(jcr, jcr->Job); /* Old clients don't have this command */
   }
 
+  if (jcr->impl->res.job->CompactAttributes) {
+    if (!SendCompactAttributesToFd(jcr)) { goto bail_out; }
+  }
+
   client = jcr->impl->res.client;
   store = jcr->impl->res.write_storage;
   char* connection_target_address;
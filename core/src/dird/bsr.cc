@@ -396,76 +396,128 @@ void DisplayBsrInfo(UaContext* ua, RestoreContext& rx)
 }
 
 /**
- * Write bsr data for a single bsr record
+ * Build the read plan for the given bsrs.
+ *
+ * Adjacent JobMedia records of the same JobId on the same Volume that
+ * contain selected files are merged into a single run.
+ *
+ * The same file may be selected from several Jobs (deltas or whole Jobs)
+ * and the versions must reach the file daemon in the order they were
+ * written. On one Volume the addresses follow the write order, so each
+ * stretch of runs on the same Volume is sorted by start address and the
+ * storage daemon only has to seek forward. The stretches themselves stay
+ * in Job order, even when the Volumes of the Jobs interleave.
+ */
+std::vector<BsrReadPlanItem> PlanBsrReads(
+    const std::vector<RestoreBootstrapRecord*>& bsrs)
+{
+  std::vector<BsrReadPlanItem> plan;
+
+  for (auto bsr : bsrs) {
+    BsrReadPlanItem* last_run = nullptr; /* only valid until next push */
+    int last_vol = -1;
+
+    for (int i = 0; i < bsr->VolCount; i++) {
+      VolumeParameters& vp = bsr->VolParams[i];
+
+      if (!is_volume_selected(bsr->fi.get(), vp.FirstIndex, vp.LastIndex)) {
+        vp.VolumeName[0] = 0; /* zap VolumeName */
+        continue;
+      }
+
+      if (last_run && last_vol == i - 1 &&
+          bstrcmp(bsr->VolParams[last_run->VolIndex].VolumeName,
+                  vp.VolumeName) &&
+          vp.StartAddr >= last_run->EndAddr) {
+        last_run->EndAddr = vp.EndAddr;
+        last_run->LastIndex = vp.LastIndex;
+        last_vol = i;
+        continue;
+      }
+
+      BsrReadPlanItem run;
+      run.bsr = bsr;
+      run.VolIndex = i;
+      run.StartAddr = vp.StartAddr;
+      run.EndAddr = vp.EndAddr;
+      run.FirstIndex = vp.FirstIndex;
+      run.LastIndex = vp.LastIndex;
+      run.continued = last_run && last_run->LastIndex == run.FirstIndex;
+      plan.push_back(run);
+
+      last_run = &plan.back();
+      last_vol = i;
+    }
+  }
+
+  auto VolumeOf = [](const BsrReadPlanItem& run) {
+    return run.bsr->VolParams[run.VolIndex].VolumeName;
+  };
+
+  auto begin = plan.begin();
+  while (begin != plan.end()) {
+    const char* volume = VolumeOf(*begin);
+    auto end = std::find_if(begin, plan.end(),
+                            [&](const BsrReadPlanItem& run) {
+                              return !bstrcmp(VolumeOf(run), volume);
+                            });
+
+    std::stable_sort(begin, end,
+                     [](const BsrReadPlanItem& a, const BsrReadPlanItem& b) {
+                       return a.StartAddr < b.StartAddr;
+                     });
+    begin = end;
+  }
+
+  return plan;
+}
+
+/**
+ * Write bsr data for a single run of the read plan
  */
-static uint32_t write_bsr_item(RestoreBootstrapRecord* bsr,
+static uint32_t write_bsr_item(const BsrReadPlanItem& run,
                                UaContext* ua,
                                RestoreContext& rx,
-                               std::string& buffer,
-                               bool& first,
-                               uint32_t& LastIndex)
+                               std::string& buffer)
 {
-  int i;
   char ed1[50], ed2[50];
   uint32_t count = 0;
-  uint32_t total_count = 0;
   char device[MAX_NAME_LENGTH];
+  RestoreBootstrapRecord* bsr = run.bsr;
+  VolumeParameters& vp = bsr->VolParams[run.VolIndex];
 
-  /*
-   * For a given volume, loop over all the JobMedia records.
-   * VolCount is the number of JobMedia records.
-   */
-  for (i = 0; i < bsr->VolCount; i++) {
-    if (!is_volume_selected(bsr->fi.get(), bsr->VolParams[i].FirstIndex,
-                            bsr->VolParams[i].LastIndex)) {
-      bsr->VolParams[i].VolumeName[0] = 0; /* zap VolumeName */
-      continue;
-    }
-
-    if (!rx.store) {
-      FindStorageResource(ua, rx, bsr->VolParams[i].Storage,
-                          bsr->VolParams[i].MediaType);
-    }
+  if (!rx.store) { FindStorageResource(ua, rx, vp.Storage, vp.MediaType); }
 
-    PrintBsrItem(buffer, "Storage=\"%s\"\n", bsr->VolParams[i].Storage);
-    PrintBsrItem(buffer, "Volume=\"%s\"\n", bsr->VolParams[i].VolumeName);
-    PrintBsrItem(buffer, "MediaType=\"%s\"\n", bsr->VolParams[i].MediaType);
+  PrintBsrItem(buffer, "Storage=\"%s\"\n", vp.Storage);
+  PrintBsrItem(buffer, "Volume=\"%s\"\n", vp.VolumeName);
+  PrintBsrItem(buffer, "MediaType=\"%s\"\n", vp.MediaType);
 
-    if (bsr->fileregex) {
-      PrintBsrItem(buffer, "FileRegex=%s\n", bsr->fileregex);
-    }
-
-    if (GetStorageDevice(device, bsr->VolParams[i].Storage)) {
-      PrintBsrItem(buffer, "Device=\"%s\"\n", device);
-    }
+  if (bsr->fileregex) {
+    PrintBsrItem(buffer, "FileRegex=%s\n", bsr->fileregex);
+  }
 
-    if (bsr->VolParams[i].Slot > 0) {
-      PrintBsrItem(buffer, "Slot=%d\n", bsr->VolParams[i].Slot);
-    }
+  if (GetStorageDevice(device, vp.Storage)) {
+    PrintBsrItem(buffer, "Device=\"%s\"\n", device);
+  }
 
-    PrintBsrItem(buffer, "VolSessionId=%u\n", bsr->VolSessionId);
-    PrintBsrItem(buffer, "VolSessionTime=%u\n", bsr->VolSessionTime);
-    PrintBsrItem(buffer, "VolAddr=%s-%s\n",
-                 edit_uint64(bsr->VolParams[i].StartAddr, ed1),
-                 edit_uint64(bsr->VolParams[i].EndAddr, ed2));
+  if (vp.Slot > 0) { PrintBsrItem(buffer, "Slot=%d\n", vp.Slot); }
 
-    count = write_findex(bsr->fi.get(), bsr->VolParams[i].FirstIndex,
-                         bsr->VolParams[i].LastIndex, buffer);
-    if (count) { PrintBsrItem(buffer, "Count=%u\n", count); }
+  PrintBsrItem(buffer, "VolSessionId=%u\n", bsr->VolSessionId);
+  PrintBsrItem(buffer, "VolSessionTime=%u\n", bsr->VolSessionTime);
+  PrintBsrItem(buffer, "VolAddr=%s-%s\n", edit_uint64(run.StartAddr, ed1),
+               edit_uint64(run.EndAddr, ed2));
 
-    total_count += count;
+  count = write_findex(bsr->fi.get(), run.FirstIndex, run.LastIndex, buffer);
+  if (count) { PrintBsrItem(buffer, "Count=%u\n", count); }
 
-    /*
-     * If the same file is present on two tapes or in two files
-     * on a tape, it is a continuation, and should not be treated
-     * twice in the totals.
-     */
-    if (!first && LastIndex == bsr->VolParams[i].FirstIndex) { total_count--; }
-    first = false;
-    LastIndex = bsr->VolParams[i].LastIndex;
-  }
+  /*
+   * If the same file is present on two tapes or in two files
+   * on a tape, it is a continuation, and should not be treated
+   * twice in the totals.
+   */
+  if (count && run.continued) { count--; }
 
-  return total_count;
+  return count;
 }
 
 /**
@@ -474,33 +526,34 @@ static uint32_t write_bsr_item(RestoreBootstrapRecord* bsr,
  * have multiple volumes, which have been entered in the
  * order they were written.
  *
- * The bsrs must be written out in the order the JobIds
- * are found in the jobid list.
+ * The bsrs are collected in the order the JobIds are found
+ * in the jobid list and then written out following the read
+ * plan, i.e. in address order within each stretch of a Volume.
  */
 uint32_t WriteBsr(UaContext* ua, RestoreContext& rx, std::string& buffer)
 {
-  bool first = true;
-  uint32_t LastIndex = 0;
   uint32_t total_count = 0;
   char* p;
   JobId_t JobId;
   RestoreBootstrapRecord* bsr;
+  std::vector<RestoreBootstrapRecord*> bsrs;
 
   if (*rx.JobIds == 0) {
     for (bsr = rx.bsr.get(); bsr; bsr = bsr->next.get()) {
-      total_count += write_bsr_item(bsr, ua, rx, buffer, first, LastIndex);
+      bsrs.push_back(bsr);
     }
-    return total_count;
-  }
-
-  for (p = rx.JobIds; GetNextJobidFromList(&p, &JobId) > 0;) {
-    for (bsr = rx.bsr.get(); bsr; bsr = bsr->next.get()) {
-      if (JobId == bsr->JobId) {
-        total_count += write_bsr_item(bsr, ua, rx, buffer, first, LastIndex);
+  } else {
+    for (p = rx.JobIds; GetNextJobidFromList(&p, &JobId) > 0;) {
+      for (bsr = rx.bsr.get(); bsr; bsr = bsr->next.get()) {
+        if (JobId == bsr->JobId) { bsrs.push_back(bsr); }
       }
     }
   }
 
+  for (const auto& run : PlanBsrReads(bsrs)) {
+    total_count += write_bsr_item(run, ua, rx, buffer);
+  }
+
   return total_count;
 }
 
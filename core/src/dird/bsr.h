@@ -84,6 +84,20 @@ struct RestoreBootstrapRecord {
   RestoreBootstrapRecord& operator=(RestoreBootstrapRecord&&) = delete;
 };
 
+/**
+ * One entry of a restore read plan: a run of adjacent JobMedia records
+ *  of a single JobId on a single Volume that contain selected files.
+ */
+struct BsrReadPlanItem {
+  RestoreBootstrapRecord* bsr = nullptr;
+  int VolIndex = 0;       /**< first VolParams entry of this run */
+  uint64_t StartAddr = 0; /**< start address of the run */
+  uint64_t EndAddr = 0;   /**< end address of the run */
+  int32_t FirstIndex = 0; /**< first FileIndex of the run */
+  int32_t LastIndex = 0;  /**< last FileIndex of the run */
+  bool continued = false; /**< first file continues the previous run */
+};
+
 class UaContext;
 
 /**
@@ -101,6 +115,8 @@ void DisplayBsrInfo(UaContext* ua, RestoreContext& rx);
 uint32_t WriteBsr(UaContext* ua, RestoreContext& rx, std::string& buffer);
 void AddFindex(RestoreBootstrapRecord* bsr, uint32_t JobId, int32_t findex);
 void AddFindexAll(RestoreBootstrapRecord* bsr, uint32_t JobId);
+std::vector<BsrReadPlanItem> PlanBsrReads(
+    const std::vector<RestoreBootstrapRecord*>& bsrs);
 RestoreBootstrapRecordFileIndex* new_findex();
 void MakeUniqueRestoreFilename(UaContext* ua, POOLMEM*& fname);
 void PrintBsr(UaContext* ua, RestoreContext& rx);
@@ -40,6 +40,7 @@
 #include "dird/jcr_private.h"
 #include "dird/sd_cmds.h"
 #include "findlib/find.h"
+#include "lib/attr_spool.h"
 #include "lib/berrno.h"
 #include "lib/edit.h"
 #include "lib/util.h"
@@ -477,6 +478,7 @@ static void UpdateAttribute(JobControlRecord* jcr,
   switch (Stream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
       if (jcr->cached_attribute) {
         Dmsg2(400, "Cached attr. Stream=%d fname=%s\n", ar->Stream, ar->fname);
         if (!jcr->db->CreateAttributesRecord(jcr, ar)) {
@@ -513,6 +515,26 @@ static void UpdateAttribute(JobControlRecord* jcr,
         }
       }
 
+      /*
+       * The catalog always stores the text form of the stat packet. LStat
+       * is read outside of the daemons (bvfs, the WebUI, SQL queries and
+       * the accurate list sent back to the client), so the compact form
+       * only saves space on the network and on the volumes. Converting
+       * costs about as much as the base64 encoding the client saved.
+       */
+      if (Stream == STREAM_UNIX_ATTRIBUTES_COMPACT) {
+        Stream = STREAM_UNIX_ATTRIBUTES;
+        if (!jcr->impl->lstat_text) {
+          jcr->impl->lstat_text = GetPoolMemory(PM_NAME);
+        }
+        if (CompactStatToText(attr, jcr->impl->lstat_text)) {
+          attr = jcr->impl->lstat_text;
+        } else {
+          Jmsg1(jcr, M_ERROR, 0, _("Invalid compact attributes for %s\n"),
+                fname);
+        }
+      }
+
       Dmsg2(400, "dird<stored: stream=%d %s\n", Stream, fname);
       Dmsg1(400, "dird<stored: attr=%s\n", attr);
 
@@ -631,6 +653,14 @@ static void UpdateAttribute(JobControlRecord* jcr,
               len = CRYPTO_DIGEST_SHA512_SIZE;
               type = CRYPTO_DIGEST_SHA512;
               break;
+            case STREAM_BLAKE3_DIGEST:
+              len = CRYPTO_DIGEST_BLAKE3_SIZE;
+              type = CRYPTO_DIGEST_BLAKE3;
+              break;
+            case STREAM_XXH128_DIGEST:
+              len = CRYPTO_DIGEST_XXH128_SIZE;
+              type = CRYPTO_DIGEST_XXH128;
+              break;
             default:
               /*
                * Never reached ...
@@ -705,6 +735,31 @@ bail_out:
  * the storage daemon spool file. We receive the filename and
  * we try to read it.
  */
+/**
+ * Read the messages of a compressed attribute spool file.
+ */
+static bool DespoolCompressedAttributes(JobControlRecord* jcr,
+                                        int spool_fd,
+                                        POOLMEM*& msg)
+{
+  int32_t message_length;
+  AttrSpoolReader reader(spool_fd);
+
+  while (reader.Next(msg, &message_length)) {
+    if (!jcr->IsJobCanceled()) {
+      UpdateAttribute(jcr, msg, message_length);
+      if (jcr->IsJobCanceled()) { return false; }
+    }
+  }
+
+  if (reader.Error()) {
+    Qmsg(jcr, M_FATAL, 0, _("Error reading compressed attr spool file.\n"));
+    return false;
+  }
+
+  return true;
+}
+
 bool DespoolAttributesFromFile(JobControlRecord* jcr, const char* file)
 {
   bool retval = false;
@@ -733,6 +788,11 @@ bool DespoolAttributesFromFile(JobControlRecord* jcr, const char* file)
   posix_fadvise(spool_fd, 0, 0, POSIX_FADV_WILLNEED);
 #endif
 
+  if (IsCompressedAttrSpool(spool_fd)) {
+    retval = DespoolCompressedAttributes(jcr, spool_fd, msg);
+    goto bail_out;
+  }
+
   while ((nbytes = read(spool_fd, (char*)&pktsiz, sizeof(int32_t))) ==
          sizeof(int32_t)) {
     size += sizeof(int32_t);
@@ -595,11 +595,8 @@ bool DoReloadConfig()
     resource_table_reference temp_config;
     temp_config.res_table = my_config->SaveResources();
 
-    int num_rcodes = my_config->r_last_ - my_config->r_first_ + 1;
-    for (int i = 0; i < num_rcodes; i++) {
-      // restore original config
-      my_config->res_head_[i] = prev_config.res_table[i];
-    }
+    // restore original config
+    my_config->RestoreResources(prev_config.res_table);
 
     // me is changed above by CheckResources()
     me = (DirectorResource*)my_config->GetNextRes(R_DIRECTOR, NULL);
@@ -633,6 +630,11 @@ bool DoReloadConfig()
     SetWorkingDirectory(me->working_directory);
     Dmsg0(10, "Director's configuration file reread.\n");
 
+    /*
+     * Concurrency limits may have changed, let waiting jobs try again
+     */
+    JobServerResourcesChanged();
+
     if (num_running_jobs > 0) {
       if (!reload_table) { reload_table = new alist(10, not_owned_by_alist); }
       reload_table->push(new_table);
@@ -224,6 +224,7 @@ struct runtime_job_status_t {
 #define FD_VERSION_52 52
 #define FD_VERSION_53 53
 #define FD_VERSION_54 54
+#define FD_VERSION_55 55
 
 bool DoReloadConfig();
 
@@ -161,6 +161,8 @@ static ResourceItem dir_items[] = {
   { "SecureEraseCommand", CFG_TYPE_STR, ITEM(res_dir, secure_erase_cmdline), 0, 0, NULL, "15.2.1-",
      "Specify command that will be called when bareos unlinks files." },
   { "LogTimestampFormat", CFG_TYPE_STR, ITEM(res_dir, log_timestamp_format), 0, 0, NULL, "15.2.3-", NULL },
+  { "JobFileIndexCache", CFG_TYPE_BOOL, ITEM(res_dir, job_file_index_cache), 0, CFG_ITEM_DEFAULT, "false", "20.0.0-",
+     "Keep a file index of every terminated job in the Working Directory and build the restore tree from it instead of querying the catalog." },
    TLS_COMMON_CONFIG(res_dir),
    TLS_CERT_CONFIG(res_dir),
   {nullptr, 0, 0, nullptr, 0, 0, nullptr, nullptr, nullptr}
@@ -432,6 +434,8 @@ ResourceItem job_items[] = {
   { "CancelRunningDuplicates", CFG_TYPE_BOOL, ITEM(res_job, CancelRunningDuplicates), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL },
   { "SaveFileHistory", CFG_TYPE_BOOL, ITEM(res_job, SaveFileHist), 0, CFG_ITEM_DEFAULT, "true", "14.2.0-", NULL },
   { "FileHistorySize", CFG_TYPE_SIZE64, ITEM(res_job, FileHistSize), 0, CFG_ITEM_DEFAULT, "10000000", "15.2.4-", NULL },
+  { "CompactAttributes", CFG_TYPE_BOOL, ITEM(res_job, CompactAttributes), 0, CFG_ITEM_DEFAULT, "false", "20.0.0-",
+     "Let the client send file attributes in a compact binary encoding. This only reduces the size of the attributes on the network and on the volumes: they are converted to the regular encoding before they are stored in the catalog, so Accurate jobs and BVFS work as before. Volumes written this way can only be read by Storage Daemons and tools (bls, bextract, bscan) of version 20 or later." },
   { "PluginOptions", CFG_TYPE_ALIST_STR, ITEM(res_job, FdPluginOptions), 0, CFG_ITEM_DEPRECATED | CFG_ITEM_ALIAS, NULL, "-12.4.0", NULL },
   { "FdPluginOptions", CFG_TYPE_ALIST_STR, ITEM(res_job, FdPluginOptions), 0, 0, NULL, NULL, NULL },
   { "SdPluginOptions", CFG_TYPE_ALIST_STR, ITEM(res_job, SdPluginOptions), 0, 0, NULL, NULL, NULL },
@@ -2051,6 +2055,14 @@ bool FilesetResource::PrintConfig(PoolMem& buff,
                 p++;
                 break;
 #endif
+              case '4':
+                IndentConfigItem(cfg_str, 3, "Signature = BLAKE3\n");
+                p++;
+                break;
+              case '5':
+                IndentConfigItem(cfg_str, 3, "Signature = XXH128\n");
+                p++;
+                break;
               default:
                 IndentConfigItem(cfg_str, 3, "Signature = SHA1\n");
                 break;
@@ -2149,6 +2161,9 @@ bool FilesetResource::PrintConfig(PoolMem& buff,
           case 'X':
             IndentConfigItem(cfg_str, 3, "XattrSupport = Yes\n");
             break;
+          case 'D':
+            IndentConfigItem(cfg_str, 3, "AclXattrDeduplication = Yes\n");
+            break;
           case 'x':
             IndentConfigItem(cfg_str, 3, "AutoExclude = No\n");
             break;
@@ -2736,36 +2751,13 @@ static void StoreActiononpurge(LEX* lc, ResourceItem* item, int index, int pass)
  */
 static void StoreDevice(LEX* lc, ResourceItem* item, int index, int pass)
 {
-  int rindex = R_DEVICE - R_FIRST;
-
   if (pass == 1) {
     LexGetToken(lc, BCT_NAME);
-    if (!res_head[rindex]) {
+    if (!my_config->GetResWithName(R_DEVICE, lc->str, false)) {
       DeviceResource* device_resource = new DeviceResource;
       device_resource->rcode_ = R_DEVICE;
       device_resource->resource_name_ = strdup(lc->str);
-      res_head[rindex] = device_resource; /* store first entry */
-      Dmsg3(900, "Inserting first %s res: %s index=%d\n",
-            my_config->ResToStr(R_DEVICE), device_resource->resource_name_,
-            rindex);
-    } else {
-      bool found = false;
-      BareosResource* next;
-      for (next = res_head[rindex]; next->next_; next = next->next_) {
-        if (bstrcmp(next->resource_name_, lc->str)) {
-          found = true;  // already defined
-          break;
-        }
-      }
-      if (!found) {
-        DeviceResource* device_resource = new DeviceResource;
-        device_resource->rcode_ = R_DEVICE;
-        device_resource->resource_name_ = strdup(lc->str);
-        next->next_ = device_resource;
-        Dmsg4(900, "Inserting %s res: %s index=%d pass=%d\n",
-              my_config->ResToStr(R_DEVICE), device_resource->resource_name_,
-              rindex, pass);
-      }
+      my_config->AppendToResourcesChain(device_resource, R_DEVICE);
     }
 
     ScanToEol(lc);
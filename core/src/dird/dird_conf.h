@@ -149,6 +149,7 @@ class DirectorResource
                          dumping the config */
   bool ndmp_snooping = false; /* NDMP Protocol specific snooping enabled */
   bool auditing = false;      /* Auditing enabled */
+  bool job_file_index_cache = false; /* Cache the file index of jobs */
   alist* audit_events = nullptr;   /* Specific audit events to enable */
   uint32_t ndmp_loglevel = 0;      /* NDMP Protocol specific loglevel to use */
   uint32_t subscriptions = 0;      /* Number of subscribtions available */
@@ -532,6 +533,7 @@ class JobResource : public BareosResource {
   bool IgnoreDuplicateJobChecking = false; /**< Ignore Duplicate Job Checking */
   bool SaveFileHist = false; /**< Ability to disable File history saving for certain protocols */
   bool AlwaysIncremental = false; /**< Always incremental with regular consolidation */
+  bool CompactAttributes = false; /**< Client sends compact binary stat packets */
 
   runtime_job_status_t* rjs = nullptr; /**< Runtime Job Status */
 
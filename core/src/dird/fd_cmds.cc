@@ -75,6 +75,7 @@ static char restoreobjectendcmd[] = "restoreobject end\n";
 static char bandwidthcmd[] = "setbandwidth=%lld Job=%s\n";
 static char pluginoptionscmd[] = "pluginoptions %s\n";
 static char getSecureEraseCmd[] = "getSecureEraseCmd\n";
+static char compactattributescmd[] = "compactattributes\n";
 
 /* Responses received from File daemon */
 static char OKinc[] = "2000 OK include\n";
@@ -86,6 +87,7 @@ static char OKRestoreObject[] = "2000 OK ObjectRestored\n";
 static char OKBandwidth[] = "2000 OK Bandwidth\n";
 static char OKPluginOptions[] = "2000 OK PluginOptions\n";
 static char OKgetSecureEraseCmd[] = "2000 OK FDSecureEraseCmd %s\n";
+static char OKCompactAttributes[] = "2000 OK compactattributes\n";
 
 /* Forward referenced functions */
 static bool SendListItem(JobControlRecord* jcr,
@@ -439,6 +441,26 @@ bool SendBwlimitToFd(JobControlRecord* jcr, const char* Job)
   return true;
 }
 
+/**
+ * Ask the File daemon to send the stat packets of this job in the compact
+ * binary encoding. They are converted back to the text form before they
+ * are stored in the catalog, see UpdateAttribute().
+ */
+bool SendCompactAttributesToFd(JobControlRecord* jcr)
+{
+  BareosSocket* fd = jcr->file_bsock;
+
+  if (jcr->impl->FDVersion >= FD_VERSION_55) {
+    fd->fsend(compactattributescmd);
+    if (!response(jcr, fd, OKCompactAttributes, "CompactAttributes",
+                  DISPLAY_ERROR)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 bool SendSecureEraseReqToFd(JobControlRecord* jcr)
 {
   int32_t n;
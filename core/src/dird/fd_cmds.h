@@ -35,6 +35,7 @@ bool SendExcludeList(JobControlRecord* jcr);
 bool SendLevelCommand(JobControlRecord* jcr);
 bool SendBwlimitToFd(JobControlRecord* jcr, const char* Job);
 bool SendSecureEraseReqToFd(JobControlRecord* jcr);
+bool SendCompactAttributesToFd(JobControlRecord* jcr);
 bool SendPreviousRestoreObjects(JobControlRecord* jcr);
 int GetAttributesAndPutInCatalog(JobControlRecord* jcr);
 void GetAttributesAndCompareToCatalog(JobControlRecord* jcr, JobId_t JobId);
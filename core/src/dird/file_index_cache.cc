@@ -0,0 +1,579 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Per job file index cache used to build the restore tree.
+ */
+
+#include "include/bareos.h"
+#include "dird.h"
+#include "dird/dird_globals.h"
+#include "dird/file_index_cache.h"
+#include "dird/ua.h"
+#include "lib/berrno.h"
+#include "lib/edit.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <queue>
+
+namespace directordaemon {
+
+static const int dbglvl = 100;
+
+static const char file_index_magic[8] = {'B', 'F', 'I', 'D', 'X', 0, 0, 0};
+static const uint32_t file_index_version = 1;
+
+struct JobFileIndex::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t JobId;
+  int64_t JobTDate;
+  uint64_t JobFiles;
+  uint64_t strings_size;
+};
+
+/* Size of the columns of one record. */
+static const size_t record_size =
+    2 * sizeof(int64_t) + 3 * sizeof(uint32_t) + 2 * sizeof(int32_t);
+
+JobFileIndex::~JobFileIndex() { Unmap(); }
+
+void JobFileIndex::Unmap()
+{
+  if (map_) {
+    munmap(map_, map_length_);
+    map_ = nullptr;
+    map_length_ = 0;
+  }
+}
+
+JobId_t JobFileIndex::JobId() const
+{
+  return header_ ? (JobId_t)header_->JobId : 0;
+}
+
+utime_t JobFileIndex::JobTDate() const
+{
+  return header_ ? (utime_t)header_->JobTDate : 0;
+}
+
+uint32_t JobFileIndex::size() const { return header_ ? header_->count : 0; }
+
+template <typename T>
+static void AppendColumn(std::vector<char>& buffer, const std::vector<T>& v)
+{
+  const char* data = reinterpret_cast<const char*>(v.data());
+
+  buffer.insert(buffer.end(), data, data + v.size() * sizeof(T));
+}
+
+bool JobFileIndex::Build(JobId_t JobId,
+                         utime_t JobTDate,
+                         uint32_t JobFiles,
+                         std::vector<JobFileRecord>& records)
+{
+  Header header;
+  std::vector<int64_t> fhinfo, fhnode;
+  std::vector<uint32_t> path, name, lstat;
+  std::vector<int32_t> file_index, delta_seq;
+  std::vector<char> strings;
+  uint32_t empty;
+  const std::string* last_path = nullptr;
+  uint32_t last_path_offset = 0;
+
+  std::sort(records.begin(), records.end(),
+            [](const JobFileRecord& a, const JobFileRecord& b) {
+              int cmp = a.path.compare(b.path);
+
+              if (cmp == 0) { cmp = a.name.compare(b.name); }
+              if (cmp == 0) { return a.DeltaSeq < b.DeltaSeq; }
+              return cmp < 0;
+            });
+
+  /*
+   * Strings are stored NUL terminated, paths only once as the records
+   * are sorted by path.
+   */
+  auto AddString = [&strings](const std::string& s) {
+    uint32_t offset = strings.size();
+
+    strings.insert(strings.end(), s.begin(), s.end());
+    strings.push_back('\0');
+    return offset;
+  };
+
+  empty = AddString(std::string());
+  for (const auto& r : records) {
+    if (!last_path || *last_path != r.path) {
+      last_path_offset = AddString(r.path);
+      last_path = &r.path;
+    }
+    fhinfo.push_back(r.fhinfo);
+    fhnode.push_back(r.fhnode);
+    path.push_back(last_path_offset);
+    name.push_back(r.name.empty() ? empty : AddString(r.name));
+    file_index.push_back(r.FileIndex);
+    delta_seq.push_back(r.DeltaSeq);
+    lstat.push_back(AddString(r.lstat));
+  }
+
+  /* Offsets are 32 bit, such jobs are left to the catalog. */
+  if (strings.size() > UINT32_MAX || records.size() > UINT32_MAX) {
+    return false;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, file_index_magic, sizeof(header.magic));
+  header.version = file_index_version;
+  header.count = records.size();
+  header.JobId = JobId;
+  header.JobTDate = JobTDate;
+  header.JobFiles = JobFiles;
+  header.strings_size = strings.size();
+
+  Unmap();
+  buffer_.clear();
+  buffer_.reserve(sizeof(header) + records.size() * record_size +
+                  strings.size());
+  buffer_.insert(buffer_.end(), reinterpret_cast<const char*>(&header),
+                 reinterpret_cast<const char*>(&header) + sizeof(header));
+  AppendColumn(buffer_, fhinfo);
+  AppendColumn(buffer_, fhnode);
+  AppendColumn(buffer_, path);
+  AppendColumn(buffer_, name);
+  AppendColumn(buffer_, file_index);
+  AppendColumn(buffer_, delta_seq);
+  AppendColumn(buffer_, lstat);
+  AppendColumn(buffer_, strings);
+
+  return Attach(buffer_.data(), buffer_.size());
+}
+
+bool JobFileIndex::Attach(const char* data, size_t length)
+{
+  const Header* header = reinterpret_cast<const Header*>(data);
+  const char* p = data + sizeof(Header);
+  uint64_t count;
+
+  header_ = nullptr;
+  if (length < sizeof(Header)) { return false; }
+  if (memcmp(header->magic, file_index_magic, sizeof(header->magic)) != 0 ||
+      header->version != file_index_version) {
+    return false;
+  }
+
+  count = header->count;
+  if (header->strings_size == 0 ||
+      length != sizeof(Header) + count * record_size + header->strings_size) {
+    return false;
+  }
+
+  fhinfo_ = reinterpret_cast<const int64_t*>(p);
+  p += count * sizeof(int64_t);
+  fhnode_ = reinterpret_cast<const int64_t*>(p);
+  p += count * sizeof(int64_t);
+  path_ = reinterpret_cast<const uint32_t*>(p);
+  p += count * sizeof(uint32_t);
+  name_ = reinterpret_cast<const uint32_t*>(p);
+  p += count * sizeof(uint32_t);
+  file_index_ = reinterpret_cast<const int32_t*>(p);
+  p += count * sizeof(int32_t);
+  delta_seq_ = reinterpret_cast<const int32_t*>(p);
+  p += count * sizeof(int32_t);
+  lstat_ = reinterpret_cast<const uint32_t*>(p);
+  p += count * sizeof(uint32_t);
+  strings_ = p;
+
+  /*
+   * Make sure every string is inside the heap and terminated.
+   */
+  if (strings_[header->strings_size - 1] != '\0') { return false; }
+  for (uint64_t i = 0; i < count; i++) {
+    if (path_[i] >= header->strings_size || name_[i] >= header->strings_size ||
+        lstat_[i] >= header->strings_size) {
+      return false;
+    }
+  }
+
+  header_ = header;
+  return true;
+}
+
+bool JobFileIndex::Save(const char* filename) const
+{
+  static std::atomic<uint32_t> uniq{0};
+  PoolMem tmpname(PM_FNAME);
+  const char* data = buffer_.data();
+  size_t length = buffer_.size();
+  int fd;
+
+  if (!header_ || map_) { return false; }
+
+  Mmsg(tmpname, "%s.%d.%u.tmp", filename, (int)getpid(), uniq++);
+  fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0600);
+  if (fd < 0) {
+    BErrNo be;
+
+    Dmsg2(dbglvl, "Cannot create %s: ERR=%s\n", tmpname.c_str(),
+          be.bstrerror());
+    return false;
+  }
+
+  while (length > 0) {
+    ssize_t n = write(fd, data, length);
+
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n <= 0) {
+      BErrNo be;
+
+      Dmsg2(dbglvl, "Cannot write %s: ERR=%s\n", tmpname.c_str(),
+            be.bstrerror());
+      close(fd);
+      unlink(tmpname.c_str());
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+
+  if (close(fd) < 0 || rename(tmpname.c_str(), filename) < 0) {
+    unlink(tmpname.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool JobFileIndex::Load(const char* filename,
+                        JobId_t JobId,
+                        utime_t JobTDate,
+                        uint32_t JobFiles)
+{
+  struct stat st;
+  void* map;
+  int fd;
+
+  Unmap();
+  buffer_.clear();
+  header_ = nullptr;
+
+  fd = open(filename, O_RDONLY | O_BINARY);
+  if (fd < 0) { return false; }
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+
+  map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) { return false; }
+  map_ = map;
+  map_length_ = st.st_size;
+
+  if (!Attach(static_cast<const char*>(map_), map_length_) ||
+      header_->JobId != JobId || header_->JobTDate != JobTDate ||
+      header_->JobFiles != JobFiles) {
+    Dmsg1(dbglvl, "File index %s is not valid\n", filename);
+    header_ = nullptr;
+    Unmap();
+    return false;
+  }
+
+  return true;
+}
+
+namespace {
+
+struct Cursor {
+  uint32_t job;
+  uint32_t pos;
+};
+
+struct Selected {
+  uint32_t job;
+  uint32_t pos;
+  int32_t FileIndex;
+};
+
+}  // namespace
+
+static int CompareRecords(const std::vector<const JobFileIndex*>& indexes,
+                          const Cursor& a,
+                          const Cursor& b)
+{
+  const JobFileIndex* ia = indexes[a.job];
+  const JobFileIndex* ib = indexes[b.job];
+  int cmp;
+
+  cmp = strcmp(ia->Path(a.pos), ib->Path(b.pos));
+  if (cmp == 0) { cmp = strcmp(ia->Name(a.pos), ib->Name(b.pos)); }
+  if (cmp == 0) {
+    int32_t da = ia->DeltaSeq(a.pos), db = ib->DeltaSeq(b.pos);
+
+    cmp = (da < db) ? -1 : (da > db);
+  }
+  return cmp;
+}
+
+void MergeJobFileIndexes(const std::vector<const JobFileIndex*>& indexes,
+                         DB_RESULT_HANDLER* ResultHandler,
+                         void* ctx)
+{
+  auto after = [&indexes](const Cursor& a, const Cursor& b) {
+    int cmp = CompareRecords(indexes, a, b);
+
+    return cmp > 0 || (cmp == 0 && a.job > b.job);
+  };
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(after)> heap(
+      after);
+  std::vector<Cursor> group;
+  std::vector<Selected> selected;
+  PoolMem path(PM_FNAME), name(PM_FNAME), lstat(PM_MESSAGE);
+  char file_index[50], job_id[50], delta_seq[50], fhinfo[50], fhnode[50];
+  char* row[8];
+
+  for (uint32_t i = 0; i < indexes.size(); i++) {
+    if (indexes[i]->size() > 0) { heap.push(Cursor{i, 0}); }
+  }
+
+  /*
+   * Visit the records ordered by Path, Name and DeltaSeq and keep the
+   * records of the most recent job having the key, like the
+   * select_recent_version_with_basejob_and_delta query does.
+   */
+  while (!heap.empty()) {
+    Cursor first = heap.top();
+    uint32_t newest = 0;
+
+    group.clear();
+    while (!heap.empty() && CompareRecords(indexes, first, heap.top()) == 0) {
+      Cursor c = heap.top();
+
+      heap.pop();
+      group.push_back(c);
+      newest = std::max(newest, c.job);
+      if (c.pos + 1 < indexes[c.job]->size()) {
+        heap.push(Cursor{c.job, c.pos + 1});
+      }
+    }
+
+    for (const auto& c : group) {
+      int32_t FileIndex = indexes[c.job]->FileIndex(c.pos);
+
+      if (c.job == newest && FileIndex > 0) {
+        selected.push_back(Selected{c.job, c.pos, FileIndex});
+      }
+    }
+  }
+
+  /*
+   * The restore code wants the files ordered by job and FileIndex.
+   */
+  std::stable_sort(selected.begin(), selected.end(),
+                   [](const Selected& a, const Selected& b) {
+                     if (a.job != b.job) { return a.job < b.job; }
+                     return a.FileIndex < b.FileIndex;
+                   });
+
+  /*
+   * The handler may modify the strings, so hand over copies.
+   */
+  row[0] = nullptr;
+  row[1] = nullptr;
+  row[2] = file_index;
+  row[3] = job_id;
+  row[4] = nullptr;
+  row[5] = delta_seq;
+  row[6] = fhinfo;
+  row[7] = fhnode;
+  for (const auto& s : selected) {
+    const JobFileIndex* index = indexes[s.job];
+
+    PmStrcpy(path, index->Path(s.pos));
+    PmStrcpy(name, index->Name(s.pos));
+    PmStrcpy(lstat, index->LStat(s.pos));
+    row[0] = path.c_str();
+    row[1] = name.c_str();
+    row[4] = lstat.c_str();
+    edit_int64(s.FileIndex, file_index);
+    edit_uint64(index->JobId(), job_id);
+    edit_int64(index->DeltaSeq(s.pos), delta_seq);
+    edit_int64(index->Fhinfo(s.pos), fhinfo);
+    edit_int64(index->Fhnode(s.pos), fhnode);
+    if (ResultHandler(ctx, 8, row)) { break; }
+  }
+}
+
+namespace {
+
+struct CachedJob {
+  JobId_t JobId{0};
+  utime_t JobTDate{0};
+  uint32_t JobFiles{0};
+  int JobStatus{0};
+  bool PurgedFiles{false};
+  bool HasBase{false};
+};
+
+}  // namespace
+
+static int CachedJobHandler(void* ctx, int num_fields, char** row)
+{
+  std::vector<CachedJob>* jobs = static_cast<std::vector<CachedJob>*>(ctx);
+  CachedJob job;
+
+  job.JobId = str_to_int64(row[0]);
+  job.JobTDate = str_to_int64(row[1]);
+  job.JobFiles = str_to_int64(row[2]);
+  job.JobStatus = row[3] ? row[3][0] : 0;
+  job.PurgedFiles = str_to_int64(row[4]) != 0;
+  job.HasBase = str_to_int64(row[5]) != 0;
+  jobs->push_back(job);
+  return 0;
+}
+
+/* row[0]=Path row[1]=Name row[2]=FileIndex row[3]=DeltaSeq row[4]=LStat
+ * row[5]=Fhinfo row[6]=Fhnode */
+static int JobFileRecordHandler(void* ctx, int num_fields, char** row)
+{
+  std::vector<JobFileRecord>* records =
+      static_cast<std::vector<JobFileRecord>*>(ctx);
+  JobFileRecord r;
+
+  r.path = row[0];
+  r.name = row[1];
+  r.FileIndex = str_to_int64(row[2]);
+  r.DeltaSeq = str_to_int64(row[3]);
+  r.lstat = row[4];
+  r.fhinfo = str_to_int64(row[5]);
+  r.fhnode = str_to_int64(row[6]);
+  records->push_back(std::move(r));
+  return 0;
+}
+
+static void JobFileIndexName(UaContext* ua, JobId_t JobId, PoolMem& fname)
+{
+  Mmsg(fname, "%s/%s.%s.%u.findex", me->working_directory, my_name,
+       ua->db->get_db_name(), JobId);
+}
+
+bool GetFileListFromIndexCache(UaContext* ua,
+                               const char* jobids,
+                               DB_RESULT_HANDLER* ResultHandler,
+                               void* ctx)
+{
+  std::vector<CachedJob> jobs;
+  std::vector<std::unique_ptr<JobFileIndex>> indexes;
+  std::vector<const JobFileIndex*> merge;
+  std::vector<JobId_t> wanted;
+  PoolMem query(PM_MESSAGE), fname(PM_FNAME);
+  char ed1[50];
+  JobId_t JobId;
+  char* p;
+
+  if (!me->job_file_index_cache || !*jobids) { return false; }
+
+  PmStrcpy(query, jobids);
+  p = query.c_str();
+  while (GetNextJobidFromList(&p, &JobId) > 0) { wanted.push_back(JobId); }
+  std::sort(wanted.begin(), wanted.end());
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+  Mmsg(query,
+       "SELECT JobId, JobTDate, JobFiles, JobStatus, PurgedFiles, HasBase "
+       "FROM Job WHERE JobId IN (%s)",
+       jobids);
+  if (!ua->db->SqlQuery(query.c_str(), CachedJobHandler, &jobs)) {
+    return false;
+  }
+
+  /*
+   * Base jobs need the BaseFiles table, leave them to the catalog.
+   */
+  if (jobs.size() != wanted.size()) { return false; }
+  for (const auto& job : jobs) {
+    if (job.HasBase) { return false; }
+  }
+
+  std::sort(jobs.begin(), jobs.end(),
+            [](const CachedJob& a, const CachedJob& b) {
+              if (a.JobTDate != b.JobTDate) { return a.JobTDate < b.JobTDate; }
+              return a.JobId < b.JobId;
+            });
+
+  for (const auto& job : jobs) {
+    std::unique_ptr<JobFileIndex> index(new JobFileIndex);
+    bool cacheable = (job.JobStatus == JS_Terminated ||
+                      job.JobStatus == JS_Warnings) &&
+                     !job.PurgedFiles;
+
+    JobFileIndexName(ua, job.JobId, fname);
+    if (!cacheable ||
+        !index->Load(fname.c_str(), job.JobId, job.JobTDate, job.JobFiles)) {
+      std::vector<JobFileRecord> records;
+
+      Mmsg(query,
+           "SELECT Path.Path, File.Name, File.FileIndex, File.DeltaSeq, "
+           "File.LStat, File.Fhinfo, File.Fhnode "
+           "FROM File JOIN Path USING (PathId) WHERE File.JobId=%s",
+           edit_uint64(job.JobId, ed1));
+      if (!ua->db->BigSqlQuery(query.c_str(), JobFileRecordHandler,
+                               &records)) {
+        return false;
+      }
+      if (!index->Build(job.JobId, job.JobTDate, job.JobFiles, records)) {
+        return false;
+      }
+      if (cacheable && !index->Save(fname.c_str())) {
+        Dmsg1(dbglvl, "Cannot save file index %s\n", fname.c_str());
+      }
+      Dmsg2(dbglvl, "Built file index of JobId %s with %u records\n", ed1,
+            index->size());
+    }
+    merge.push_back(index.get());
+    indexes.push_back(std::move(index));
+  }
+
+  MergeJobFileIndexes(merge, ResultHandler, ctx);
+
+  return true;
+}
+
+void RemoveJobFileIndexes(UaContext* ua, const char* jobids)
+{
+  PoolMem list(PM_MESSAGE), fname(PM_FNAME);
+  JobId_t JobId;
+  char* p;
+
+  PmStrcpy(list, jobids);
+  p = list.c_str();
+  while (GetNextJobidFromList(&p, &JobId) > 0) {
+    JobFileIndexName(ua, JobId, fname);
+    unlink(fname.c_str());
+  }
+}
+
+} /* namespace directordaemon */
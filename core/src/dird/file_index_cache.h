@@ -0,0 +1,159 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Per job file index cache used to build the restore tree.
+ *
+ * Building the restore tree with GetFileList() joins the File and Path
+ * tables of all jobs of the restore chain and selects the most recent
+ * version of every file, which takes very long for clients with many
+ * files. The file index of a job never changes once the job has
+ * terminated, so it is kept in a compact file in the working directory
+ * and the most recent versions are selected by merging the sorted
+ * indexes of the jobs.
+ *
+ * The index file of a job consists of a header followed by the columns
+ *
+ *   int64_t  Fhinfo[count]
+ *   int64_t  Fhnode[count]
+ *   uint32_t Path[count]      offset in the string heap
+ *   uint32_t Name[count]      offset in the string heap
+ *   int32_t  FileIndex[count]
+ *   int32_t  DeltaSeq[count]
+ *   uint32_t LStat[count]     offset in the string heap
+ *   char     strings[strings_size]
+ *
+ * in host byte order, with the records sorted by Path, Name and DeltaSeq.
+ * It is memory mapped when read.
+ */
+
+#ifndef BAREOS_DIRD_FILE_INDEX_CACHE_H_
+#define BAREOS_DIRD_FILE_INDEX_CACHE_H_
+
+#include "cats/cats.h"
+
+#include <string>
+#include <vector>
+
+namespace directordaemon {
+
+class UaContext;
+
+/* A file record of a job as read from the catalog. */
+struct JobFileRecord {
+  std::string path;
+  std::string name;
+  int32_t FileIndex{0};
+  int32_t DeltaSeq{0};
+  std::string lstat;
+  int64_t fhinfo{0};
+  int64_t fhnode{0};
+};
+
+class JobFileIndex {
+ public:
+  JobFileIndex() = default;
+  ~JobFileIndex();
+  JobFileIndex(const JobFileIndex&) = delete;
+  JobFileIndex& operator=(const JobFileIndex&) = delete;
+
+  /*
+   * Build the index of a job in memory, the records get sorted.
+   */
+  bool Build(JobId_t JobId,
+             utime_t JobTDate,
+             uint32_t JobFiles,
+             std::vector<JobFileRecord>& records);
+
+  /*
+   * Write the index to a file, atomically replacing an existing one.
+   */
+  bool Save(const char* filename) const;
+
+  /*
+   * Map the index file of a job, fails if it does not exist, is damaged
+   * or belongs to another incarnation of the job.
+   */
+  bool Load(const char* filename,
+            JobId_t JobId,
+            utime_t JobTDate,
+            uint32_t JobFiles);
+
+  JobId_t JobId() const;
+  utime_t JobTDate() const;
+  uint32_t size() const;
+
+  const char* Path(uint32_t i) const { return strings_ + path_[i]; }
+  const char* Name(uint32_t i) const { return strings_ + name_[i]; }
+  const char* LStat(uint32_t i) const { return strings_ + lstat_[i]; }
+  int32_t FileIndex(uint32_t i) const { return file_index_[i]; }
+  int32_t DeltaSeq(uint32_t i) const { return delta_seq_[i]; }
+  int64_t Fhinfo(uint32_t i) const { return fhinfo_[i]; }
+  int64_t Fhnode(uint32_t i) const { return fhnode_[i]; }
+
+ private:
+  struct Header;
+
+  bool Attach(const char* data, size_t length);
+  void Unmap();
+
+  std::vector<char> buffer_;
+  void* map_{nullptr};
+  size_t map_length_{0};
+
+  const Header* header_{nullptr};
+  const int64_t* fhinfo_{nullptr};
+  const int64_t* fhnode_{nullptr};
+  const uint32_t* path_{nullptr};
+  const uint32_t* name_{nullptr};
+  const int32_t* file_index_{nullptr};
+  const int32_t* delta_seq_{nullptr};
+  const uint32_t* lstat_{nullptr};
+  const char* strings_{nullptr};
+};
+
+/*
+ * Select the most recent version of every file from the indexes, which
+ * must be ordered from the oldest to the most recent job, and pass them
+ * to ResultHandler like GetFileList() with delta parts and without MD5.
+ */
+void MergeJobFileIndexes(const std::vector<const JobFileIndex*>& indexes,
+                         DB_RESULT_HANDLER* ResultHandler,
+                         void* ctx);
+
+/*
+ * GetFileList() for the restore tree using the file index cache. Returns
+ * false without calling ResultHandler when the cache is disabled or cannot
+ * be used for the jobs, the caller then has to query the catalog.
+ */
+bool GetFileListFromIndexCache(UaContext* ua,
+                               const char* jobids,
+                               DB_RESULT_HANDLER* ResultHandler,
+                               void* ctx);
+
+/*
+ * Remove the cached file indexes of the jobs, called when their file
+ * records are purged.
+ */
+void RemoveJobFileIndexes(UaContext* ua, const char* jobids);
+
+} /* namespace directordaemon */
+#endif  // BAREOS_DIRD_FILE_INDEX_CACHE_H_
@@ -94,7 +94,8 @@ enum
   INC_KW_SIZE,
   INC_KW_SHADOWING,
   INC_KW_AUTO_EXCLUDE,
-  INC_KW_FORCE_ENCRYPTION
+  INC_KW_FORCE_ENCRYPTION,
+  INC_KW_ACL_XATTR_DEDUP
 };
 
 /*
@@ -133,6 +134,7 @@ static struct s_kw FS_option_kw[] = {
     {"shadowing", INC_KW_SHADOWING},
     {"autoexclude", INC_KW_AUTO_EXCLUDE},
     {"forceencryption", INC_KW_FORCE_ENCRYPTION},
+    {"aclxattrdeduplication", INC_KW_ACL_XATTR_DEDUP},
     {NULL, 0}};
 
 /*
@@ -155,6 +157,8 @@ static struct s_fs_opt FS_options[] = {
     {"sha1", INC_KW_DIGEST, "S"},
     {"sha256", INC_KW_DIGEST, "S2"},
     {"sha512", INC_KW_DIGEST, "S3"},
+    {"blake3", INC_KW_DIGEST, "S4"},
+    {"xxh128", INC_KW_DIGEST, "S5"},
     {"gzip", INC_KW_COMPRESSION, "Z6"},
     {"gzip1", INC_KW_COMPRESSION, "Z1"},
     {"gzip2", INC_KW_COMPRESSION, "Z2"},
@@ -179,6 +183,9 @@ static struct s_fs_opt FS_options[] = {
     {"camellia256", INC_KW_ENCRYPTION, "Ec3"},
     {"aes128hmacsha1", INC_KW_ENCRYPTION, "Eh1"},
     {"aes256hmacsha1", INC_KW_ENCRYPTION, "Eh2"},
+    {"aes128gcm", INC_KW_ENCRYPTION, "Eg1"},
+    {"aes256gcm", INC_KW_ENCRYPTION, "Eg2"},
+    {"chacha20poly1305", INC_KW_ENCRYPTION, "Ep1"},
     {"yes", INC_KW_ONEFS, "0"},
     {"no", INC_KW_ONEFS, "f"},
     {"yes", INC_KW_RECURSE, "0"},
@@ -225,6 +232,8 @@ static struct s_fs_opt FS_options[] = {
     {"no", INC_KW_AUTO_EXCLUDE, "x"},
     {"yes", INC_KW_FORCE_ENCRYPTION, "Ef"},
     {"no", INC_KW_FORCE_ENCRYPTION, "0"},
+    {"yes", INC_KW_ACL_XATTR_DEDUP, "D"},
+    {"no", INC_KW_ACL_XATTR_DEDUP, "0"},
     {NULL, 0, 0}};
 
 /*
@@ -292,6 +301,7 @@ ResourceItem options_items[] = {
   { "Shadowing", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
   { "AutoExclude", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
   { "ForceEncryption", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
+  { "AclXattrDeduplication", CFG_TYPE_OPTION, 0, nullptr, 0, 0, NULL, NULL, NULL },
   { "Meta", CFG_TYPE_META, 0, nullptr, 0, 0, 0, NULL, NULL },
   { NULL, 0, 0, nullptr, 0, 0, NULL, NULL, NULL }
 };
@@ -130,6 +130,7 @@ struct JobControlRecordPrivate {
   POOLMEM* FDSecureEraseCmd{};          /**< Report: Secure Erase Command  */
   POOLMEM* SDSecureEraseCmd{};          /**< Report: Secure Erase Command  */
   POOLMEM* vf_jobids{};                 /**< JobIds to use for Virtual Full */
+  POOLMEM* lstat_text{};                /**< Text form of a compact stat packet */
   uint32_t replace{};                   /**< Replace option */
   int32_t NumVols{};                    /**< Number of Volume used in pool */
   int32_t reschedule_count{};           /**< Number of times rescheduled */
@@ -111,6 +111,13 @@ void InitJobServer(int max_workers)
 
 void TermJobServer() { JobqDestroy(&job_queue); /* ignore any errors */ }
 
+void GetJobQueueStatistics(jobq_statistics_t* stats)
+{
+  JobqGetStatistics(&job_queue, stats);
+}
+
+void JobServerResourcesChanged() { JobqResourcesChanged(&job_queue); }
+
 /**
  * Run a job -- typically called by the scheduler, but may also
  *              be called by the UA (Console program).
@@ -1581,6 +1588,7 @@ void DirdFreeJcrPointers(JobControlRecord* jcr)
   FreeAndNullPoolMemory(jcr->impl->client_uname);
   FreeAndNullPoolMemory(jcr->attr);
   FreeAndNullPoolMemory(jcr->impl->fname);
+  FreeAndNullPoolMemory(jcr->impl->lstat_text);
 }
 
 /**
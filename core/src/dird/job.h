@@ -30,6 +30,7 @@ class UaContext;
 class JobResource;
 class UnifiedStorageResource;
 class RunResource;
+struct jobq_statistics_t;
 
 bool AllowDuplicateJob(JobControlRecord* jcr);
 JobControlRecord* NewDirectorJcr();
@@ -59,6 +60,8 @@ bool RunConsoleCommand(JobControlRecord* jcr, const char* cmd);
 void SdMsgThreadSendSignal(JobControlRecord* jcr, int sig);
 void InitJobServer(int max_workers);
 void TermJobServer();
+void GetJobQueueStatistics(jobq_statistics_t* stats);
+void JobServerResourcesChanged();
 
 } /* namespace directordaemon */
 #endif  // BAREOS_DIRD_JOB_H_
@@ -40,23 +40,47 @@
 #include "lib/berrno.h"
 #include "lib/thread_specific_data.h"
 
+#include <map>
+
 namespace directordaemon {
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Number of times a concurrency slot of a client, storage or job was given
+ * back, indexed by the runtime status of the resource. A waiting job that
+ * found a resource busy is not examined again until that resource released
+ * a slot or the resources changed, so jobs blocked on one storage do not
+ * make every scan of the wait queue slow. Protected by mutex.
+ *
+ * A reload may raise concurrency limits and free or reuse runtime status
+ * objects, so it clears the map and bumps resource_changes, which makes
+ * every waiting job try again.
+ */
+static std::map<const void*, uint64_t> resource_releases;
+static uint64_t resource_changes = 0;
+
+/*
+ * Time after which a worker looks at waiting jobs again even if it was not
+ * woken up, resources are also released outside of the job queue.
+ */
+#define JOBQ_RECHECK_INTERVAL 2
+
 /* Forward referenced functions */
 extern "C" void* jobq_server(void* arg);
 extern "C" void* sched_wait(void* arg);
 
 static int StartServer(jobq_t* jq);
-static bool AcquireResources(JobControlRecord* jcr);
+static bool AcquireResources(JobControlRecord* jcr, jobq_item_t* je);
+static uint64_t ResourceReleases(const void* status);
+static bool ResourceStillBusy(const jobq_item_t* je);
 static bool RescheduleJob(JobControlRecord* jcr, jobq_t* jq, jobq_item_t* je);
 static bool IncClientConcurrency(JobControlRecord* jcr);
-static void DecClientConcurrency(JobControlRecord* jcr);
+static void DecClientConcurrency(JobControlRecord* jcr, bool release = true);
 static bool IncJobConcurrency(JobControlRecord* jcr);
 static void DecJobConcurrency(JobControlRecord* jcr);
 static bool IncWriteStore(JobControlRecord* jcr);
-static void DecWriteStore(JobControlRecord* jcr);
+static void DecWriteStore(JobControlRecord* jcr, bool release = true);
 
 /*
  * Initialize a job queue
@@ -99,6 +123,11 @@ int JobqInit(jobq_t* jq, int max_workers, void* (*engine)(void* arg))
   jq->max_workers = max_workers; /* max threads to create */
   jq->num_workers = 0;           /* no threads yet */
   jq->engine = engine;           /* routine to run */
+  jq->jobs_started = 0;
+  jq->acquire_attempts = 0;
+  jq->acquire_skipped = 0;
+  jq->total_wait = 0;
+  jq->max_wait = 0;
   jq->valid = JOBQ_VALID;
 
   /*
@@ -257,6 +286,10 @@ int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
     return ENOMEM;
   }
   item->jcr = jcr;
+  item->waiting_for = NULL;
+  item->releases_seen = 0;
+  item->changes_seen = 0;
+  item->queued = GetCurrentBtime();
 
   /*
    * While waiting in a queue this job is not attached to a thread
@@ -294,9 +327,11 @@ int JobqAdd(jobq_t* jq, JobControlRecord* jcr)
   }
 
   /*
-   * Ensure that at least one server looks at the queue.
+   * Ensure that at least one server looks at the queue and wake up the
+   * ones waiting for resources.
    */
   status = StartServer(jq);
+  pthread_cond_broadcast(&jq->work);
 
   V(jq->mutex);
   Dmsg0(2300, "Return JobqAdd\n");
@@ -342,6 +377,7 @@ int JobqRemove(jobq_t* jq, JobControlRecord* jcr)
         jcr);
 
   status = StartServer(jq);
+  pthread_cond_broadcast(&jq->work);
 
   V(jq->mutex);
   Dmsg0(2300, "Return JobqRemove\n");
@@ -487,6 +523,11 @@ extern "C" void* jobq_server(void* arg)
         DecClientConcurrency(jcr);
         DecJobConcurrency(jcr);
         jcr->impl->acquired_resource_locks = false;
+
+        /*
+         * Wake up the workers waiting for resources
+         */
+        pthread_cond_broadcast(&jq->work);
       }
 
       if (RescheduleJob(jcr, jq, je)) { continue; /* go look for more work */ }
@@ -561,7 +602,17 @@ extern "C" void* jobq_server(void* arg)
           break;
         }
 
-        if (!AcquireResources(jcr)) {
+        /*
+         * Don't try again while the resource the job waits for is still busy
+         */
+        if (!JobCanceled(jcr) && ResourceStillBusy(je)) {
+          jq->acquire_skipped++;
+          je = jn; /* point to next waiting job */
+          continue;
+        }
+
+        jq->acquire_attempts++;
+        if (!AcquireResources(jcr, je)) {
           /*
            * If resource conflict, job is canceled
            */
@@ -569,6 +620,14 @@ extern "C" void* jobq_server(void* arg)
             je = jn; /* point to next waiting job */
             continue;
           }
+        } else {
+          btime_t wait = GetCurrentBtime() - je->queued;
+
+          jq->jobs_started++;
+          jq->total_wait += wait;
+          if (wait > jq->max_wait) { jq->max_wait = wait; }
+          Dmsg2(2300, "JobId=%d waited %lld usec for its resources\n",
+                jcr->JobId, (long long)wait);
         }
 
         /*
@@ -617,16 +676,18 @@ extern "C" void* jobq_server(void* arg)
     }
 
     work = !jq->ready_jobs->empty() || !jq->waiting_jobs->empty();
-    if (work) {
+    if (work && jq->ready_jobs->empty()) {
       /*
        * If a job is waiting on a Resource, don't consume all
        * the CPU time looping looking for work, and even more
        * important, release the lock so that a job that has
-       * terminated can give us the resource.
+       * terminated can give us the resource. We are woken up
+       * when a job gives back its resources or a job is added.
        */
-      V(jq->mutex);
-      Bmicrosleep(2, 0); /* pause for 2 seconds */
-      P(jq->mutex);
+      gettimeofday(&tv, &tz);
+      timeout.tv_nsec = tv.tv_usec * 1000;
+      timeout.tv_sec = tv.tv_sec + JOBQ_RECHECK_INTERVAL;
+      pthread_cond_timedwait(&jq->work, &jq->mutex, &timeout);
 
       /*
        * Recompute work as something may have changed in last 2 secs
@@ -770,6 +831,84 @@ static bool RescheduleJob(JobControlRecord* jcr, jobq_t* jq, jobq_item_t* je)
   return retval;
 }
 
+/**
+ * Return how often a concurrency slot of a resource was released
+ */
+static uint64_t ResourceReleases(const void* status)
+{
+  uint64_t releases = 0;
+
+  if (status) {
+    P(mutex);
+    auto it = resource_releases.find(status);
+    if (it != resource_releases.end()) { releases = it->second; }
+    V(mutex);
+  }
+
+  return releases;
+}
+
+/**
+ * Check whether the resource a job waits for is busy as it was when the
+ * job last tried to get it, i.e. it released no slot and no reload
+ * happened since.
+ */
+static bool ResourceStillBusy(const jobq_item_t* je)
+{
+  bool busy = false;
+
+  if (je->waiting_for) {
+    P(mutex);
+    if (je->changes_seen == resource_changes) {
+      auto it = resource_releases.find(je->waiting_for);
+      uint64_t releases = it != resource_releases.end() ? it->second : 0;
+      busy = releases == je->releases_seen;
+    }
+    V(mutex);
+  }
+
+  return busy;
+}
+
+/**
+ * Forget which resources were busy after the resources changed, e.g. on
+ * a reload, and wake up the workers so all waiting jobs are tried again.
+ */
+void JobqResourcesChanged(jobq_t* jq)
+{
+  P(mutex);
+  resource_releases.clear();
+  resource_changes++;
+  V(mutex);
+
+  if (jq && jq->valid == JOBQ_VALID) {
+    P(jq->mutex);
+    pthread_cond_broadcast(&jq->work);
+    V(jq->mutex);
+  }
+}
+
+/**
+ * Count a released concurrency slot of a resource, mutex must be held.
+ * Slots given back because a job could not get all its resources are not
+ * counted, nobody waiting could have used them.
+ */
+static void ResourceReleased(const void* status)
+{
+  resource_releases[status]++;
+}
+
+/**
+ * Remember the resource a job waits for with the number of its releases
+ * before the attempt to get it. The job is not examined again until the
+ * resource was released afterwards.
+ */
+static void WaitFor(jobq_item_t* je, const void* status, uint64_t releases)
+{
+  je->waiting_for = status;
+  je->releases_seen = releases;
+}
+
 /**
  * See if we can acquire all the necessary resources for the job
  * (JobControlRecord)
@@ -777,12 +916,19 @@ static bool RescheduleJob(JobControlRecord* jcr, jobq_t* jq, jobq_item_t* je)
  *  Returns: true  if successful
  *           false if resource failure
  */
-static bool AcquireResources(JobControlRecord* jcr)
+static bool AcquireResources(JobControlRecord* jcr, jobq_item_t* je)
 {
+  const void* status;
+  uint64_t releases;
+
   /*
    * Set that we didn't acquire any resourse locks yet.
    */
   jcr->impl->acquired_resource_locks = false;
+  WaitFor(je, NULL, 0);
+  P(mutex);
+  je->changes_seen = resource_changes;
+  V(mutex);
 
   /*
    * Some Job Types are excluded from the client and storage concurrency
@@ -816,7 +962,10 @@ static bool AcquireResources(JobControlRecord* jcr)
   }
 
   if (jcr->impl->res.read_storage) {
+    status = jcr->impl->res.read_storage->runtime_storage_status;
+    releases = ResourceReleases(status);
     if (!IncReadStore(jcr)) {
+      WaitFor(je, status, releases);
       jcr->setJobStatus(JS_WaitStoreRes);
 
       return false;
@@ -824,32 +973,43 @@ static bool AcquireResources(JobControlRecord* jcr)
   }
 
   if (jcr->impl->res.write_storage) {
+    status = jcr->impl->res.write_storage->runtime_storage_status;
+    releases = ResourceReleases(status);
     if (!IncWriteStore(jcr)) {
-      DecReadStore(jcr);
+      WaitFor(je, status, releases);
+      DecReadStore(jcr, false);
       jcr->setJobStatus(JS_WaitStoreRes);
 
       return false;
     }
   }
 
+  status = jcr->impl->res.client ? jcr->impl->res.client->rcs : NULL;
+  releases = ResourceReleases(status);
   if (!IncClientConcurrency(jcr)) {
+    WaitFor(je, status, releases);
+
     /*
      * Back out previous locks
      */
-    DecWriteStore(jcr);
-    DecReadStore(jcr);
+    DecWriteStore(jcr, false);
+    DecReadStore(jcr, false);
     jcr->setJobStatus(JS_WaitClientRes);
 
     return false;
   }
 
+  status = jcr->impl->res.job->rjs;
+  releases = ResourceReleases(status);
   if (!IncJobConcurrency(jcr)) {
+    WaitFor(je, status, releases);
+
     /*
      * Back out previous locks
      */
-    DecWriteStore(jcr);
-    DecReadStore(jcr);
-    DecClientConcurrency(jcr);
+    DecWriteStore(jcr, false);
+    DecReadStore(jcr, false);
+    DecClientConcurrency(jcr, false);
     jcr->setJobStatus(JS_WaitJobRes);
 
     return false;
@@ -882,13 +1042,14 @@ static bool IncClientConcurrency(JobControlRecord* jcr)
   return false;
 }
 
-static void DecClientConcurrency(JobControlRecord* jcr)
+static void DecClientConcurrency(JobControlRecord* jcr, bool release)
 {
   if (jcr->impl->IgnoreClientConcurrency) { return; }
 
   P(mutex);
   if (jcr->impl->res.client) {
     jcr->impl->res.client->rcs->NumConcurrentJobs--;
+    if (release) { ResourceReleased(jcr->impl->res.client->rcs); }
     Dmsg2(50, "Dec Client=%s rncj=%d\n", jcr->impl->res.client->resource_name_,
           jcr->impl->res.client->rcs->NumConcurrentJobs);
   }
@@ -917,6 +1078,7 @@ static void DecJobConcurrency(JobControlRecord* jcr)
 {
   P(mutex);
   jcr->impl->res.job->rjs->NumConcurrentJobs--;
+  ResourceReleased(jcr->impl->res.job->rjs);
   Dmsg2(50, "Dec Job=%s rncj=%d\n", jcr->impl->res.job->resource_name_,
         jcr->impl->res.job->rjs->NumConcurrentJobs);
   V(mutex);
@@ -954,13 +1116,16 @@ bool IncReadStore(JobControlRecord* jcr)
   return false;
 }
 
-void DecReadStore(JobControlRecord* jcr)
+void DecReadStore(JobControlRecord* jcr, bool release)
 {
   if (jcr->impl->res.read_storage && !jcr->impl->IgnoreStorageConcurrency) {
     P(mutex);
     jcr->impl->res.read_storage->runtime_storage_status
         ->NumConcurrentReadJobs--;
     jcr->impl->res.read_storage->runtime_storage_status->NumConcurrentJobs--;
+    if (release) {
+      ResourceReleased(jcr->impl->res.read_storage->runtime_storage_status);
+    }
     Dmsg2(50, "Dec Rstore=%s rncj=%d\n",
           jcr->impl->res.read_storage->resource_name_,
           jcr->impl->res.read_storage->runtime_storage_status
@@ -1011,11 +1176,14 @@ static bool IncWriteStore(JobControlRecord* jcr)
   return false;
 }
 
-static void DecWriteStore(JobControlRecord* jcr)
+static void DecWriteStore(JobControlRecord* jcr, bool release)
 {
   if (jcr->impl->res.write_storage && !jcr->impl->IgnoreStorageConcurrency) {
     P(mutex);
     jcr->impl->res.write_storage->runtime_storage_status->NumConcurrentJobs--;
+    if (release) {
+      ResourceReleased(jcr->impl->res.write_storage->runtime_storage_status);
+    }
     Dmsg2(50, "Dec Wstore=%s wncj=%d\n",
           jcr->impl->res.write_storage->resource_name_,
           jcr->impl->res.write_storage->runtime_storage_status
@@ -1031,4 +1199,24 @@ static void DecWriteStore(JobControlRecord* jcr)
     V(mutex);
   }
 }
+
+/**
+ * Get the state of the job queue and how long jobs waited to be started
+ */
+void JobqGetStatistics(jobq_t* jq, jobq_statistics_t* stats)
+{
+  memset(stats, 0, sizeof(jobq_statistics_t));
+  if (jq->valid != JOBQ_VALID) { return; }
+
+  P(jq->mutex);
+  stats->waiting = jq->waiting_jobs->size();
+  stats->ready = jq->ready_jobs->size();
+  stats->running = jq->running_jobs->size();
+  stats->jobs_started = jq->jobs_started;
+  stats->acquire_attempts = jq->acquire_attempts;
+  stats->acquire_skipped = jq->acquire_skipped;
+  stats->total_wait = jq->total_wait;
+  stats->max_wait = jq->max_wait;
+  V(jq->mutex);
+}
 } /* namespace directordaemon */
@@ -43,6 +43,10 @@ namespace directordaemon {
 struct jobq_item_t {
   dlink link;
   JobControlRecord* jcr;
+  const void* waiting_for; /* runtime status of the busy resource or NULL */
+  uint64_t releases_seen;  /* releases of that resource when it was busy */
+  uint64_t changes_seen;   /* resource changes when it was busy */
+  btime_t queued;          /* time the job entered the wait queue */
 };
 
 /**
@@ -60,6 +64,25 @@ struct jobq_t {
   int max_workers;            /* max threads */
   int num_workers;            /* current threads */
   void* (*engine)(void* arg); /* user engine */
+  uint64_t jobs_started;      /* jobs taken from the wait queue */
+  uint64_t acquire_attempts;  /* tries to acquire the resources of a job */
+  uint64_t acquire_skipped;   /* tries saved as the resource is still busy */
+  btime_t total_wait;         /* time started jobs spent in the wait queue */
+  btime_t max_wait;           /* longest time a job spent in the wait queue */
+};
+
+/**
+ * Snapshot of the job queue state and scheduling latency
+ */
+struct jobq_statistics_t {
+  int waiting;
+  int ready;
+  int running;
+  uint64_t jobs_started;
+  uint64_t acquire_attempts;
+  uint64_t acquire_skipped;
+  btime_t total_wait;
+  btime_t max_wait;
 };
 
 #define JOBQ_VALID 0xdec1993
@@ -71,9 +94,11 @@ extern int JobqInit(jobq_t* wq,
 extern int JobqDestroy(jobq_t* wq);
 extern int JobqAdd(jobq_t* wq, JobControlRecord* jcr);
 extern int JobqRemove(jobq_t* wq, JobControlRecord* jcr);
+extern void JobqGetStatistics(jobq_t* wq, jobq_statistics_t* stats);
+extern void JobqResourcesChanged(jobq_t* wq);
 
 bool IncReadStore(JobControlRecord* jcr);
-void DecReadStore(JobControlRecord* jcr);
+void DecReadStore(JobControlRecord* jcr, bool release = true);
 
 } /* namespace directordaemon */
 #endif /* BAREOS_DIRD_JOBQ_H_ */
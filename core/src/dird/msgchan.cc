@@ -43,6 +43,7 @@
 #include "dird/msgchan.h"
 #include "dird/quota.h"
 #include "dird/sd_cmds.h"
+#include "lib/attr_spool.h"
 #include "lib/berrno.h"
 #include "lib/bnet.h"
 #include "lib/edit.h"
@@ -134,6 +135,7 @@ bool StartStorageDaemonJob(JobControlRecord* jcr,
   PoolMem job_name, client_name, fileset_name;
   int copy = 0;
   int stripe = 0;
+  int spool_attributes;
   uint64_t remainingquota = 0;
   char ed1[30], ed2[30];
   BareosSocket* sd = jcr->store_bsock;
@@ -198,10 +200,16 @@ bool StartStorageDaemonJob(JobControlRecord* jcr,
   remainingquota = FetchRemainingQuotas(jcr);
   Dmsg1(50, "Remainingquota: %llu\n", remainingquota);
 
+  /*
+   * An older storage daemon takes any non zero SpoolAttr as a plain yes
+   */
+  spool_attributes =
+      jcr->impl->res.job->SpoolAttributes ? SPOOL_ATTRIBUTES_COMPRESSED : 0;
+
   sd->fsend(jobcmd, edit_int64(jcr->JobId, ed1), jcr->Job, job_name.c_str(),
             client_name.c_str(), jcr->getJobType(), jcr->getJobLevel(),
             fileset_name.c_str(), !jcr->impl->res.pool->catalog_files,
-            jcr->impl->res.job->SpoolAttributes, fileset_md5,
+            spool_attributes, fileset_md5,
             jcr->impl->spool_data, jcr->impl->res.job->PreferMountedVolumes,
             edit_int64(jcr->impl->spool_size, ed2), jcr->rerunning,
             jcr->VolSessionId, jcr->VolSessionTime, remainingquota,
@@ -593,6 +593,14 @@ static void SetOptions(findFOPTS* fo, const char* opts)
             p++;
             break;
 #endif
+          case '4':
+            SetBit(FO_BLAKE3, fo->flags);
+            p++;
+            break;
+          case '5':
+            SetBit(FO_XXH128, fo->flags);
+            p++;
+            break;
           default:
             /* Automatically downgrade to SHA-1 if an unsupported
              * SHA variant is specified */
@@ -647,6 +655,9 @@ static void SetOptions(findFOPTS* fo, const char* opts)
       case 'X':
         SetBit(FO_XATTR, fo->flags);
         break;
+      case 'D':
+        SetBit(FO_ACL_XATTR_DEDUP, fo->flags);
+        break;
       default:
         Emsg1(M_ERROR, 0, _("Unknown include/exclude option: %c\n"), *p);
         break;
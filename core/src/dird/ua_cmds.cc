@@ -235,7 +235,7 @@ static struct ua_cmdstruct commands[] = {
      NT_("dir ( current | last | header | scheduled | running | terminated ) "
          "|\n"
          "storage=<storage> [ header | waitreservation | devices | volumes | "
-         "spooling | running | terminated ] |\n"
+         "spooling | reservations | running | terminated ] |\n"
          "client=<client> [ header | terminated | running ]"),
      false, true},
     {NT_(".storages"), DotStorageCmd, _("List all storage resources"),
@@ -34,6 +34,7 @@
 
 #include "include/bareos.h"
 #include "dird.h"
+#include "dird/file_index_cache.h"
 #include "dird/jcr_private.h"
 #include "dird/next_vol.h"
 #include "dird/sd_cmds.h"
@@ -341,6 +342,8 @@ void PurgeFilesFromJobs(UaContext* ua, const char* jobs)
   ua->db->SqlQuery(query.c_str());
   Dmsg1(050, "Delete BaseFiles sql=%s\n", query.c_str());
 
+  RemoveJobFileIndexes(ua, jobs);
+
   /*
    * Now mark Job as having files purged. This is necessary to
    * avoid having too many Jobs to process in future prunings. If
@@ -36,6 +36,7 @@
 #include "include/bareos.h"
 #include "dird.h"
 #include "dird/dird_globals.h"
+#include "dird/file_index_cache.h"
 #include "dird/jcr_private.h"
 #include "dird/ua_db.h"
 #include "dird/ua_input.h"
@@ -1140,7 +1141,9 @@ static bool BuildDirectoryTree(UaContext* ua, RestoreContext* rx)
   ua->LogAuditEventInfoMsg(
       _("Building directory tree for JobId(s) %s"), rx->JobIds);
 
-  if (!ua->db->GetFileList(ua->jcr, rx->JobIds, false /* do not use md5 */,
+  if (!GetFileListFromIndexCache(ua, rx->JobIds, InsertTreeHandler,
+                                 (void*)&tree) &&
+      !ua->db->GetFileList(ua->jcr, rx->JobIds, false /* do not use md5 */,
                            true /* get delta */, InsertTreeHandler,
                            (void*)&tree)) {
     ua->ErrorMsg("%s", ua->db->strerror());
@@ -354,6 +354,8 @@ void ListDirStatusHeader(UaContext* ua)
   int len, cnt;
   CatalogResource* catalog;
   char dt[MAX_TIME_LENGTH];
+  char ed1[50], ed2[50], ed3[50];
+  jobq_statistics_t jobq_stats;
   PoolMem msg(PM_FNAME), dbdrivers(PM_FNAME);
 
   cnt = 0;
@@ -375,6 +377,18 @@ void ListDirStatusHeader(UaContext* ua)
     ua->SendMsg(_(" secure erase command='%s'\n"), me->secure_erase_cmdline);
   }
 
+  GetJobQueueStatistics(&jobq_stats);
+  ua->SendMsg(_(" Job queue: waiting=%d ready=%d running=%d started=%s "
+                "avg wait=%.3fs max wait=%.3fs checks=%s skipped=%s\n"),
+              jobq_stats.waiting, jobq_stats.ready, jobq_stats.running,
+              edit_uint64_with_commas(jobq_stats.jobs_started, ed1),
+              jobq_stats.jobs_started ? (double)jobq_stats.total_wait
+                                            / jobq_stats.jobs_started / 1000000
+                                      : 0.0,
+              (double)jobq_stats.max_wait / 1000000,
+              edit_uint64_with_commas(jobq_stats.acquire_attempts, ed2),
+              edit_uint64_with_commas(jobq_stats.acquire_skipped, ed3));
+
   len = ListDirPlugins(msg);
   if (len > 0) { ua->SendMsg("%s\n", msg.c_str()); }
 
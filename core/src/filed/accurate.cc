@@ -295,7 +295,9 @@ bool AccurateCheckFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
              (BitIsSet(FO_MD5, ff_pkt->flags) ||
               BitIsSet(FO_SHA1, ff_pkt->flags) ||
               BitIsSet(FO_SHA256, ff_pkt->flags) ||
-              BitIsSet(FO_SHA512, ff_pkt->flags)))) {
+              BitIsSet(FO_SHA512, ff_pkt->flags) ||
+              BitIsSet(FO_BLAKE3, ff_pkt->flags) ||
+              BitIsSet(FO_XXH128, ff_pkt->flags)))) {
           if (!*payload->chksum && !jcr->rerunning) {
             Jmsg(jcr, M_WARNING, 0, _("Cannot verify checksum for %s\n"),
                  ff_pkt->fname);
@@ -54,9 +54,10 @@ const int debuglevel = 50;
  *  52 13Jul13 - Added plugin options
  *  53 02Apr15 - Added setdebug timestamp
  *  54 29Oct15 - Added getSecureEraseCmd
+ *  55 15Oct20 - Added compactattributes
  */
 static char OK_hello_compat[] = "2000 OK Hello 5\n";
-static char OK_hello[] = "2000 OK Hello 54\n";
+static char OK_hello[] = "2000 OK Hello 55\n";
 
 static char Dir_sorry[] = "2999 Authentication failed.\n";
 
@@ -209,4 +210,23 @@ bool AuthenticateWithStoragedaemon(JobControlRecord* jcr)
 
   return result;
 }
+
+/**
+ * Authenticate an additional data connection with a remote storage daemon.
+ *
+ * Failures are not fatal for the job, which then uses a single connection.
+ */
+bool AuthenticateStripeWithStoragedaemon(JobControlRecord* jcr,
+                                         BareosSocket* sd,
+                                         char* auth_key)
+{
+  s_password password;
+
+  password.encoding = p_encoding_md5;
+  password.value = auth_key;
+
+  return sd->AuthenticateOutboundConnection(
+      nullptr, my_config->CreateOwnQualifiedNameForNetworkDump(),
+      (char*)jcr->client_name, password, me);
+}
 } /* namespace filedaemon */
@@ -44,6 +44,7 @@
 #include "findlib/find_one.h"
 #include "lib/berrno.h"
 #include "lib/bsock.h"
+#include "lib/bsock_striped.h"
 #include "lib/btimers.h"
 #include "lib/parse_conf.h"
 #include "lib/util.h"
@@ -85,6 +86,19 @@ bool EncodeAndSendAttributes(JobControlRecord* jcr,
                              int& data_stream);
 static void CloseVssBackupSession(JobControlRecord* jcr);
 
+static void LogAclXattrBlobCache(JobControlRecord* jcr,
+                                 const char* type,
+                                 AclXattrBlobCache* cache)
+{
+  if (cache && cache->nr_references() > 0) {
+    Dmsg4(100,
+          "%s: sent %u unique %s streams, %llu references saved %llu "
+          "bytes\n",
+          jcr->Job, cache->nr_blobs(), type, cache->nr_references(),
+          cache->bytes_saved());
+  }
+}
+
 /**
  * Find all the requested files and send them
  * to the Storage daemon.
@@ -101,6 +115,7 @@ bool BlastDataToStorageDaemon(JobControlRecord* jcr,
                               crypto_cipher_t cipher)
 {
   BareosSocket* sd;
+  BareosSocketStriped* striped = nullptr;
   bool ok = true;
 
   sd = jcr->store_bsock;
@@ -141,6 +156,18 @@ bool BlastDataToStorageDaemon(JobControlRecord* jcr,
     SetFindChangedFunction((FindFilesPacket*)jcr->impl->ff, AccurateCheckFile);
   }
 
+  /**
+   * Spread the data over the additional connections to the SD if any
+   */
+  if (!jcr->impl->stripes.empty()) {
+    striped = new BareosSocketStriped(jcr, sd, jcr->impl->stripes, true);
+    jcr->impl->stripes.clear();
+    striped->SetBufferSize(buf_size, BNET_SETBUF_WRITE);
+    striped->SetBwlimit(jcr->max_bandwidth);
+    if (me->allow_bw_bursting) { striped->SetBwlimitBursting(); }
+    jcr->store_bsock = striped;
+  }
+
   StartHeartbeatMonitor(jcr);
 
   if (have_acl) {
@@ -150,6 +177,7 @@ bool BlastDataToStorageDaemon(JobControlRecord* jcr,
         (acl_build_data_t*)malloc(sizeof(acl_build_data_t));
     memset(jcr->impl->acl_data->u.build, 0, sizeof(acl_build_data_t));
     jcr->impl->acl_data->u.build->content = GetPoolMemory(PM_MESSAGE);
+    jcr->impl->acl_data->u.build->blob_cache = new AclXattrBlobCache;
   }
 
   if (have_xattr) {
@@ -159,6 +187,7 @@ bool BlastDataToStorageDaemon(JobControlRecord* jcr,
         (xattr_build_data_t*)malloc(sizeof(xattr_build_data_t));
     memset(jcr->impl->xattr_data->u.build, 0, sizeof(xattr_build_data_t));
     jcr->impl->xattr_data->u.build->content = GetPoolMemory(PM_MESSAGE);
+    jcr->impl->xattr_data->u.build->blob_cache = new AclXattrBlobCache;
   }
 
   /**
@@ -186,9 +215,22 @@ bool BlastDataToStorageDaemon(JobControlRecord* jcr,
 
   StopHeartbeatMonitor(jcr);
 
-  sd->signal(BNET_EOD); /* end of sending data */
+  jcr->store_bsock->signal(BNET_EOD); /* end of sending data */
+
+  if (striped) {
+    if (!striped->Finish() && ok) {
+      Jmsg(jcr, M_FATAL, 0, _("Network send error to SD over %d connections.\n"),
+           striped->NumberOfStripes());
+      jcr->setJobStatus(JS_ErrorTerminated);
+      ok = false;
+    }
+    jcr->store_bsock = sd;
+    delete striped;
+  }
 
   if (have_acl && jcr->impl->acl_data) {
+    LogAclXattrBlobCache(jcr, "acl", jcr->impl->acl_data->u.build->blob_cache);
+    delete jcr->impl->acl_data->u.build->blob_cache;
     FreePoolMemory(jcr->impl->acl_data->u.build->content);
     free(jcr->impl->acl_data->u.build);
     free(jcr->impl->acl_data);
@@ -196,6 +238,9 @@ bool BlastDataToStorageDaemon(JobControlRecord* jcr,
   }
 
   if (have_xattr && jcr->impl->xattr_data) {
+    LogAclXattrBlobCache(jcr, "xattr",
+                         jcr->impl->xattr_data->u.build->blob_cache);
+    delete jcr->impl->xattr_data->u.build->blob_cache;
     FreePoolMemory(jcr->impl->xattr_data->u.build->content);
     free(jcr->impl->xattr_data->u.build);
     free(jcr->impl->xattr_data);
@@ -277,7 +322,7 @@ bail_out:
 
 /**
  * Setup for digest handling. If this fails, the digest will be set to NULL
- * and not used. Note, the digest (file hash) can be any one of the four
+ * and not used. Note, the digest (file hash) can be any one of the
  * algorithms below.
  *
  * The signing digest is a single algorithm depending on
@@ -308,6 +353,12 @@ static inline bool SetupEncryptionDigests(b_save_ctx& bsctx)
   } else if (BitIsSet(FO_SHA512, bsctx.ff_pkt->flags)) {
     bsctx.digest = crypto_digest_new(bsctx.jcr, CRYPTO_DIGEST_SHA512);
     bsctx.digest_stream = STREAM_SHA512_DIGEST;
+  } else if (BitIsSet(FO_BLAKE3, bsctx.ff_pkt->flags)) {
+    bsctx.digest = crypto_digest_new(bsctx.jcr, CRYPTO_DIGEST_BLAKE3);
+    bsctx.digest_stream = STREAM_BLAKE3_DIGEST;
+  } else if (BitIsSet(FO_XXH128, bsctx.ff_pkt->flags)) {
+    bsctx.digest = crypto_digest_new(bsctx.jcr, CRYPTO_DIGEST_XXH128);
+    bsctx.digest_stream = STREAM_XXH128_DIGEST;
   }
 
   /*
@@ -465,6 +516,8 @@ static inline bool DoBackupAcl(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
 
   jcr->impl->acl_data->filetype = ff_pkt->type;
   jcr->impl->acl_data->last_fname = jcr->impl->last_fname;
+  jcr->impl->acl_data->u.build->deduplicate =
+      BitIsSet(FO_ACL_XATTR_DEDUP, ff_pkt->flags);
 
   if (jcr->IsPlugin()) {
     retval = PluginBuildAclStreams(jcr, jcr->impl->acl_data, ff_pkt);
@@ -491,6 +544,8 @@ static inline bool DoBackupXattr(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
   BxattrExitCode retval;
 
   jcr->impl->xattr_data->last_fname = jcr->impl->last_fname;
+  jcr->impl->xattr_data->u.build->deduplicate =
+      BitIsSet(FO_ACL_XATTR_DEDUP, ff_pkt->flags);
 
   if (jcr->IsPlugin()) {
     retval = PluginBuildXattrStreams(jcr, jcr->impl->xattr_data, ff_pkt);
@@ -790,8 +845,9 @@ int SaveFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool top_level)
     ff_pkt->bfd.reparse_point =
         (ff_pkt->type == FT_REPARSE || ff_pkt->type == FT_JUNCTION);
 
-    if (bopen(&ff_pkt->bfd, ff_pkt->fname, O_RDONLY | O_BINARY | noatime, 0,
-              ff_pkt->statp.st_rdev) < 0) {
+    if (BopenAt(&ff_pkt->bfd, ff_pkt->dir_fd, ff_pkt->dir_relname,
+                ff_pkt->fname, O_RDONLY | O_BINARY | noatime, 0,
+                ff_pkt->statp.st_rdev) < 0) {
       ff_pkt->ff_errno = errno;
       BErrNo be;
       Jmsg(jcr, M_NOTSAVED, 0, _("     Cannot open \"%s\": ERR=%s.\n"),
@@ -1299,8 +1355,6 @@ bool EncodeAndSendAttributes(JobControlRecord* jcr,
           _("Invalid file flags, no supported data stream type.\n"));
     return false;
   }
-  EncodeStat(attribs.c_str(), &ff_pkt->statp, sizeof(ff_pkt->statp),
-             ff_pkt->LinkFI, data_stream);
 
   /** Now possibly extend the attributes */
   if (IS_FT_OBJECT(ff_pkt->type)) {
@@ -1310,6 +1364,20 @@ bool EncodeAndSendAttributes(JobControlRecord* jcr,
     attr_stream = encode_attribsEx(jcr, attribsEx, ff_pkt);
   }
 
+  /*
+   * The compact stat packet gets its own stream type, so programs that
+   * don't know it skip the record instead of reading it as base64.
+   * Extended Win32 attributes keep the text form.
+   */
+  if (jcr->impl->compact_attributes && attr_stream == STREAM_UNIX_ATTRIBUTES) {
+    EncodeStatCompact(attribs.c_str(), &ff_pkt->statp, sizeof(ff_pkt->statp),
+                      ff_pkt->LinkFI, data_stream);
+    attr_stream = STREAM_UNIX_ATTRIBUTES_COMPACT;
+  } else {
+    EncodeStat(attribs.c_str(), &ff_pkt->statp, sizeof(ff_pkt->statp),
+               ff_pkt->LinkFI, data_stream);
+  }
+
   Dmsg3(300, "File %s\nattribs=%s\nattribsEx=%s\n", ff_pkt->fname,
         attribs.c_str(), attribsEx);
 
@@ -310,6 +310,20 @@ bool FlushCipher(JobControlRecord* jcr,
   char ec1[50];   /* Buffer printing huge values */
   bool second_pass = false;
 
+  /*
+   * A chunked cipher has nothing buffered, but the stream must have ended
+   * with its final chunk or the file was cut off.
+   */
+  if (CryptoCipherIsChunked(cipher_ctx->cipher)) {
+    if (!CryptoCipherFinalize(cipher_ctx->cipher, NULL, &decrypted_len)) {
+      Jmsg(jcr, M_ERROR, 0,
+           _("Decryption error, data of file %s is incomplete\n"),
+           jcr->impl->last_fname);
+      return false;
+    }
+    return true;
+  }
+
 again:
   /*
    * Write out the remaining block and free the cipher context
@@ -460,13 +474,21 @@ bool SetupEncryptionContext(b_ctx& bctx)
      * We grow crypto_buf to the maximum number of blocks that
      * could be returned for the given read buffer size.
      * (Using the larger of either rsize or max_compress_len)
+     * A chunked cipher adds its nonce and tag to every chunk.
      */
-    bctx.jcr->impl->crypto.crypto_buf =
-        CheckPoolMemorySize(bctx.jcr->impl->crypto.crypto_buf,
-                            (MAX(bctx.jcr->buf_size + (int)sizeof(uint32_t),
-                                 (int32_t)bctx.max_compress_len) +
-                             cipher_block_size - 1) /
-                                cipher_block_size * cipher_block_size);
+    if (CryptoCipherIsChunked(bctx.cipher_ctx)) {
+      bctx.jcr->impl->crypto.crypto_buf = CheckPoolMemorySize(
+          bctx.jcr->impl->crypto.crypto_buf,
+          MAX(bctx.jcr->buf_size, (int32_t)bctx.max_compress_len) +
+              CRYPTO_AEAD_OVERHEAD);
+    } else {
+      bctx.jcr->impl->crypto.crypto_buf =
+          CheckPoolMemorySize(bctx.jcr->impl->crypto.crypto_buf,
+                              (MAX(bctx.jcr->buf_size + (int)sizeof(uint32_t),
+                                   (int32_t)bctx.max_compress_len) +
+                               cipher_block_size - 1) /
+                                  cipher_block_size * cipher_block_size);
+    }
 
     bctx.wbuf =
         bctx.jcr->impl->crypto
@@ -528,6 +550,22 @@ bool EncryptData(b_ctx* bctx, bool* need_more_data)
     bctx->cipher_input_len += OFFSET_FADDR_SIZE;
   }
 
+  /*
+   * A chunked cipher seals every record on its own, the record boundaries
+   * are kept without a length prefix and nothing is buffered.
+   */
+  if (CryptoCipherIsChunked(bctx->cipher_ctx)) {
+    if (!CryptoCipherSealChunk(bctx->cipher_ctx, bctx->cipher_input,
+                               bctx->cipher_input_len,
+                               (uint8_t*)bctx->jcr->impl->crypto.crypto_buf,
+                               &bctx->encrypted_len)) {
+      Jmsg(bctx->jcr, M_FATAL, 0, _("Encryption error\n"));
+      goto bail_out;
+    }
+    bctx->jcr->store_bsock->message_length = bctx->encrypted_len;
+    return true;
+  }
+
   /*
    * Encrypt the length of the input block
    */
@@ -590,6 +628,27 @@ bool DecryptData(JobControlRecord* jcr,
 
   ASSERT(cipher_ctx->cipher);
 
+  /*
+   * A chunked cipher record decrypts on its own into one preserved block.
+   */
+  if (CryptoCipherIsChunked(cipher_ctx->cipher)) {
+    cipher_ctx->buf = CheckPoolMemorySize(cipher_ctx->buf, *length);
+    if (!CryptoCipherOpenChunk(cipher_ctx->cipher, (const uint8_t*)*data,
+                               *length, (uint8_t*)cipher_ctx->buf,
+                               &decrypted_len)) {
+      Jmsg(jcr, M_ERROR, 0,
+           _("Decryption error, data of file %s is damaged or was "
+             "modified\n"),
+           jcr->impl->last_fname);
+      goto bail_out;
+    }
+    cipher_ctx->buf_len = 0;
+    cipher_ctx->packet_len = 0;
+    *data = cipher_ctx->buf;
+    *length = decrypted_len;
+    return true;
+  }
+
   /*
    * NOTE: We must implement block preserving semantics for the
    * non-streaming compression and sparse code.
@@ -54,6 +54,7 @@
 #include "lib/thread_specific_data.h"
 #include "lib/tls_conf.h"
 #include "lib/parse_conf.h"
+#include "lib/bsock_striped.h"
 #include "lib/bsock_tcp.h"
 #include "lib/bnet_network_dump.h"
 #include "lib/watchdog.h"
@@ -105,6 +106,7 @@ extern "C" char* job_code_callback_filed(JobControlRecord* jcr,
 static bool BackupCmd(JobControlRecord* jcr);
 static bool BootstrapCmd(JobControlRecord* jcr);
 static bool CancelCmd(JobControlRecord* jcr);
+static bool CompactattributesCmd(JobControlRecord* jcr);
 static bool EndRestoreCmd(JobControlRecord* jcr);
 static bool EstimateCmd(JobControlRecord* jcr);
 #ifdef DEVELOPER
@@ -161,6 +163,7 @@ static struct s_cmds cmds[] = {
     {"backup", BackupCmd, false},
     {"bootstrap", BootstrapCmd, false},
     {"cancel", CancelCmd, false},
+    {"compactattributes", CompactattributesCmd, false},
     {"endrestore", EndRestoreCmd, false},
     {"estimate", EstimateCmd, false},
 #ifdef DEVELOPER
@@ -234,6 +237,7 @@ static char invalid_cmd[] =
     "2997 Invalid command for a Director with Monitor directive enabled.\n";
 static char OkAuthorization[] = "2000 OK Authorization\n";
 static char OKBandwidth[] = "2000 OK Bandwidth\n";
+static char OKCompactAttributes[] = "2000 OK compactattributes\n";
 static char OKinc[] = "2000 OK include\n";
 static char OKest[] = "2000 OK estimate files=%s bytes=%s\n";
 static char OKlevel[] = "2000 OK level\n";
@@ -280,6 +284,7 @@ static char OK_append[] = "3000 OK append data\n";
  */
 static char append_open[] = "append open session\n";
 static char append_data[] = "append data %d\n";
+static char append_data_stripes[] = "append data %d stripes=%d\n";
 static char append_end[] = "append end session %d\n";
 static char append_close[] = "append close session %d\n";
 static char read_open[] = "read open session = %s %ld %ld %ld %ld %ld %ld\n";
@@ -844,6 +849,20 @@ static bool SetauthorizationCmd(JobControlRecord* jcr)
   return dir->fsend(OkAuthorization);
 }
 
+/**
+ * Director tells us it understands the compact binary stat encoding
+ * so we can use it for the attributes of this backup.
+ */
+static bool CompactattributesCmd(JobControlRecord* jcr)
+{
+  BareosSocket* dir = jcr->dir_bsock;
+
+  jcr->impl->compact_attributes = true;
+  Dmsg0(100, "Using compact attribute encoding\n");
+
+  return dir->fsend(OKCompactAttributes);
+}
+
 /**
  * Set bandwidth limit as requested by the Director
  */
@@ -1618,6 +1637,99 @@ static void SetStorageAuthKeyAndTlsPolicy(JobControlRecord* jcr,
   Dmsg1(5, "set sd ssl_policy to %d\n", policy);
 }
 
+/**
+ * Forget the Storage daemon for additional data connections.
+ */
+static void ClearStripeTarget(JobControlRecord* jcr)
+{
+  if (jcr->impl->stripe_auth_key) {
+    memset(jcr->impl->stripe_auth_key, 0, strlen(jcr->impl->stripe_auth_key));
+    free(jcr->impl->stripe_auth_key);
+    jcr->impl->stripe_auth_key = nullptr;
+  }
+  if (jcr->impl->stripe_addr) {
+    free(jcr->impl->stripe_addr);
+    jcr->impl->stripe_addr = nullptr;
+  }
+}
+
+static void CloseStripes(JobControlRecord* jcr)
+{
+  for (auto stripe : jcr->impl->stripes) {
+    stripe->close();
+    delete stripe;
+  }
+  jcr->impl->stripes.clear();
+}
+
+/**
+ * Open the additional data connections to the Storage daemon. Returns the
+ * number of connections the data of the backup is spread over, 1 when
+ * they cannot be opened, e.g. because the Storage daemon is too old.
+ */
+static int OpenStripes(JobControlRecord* jcr)
+{
+  int count = std::min((int)me->storage_data_connections, BSOCK_MAX_STRIPES);
+  std::string qualified_resource_name;
+  BareosSocket* sd;
+  bool ok = true;
+
+  if (count <= 1 || !jcr->impl->stripe_addr) {
+    ClearStripeTarget(jcr);
+    return 1;
+  }
+
+  if (!my_config->GetQualifiedResourceNameTypeConverter()->ResourceToString(
+          jcr->Job, R_JOB, qualified_resource_name)) {
+    ClearStripeTarget(jcr);
+    return 1;
+  }
+
+  for (int i = 1; ok && i < count; i++) {
+    sd = new BareosSocketTCP;
+    if (me->nokeepalive) { sd->ClearKeepalive(); }
+    sd->SetSourceAddress(me->FDsrc_addr);
+    sd->SetTlsKernelOffload(me->tls_kernel_offload);
+
+    /*
+     * Failures must not end the job, which then uses a single connection.
+     */
+    if (!sd->connect(nullptr, 1, 10, me->heartbeat_interval,
+                     _("Storage daemon"), jcr->impl->stripe_addr, nullptr,
+                     jcr->impl->stripe_port, 0)) {
+      delete sd;
+      ok = false;
+      break;
+    }
+    jcr->impl->stripes.push_back(sd);
+
+    if (jcr->sd_tls_policy == TlsPolicy::kBnetTlsAuto
+        && !sd->DoTlsHandshake(TlsPolicy::kBnetTlsAuto, me, false,
+                               qualified_resource_name.c_str(),
+                               jcr->impl->stripe_auth_key, nullptr)) {
+      ok = false;
+      break;
+    }
+
+    sd->fsend("Hello Start Job Stripe %d %s\n", i, jcr->Job);
+    ok = AuthenticateStripeWithStoragedaemon(jcr, sd,
+                                             jcr->impl->stripe_auth_key);
+    sd->SetJcr(jcr);
+  }
+  ClearStripeTarget(jcr);
+
+  if (!ok) {
+    Jmsg(jcr, M_INFO, 0,
+         _("Cannot open %d data connections to Storage daemon, using one.\n"),
+         count);
+    CloseStripes(jcr);
+    return 1;
+  }
+  Dmsg1(100, "Opened %d data connections to SD\n", count);
+
+  return count;
+}
+
 /**
  * Get address of storage daemon from Director
  */
@@ -1649,6 +1761,7 @@ static bool StorageCmd(JobControlRecord* jcr)
         tls_policy);
 
   storage_daemon_socket->SetSourceAddress(me->FDsrc_addr);
+  storage_daemon_socket->SetTlsKernelOffload(me->tls_kernel_offload);
 
   /*
    * TODO: see if we put limit on restore and backup...
@@ -1695,6 +1808,17 @@ static bool StorageCmd(JobControlRecord* jcr)
     }
   }
 
+  /*
+   * Keep what a backup needs to open additional data connections, the
+   * session key is destroyed by the authentication.
+   */
+  ClearStripeTarget(jcr);
+  if (me->storage_data_connections > 1) {
+    jcr->impl->stripe_addr = strdup(stored_addr);
+    jcr->impl->stripe_port = stored_port;
+    jcr->impl->stripe_auth_key = strdup(jcr->sd_auth_key);
+  }
+
   storage_daemon_socket->InitBnetDump(
       my_config->CreateOwnQualifiedNameForNetworkDump());
   storage_daemon_socket->fsend("Hello Start Job %s\n", jcr->Job);
@@ -1924,6 +2048,7 @@ static bool BackupCmd(JobControlRecord* jcr)
   int ok = 0;
   int SDJobStatus;
   int32_t FileIndex;
+  int stripes;
   BareosSocket* dir = jcr->dir_bsock;
   BareosSocket* sd = jcr->store_bsock;
   crypto_cipher_t cipher = CRYPTO_CIPHER_NONE;
@@ -2030,7 +2155,12 @@ static bool BackupCmd(JobControlRecord* jcr)
   /**
    * Send Append data command to Storage daemon
    */
-  sd->fsend(append_data, jcr->impl->Ticket);
+  stripes = OpenStripes(jcr);
+  if (stripes > 1) {
+    sd->fsend(append_data_stripes, jcr->impl->Ticket, stripes);
+  } else {
+    sd->fsend(append_data, jcr->impl->Ticket);
+  }
   Dmsg1(110, ">stored: %s", sd->msg);
 
   /**
@@ -2628,6 +2758,9 @@ static void FiledFreeJcr(JobControlRecord* jcr)
     jcr->store_bsock = nullptr;
   }
 
+  CloseStripes(jcr);
+  ClearStripeTarget(jcr);
+
   if (jcr->dir_bsock) {
     jcr->dir_bsock->close();
     delete jcr->dir_bsock;
@@ -125,6 +125,21 @@ static ResourceItem cli_items[] = {
   {"AbsoluteJobTimeout", CFG_TYPE_PINT32, ITEM(res_client, jcr_watchdog_time), 0, 0, NULL, NULL, NULL},
   {"AlwaysUseLmdb", CFG_TYPE_BOOL, ITEM(res_client, always_use_lmdb), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL},
   {"LmdbThreshold", CFG_TYPE_PINT32, ITEM(res_client, lmdb_threshold), 0, 0, NULL, NULL, NULL},
+  {"RestoreWriterThreads", CFG_TYPE_PINT32, ITEM(res_client, restore_writer_threads), 0, CFG_ITEM_DEFAULT, "0", "20.0.0-",
+      "Number of threads creating and writing small files during a restore, while the job thread keeps reading "
+      "from the Storage Daemon. 0 restores all files from the job thread."},
+  {"StorageDataConnections", CFG_TYPE_PINT32, ITEM(res_client, storage_data_connections), 0, CFG_ITEM_DEFAULT, "1", "20.0.0-",
+      "Number of connections to the Storage Daemon the data of a backup job is spread over, to get past the "
+      "throughput of a single TCP stream on links with a high bandwidth delay product. At most 16 are used; "
+      "Storage Daemons not supporting this reject the additional connections, logging that the job name is "
+      "not found, and the backup uses a single connection."},
+  {"TlsKernelOffload", CFG_TYPE_BOOL, ITEM(res_client, tls_kernel_offload), 0, CFG_ITEM_DEFAULT, "false", "20.0.0-",
+      "Let the kernel encrypt and decrypt the TLS records (kTLS) of the connections accepted by the File Daemon "
+      "and of its connections to Storage Daemons, which saves copying the data through OpenSSL. Connections fall "
+      "back to OpenSSL when the kernel or OpenSSL does not support it."},
+  {"VerifyDigestThreads", CFG_TYPE_PINT32, ITEM(res_client, verify_digest_threads), 0, CFG_ITEM_DEFAULT, "0", "20.0.0-",
+      "Number of threads reading files and computing their digests during a Verify job. 0 computes all digests "
+      "from the job thread."},
   {"SecureEraseCommand", CFG_TYPE_STR, ITEM(res_client, secure_erase_cmdline), 0, 0, NULL, "15.2.1-",
       "Specify command that will be called when bareos unlinks files."},
   {"LogTimestampFormat", CFG_TYPE_STR, ITEM(res_client, log_timestamp_format), 0, 0, NULL, "15.2.3-", NULL},
@@ -185,6 +200,9 @@ static struct s_kw CryptoCiphers[] = {
     {"camellia256", CRYPTO_CIPHER_CAMELLIA_256_CBC},
     {"aes128hmacsha1", CRYPTO_CIPHER_AES_128_CBC_HMAC_SHA1},
     {"aes256hmacsha1", CRYPTO_CIPHER_AES_256_CBC_HMAC_SHA1},
+    {"aes128gcm", CRYPTO_CIPHER_AES_128_GCM},
+    {"aes256gcm", CRYPTO_CIPHER_AES_256_GCM},
+    {"chacha20poly1305", CRYPTO_CIPHER_CHACHA20_POLY1305},
     {NULL, 0}};
 
 static void StoreCipher(LEX* lc, ResourceItem* item, int index, int pass)
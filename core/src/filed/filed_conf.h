@@ -120,6 +120,10 @@ class ClientResource
   bool always_use_lmdb = false; /* Use LMDB for accurate data */
   uint32_t lmdb_threshold = 0;  /* Switch to using LDMD when number of accurate
                                entries exceeds treshold. */
+  uint32_t restore_writer_threads = 0; /* Threads writing restored files */
+  uint32_t storage_data_connections = 1; /* Connections to the SD per backup */
+  uint32_t verify_digest_threads = 0;  /* Threads computing verify digests */
+  bool tls_kernel_offload = false; /* Use kTLS for connections to the SD */
   X509_KEYPAIR* pki_keypair = nullptr; /* Shared PKI Public/Private Keypair */
   alist* pki_signers = nullptr;        /* Shared PKI Trusted Signers */
   alist* pki_recipients = nullptr;     /* Shared PKI Recipients */
@@ -518,6 +518,26 @@ static int SetOptions(findFOPTS* fo, const char* opts)
                 p += 2;
                 break;
             }
+            break;
+          case 'g':
+            switch (*(p + 2)) {
+              case '1':
+                fo->Encryption_cipher = CRYPTO_CIPHER_AES_128_GCM;
+                p += 2;
+                break;
+              case '2':
+                fo->Encryption_cipher = CRYPTO_CIPHER_AES_256_GCM;
+                p += 2;
+                break;
+            }
+            break;
+          case 'p':
+            switch (*(p + 2)) {
+              case '1':
+                fo->Encryption_cipher = CRYPTO_CIPHER_CHACHA20_POLY1305;
+                p += 2;
+                break;
+            }
         }
         break;
       case 'f':
@@ -599,6 +619,14 @@ static int SetOptions(findFOPTS* fo, const char* opts)
             p++;
             break;
 #endif
+          case '4':
+            SetBit(FO_BLAKE3, fo->flags);
+            p++;
+            break;
+          case '5':
+            SetBit(FO_XXH128, fo->flags);
+            p++;
+            break;
           default:
             /*
              * If 2 or 3 is seen here, SHA2 is not configured, so eat the
@@ -634,6 +662,9 @@ static int SetOptions(findFOPTS* fo, const char* opts)
       case 'X':
         SetBit(FO_XATTR, fo->flags);
         break;
+      case 'D':
+        SetBit(FO_ACL_XATTR_DEDUP, fo->flags);
+        break;
       case 'Z': /* Compression */
         p++;    /* Skip Z */
         if (*p >= '0' && *p <= '9') {
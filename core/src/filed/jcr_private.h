@@ -26,11 +26,16 @@
 
 #include "include/bareos.h"
 
+#include <vector>
+
+class BareosSocket;
+
 struct acl_data_t;
 struct xattr_data_t;
 
 namespace filedaemon {
 class BareosAccurateFilelist;
+class VerifyDigestPool;
 }
 
 /* clang-format off */
@@ -77,9 +82,15 @@ struct JobControlRecordPrivate {
   bool enable_vss{};              /**< VSS used by FD */
   bool got_metadata{};            /**< Set when found job_metadata */
   bool multi_restore{};           /**< Dir can do multiple storage restore */
+  bool compact_attributes{};      /**< Dir accepts compact stat encoding */
   filedaemon::BareosAccurateFilelist* file_list{}; /**< Previous file list (accurate mode) */
   uint64_t base_size{};           /**< Compute space saved with base job */
   filedaemon::save_pkt* plugin_sp{}; /**< Plugin save packet */
+  filedaemon::VerifyDigestPool* verify_pool{}; /**< Digest threads of a verify job */
+  char* stripe_addr{};            /**< SD address for additional data connections */
+  int stripe_port{};              /**< SD port for additional data connections */
+  char* stripe_auth_key{};        /**< Session key for additional data connections */
+  std::vector<BareosSocket*> stripes; /**< Additional data connections to the SD */
 #ifdef HAVE_WIN32
   VSSClient* pVSSClient{};        /**< VSS Client Instance */
 #endif
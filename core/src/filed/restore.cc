@@ -35,6 +35,7 @@
 #include "filed/compression.h"
 #include "filed/crypto.h"
 #include "filed/restore.h"
+#include "filed/restore_writer.h"
 #include "filed/verify.h"
 #include "include/ch.h"
 #include "findlib/create_file.h"
@@ -47,6 +48,9 @@
 #include "lib/edit.h"
 #include "lib/parse_conf.h"
 
+#include <algorithm>
+#include <vector>
+
 #ifdef HAVE_WIN32
 #include "win32/findlib/win32.h"
 #endif
@@ -177,30 +181,32 @@ static inline bool RestoreFinderinfo(JobControlRecord* jcr,
 /**
  * Cleanup of delayed restore stack with streams for later processing.
  */
-static inline void DropDelayedDataStreams(r_ctx& rctx, bool reuse)
+static inline void DropDelayedDataStreams(alist* delayed_streams, bool reuse)
 {
   DelayedDataStream* dds = nullptr;
 
-  if (!rctx.delayed_streams || rctx.delayed_streams->empty()) { return; }
+  if (!delayed_streams || delayed_streams->empty()) { return; }
 
-  foreach_alist (dds, rctx.delayed_streams) {
+  foreach_alist (dds, delayed_streams) {
     free(dds->content);
   }
 
-  rctx.delayed_streams->destroy();
-  if (reuse) { rctx.delayed_streams->init(10, owned_by_alist); }
+  delayed_streams->destroy();
+  if (reuse) { delayed_streams->init(10, owned_by_alist); }
 }
 
 /**
  * Push a data stream onto the delayed restore stack for later processing.
+ * Streams of a directory whose attributes are deferred are kept with them.
  */
 static inline void PushDelayedDataStream(r_ctx& rctx, BareosSocket* sd)
 {
   DelayedDataStream* dds;
+  alist*& delayed_streams = rctx.deferred_dir
+                                ? rctx.deferred_dir->delayed_streams
+                                : rctx.delayed_streams;
 
-  if (!rctx.delayed_streams) {
-    rctx.delayed_streams = new alist(10, owned_by_alist);
-  }
+  if (!delayed_streams) { delayed_streams = new alist(10, owned_by_alist); }
 
   dds = (DelayedDataStream*)malloc(sizeof(DelayedDataStream));
   dds->stream = rctx.stream;
@@ -208,7 +214,7 @@ static inline void PushDelayedDataStream(r_ctx& rctx, BareosSocket* sd)
   memcpy(dds->content, sd->msg, sd->message_length);
   dds->content_length = sd->message_length;
 
-  rctx.delayed_streams->append(dds);
+  delayed_streams->append(dds);
 }
 
 /**
@@ -216,6 +222,7 @@ static inline void PushDelayedDataStream(r_ctx& rctx, BareosSocket* sd)
  * This can either be a delayed restore or direct restore.
  */
 static inline bool do_reStoreAcl(JobControlRecord* jcr,
+                                 POOLMEM* fname,
                                  int stream,
                                  char* content,
                                  uint32_t content_length)
@@ -223,7 +230,7 @@ static inline bool do_reStoreAcl(JobControlRecord* jcr,
 {
   bacl_exit_code retval;
 
-  jcr->impl->acl_data->last_fname = jcr->impl->last_fname;
+  jcr->impl->acl_data->last_fname = fname;
   switch (stream) {
     case STREAM_ACL_PLUGIN:
       retval = plugin_parse_acl_streams(jcr, jcr->impl->acl_data, stream,
@@ -262,13 +269,14 @@ static inline bool do_reStoreAcl(JobControlRecord* jcr,
  * This can either be a delayed restore or direct restore.
  */
 static inline bool do_restore_xattr(JobControlRecord* jcr,
+                                    POOLMEM* fname,
                                     int stream,
                                     char* content,
                                     uint32_t content_length)
 {
   BxattrExitCode retval;
 
-  jcr->impl->xattr_data->last_fname = jcr->impl->last_fname;
+  jcr->impl->xattr_data->last_fname = fname;
   switch (stream) {
     case STREAM_XATTR_PLUGIN:
       retval = PluginParseXattrStreams(jcr, jcr->impl->xattr_data, stream,
@@ -304,14 +312,16 @@ static inline bool do_restore_xattr(JobControlRecord* jcr,
  * attributes otherwise we might clear some security flags
  * by setting the attributes.
  */
-static inline bool PopDelayedDataStreams(JobControlRecord* jcr, r_ctx& rctx)
+static inline bool PopDelayedDataStreams(JobControlRecord* jcr,
+                                         alist* delayed_streams,
+                                         POOLMEM* fname)
 {
   DelayedDataStream* dds = nullptr;
 
   /*
    * See if there is anything todo.
    */
-  if (!rctx.delayed_streams || rctx.delayed_streams->empty()) { return true; }
+  if (!delayed_streams || delayed_streams->empty()) { return true; }
 
   /*
    * Only process known delayed data streams here.
@@ -324,7 +334,7 @@ static inline bool PopDelayedDataStreams(JobControlRecord* jcr, r_ctx& rctx)
    * - *_ACL_*
    * - *_XATTR_*
    */
-  foreach_alist (dds, rctx.delayed_streams) {
+  foreach_alist (dds, delayed_streams) {
     switch (dds->stream) {
       case STREAM_UNIX_ACCESS_ACL:
       case STREAM_UNIX_DEFAULT_ACL:
@@ -348,7 +358,7 @@ static inline bool PopDelayedDataStreams(JobControlRecord* jcr, r_ctx& rctx)
       case STREAM_ACL_FREEBSD_NFS4_ACL:
       case STREAM_ACL_HURD_DEFAULT_ACL:
       case STREAM_ACL_HURD_ACCESS_ACL:
-        if (!do_reStoreAcl(jcr, dds->stream, dds->content,
+        if (!do_reStoreAcl(jcr, fname, dds->stream, dds->content,
                            dds->content_length)) {
           goto bail_out;
         }
@@ -365,7 +375,7 @@ static inline bool PopDelayedDataStreams(JobControlRecord* jcr, r_ctx& rctx)
       case STREAM_XATTR_FREEBSD:
       case STREAM_XATTR_LINUX:
       case STREAM_XATTR_NETBSD:
-        if (!do_restore_xattr(jcr, dds->stream, dds->content,
+        if (!do_restore_xattr(jcr, fname, dds->stream, dds->content,
                               dds->content_length)) {
           goto bail_out;
         }
@@ -382,12 +392,12 @@ static inline bool PopDelayedDataStreams(JobControlRecord* jcr, r_ctx& rctx)
   /*
    * We processed the stack so we can destroy it.
    */
-  rctx.delayed_streams->destroy();
+  delayed_streams->destroy();
 
   /*
    * (Re)Initialize the stack for a new use.
    */
-  rctx.delayed_streams->init(10, owned_by_alist);
+  delayed_streams->init(10, owned_by_alist);
 
   return true;
 
@@ -396,11 +406,141 @@ bail_out:
   /*
    * Destroy the content of the stack and (re)initialize it for a new use.
    */
-  DropDelayedDataStreams(rctx, true);
+  DropDelayedDataStreams(delayed_streams, true);
 
   return false;
 }
 
+/**
+ * Check if a file can be restored by the restore writer pool. Only small
+ * files with plain or compressed data qualify, their data is decoded by the
+ * job thread and kept in memory until a writer creates the file.
+ */
+static inline bool UseRestoreWriter(JobControlRecord* jcr,
+                                    r_ctx& rctx,
+                                    Attributes* attr)
+{
+  if (!rctx.writer || jcr->IsPlugin()) { return false; }
+
+  switch (attr->type) {
+    case FT_REG:
+    case FT_REGE:
+      break;
+    default:
+      return false;
+  }
+
+  if (attr->statp.st_size > RESTORE_WRITER_MAX_FILE_SIZE) { return false; }
+
+  switch (attr->data_stream) {
+    case STREAM_NONE:
+    case STREAM_FILE_DATA:
+    case STREAM_SPARSE_DATA:
+    case STREAM_GZIP_DATA:
+    case STREAM_SPARSE_GZIP_DATA:
+    case STREAM_COMPRESSED_DATA:
+    case STREAM_SPARSE_COMPRESSED_DATA:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Same as ExtractData() for a file restored by the restore writer pool,
+ * the decoded data is added to its write task instead of being written.
+ */
+static int32_t BufferData(JobControlRecord* jcr,
+                          r_ctx& rctx,
+                          POOLMEM* buf,
+                          int32_t buflen)
+{
+  char* wbuf = buf;
+  uint32_t wsize = buflen;
+  unser_declare;
+
+  jcr->ReadBytes += buflen;
+
+  if (BitIsSet(FO_SPARSE, rctx.flags) || BitIsSet(FO_OFFSETS, rctx.flags)) {
+    UnserBegin(wbuf, OFFSET_FADDR_SIZE);
+    unser_uint64(rctx.fileAddr);
+    wbuf += OFFSET_FADDR_SIZE;
+    wsize -= OFFSET_FADDR_SIZE;
+  }
+
+  if (BitIsSet(FO_COMPRESS, rctx.flags)) {
+    if (!DecompressData(jcr, jcr->impl->last_fname, rctx.stream, &wbuf,
+                        &wsize, false)) {
+      return -1;
+    }
+  }
+
+  rctx.task->Append(rctx.fileAddr, wbuf, wsize);
+  jcr->JobBytes += wsize;
+  rctx.fileAddr += wsize;
+
+  return wsize;
+}
+
+/**
+ * Restore the delayed data streams of the files the restore writer pool
+ * has finished and account for the files it could not create.
+ */
+static bool RestoreCompletedWrites(JobControlRecord* jcr, r_ctx& rctx)
+{
+  RestoreWriteTask* task;
+  PoolMem fname(PM_FNAME);
+  bool ok = true;
+
+  while ((task = rctx.writer->NextCompleted())) {
+    PmStrcpy(fname, task->ofname().c_str());
+    if (ok &&
+        !PopDelayedDataStreams(jcr, task->delayed_streams, fname.addr())) {
+      ok = false;
+    }
+    delete task;
+  }
+  jcr->JobFiles -= rctx.writer->TakeFailedFiles();
+
+  return ok;
+}
+
+/**
+ * Set the attributes of the restored directories once the writer pool
+ * created their content, otherwise creating the files would change their
+ * times again. Deeper directories are done first, so restrictive
+ * permissions of a parent do not get in the way. The attributes are also
+ * set when the job failed, as they would have been without the pool.
+ */
+static bool RestoreDeferredDirectories(JobControlRecord* jcr,
+                                       std::vector<SavedAttributes*>& dirs)
+{
+  Attributes* attr = new_attr(jcr);
+  BareosWinFilePacket bfd;
+  PoolMem fname(PM_FNAME);
+  bool ok = true;
+
+  std::stable_sort(dirs.begin(), dirs.end(),
+                   [](const SavedAttributes* a, const SavedAttributes* b) {
+                     return a->ofname() > b->ofname();
+                   });
+
+  binit(&bfd);
+  for (auto dir : dirs) {
+    dir->Unpack(attr);
+    SetAttributes(jcr, attr, &bfd);
+    PmStrcpy(fname, dir->ofname().c_str());
+    if (!PopDelayedDataStreams(jcr, dir->delayed_streams, fname.addr())) {
+      ok = false;
+    }
+    delete dir;
+  }
+  dirs.clear();
+  FreeAttr(attr);
+
+  return ok;
+}
+
 /**
  * Restore the requested files.
  */
@@ -414,6 +554,9 @@ void DoRestore(JobControlRecord* jcr)
   int status;
   int64_t rsrc_len = 0; /* Original length of resource fork */
   r_ctx rctx;
+  AclXattrBlobStore acl_xattr_blobs;
+  uint32_t missing_acl_xattr_blobs = 0;
+  std::vector<SavedAttributes*> deferred_dirs;
   Attributes* attr;
   /* ***FIXME*** make configurable */
   crypto_digest_t signing_algorithm =
@@ -504,6 +647,18 @@ void DoRestore(JobControlRecord* jcr)
     memset(jcr->impl->xattr_data->u.parse, 0, sizeof(xattr_parse_data_t));
   }
 
+  /*
+   * Small files are created and written by a pool of writer threads while
+   * we keep reading from the Storage daemon. Not used when the file data
+   * signatures are verified, as that needs the file content.
+   */
+  if (client && client->restore_writer_threads > 0 && !jcr->keep_path_list &&
+      !jcr->impl->crypto.pki_sign && !have_darwin_os && !have_win32_api()) {
+    if (jcr->dir_bsock) { jcr->dir_bsock->SetLocking(); }
+    rctx.writer = new RestoreWriterPool(jcr, jcr->impl->replace,
+                                        client->restore_writer_threads);
+  }
+
   while (BgetMsg(sd) >= 0 && !JobCanceled(jcr)) {
     /*
      * Remember previous stream type
@@ -541,6 +696,46 @@ void DoRestore(JobControlRecord* jcr)
     Dmsg3(130, "Got stream: %s len=%d extract=%d\n",
           stream_to_ascii(rctx.stream), sd->message_length, rctx.extract);
 
+    /*
+     * Shared ACL and extended attribute contents are kept for the whole
+     * restore, references to them are replaced by the content itself.
+     */
+    switch (rctx.stream) {
+      case STREAM_ACL_XATTR_BLOB:
+        if (!acl_xattr_blobs.Add(sd->msg, sd->message_length)) {
+          Jmsg0(jcr, M_WARNING, 0,
+                _("Invalid shared ACL or Extended attribs record ignored.\n"));
+        }
+        rctx.stream = rctx.prev_stream;
+        continue;
+      case STREAM_ACL_XATTR_REFERENCE: {
+        const std::string* blob;
+        int stream;
+
+        blob = acl_xattr_blobs.Lookup(sd->msg, &stream);
+        if (!blob) {
+          if ((rctx.extract || jcr->impl->last_type == FT_DIREND) &&
+              missing_acl_xattr_blobs++ < ACL_REPORT_ERR_MAX_PER_JOB) {
+            Jmsg2(jcr, M_WARNING, 0,
+                  _("Shared ACL or Extended attribs %s of \"%s\" not found, "
+                    "not restored.\n"),
+                  sd->msg, jcr->impl->last_fname);
+          }
+          rctx.stream = rctx.prev_stream;
+          continue;
+        }
+        sd->msg = CheckPoolMemorySize(sd->msg, blob->size() + 1);
+        memcpy(sd->msg, blob->data(), blob->size());
+        sd->msg[blob->size()] = 0;
+        sd->message_length = blob->size();
+        rctx.size = blob->size();
+        rctx.stream = stream;
+        break;
+      }
+      default:
+        break;
+    }
+
     /*
      * If we change streams, close and reset alternate data streams
      */
@@ -562,10 +757,12 @@ void DoRestore(JobControlRecord* jcr)
     switch (rctx.stream) {
       case STREAM_UNIX_ATTRIBUTES:
       case STREAM_UNIX_ATTRIBUTES_EX:
+      case STREAM_UNIX_ATTRIBUTES_COMPACT:
         /*
          * if any previous stream open, close it
          */
         if (!ClosePreviousStream(jcr, rctx)) { goto bail_out; }
+        rctx.deferred_dir = nullptr;
 
         /*
          * TODO: manage deleted files
@@ -606,6 +803,16 @@ void DoRestore(JobControlRecord* jcr)
 
         BuildAttrOutputFnames(jcr, attr);
 
+        /*
+         * A file restored again or hard linked to must be completely
+         * restored by the writer pool first.
+         */
+        if (rctx.writer) {
+          rctx.writer->WaitFor(attr->ofname);
+          if (attr->type == FT_LNKSAVED) { rctx.writer->WaitFor(attr->olname); }
+          if (!RestoreCompletedWrites(jcr, rctx)) { goto bail_out; }
+        }
+
         /*
          * Try to actually create the file, which returns a status telling
          * us if we need to extract or not.
@@ -614,7 +821,13 @@ void DoRestore(JobControlRecord* jcr)
         rctx.extract = false;
         status = CF_CORE; /* By default, let Bareos's core handle it */
 
-        if (jcr->IsPlugin()) {
+        if (UseRestoreWriter(jcr, rctx, attr)) {
+          /*
+           * The file is created by the writer pool once all data is read
+           */
+          rctx.task = new RestoreWriteTask(attr);
+          status = CF_EXTRACT;
+        } else if (jcr->IsPlugin()) {
           status = PluginCreateFile(jcr, attr, &rctx.bfd, jcr->impl->replace);
         }
 
@@ -665,10 +878,22 @@ void DoRestore(JobControlRecord* jcr)
 
             if (!rctx.extract) {
               /*
-               * Set attributes now because file will not be extracted
+               * Set attributes now because file will not be extracted,
+               * those of directories restored by the writer pool are set
+               * once the pool created their files.
                */
               if (jcr->IsPlugin()) {
                 PluginSetAttributes(jcr, attr, &rctx.bfd);
+              } else if (attr->type == FT_DIREND && rctx.writer) {
+                if (deferred_dirs.size() >= RESTORE_WRITER_MAX_DEFERRED_DIRS) {
+                  rctx.writer->Drain();
+                  if (!RestoreCompletedWrites(jcr, rctx) ||
+                      !RestoreDeferredDirectories(jcr, deferred_dirs)) {
+                    goto bail_out;
+                  }
+                }
+                rctx.deferred_dir = new SavedAttributes(attr);
+                deferred_dirs.push_back(rctx.deferred_dir);
               } else {
                 SetAttributes(jcr, attr, &rctx.bfd);
               }
@@ -786,6 +1011,7 @@ void DoRestore(JobControlRecord* jcr)
             switch (rctx.prev_stream) {
               case STREAM_UNIX_ATTRIBUTES:
               case STREAM_UNIX_ATTRIBUTES_EX:
+              case STREAM_UNIX_ATTRIBUTES_COMPACT:
               case STREAM_ENCRYPTED_SESSION_DATA:
                 process_data = true;
                 break;
@@ -859,9 +1085,16 @@ void DoRestore(JobControlRecord* jcr)
               SetBit(FO_WIN32DECOMP, rctx.flags);
             }
 
-            if (ExtractData(jcr, &rctx.bfd, sd->msg, sd->message_length,
-                            &rctx.fileAddr, rctx.flags, rctx.stream,
-                            &rctx.cipher_ctx) < 0) {
+            if (rctx.task) {
+              if (BufferData(jcr, rctx, sd->msg, sd->message_length) < 0) {
+                rctx.extract = false;
+                delete rctx.task;
+                rctx.task = nullptr;
+                continue;
+              }
+            } else if (ExtractData(jcr, &rctx.bfd, sd->msg, sd->message_length,
+                                   &rctx.fileAddr, rctx.flags, rctx.stream,
+                                   &rctx.cipher_ctx) < 0) {
               rctx.extract = false;
               bclose(&rctx.bfd);
               continue;
@@ -966,10 +1199,11 @@ void DoRestore(JobControlRecord* jcr)
            * For anything that is not a directory we delay
            * the restore of acls till a later stage.
            */
-          if (jcr->impl->last_type != FT_DIREND) {
+          if (jcr->impl->last_type != FT_DIREND || rctx.deferred_dir) {
             PushDelayedDataStream(rctx, sd);
           } else {
-            if (!do_reStoreAcl(jcr, rctx.stream, sd->msg, sd->message_length)) {
+            if (!do_reStoreAcl(jcr, jcr->impl->last_fname, rctx.stream,
+                               sd->msg, sd->message_length)) {
               goto bail_out;
             }
           }
@@ -1004,11 +1238,11 @@ void DoRestore(JobControlRecord* jcr)
            * For anything that is not a directory we delay
            * the restore of xattr till a later stage.
            */
-          if (jcr->impl->last_type != FT_DIREND) {
+          if (jcr->impl->last_type != FT_DIREND || rctx.deferred_dir) {
             PushDelayedDataStream(rctx, sd);
           } else {
-            if (!do_restore_xattr(jcr, rctx.stream, sd->msg,
-                                  sd->message_length)) {
+            if (!do_restore_xattr(jcr, jcr->impl->last_fname, rctx.stream,
+                                  sd->msg, sd->message_length)) {
               goto bail_out;
             }
           }
@@ -1029,8 +1263,8 @@ void DoRestore(JobControlRecord* jcr)
           break;
         }
         if (have_xattr) {
-          if (!do_restore_xattr(jcr, rctx.stream, sd->msg,
-                                sd->message_length)) {
+          if (!do_restore_xattr(jcr, jcr->impl->last_fname, rctx.stream,
+                                sd->msg, sd->message_length)) {
             goto bail_out;
           }
         } else {
@@ -1064,6 +1298,8 @@ void DoRestore(JobControlRecord* jcr)
       case STREAM_SHA1_DIGEST:
       case STREAM_SHA256_DIGEST:
       case STREAM_SHA512_DIGEST:
+      case STREAM_BLAKE3_DIGEST:
+      case STREAM_XXH128_DIGEST:
         break;
 
       case STREAM_PROGRAM_NAMES:
@@ -1076,6 +1312,11 @@ void DoRestore(JobControlRecord* jcr)
 
       case STREAM_PLUGIN_NAME:
         if (!ClosePreviousStream(jcr, rctx)) { goto bail_out; }
+        rctx.deferred_dir = nullptr;
+        if (rctx.writer) {
+          rctx.writer->Drain();
+          if (!RestoreCompletedWrites(jcr, rctx)) { goto bail_out; }
+        }
         Dmsg1(50, "restore stream_plugin_name=%s\n", sd->msg);
         if (!PluginNameStream(jcr, sd->msg)) { goto bail_out; }
         break;
@@ -1102,6 +1343,11 @@ void DoRestore(JobControlRecord* jcr)
   }
 
   if (!ClosePreviousStream(jcr, rctx)) { goto bail_out; }
+  if (rctx.writer) {
+    rctx.writer->Drain();
+    if (!RestoreCompletedWrites(jcr, rctx)) { goto bail_out; }
+  }
+  if (!RestoreDeferredDirectories(jcr, deferred_dirs)) { goto bail_out; }
   jcr->setJobStatus(JS_Terminated);
   goto ok_out;
 
@@ -1109,6 +1355,23 @@ bail_out:
   jcr->setJobStatus(JS_ErrorTerminated);
 
 ok_out:
+  /*
+   * Files still queued are restored and the attributes of the directories
+   * held for them are set, delayed streams of files not yet processed are
+   * dropped.
+   */
+  if (rctx.writer) {
+    delete rctx.writer;
+    rctx.writer = nullptr;
+  }
+  if (rctx.task) {
+    delete rctx.task;
+    rctx.task = nullptr;
+  }
+  if (!deferred_dirs.empty()) {
+    RestoreDeferredDirectories(jcr, deferred_dirs);
+  }
+
 #ifdef HAVE_WIN32
   /*
    * Cleanup the copy thread if we restored any EFS data.
@@ -1209,7 +1472,7 @@ ok_out:
    * Free the delayed stream stack list.
    */
   if (rctx.delayed_streams) {
-    DropDelayedDataStreams(rctx, false);
+    DropDelayedDataStreams(rctx.delayed_streams, false);
     delete rctx.delayed_streams;
   }
 
@@ -1381,6 +1644,26 @@ bail_out:
  */
 static bool ClosePreviousStream(JobControlRecord* jcr, r_ctx& rctx)
 {
+  /*
+   * A file restored by the writer pool is complete now, hand it over
+   * together with its delayed data streams.
+   */
+  if (rctx.extract && rctx.task) {
+    if (rctx.delayed_streams && !rctx.delayed_streams->empty()) {
+      rctx.task->delayed_streams = rctx.delayed_streams;
+      rctx.delayed_streams = nullptr;
+    }
+    rctx.writer->Submit(rctx.task);
+    rctx.task = nullptr;
+    rctx.extract = false;
+
+    FreeSignature(rctx);
+    FreeSession(rctx);
+    ClearAllBits(FO_MAX, rctx.jcr->impl->ff->flags);
+    Dmsg0(130, "Stop extracting.\n");
+    return true;
+  }
+
   /*
    * If extracting, it was from previous stream, so
    * close the output file and validate the signature.
@@ -1412,7 +1695,10 @@ static bool ClosePreviousStream(JobControlRecord* jcr, r_ctx& rctx)
     /*
      * Now perform the delayed restore of some specific data streams.
      */
-    if (!PopDelayedDataStreams(jcr, rctx)) { return false; }
+    if (!PopDelayedDataStreams(jcr, rctx.delayed_streams,
+                               jcr->impl->last_fname)) {
+      return false;
+    }
 
     /*
      * Verify the cryptographic signature, if any
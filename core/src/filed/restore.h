@@ -29,6 +29,10 @@ class alist;
 
 namespace filedaemon {
 
+class RestoreWriterPool;
+class RestoreWriteTask;
+class SavedAttributes;
+
 struct DelayedDataStream {
   int32_t stream;          /* stream less new bits */
   char* content;           /* stream data */
@@ -68,6 +72,10 @@ struct r_ctx {
   RestoreCipherContext cipher_ctx{0}; /* Cryptographic restore context (if any) for file */
   RestoreCipherContext fork_cipher_ctx{0}; /* Cryptographic restore context (if any)
                                               for alternative stream */
+  RestoreWriterPool* writer{nullptr};      /* Pool writing small files (if any) */
+  RestoreWriteTask* task{nullptr};         /* File restored by the writer pool */
+  SavedAttributes* deferred_dir{nullptr};  /* Directory whose attributes are
+                                              set at the end of the restore */
 };
 /* clang-format on */
 
@@ -0,0 +1,299 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Pool of threads creating and writing restored files.
+ */
+
+#include "include/bareos.h"
+#include "filed/filed.h"
+#include "filed/restore.h"
+#include "filed/restore_writer.h"
+#include "findlib/attribs.h"
+#include "findlib/create_file.h"
+#include "lib/attr.h"
+#include "lib/berrno.h"
+#include "lib/edit.h"
+#include "lib/thread_specific_data.h"
+
+namespace filedaemon {
+
+static char empty_string[] = "";
+
+SavedAttributes::SavedAttributes(Attributes* attr)
+    : stream_(attr->stream)
+    , data_stream_(attr->data_stream)
+    , type_(attr->type)
+    , file_index_(attr->file_index)
+    , LinkFI_(attr->LinkFI)
+    , delta_seq_(attr->delta_seq)
+    , statp_(attr->statp)
+    , fname_(attr->fname)
+    , ofname_(attr->ofname)
+    , olname_(attr->olname)
+    , attrEx_(attr->attrEx)
+{
+}
+
+SavedAttributes::~SavedAttributes()
+{
+  DelayedDataStream* dds = nullptr;
+
+  if (delayed_streams) {
+    foreach_alist (dds, delayed_streams) {
+      free(dds->content);
+    }
+    delete delayed_streams;
+  }
+}
+
+/**
+ * Fill attr with the saved attributes, attr->fname stays valid as long
+ * as this object exists.
+ */
+void SavedAttributes::Unpack(Attributes* attr) const
+{
+  attr->stream = stream_;
+  attr->data_stream = data_stream_;
+  attr->type = type_;
+  attr->file_index = file_index_;
+  attr->LinkFI = LinkFI_;
+  attr->delta_seq = delta_seq_;
+  attr->statp = statp_;
+  attr->fname = const_cast<char*>(fname_.c_str());
+  attr->attr = empty_string;
+  attr->lname = empty_string;
+  PmStrcpy(attr->ofname, ofname_.c_str());
+  PmStrcpy(attr->olname, olname_.c_str());
+  PmStrcpy(attr->attrEx, attrEx_.c_str());
+}
+
+/**
+ * Add decoded file data to be written at addr.
+ */
+void RestoreWriteTask::Append(uint64_t addr, const char* data, uint32_t length)
+{
+  if (!chunks_.empty() &&
+      chunks_.back().addr + chunks_.back().data.size() == addr) {
+    chunks_.back().data.append(data, length);
+  } else {
+    chunks_.push_back(Chunk{addr, std::string(data, length)});
+  }
+  size_ += length;
+}
+
+RestoreWriterPool::RestoreWriterPool(JobControlRecord* jcr,
+                                     int replace,
+                                     int nr_threads)
+    : jcr_(jcr), replace_(replace)
+{
+  for (int i = 0; i < nr_threads; i++) {
+    threads_.emplace_back(&RestoreWriterPool::Work, this);
+  }
+  Dmsg1(100, "Started %d restore writer threads\n", nr_threads);
+}
+
+RestoreWriterPool::~RestoreWriterPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) { thread.join(); }
+
+  for (auto task : completed_) { delete task; }
+}
+
+/**
+ * Queue a file for restore, waits while too much data is queued already.
+ */
+void RestoreWriterPool::Submit(RestoreWriteTask* task)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  done_cv_.wait(lock, [this] {
+    return queue_.size() < RESTORE_WRITER_MAX_QUEUED_FILES &&
+           queued_bytes_ < RESTORE_WRITER_MAX_QUEUED_BYTES;
+  });
+  pending_names_[task->ofname()]++;
+  queue_.push_back(task);
+  queued_bytes_ += task->size();
+  pending_++;
+  work_cv_.notify_one();
+}
+
+/**
+ * Wait until no file with this name is being restored by the pool, used
+ * before the same name is restored again or hard linked to.
+ */
+void RestoreWriterPool::WaitFor(const char* ofname)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (pending_names_.empty()) { return; }
+  std::string name(ofname);
+  done_cv_.wait(lock, [this, &name] {
+    return pending_names_.find(name) == pending_names_.end();
+  });
+}
+
+/**
+ * Wait until all queued files are restored.
+ */
+void RestoreWriterPool::Drain()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+/**
+ * Return the next restored file which still has delayed data streams to
+ * be restored by the job thread, nullptr if there is none.
+ */
+RestoreWriteTask* RestoreWriterPool::NextCompleted()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  RestoreWriteTask* task = nullptr;
+
+  if (!completed_.empty()) {
+    task = completed_.front();
+    completed_.pop_front();
+  }
+
+  return task;
+}
+
+/**
+ * Return the number of files that could not be created since the last call.
+ */
+uint32_t RestoreWriterPool::TakeFailedFiles()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t failed = failed_files_;
+
+  failed_files_ = 0;
+
+  return failed;
+}
+
+void RestoreWriterPool::Work()
+{
+  Attributes* attr = new_attr(jcr_);
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  SetJcrInThreadSpecificData(jcr_);
+  while (true) {
+    RestoreWriteTask* task;
+
+    work_cv_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+    if (queue_.empty()) { break; }
+
+    task = queue_.front();
+    queue_.pop_front();
+    queued_bytes_ -= task->size();
+    done_cv_.notify_all();
+
+    lock.unlock();
+    if (!JobCanceled(jcr_)) { Write(task, attr); }
+    std::vector<RestoreWriteTask::Chunk>().swap(task->chunks_);
+    lock.lock();
+
+    auto name = pending_names_.find(task->ofname());
+    if (--name->second == 0) { pending_names_.erase(name); }
+    pending_--;
+
+    if (task->created_ && task->delayed_streams &&
+        !task->delayed_streams->empty()) {
+      completed_.push_back(task);
+    } else {
+      delete task;
+    }
+    done_cv_.notify_all();
+  }
+  lock.unlock();
+
+  RemoveJcrFromThreadSpecificData(jcr_);
+  FreeAttr(attr);
+}
+
+void RestoreWriterPool::CountFailedFile()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  failed_files_++;
+}
+
+/**
+ * Create a file, write its data and set its attributes.
+ */
+void RestoreWriterPool::Write(RestoreWriteTask* task, Attributes* attr)
+{
+  BareosWinFilePacket bfd;
+  uint64_t addr = 0;
+  char ec1[50];
+
+  task->Unpack(attr);
+  binit(&bfd);
+
+  switch (CreateFile(jcr_, attr, &bfd, replace_)) {
+    case CF_ERROR:
+      CountFailedFile();
+      return;
+    case CF_SKIP:
+      return;
+    case CF_EXTRACT:
+      for (auto& chunk : task->chunks_) {
+        if (chunk.addr != addr) {
+          if (blseek(&bfd, (boffset_t)chunk.addr, SEEK_SET) < 0) {
+            BErrNo be;
+            Qmsg3(jcr_, M_ERROR, 0, _("Seek to %s error on %s: ERR=%s\n"),
+                  edit_uint64(chunk.addr, ec1), task->ofname().c_str(),
+                  be.bstrerror(bfd.BErrNo));
+            bclose(&bfd);
+            CountFailedFile();
+            return;
+          }
+          addr = chunk.addr;
+        }
+
+        if (bwrite(&bfd, const_cast<char*>(chunk.data.data()),
+                   chunk.data.size()) != (ssize_t)chunk.data.size()) {
+          BErrNo be;
+          Qmsg2(jcr_, M_ERROR, 0, _("Write error on %s: %s\n"),
+                task->ofname().c_str(), be.bstrerror(bfd.BErrNo));
+          bclose(&bfd);
+          CountFailedFile();
+          return;
+        }
+        addr += chunk.data.size();
+      }
+      /*
+       * FALLTHROUGH
+       */
+    case CF_CREATED:
+      SetAttributes(jcr_, attr, &bfd);
+      task->created_ = true;
+      break;
+  }
+}
+
+} /* namespace filedaemon */
@@ -0,0 +1,147 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Pool of threads creating and writing restored files.
+ *
+ * Restoring many small files is bound by the latency of creating the file,
+ * writing it and setting its attributes. The job thread keeps reading and
+ * decoding the data from the storage daemon and hands complete small files
+ * to a pool of writers, which create them concurrently.
+ */
+
+#ifndef BAREOS_FILED_RESTORE_WRITER_H_
+#define BAREOS_FILED_RESTORE_WRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class alist;
+struct Attributes;
+
+namespace filedaemon {
+
+/*
+ * Only files up to this size are given to the writers, their decoded data
+ * is kept in memory until written. At most this amount of data waits for a
+ * writer.
+ */
+#define RESTORE_WRITER_MAX_FILE_SIZE (1024 * 1024)
+#define RESTORE_WRITER_MAX_QUEUED_BYTES (64 * 1024 * 1024)
+#define RESTORE_WRITER_MAX_QUEUED_FILES 4096
+
+/*
+ * Directory attributes are set once the writers created the files in them.
+ * When this many directories are held, the writers are drained and the
+ * attributes are set.
+ */
+#define RESTORE_WRITER_MAX_DEFERRED_DIRS 4096
+
+/**
+ * Compact copy of the attributes of a file whose restore is finished after
+ * its attributes record was read, together with the ACL and extended
+ * attribute streams to restore after its attributes are set.
+ */
+class SavedAttributes {
+ public:
+  explicit SavedAttributes(Attributes* attr);
+  ~SavedAttributes();
+
+  void Unpack(Attributes* attr) const;
+  const std::string& ofname() const { return ofname_; }
+
+  alist* delayed_streams{nullptr};
+
+ private:
+  int32_t stream_;
+  int32_t data_stream_;
+  int32_t type_;
+  int32_t file_index_;
+  int32_t LinkFI_;
+  int32_t delta_seq_;
+  struct stat statp_;
+  std::string fname_;
+  std::string ofname_;
+  std::string olname_;
+  std::string attrEx_;
+};
+
+/**
+ * A file restored by the writer pool.
+ */
+class RestoreWriteTask : public SavedAttributes {
+ public:
+  explicit RestoreWriteTask(Attributes* attr) : SavedAttributes(attr) {}
+
+  void Append(uint64_t addr, const char* data, uint32_t length);
+  uint64_t size() const { return size_; }
+
+ private:
+  friend class RestoreWriterPool;
+
+  struct Chunk {
+    uint64_t addr;
+    std::string data;
+  };
+
+  std::vector<Chunk> chunks_;
+  uint64_t size_{0};
+  bool created_{false};
+};
+
+class RestoreWriterPool {
+ public:
+  RestoreWriterPool(JobControlRecord* jcr, int replace, int nr_threads);
+  ~RestoreWriterPool();
+
+  void Submit(RestoreWriteTask* task);
+  void WaitFor(const char* ofname);
+  void Drain();
+  RestoreWriteTask* NextCompleted();
+  uint32_t TakeFailedFiles();
+
+ private:
+  void Work();
+  void Write(RestoreWriteTask* task, Attributes* attr);
+  void CountFailedFile();
+
+  JobControlRecord* jcr_;
+  int replace_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::deque<RestoreWriteTask*> queue_;
+  std::deque<RestoreWriteTask*> completed_;
+  std::unordered_map<std::string, int> pending_names_;
+  uint64_t queued_bytes_{0};
+  uint32_t pending_{0};
+  uint32_t failed_files_{0};
+  bool quit_{false};
+};
+
+} /* namespace filedaemon */
+#endif  // BAREOS_FILED_RESTORE_WRITER_H_
@@ -63,6 +63,11 @@ static void* HandleConnectionRequest(ConfigurationParser* config, void* arg)
 {
   BareosSocket* bs = (BareosSocket*)arg;
 
+  /*
+   * The kind of connection is only known after the TLS handshake, so all
+   * connections accepted by the daemon use the kernel offload if enabled.
+   */
+  bs->SetTlsKernelOffload(me->tls_kernel_offload);
   if (!TryTlsHandshakeAsAServer(bs, config)) {
     bs->signal(BNET_TERMINATE);
     bs->close();
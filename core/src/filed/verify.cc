@@ -29,15 +29,29 @@
 
 #include "include/bareos.h"
 #include "filed/filed.h"
+#include "filed/filed_globals.h"
 #include "filed/jcr_private.h"
+#include "filed/verify.h"
 #include "findlib/find.h"
 #include "findlib/attribs.h"
 #include "lib/attribs.h"
 #include "lib/berrno.h"
 #include "lib/bnet.h"
 #include "lib/bsock.h"
+#include "lib/edit.h"
+#include "lib/parse_conf.h"
+#include "lib/thread_specific_data.h"
 #include "lib/util.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace filedaemon {
 
 #ifdef HAVE_DARWIN_OS
@@ -46,10 +60,10 @@ const bool have_darwin_os = true;
 const bool have_darwin_os = false;
 #endif
 
-static int VerifyFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool);
 static int ReadDigest(BareosWinFilePacket* bfd,
                       DIGEST* digest,
-                      JobControlRecord* jcr);
+                      JobControlRecord* jcr,
+                      FindFilesPacket* ff_pkt);
 static bool calculate_file_chksum(JobControlRecord* jcr,
                                   FindFilesPacket* ff_pkt,
                                   DIGEST** digest,
@@ -57,6 +71,191 @@ static bool calculate_file_chksum(JobControlRecord* jcr,
                                   char** digest_buf,
                                   const char** digest_name);
 
+/*
+ * With "Verify Digest Threads" set, the files of a verify job are read and
+ * digested by a pool of threads. The Director expects the digest of a file
+ * right after its attributes, so the records of all files are queued in the
+ * order they are found and sent by the job thread as soon as the record at
+ * the head of the queue is complete. At most this many records are queued.
+ */
+#define VERIFY_DIGEST_MAX_QUEUED 1024
+
+/**
+ * Attributes record of a file, with its digest computed by the pool.
+ */
+struct VerifyRecord {
+  ~VerifyRecord();
+
+  std::string attributes;                 /**< Record for the Director */
+  int32_t file_index{0};                  /**< FileIndex sent */
+  std::string fname;                      /**< File to digest */
+  std::unique_ptr<FindFilesPacket> ff_pkt; /**< Set when a digest is wanted */
+  bool done{false};                       /**< Record can be sent */
+  bool calculated{false};                 /**< Digest calculation succeeded */
+  int digest_stream{STREAM_NONE};
+  DIGEST* digest{nullptr};
+  char* digest_buf{nullptr};
+  const char* digest_name{nullptr};
+};
+
+static void SendDigest(JobControlRecord* jcr,
+                       int32_t file_index,
+                       int digest_stream,
+                       DIGEST* digest,
+                       const char* digest_buf,
+                       const char* digest_name);
+static bool SendRecord(JobControlRecord* jcr, VerifyRecord* record);
+
+class VerifyDigestPool {
+ public:
+  VerifyDigestPool(JobControlRecord* jcr, int nr_threads);
+  ~VerifyDigestPool();
+
+  void Queue(VerifyRecord* record);
+  bool Send(size_t max_queued);
+
+ private:
+  void Work();
+
+  JobControlRecord* jcr_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::deque<VerifyRecord*> records_; /* All records in file order */
+  std::deque<VerifyRecord*> work_;    /* Records waiting for their digest */
+  bool quit_{false};
+};
+
+VerifyRecord::~VerifyRecord()
+{
+  if (digest_buf) { free(digest_buf); }
+  if (digest) { CryptoDigestFree(digest); }
+}
+
+VerifyDigestPool::VerifyDigestPool(JobControlRecord* jcr, int nr_threads)
+    : jcr_(jcr)
+{
+  for (int i = 0; i < nr_threads; i++) {
+    threads_.emplace_back(&VerifyDigestPool::Work, this);
+  }
+  Dmsg1(100, "Started %d verify digest threads\n", nr_threads);
+}
+
+VerifyDigestPool::~VerifyDigestPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) { thread.join(); }
+
+  for (auto record : records_) { delete record; }
+}
+
+/**
+ * Add the record of the next file, its digest is computed by the pool when
+ * record->ff_pkt is set.
+ */
+void VerifyDigestPool::Queue(VerifyRecord* record)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  records_.push_back(record);
+  if (record->ff_pkt) {
+    work_.push_back(record);
+    work_cv_.notify_one();
+  } else {
+    record->done = true;
+  }
+}
+
+/**
+ * Send the complete records at the head of the queue to the Director,
+ * waiting for the head as long as more than max_queued records are queued.
+ */
+bool VerifyDigestPool::Send(size_t max_queued)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!records_.empty()) {
+    VerifyRecord* record = records_.front();
+
+    if (!record->done) {
+      if (records_.size() <= max_queued) { break; }
+      done_cv_.wait(lock, [record] { return record->done; });
+    }
+    records_.pop_front();
+
+    lock.unlock();
+    bool ok = SendRecord(jcr_, record);
+    delete record;
+    if (!ok) { return false; }
+    lock.lock();
+  }
+
+  return true;
+}
+
+void VerifyDigestPool::Work()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  SetJcrInThreadSpecificData(jcr_);
+  while (true) {
+    VerifyRecord* record;
+
+    work_cv_.wait(lock, [this] { return quit_ || !work_.empty(); });
+    if (quit_) { break; }
+
+    record = work_.front();
+    work_.pop_front();
+
+    lock.unlock();
+    if (!JobCanceled(jcr_)) {
+      record->calculated = calculate_file_chksum(
+          jcr_, record->ff_pkt.get(), &record->digest, &record->digest_stream,
+          &record->digest_buf, &record->digest_name);
+    }
+    lock.lock();
+
+    record->done = true;
+    done_cv_.notify_all();
+  }
+  lock.unlock();
+
+  RemoveJcrFromThreadSpecificData(jcr_);
+}
+
+/**
+ * Let a pool of threads compute the digests of the files VerifyFile() is
+ * called for. The digest threads report errors themselves, so the Director
+ * socket is used by more than one thread.
+ */
+void StartVerifyDigestThreads(JobControlRecord* jcr, int nr_threads)
+{
+  if (jcr->dir_bsock) { jcr->dir_bsock->SetLocking(); }
+  jcr->impl->verify_pool = new VerifyDigestPool(jcr, nr_threads);
+}
+
+/**
+ * Stop the digest threads, when send is set after sending all records
+ * still queued. Returns false if sending failed.
+ */
+bool StopVerifyDigestThreads(JobControlRecord* jcr, bool send)
+{
+  bool ok = true;
+
+  if (!jcr->impl->verify_pool) { return true; }
+
+  if (send) { ok = jcr->impl->verify_pool->Send(0); }
+  delete jcr->impl->verify_pool;
+  jcr->impl->verify_pool = NULL;
+
+  return ok;
+}
+
 /**
  * Find all the requested files and send attributes
  * to the Director.
@@ -64,6 +263,8 @@ static bool calculate_file_chksum(JobControlRecord* jcr,
  */
 void DoVerify(JobControlRecord* jcr)
 {
+  int nr_threads = 1;
+
   jcr->setJobStatus(JS_Running);
   jcr->buf_size = DEFAULT_NETWORK_BUFFER_SIZE;
   if ((jcr->impl->big_buf = (char*)malloc(jcr->buf_size)) == NULL) {
@@ -72,11 +273,50 @@ void DoVerify(JobControlRecord* jcr)
   }
   SetFindOptions((FindFilesPacket*)jcr->impl->ff, jcr->impl->incremental,
                  jcr->impl->since_time);
+
+  LockRes(my_config);
+  ClientResource* client =
+      (ClientResource*)my_config->GetNextRes(R_CLIENT, NULL);
+  UnlockRes(my_config);
+
+  if (client && client->verify_digest_threads > 0 && !have_darwin_os) {
+    nr_threads = client->verify_digest_threads;
+    StartVerifyDigestThreads(jcr, nr_threads);
+  }
+
+  auto start = std::chrono::steady_clock::now();
   Dmsg0(10, "Start find files\n");
   /* Subroutine VerifyFile() is called for each file */
-  FindFiles(jcr, (FindFilesPacket*)jcr->impl->ff, VerifyFile, NULL);
+  bool found =
+      FindFiles(jcr, (FindFilesPacket*)jcr->impl->ff, VerifyFile, NULL);
+  if (!StopVerifyDigestThreads(jcr, found)) {
+    /*
+     * Sending the queued records failed, the error is already reported.
+     */
+    jcr->setJobStatus(JS_ErrorTerminated);
+  }
   Dmsg0(10, "End find files\n");
 
+  /*
+   * Report the digest throughput, JobBytes only counts the bytes read for
+   * computing digests.
+   */
+  if (jcr->JobBytes > 0 && !JobCanceled(jcr)) {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double kbps = 0;
+    char ec1[50];
+
+    if (elapsed.count() > 0) {
+      kbps = (double)jcr->JobBytes / (1000.0 * elapsed.count());
+    }
+    Jmsg(jcr, M_INFO, 0,
+         _("Computed digests of %s bytes in %.1f sec (%.1f KB/s) using %d "
+           "thread(s).\n"),
+         edit_uint64_with_commas(jcr->JobBytes, ec1), elapsed.count(), kbps,
+         nr_threads);
+  }
+
   if (jcr->impl->big_buf) {
     free(jcr->impl->big_buf);
     jcr->impl->big_buf = NULL;
@@ -89,12 +329,11 @@ void DoVerify(JobControlRecord* jcr)
  *
  *  Find the file, compute the MD5 or SHA1 and send it back to the Director
  */
-static int VerifyFile(JobControlRecord* jcr,
-                      FindFilesPacket* ff_pkt,
-                      bool top_level)
+int VerifyFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool top_level)
 {
-  PoolMem attribs(PM_NAME), attribsEx(PM_NAME);
-  int status;
+  PoolMem attribs(PM_NAME), attribsEx(PM_NAME), record(PM_MESSAGE);
+  int length;
+  bool want_digest;
   BareosSocket* dir;
 
   if (JobCanceled(jcr)) { return 0; }
@@ -220,34 +459,63 @@ static int VerifyFile(JobControlRecord* jcr,
    */
   Dmsg2(400, "send Attributes inx=%d fname=%s\n", jcr->JobFiles, ff_pkt->fname);
   if (ff_pkt->type == FT_LNK || ff_pkt->type == FT_LNKSAVED) {
-    status = dir->fsend("%d %d %s %s%c%s%c%s%c", jcr->JobFiles,
-                        STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts,
-                        ff_pkt->fname, 0, attribs.c_str(), 0, ff_pkt->link, 0);
+    length = Mmsg(record, "%d %d %s %s%c%s%c%s%c", jcr->JobFiles,
+                  STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts, ff_pkt->fname, 0,
+                  attribs.c_str(), 0, ff_pkt->link, 0);
   } else if (ff_pkt->type == FT_DIREND || ff_pkt->type == FT_REPARSE ||
              ff_pkt->type == FT_JUNCTION) {
     /*
      * Here link is the canonical filename (i.e. with trailing slash)
      */
-    status =
-        dir->fsend("%d %d %s %s%c%s%c%c", jcr->JobFiles, STREAM_UNIX_ATTRIBUTES,
-                   ff_pkt->VerifyOpts, ff_pkt->link, 0, attribs.c_str(), 0, 0);
+    length = Mmsg(record, "%d %d %s %s%c%s%c%c", jcr->JobFiles,
+                  STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts, ff_pkt->link, 0,
+                  attribs.c_str(), 0, 0);
   } else {
-    status =
-        dir->fsend("%d %d %s %s%c%s%c%c", jcr->JobFiles, STREAM_UNIX_ATTRIBUTES,
-                   ff_pkt->VerifyOpts, ff_pkt->fname, 0, attribs.c_str(), 0, 0);
+    length = Mmsg(record, "%d %d %s %s%c%s%c%c", jcr->JobFiles,
+                  STREAM_UNIX_ATTRIBUTES, ff_pkt->VerifyOpts, ff_pkt->fname, 0,
+                  attribs.c_str(), 0, 0);
   }
-  Dmsg2(20, "filed>dir: attribs len=%d: msg=%s\n", dir->message_length,
-        dir->msg);
-  if (!status) {
+
+  want_digest =
+      ff_pkt->type != FT_LNKSAVED && S_ISREG(ff_pkt->statp.st_mode) &&
+      (BitIsSet(FO_MD5, ff_pkt->flags) || BitIsSet(FO_SHA1, ff_pkt->flags) ||
+       BitIsSet(FO_SHA256, ff_pkt->flags) ||
+       BitIsSet(FO_SHA512, ff_pkt->flags) ||
+       BitIsSet(FO_BLAKE3, ff_pkt->flags) ||
+       BitIsSet(FO_XXH128, ff_pkt->flags));
+
+  /*
+   * Let the digest threads read the file, the record is sent once its
+   * digest is known.
+   */
+  if (jcr->impl->verify_pool) {
+    VerifyRecord* vr = new VerifyRecord;
+
+    vr->attributes.assign(record.c_str(), length);
+    vr->file_index = jcr->JobFiles;
+    if (want_digest) {
+      vr->fname.assign(ff_pkt->fname);
+      vr->ff_pkt.reset(new FindFilesPacket);
+      vr->ff_pkt->fname = const_cast<char*>(vr->fname.c_str());
+      vr->ff_pkt->type = ff_pkt->type;
+      vr->ff_pkt->statp = ff_pkt->statp;
+      memcpy(vr->ff_pkt->flags, ff_pkt->flags, sizeof(ff_pkt->flags));
+      vr->ff_pkt->hfsinfo = ff_pkt->hfsinfo;
+    }
+    jcr->impl->verify_pool->Queue(vr);
+
+    return jcr->impl->verify_pool->Send(VERIFY_DIGEST_MAX_QUEUED) ? 1 : 0;
+  }
+
+  if (!dir->send(record.c_str(), length)) {
     Jmsg(jcr, M_FATAL, 0, _("Network error in send to Director: ERR=%s\n"),
          BnetStrerror(dir));
     return 0;
   }
+  Dmsg2(20, "filed>dir: attribs len=%d: msg=%s\n", dir->message_length,
+        dir->msg);
 
-  if (ff_pkt->type != FT_LNKSAVED && S_ISREG(ff_pkt->statp.st_mode) &&
-      (BitIsSet(FO_MD5, ff_pkt->flags) || BitIsSet(FO_SHA1, ff_pkt->flags) ||
-       BitIsSet(FO_SHA256, ff_pkt->flags) ||
-       BitIsSet(FO_SHA512, ff_pkt->flags))) {
+  if (want_digest) {
     int digest_stream = STREAM_NONE;
     DIGEST* digest = NULL;
     char* digest_buf = NULL;
@@ -255,20 +523,8 @@ static int VerifyFile(JobControlRecord* jcr,
 
     if (calculate_file_chksum(jcr, ff_pkt, &digest, &digest_stream, &digest_buf,
                               &digest_name)) {
-      /*
-       * Did digest initialization fail?
-       */
-      if (digest_stream != STREAM_NONE && digest == NULL) {
-        Jmsg(jcr, M_WARNING, 0, _("%s digest initialization failed\n"),
-             stream_to_ascii(digest_stream));
-      } else if (digest && digest_buf) {
-        Dmsg3(400, "send inx=%d %s=%s\n", jcr->JobFiles, digest_name,
-              digest_buf);
-        dir->fsend("%d %d %s *%s-%d*", jcr->JobFiles, digest_stream, digest_buf,
-                   digest_name, jcr->JobFiles);
-        Dmsg3(20, "filed>dir: %s len=%d: msg=%s\n", digest_name,
-              dir->message_length, dir->msg);
-      }
+      SendDigest(jcr, jcr->JobFiles, digest_stream, digest, digest_buf,
+                 digest_name);
     }
 
     /*
@@ -282,6 +538,56 @@ static int VerifyFile(JobControlRecord* jcr,
   return 1;
 }
 
+/**
+ * Send the digest of a file to the Director.
+ */
+static void SendDigest(JobControlRecord* jcr,
+                       int32_t file_index,
+                       int digest_stream,
+                       DIGEST* digest,
+                       const char* digest_buf,
+                       const char* digest_name)
+{
+  BareosSocket* dir = jcr->dir_bsock;
+
+  /*
+   * Did digest initialization fail?
+   */
+  if (digest_stream != STREAM_NONE && digest == NULL) {
+    Jmsg(jcr, M_WARNING, 0, _("%s digest initialization failed\n"),
+         stream_to_ascii(digest_stream));
+  } else if (digest && digest_buf) {
+    Dmsg3(400, "send inx=%d %s=%s\n", file_index, digest_name, digest_buf);
+    dir->fsend("%d %d %s *%s-%d*", file_index, digest_stream, digest_buf,
+               digest_name, file_index);
+    Dmsg3(20, "filed>dir: %s len=%d: msg=%s\n", digest_name,
+          dir->message_length, dir->msg);
+  }
+}
+
+/**
+ * Send a record queued in the verify digest pool to the Director.
+ */
+static bool SendRecord(JobControlRecord* jcr, VerifyRecord* record)
+{
+  BareosSocket* dir = jcr->dir_bsock;
+
+  if (!dir->send(record->attributes.c_str(), record->attributes.size())) {
+    Jmsg(jcr, M_FATAL, 0, _("Network error in send to Director: ERR=%s\n"),
+         BnetStrerror(dir));
+    return false;
+  }
+  Dmsg2(20, "filed>dir: attribs len=%d: msg=%s\n", dir->message_length,
+        dir->msg);
+
+  if (record->ff_pkt && record->calculated) {
+    SendDigest(jcr, record->file_index, record->digest_stream, record->digest,
+               record->digest_buf, record->digest_name);
+  }
+
+  return true;
+}
+
 /**
  * Compute message digest for the file specified by ff_pkt.
  * In case of errors we need the job control record and file name.
@@ -294,8 +600,8 @@ int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest)
 
   int noatime = BitIsSet(FO_NOATIME, ff_pkt->flags) ? O_NOATIME : 0;
 
-  if ((bopen(&bfd, ff_pkt->fname, O_RDONLY | O_BINARY | noatime, 0,
-             ff_pkt->statp.st_rdev)) < 0) {
+  if ((BopenAt(&bfd, ff_pkt->dir_fd, ff_pkt->dir_relname, ff_pkt->fname,
+               O_RDONLY | O_BINARY | noatime, 0, ff_pkt->statp.st_rdev)) < 0) {
     ff_pkt->ff_errno = errno;
     BErrNo be;
     be.SetErrno(bfd.BErrNo);
@@ -304,7 +610,7 @@ int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest)
          be.bstrerror());
     return 1;
   }
-  ReadDigest(&bfd, digest, jcr);
+  ReadDigest(&bfd, digest, jcr, ff_pkt);
   bclose(&bfd);
 
   if (have_darwin_os) {
@@ -321,7 +627,7 @@ int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest)
         if (IsBopen(&ff_pkt->bfd)) { bclose(&ff_pkt->bfd); }
         return 1;
       }
-      ReadDigest(&bfd, digest, jcr);
+      ReadDigest(&bfd, digest, jcr, ff_pkt);
       bclose(&bfd);
     }
 
@@ -338,14 +644,14 @@ int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest)
  */
 static int ReadDigest(BareosWinFilePacket* bfd,
                       DIGEST* digest,
-                      JobControlRecord* jcr)
+                      JobControlRecord* jcr,
+                      FindFilesPacket* ff_pkt)
 {
   char buf[DEFAULT_NETWORK_BUFFER_SIZE];
   int64_t n;
   int64_t bufsiz = (int64_t)sizeof(buf);
-  FindFilesPacket* ff_pkt = (FindFilesPacket*)jcr->impl->ff;
   uint64_t fileAddr = 0; /* file address */
-
+  bool pooled = jcr->impl->verify_pool != NULL;
 
   Dmsg0(50, "=== ReadDigest\n");
   while ((n = bread(bfd, buf, bufsiz)) > 0) {
@@ -365,19 +671,23 @@ static int ReadDigest(BareosWinFilePacket* bfd,
     CryptoDigestUpdate(digest, (uint8_t*)buf, n);
 
     /* Can be used by BaseJobs or with accurate, update only for Verify
-     * jobs
+     * jobs. Only the digest threads of a verify job need the lock.
      */
+    if (pooled) { jcr->lock(); }
     if (jcr->is_JobType(JT_VERIFY)) { jcr->JobBytes += n; }
     jcr->ReadBytes += n;
+    if (pooled) { jcr->unlock(); }
   }
   if (n < 0) {
     BErrNo be;
     be.SetErrno(bfd->BErrNo);
-    Dmsg2(100, "Error reading file %s: ERR=%s\n", jcr->impl->last_fname,
+    Dmsg2(100, "Error reading file %s: ERR=%s\n", ff_pkt->fname,
           be.bstrerror());
     Jmsg(jcr, M_ERROR, 1, _("Error reading file %s: ERR=%s\n"),
-         jcr->impl->last_fname, be.bstrerror());
+         ff_pkt->fname, be.bstrerror());
+    jcr->lock();
     jcr->JobErrors++;
+    jcr->unlock();
     return -1;
   }
   return 0;
@@ -416,6 +726,12 @@ static bool calculate_file_chksum(JobControlRecord* jcr,
   } else if (BitIsSet(FO_SHA512, ff_pkt->flags)) {
     *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_SHA512);
     *digest_stream = STREAM_SHA512_DIGEST;
+  } else if (BitIsSet(FO_BLAKE3, ff_pkt->flags)) {
+    *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_BLAKE3);
+    *digest_stream = STREAM_BLAKE3_DIGEST;
+  } else if (BitIsSet(FO_XXH128, ff_pkt->flags)) {
+    *digest = crypto_digest_new(jcr, CRYPTO_DIGEST_XXH128);
+    *digest_stream = STREAM_XXH128_DIGEST;
   }
 
   /*
@@ -427,7 +743,9 @@ static bool calculate_file_chksum(JobControlRecord* jcr,
 
     size = sizeof(md);
     if (DigestFile(jcr, ff_pkt, *digest) != 0) {
+      jcr->lock();
       jcr->JobErrors++;
+      jcr->unlock();
       return false;
     }
 
@@ -26,6 +26,9 @@ namespace filedaemon {
 
 int DigestFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, DIGEST* digest);
 void DoVerify(JobControlRecord* jcr);
+int VerifyFile(JobControlRecord* jcr, FindFilesPacket* ff_pkt, bool top_level);
+void StartVerifyDigestThreads(JobControlRecord* jcr, int nr_threads);
+bool StopVerifyDigestThreads(JobControlRecord* jcr, bool send);
 void DoVerifyVolume(JobControlRecord* jcr);
 bool CalculateAndCompareFileChksum(JobControlRecord* jcr,
                                    FindFilesPacket* ff_pkt,
@@ -122,6 +122,7 @@ void DoVerifyVolume(JobControlRecord* jcr)
     switch (stream) {
       case STREAM_UNIX_ATTRIBUTES:
       case STREAM_UNIX_ATTRIBUTES_EX:
+      case STREAM_UNIX_ATTRIBUTES_COMPACT:
         char *ap, *lp, *fp;
 
         Dmsg0(400, "Stream=Unix Attributes.\n");
@@ -253,6 +254,26 @@ void DoVerifyVolume(JobControlRecord* jcr)
               dir->msg);
         break;
 
+      case STREAM_BLAKE3_DIGEST:
+        BinToBase64(digest, sizeof(digest), (char*)sd->msg,
+                    CRYPTO_DIGEST_BLAKE3_SIZE, true);
+        Dmsg2(400, "send inx=%d BLAKE3=%s\n", jcr->JobFiles, digest);
+        dir->fsend("%d %d %s *BLAKE3-%d*", jcr->JobFiles, STREAM_BLAKE3_DIGEST,
+                   digest, jcr->JobFiles);
+        Dmsg2(20, "filed>dir: BLAKE3 len=%d: msg=%s\n", dir->message_length,
+              dir->msg);
+        break;
+
+      case STREAM_XXH128_DIGEST:
+        BinToBase64(digest, sizeof(digest), (char*)sd->msg,
+                    CRYPTO_DIGEST_XXH128_SIZE, true);
+        Dmsg2(400, "send inx=%d XXH128=%s\n", jcr->JobFiles, digest);
+        dir->fsend("%d %d %s *XXH128-%d*", jcr->JobFiles, STREAM_XXH128_DIGEST,
+                   digest, jcr->JobFiles);
+        Dmsg2(20, "filed>dir: XXH128 len=%d: msg=%s\n", dir->message_length,
+              dir->msg);
+        break;
+
       case STREAM_RESTORE_OBJECT:
         jcr->lock();
         jcr->JobFiles++;
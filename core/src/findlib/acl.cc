@@ -95,8 +95,6 @@ bacl_exit_code SendAclStream(JobControlRecord* jcr,
                              acl_data_t* acl_data,
                              int stream)
 {
-  BareosSocket* sd = jcr->store_bsock;
-  POOLMEM* msgsave;
 #ifdef FD_NO_SEND_TEST
   return bacl_exit_ok;
 #endif
@@ -106,35 +104,17 @@ bacl_exit_code SendAclStream(JobControlRecord* jcr,
    */
   if (acl_data->u.build->content_length <= 0) { return bacl_exit_ok; }
 
-  /*
-   * Send header
-   */
-  if (!sd->fsend("%ld %d 0", jcr->JobFiles, stream)) {
-    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
-          sd->bstrerror());
-    return bacl_exit_fatal;
-  }
-
   /*
    * Send the buffer to the storage deamon
    */
   Dmsg1(400, "Backing up ACL <%s>\n", acl_data->u.build->content);
-  msgsave = sd->msg;
-  sd->msg = acl_data->u.build->content;
-  sd->message_length = acl_data->u.build->content_length + 1;
-  if (!sd->send()) {
-    sd->msg = msgsave;
-    sd->message_length = 0;
-    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
-          sd->bstrerror());
-    return bacl_exit_fatal;
-  }
-
-  jcr->JobBytes += sd->message_length;
-  sd->msg = msgsave;
-  if (!sd->signal(BNET_EOD)) {
-    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
-          sd->bstrerror());
+  if (!SendAclXattrStream(jcr,
+                          acl_data->u.build->deduplicate
+                              ? acl_data->u.build->blob_cache
+                              : nullptr,
+                          stream,
+                          acl_data->u.build->content,
+                          acl_data->u.build->content_length + 1)) {
     return bacl_exit_fatal;
   }
 
@@ -86,6 +86,8 @@ struct acl_build_data_t {
   uint32_t nr_errors;
   uint32_t content_length;
   POOLMEM* content;
+  AclXattrBlobCache* blob_cache;
+  bool deduplicate; /* use blob_cache for the current file */
 };
 
 struct acl_parse_data_t {
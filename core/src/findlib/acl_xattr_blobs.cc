@@ -0,0 +1,203 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Deduplication of ACL and extended attribute streams.
+ */
+
+#include "include/bareos.h"
+#include "include/jcr.h"
+#include "include/streams.h"
+#include "lib/bsock.h"
+#include "lib/blake3.h"
+#include "findlib/acl_xattr_blobs.h"
+
+/**
+ * Hex encoded BLAKE3 digest of a stream content and its stream type.
+ */
+std::string AclXattrBlobHash(int stream,
+                             const char* content,
+                             uint32_t content_length)
+{
+  static const char hex[] = "0123456789abcdef";
+  BLAKE3_CTX ctx;
+  uint8_t digest[BLAKE3_DIGEST_LENGTH];
+  char prefix[32];
+  std::string hash;
+
+  int length = Bsnprintf(prefix, sizeof(prefix), "%d ", stream);
+  Blake3Init(&ctx);
+  Blake3Update(&ctx, prefix, length);
+  Blake3Update(&ctx, content, content_length);
+  Blake3Final(&ctx, digest);
+
+  for (int i = 0; i < BLAKE3_DIGEST_LENGTH; i++) {
+    hash += hex[digest[i] >> 4];
+    hash += hex[digest[i] & 0xf];
+  }
+  return hash;
+}
+
+/**
+ * Send a single stream record to the storage daemon.
+ */
+static bool SendStreamRecord(JobControlRecord* jcr,
+                             int stream,
+                             POOLMEM* content,
+                             uint32_t content_length)
+{
+  BareosSocket* sd = jcr->store_bsock;
+  POOLMEM* msgsave;
+
+  /*
+   * Send header
+   */
+  if (!sd->fsend("%ld %d 0", jcr->JobFiles, stream)) {
+    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
+          sd->bstrerror());
+    return false;
+  }
+
+  /*
+   * Send the buffer to the storage deamon
+   */
+  msgsave = sd->msg;
+  sd->msg = content;
+  sd->message_length = content_length;
+  if (!sd->send()) {
+    sd->msg = msgsave;
+    sd->message_length = 0;
+    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
+          sd->bstrerror());
+    return false;
+  }
+
+  jcr->JobBytes += sd->message_length;
+  sd->msg = msgsave;
+  if (!sd->signal(BNET_EOD)) {
+    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
+          sd->bstrerror());
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Send an ACL or extended attribute stream, replacing contents already
+ * sent during this job by a reference.
+ */
+bool AclXattrBlobCache::Send(JobControlRecord* jcr,
+                             int stream,
+                             POOLMEM* content,
+                             uint32_t content_length)
+{
+  PoolMem record(PM_MESSAGE);
+  std::string hash;
+  int length;
+
+  if (content_length < ACL_XATTR_BLOB_MIN_LENGTH) {
+    return SendStreamRecord(jcr, stream, content, content_length);
+  }
+
+  hash = AclXattrBlobHash(stream, content, content_length);
+
+  auto found = hashes_.find(hash);
+  if (found == hashes_.end()) {
+    if (cached_bytes_ + content_length > ACL_XATTR_BLOB_CACHE_SIZE) {
+      return SendStreamRecord(jcr, stream, content, content_length);
+    }
+
+    hashes_.emplace(hash, content_length);
+    cached_bytes_ += content_length;
+
+    length = Mmsg(record, "%s %d\n", hash.c_str(), stream);
+    record.check_size(length + content_length);
+    memcpy(record.c_str() + length, content, content_length);
+    if (!SendStreamRecord(jcr, STREAM_ACL_XATTR_BLOB, record.addr(),
+                          length + content_length)) {
+      return false;
+    }
+  } else {
+    nr_references_++;
+    bytes_saved_ += content_length;
+  }
+
+  Dmsg2(400, "Referencing ACL/XATTR blob %s of stream %d\n", hash.c_str(),
+        stream);
+  length = Mmsg(record, "%s", hash.c_str());
+  return SendStreamRecord(jcr, STREAM_ACL_XATTR_REFERENCE, record.addr(),
+                          length + 1);
+}
+
+/**
+ * Remember the content of a STREAM_ACL_XATTR_BLOB record. A blob whose
+ * content does not match its hash is rejected.
+ */
+bool AclXattrBlobStore::Add(const char* data, uint32_t data_length)
+{
+  const char* content;
+  char hash[2 * BLAKE3_DIGEST_LENGTH + 1];
+  int stream;
+
+  content = (const char*)memchr(data, '\n', data_length);
+  if (!content) { return false; }
+  if (sscanf(std::string(data, content - data).c_str(), "%64s %d", hash,
+             &stream) != 2) {
+    return false;
+  }
+  content++;
+
+  uint32_t content_length = data_length - (content - data);
+  if (AclXattrBlobHash(stream, content, content_length) != hash) {
+    return false;
+  }
+
+  auto& blob = blobs_[hash];
+  blob.first = stream;
+  blob.second.assign(content, content_length);
+
+  return true;
+}
+
+/**
+ * Resolve the content of a STREAM_ACL_XATTR_REFERENCE record.
+ */
+const std::string* AclXattrBlobStore::Lookup(const char* data,
+                                             int* stream) const
+{
+  auto found = blobs_.find(data);
+  if (found == blobs_.end()) { return nullptr; }
+
+  *stream = found->second.first;
+  return &found->second.second;
+}
+
+bool SendAclXattrStream(JobControlRecord* jcr,
+                        AclXattrBlobCache* cache,
+                        int stream,
+                        POOLMEM* content,
+                        uint32_t content_length)
+{
+  if (cache) { return cache->Send(jcr, stream, content, content_length); }
+
+  return SendStreamRecord(jcr, stream, content, content_length);
+}
@@ -0,0 +1,97 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Deduplication of ACL and extended attribute streams.
+ *
+ * Most files of a backup share a handful of identical ACLs and extended
+ * attributes. With the AclXattrDeduplication FileSet option, the first time
+ * a stream content is seen during a backup it is sent once as a
+ * STREAM_ACL_XATTR_BLOB record ("<hash> <stream>\n<content>") with the
+ * records of that file, every file then gets a STREAM_ACL_XATTR_REFERENCE
+ * record ("<hash>") instead of the full stream.
+ *
+ * The hash is the BLAKE3 digest of stream and content, so a blob read from
+ * any job or session of a restore resolves a reference correctly. The
+ * storage daemon passes the blobs of every session it reads, also those of
+ * files that are not selected. References to a blob that was not read are
+ * reported and the ACL or xattrs are not restored.
+ */
+
+#ifndef BAREOS_FINDLIB_ACL_XATTR_BLOBS_H_
+#define BAREOS_FINDLIB_ACL_XATTR_BLOBS_H_
+
+#include <string>
+#include <unordered_map>
+
+/*
+ * Only contents of at least this size are deduplicated, shorter ones are
+ * not worth a reference, and at most this amount of unique content is
+ * cached per job.
+ */
+#define ACL_XATTR_BLOB_MIN_LENGTH 128
+#define ACL_XATTR_BLOB_CACHE_SIZE (16 * 1024 * 1024)
+
+/**
+ * Backup side: remembers the hashes of the stream contents sent during a
+ * job.
+ */
+class AclXattrBlobCache {
+ public:
+  bool Send(JobControlRecord* jcr,
+            int stream,
+            POOLMEM* content,
+            uint32_t content_length);
+
+  uint32_t nr_blobs() const { return hashes_.size(); }
+  uint64_t nr_references() const { return nr_references_; }
+  uint64_t bytes_saved() const { return bytes_saved_; }
+
+ private:
+  std::unordered_map<std::string, uint32_t> hashes_;
+  uint64_t cached_bytes_{0};
+  uint64_t nr_references_{0};
+  uint64_t bytes_saved_{0};
+};
+
+/**
+ * Restore side: remembers the blobs read by a restore.
+ */
+class AclXattrBlobStore {
+ public:
+  bool Add(const char* data, uint32_t data_length);
+  const std::string* Lookup(const char* data, int* stream) const;
+
+ private:
+  std::unordered_map<std::string, std::pair<int, std::string>> blobs_;
+};
+
+std::string AclXattrBlobHash(int stream,
+                             const char* content,
+                             uint32_t content_length);
+
+bool SendAclXattrStream(JobControlRecord* jcr,
+                        AclXattrBlobCache* cache,
+                        int stream,
+                        POOLMEM* content,
+                        uint32_t content_length);
+
+#endif  // BAREOS_FINDLIB_ACL_XATTR_BLOBS_H_
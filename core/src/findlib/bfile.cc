@@ -110,6 +110,8 @@ const char* stream_to_ascii(int stream)
       return _("Compressed data");
     case STREAM_UNIX_ATTRIBUTES_EX:
       return _("Extended attributes");
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
+      return _("Compact Unix attributes");
     case STREAM_SPARSE_DATA:
       return _("Sparse data");
     case STREAM_SPARSE_GZIP_DATA:
@@ -122,6 +124,10 @@ const char* stream_to_ascii(int stream)
       return _("Program data");
     case STREAM_SHA1_DIGEST:
       return _("SHA1 digest");
+    case STREAM_BLAKE3_DIGEST:
+      return _("BLAKE3 digest");
+    case STREAM_XXH128_DIGEST:
+      return _("XXH128 digest");
     case STREAM_WIN32_DATA:
       return _("Win32 data");
     case STREAM_WIN32_GZIP_DATA:
@@ -219,6 +225,10 @@ const char* stream_to_ascii(int stream)
       return _("Linux Specific Extended attribs");
     case STREAM_XATTR_NETBSD:
       return _("NetBSD Specific Extended attribs");
+    case STREAM_ACL_XATTR_BLOB:
+      return _("Shared ACL or Extended attribs");
+    case STREAM_ACL_XATTR_REFERENCE:
+      return _("Shared ACL or Extended attribs reference");
     default:
       sprintf(buf, "%d", stream);
       return (const char*)buf;
@@ -457,10 +467,13 @@ bool IsRestoreStreamSupported(int stream)
     case STREAM_FILE_DATA:
     case STREAM_MD5_DIGEST:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
     case STREAM_SPARSE_DATA:
     case STREAM_PROGRAM_NAMES:
     case STREAM_PROGRAM_DATA:
     case STREAM_SHA1_DIGEST:
+    case STREAM_BLAKE3_DIGEST:
+    case STREAM_XXH128_DIGEST:
 #ifdef HAVE_SHA2
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
@@ -792,6 +805,20 @@ int bopen(BareosWinFilePacket* bfd,
   }
 }
 
+/**
+ * Opening relative to a directory is not supported, always use the full path.
+ */
+int BopenAt(BareosWinFilePacket* bfd,
+            int dir_fd,
+            const char* relname,
+            const char* fname,
+            int flags,
+            mode_t mode,
+            dev_t rdev)
+{
+  return bopen(bfd, fname, flags, mode, rdev);
+}
+
 /**
  * Returns  0 on success
  *         -1 on error
@@ -1057,10 +1084,13 @@ bool IsRestoreStreamSupported(int stream)
     case STREAM_FILE_DATA:
     case STREAM_MD5_DIGEST:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
     case STREAM_SPARSE_DATA:
     case STREAM_PROGRAM_NAMES:
     case STREAM_PROGRAM_DATA:
     case STREAM_SHA1_DIGEST:
+    case STREAM_BLAKE3_DIGEST:
+    case STREAM_XXH128_DIGEST:
 #ifdef HAVE_SHA2
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
@@ -1085,11 +1115,17 @@ bool IsRestoreStreamSupported(int stream)
   return false;
 }
 
-int bopen(BareosWinFilePacket* bfd,
-          const char* fname,
-          int flags,
-          mode_t mode,
-          dev_t rdev)
+/**
+ * Open a file, when dir_fd is an open directory open relname relative to it
+ * so the kernel doesn't need to resolve the full path fname again.
+ */
+int BopenAt(BareosWinFilePacket* bfd,
+            int dir_fd,
+            const char* relname,
+            const char* fname,
+            int flags,
+            mode_t mode,
+            dev_t rdev)
 {
   Dmsg4(100, "bopen: fname %s, flags %08o, mode %04o, rdev %u\n", fname, flags,
         (mode & ~S_IFMT), rdev);
@@ -1105,7 +1141,15 @@ int bopen(BareosWinFilePacket* bfd,
   Dmsg1(debuglevel, "open file %s\n", fname);
 
   /* We use fnctl to set O_NOATIME if requested to avoid open error */
+#ifdef HAVE_OPENAT
+  if (dir_fd >= 0) {
+    bfd->fid = openat(dir_fd, relname, flags & ~O_NOATIME, mode);
+  } else {
+    bfd->fid = open(fname, flags & ~O_NOATIME, mode);
+  }
+#else
   bfd->fid = open(fname, flags & ~O_NOATIME, mode);
+#endif
 
   /* Set O_NOATIME if possible */
   if (bfd->fid != -1 && flags & O_NOATIME) {
@@ -1143,6 +1187,15 @@ int bopen(BareosWinFilePacket* bfd,
   return bfd->fid;
 }
 
+int bopen(BareosWinFilePacket* bfd,
+          const char* fname,
+          int flags,
+          mode_t mode,
+          dev_t rdev)
+{
+  return BopenAt(bfd, -1, NULL, fname, flags, mode, rdev);
+}
+
 #ifdef HAVE_DARWIN_OS
 /**
  * Open the resource fork of a file.
@@ -139,6 +139,13 @@ int bopen(BareosWinFilePacket* bfd,
           int flags,
           mode_t mode,
           dev_t rdev);
+int BopenAt(BareosWinFilePacket* bfd,
+            int dir_fd,
+            const char* relname,
+            const char* fname,
+            int flags,
+            mode_t mode,
+            dev_t rdev);
 int BopenRsrc(BareosWinFilePacket* bfd,
               const char* fname,
               int flags,
@@ -46,8 +46,17 @@
 #define O_CTG 0
 #endif
 
+/*
+ * Maximum number of directories remembered as existing per job, when more
+ * are seen the cache starts over.
+ */
+#define MAX_KNOWN_PATHS 100000
+
 static int SeparatePathAndFile(JobControlRecord* jcr, char* fname, char* ofile);
-static int PathAlreadySeen(JobControlRecord* jcr, char* path, int pnl);
+static bool PathAlreadySeen(JobControlRecord* jcr, char* path);
+static void RememberPath(JobControlRecord* jcr, char* path, int pnl);
+
+static pthread_mutex_t known_paths_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * Create the file, or the directory
@@ -201,7 +210,7 @@ int CreateFile(JobControlRecord* jcr,
         savechr = attr->ofname[pnl];
         attr->ofname[pnl] = 0; /* Terminate path */
 
-        if (!PathAlreadySeen(jcr, attr->ofname, pnl)) {
+        if (!PathAlreadySeen(jcr, attr->ofname)) {
           Dmsg1(400, "Make path %s\n", attr->ofname);
           /*
            * If we need to make the directory, ensure that it is with
@@ -214,6 +223,7 @@ int CreateFile(JobControlRecord* jcr,
             attr->ofname[pnl] = savechr; /* restore full name */
             return CF_ERROR;
           }
+          RememberPath(jcr, attr->ofname, pnl);
         }
         attr->ofname[pnl] = savechr; /* restore full name */
       }
@@ -455,6 +465,9 @@ int CreateFile(JobControlRecord* jcr,
       if (!makepath(attr, attr->ofname, new_mode, parent_mode, uid, gid, 0)) {
         return CF_ERROR;
       }
+      if (attr->type != FT_JUNCTION) {
+        RememberPath(jcr, attr->ofname, strlen(attr->ofname));
+      }
       /*
        * If we are using the Win32 Backup API, we open the directory so
        * that the security info will be read and saved.
@@ -552,14 +565,35 @@ static int SeparatePathAndFile(JobControlRecord* jcr, char* fname, char* ofile)
 }
 
 /**
- * Primitive caching of path to prevent recreating a pathname
- *   each time as long as we remain in the same directory.
+ * Check if a directory is known to exist, so creating files in it does not
+ * need makepath() to stat() all of its components. The cache is shared by
+ * all threads restoring files of a job.
+ */
+static bool PathAlreadySeen(JobControlRecord* jcr, char* path)
+{
+  bool found;
+
+  P(known_paths_mutex);
+  found = PathListLookup(jcr->known_paths, path);
+  V(known_paths_mutex);
+
+  return found;
+}
+
+/**
+ * Remember a directory that exists or was just created.
  */
-static int PathAlreadySeen(JobControlRecord* jcr, char* path, int pnl)
+static void RememberPath(JobControlRecord* jcr, char* path, int pnl)
 {
-  if (!jcr->cached_path) { jcr->cached_path = GetPoolMemory(PM_FNAME); }
-  if (jcr->cached_pnl == pnl && bstrcmp(path, jcr->cached_path)) { return 1; }
-  PmStrcpy(jcr->cached_path, path);
-  jcr->cached_pnl = pnl;
-  return 0;
+  while (pnl > 1 && IsPathSeparator(path[pnl - 1])) { pnl--; }
+  std::string dir(path, pnl);
+
+  P(known_paths_mutex);
+  if (jcr->known_paths && jcr->known_paths->size() >= MAX_KNOWN_PATHS) {
+    FreePathList(jcr->known_paths);
+    jcr->known_paths = NULL;
+  }
+  if (!jcr->known_paths) { jcr->known_paths = path_list_init(); }
+  PathListAdd(jcr->known_paths, dir.size(), dir.c_str());
+  V(known_paths_mutex);
 }
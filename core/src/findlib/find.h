@@ -206,6 +206,8 @@ struct FindFilesPacket {
   char* top_fname{nullptr};          /**< Full filename before descending */
   char* fname{nullptr};              /**< Full filename */
   char* link{nullptr};               /**< Link if file linked */
+  const char* dir_relname{nullptr};  /**< fname relative to dir_fd */
+  int dir_fd{-1};                    /**< Open directory fname is in or -1 */
   char* object_name{nullptr};        /**< Object name */
   char* object{nullptr};             /**< Restore object */
   char* plugin{nullptr};             /**< Current Options{Plugin=} name */
@@ -303,6 +305,7 @@ findFOPTS* start_options(FindFilesPacket* ff);
 void NewOptions(FindFilesPacket* ff, findIncludeExcludeItem* incexe);
 
 
+#include "acl_xattr_blobs.h"
 #include "acl.h"
 #include "xattr.h"
 
@@ -50,6 +50,16 @@
 extern int32_t name_max; /* filename max length */
 extern int32_t path_max; /* path name max length */
 
+/*
+ * Traverse directories relative to an open file descriptor of the directory
+ * being read, that way the kernel only has to lookup the last component of
+ * the path of each entry instead of resolving the full path every time.
+ */
+#if !defined(HAVE_WIN32) && defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && \
+    defined(HAVE_FDOPENDIR) && defined(O_DIRECTORY)
+#define USE_DIRFD_TRAVERSAL 1
+#endif
+
 /**
  * Create a new directory Find File packet, but copy
  * some of the essential info from the current packet.
@@ -65,6 +75,8 @@ static inline FindFilesPacket* new_dir_ff_pkt(FindFilesPacket* ff_pkt)
   *dir_ff_pkt = *ff_pkt;
   dir_ff_pkt->fname = strdup(ff_pkt->fname);
   dir_ff_pkt->link = strdup(ff_pkt->link);
+  dir_ff_pkt->dir_fd = -1;
+  dir_ff_pkt->dir_relname = NULL;
   dir_ff_pkt->sys_fname = GetPoolMemory(PM_FNAME);
   dir_ff_pkt->included_files_list = NULL;
   dir_ff_pkt->excluded_files_list = NULL;
@@ -268,6 +280,56 @@ static inline bool CheckSizeMatching(JobControlRecord* jcr,
   }
 }
 
+/**
+ * Lstat a file, when it was found while traversing a directory do it
+ * relative to the open directory.
+ */
+static inline int LstatFile(FindFilesPacket* ff_pkt,
+                            const char* fname,
+                            struct stat* statp)
+{
+#ifdef USE_DIRFD_TRAVERSAL
+  if (ff_pkt->dir_fd >= 0) {
+    return fstatat(ff_pkt->dir_fd, ff_pkt->dir_relname, statp,
+                   AT_SYMLINK_NOFOLLOW);
+  }
+#endif
+
+  return lstat(fname, statp);
+}
+
+/**
+ * Stat a file again to see if it changed. Where statx() is available only
+ * ask for the fields compared in HasFileChanged() so network filesystems
+ * don't need to fetch the other attributes.
+ */
+static inline int RestatFile(FindFilesPacket* ff_pkt, struct stat* statp)
+{
+#if defined(USE_DIRFD_TRAVERSAL) && defined(HAVE_STATX)
+  if (ff_pkt->dir_fd >= 0) {
+    struct statx stx;
+    unsigned int mask = STATX_MTIME | STATX_CTIME | STATX_SIZE | STATX_BLOCKS;
+
+    if (statx(ff_pkt->dir_fd, ff_pkt->dir_relname, AT_SYMLINK_NOFOLLOW, mask,
+              &stx) != 0) {
+      return -1;
+    }
+
+    if ((stx.stx_mask & mask) == mask) {
+      memset(statp, 0, sizeof(struct stat));
+      statp->st_mtime = stx.stx_mtime.tv_sec;
+      statp->st_ctime = stx.stx_ctime.tv_sec;
+      statp->st_size = stx.stx_size;
+      statp->st_blocks = stx.stx_blocks;
+      statp->st_blksize = stx.stx_blksize;
+      return 0;
+    }
+  }
+#endif
+
+  return LstatFile(ff_pkt, ff_pkt->fname, statp);
+}
+
 /**
  * Check if a file have changed during backup and display an error
  */
@@ -280,7 +342,7 @@ bool HasFileChanged(JobControlRecord* jcr, FindFilesPacket* ff_pkt)
     return false;
   }
 
-  if (lstat(ff_pkt->fname, &statp) != 0) {
+  if (RestatFile(ff_pkt, &statp) != 0) {
     BErrNo be;
     Jmsg(jcr, M_WARNING, 0, _("Cannot stat file %s: ERR=%s\n"), ff_pkt->fname,
          be.bstrerror());
@@ -593,6 +655,9 @@ static inline int process_directory(JobControlRecord* jcr,
   char* link;
   int link_len;
   int len;
+  int our_fd = -1;
+  int dir_fd = ff_pkt->dir_fd;
+  const char* dir_relname = ff_pkt->dir_relname;
   dev_t our_device = ff_pkt->statp.st_dev;
   bool recurse = true;
   bool volhas_attrlist =
@@ -718,7 +783,26 @@ static inline int process_directory(JobControlRecord* jcr,
    * Descend into or "recurse" into the directory to read all the files in it.
    */
   errno = 0;
-  if ((directory = opendir(fname)) == NULL) {
+#ifdef USE_DIRFD_TRAVERSAL
+  if (dir_fd >= 0) {
+    our_fd = openat(dir_fd, dir_relname,
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  } else {
+    our_fd = open(fname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+
+  if (our_fd < 0) {
+    directory = NULL;
+  } else if ((directory = fdopendir(our_fd)) == NULL) {
+    int saved_errno = errno;
+
+    close(our_fd);
+    errno = saved_errno;
+  }
+#else
+  directory = opendir(fname);
+#endif
+  if (directory == NULL) {
     ff_pkt->type = FT_NOOPEN;
     ff_pkt->ff_errno = errno;
     rtn_stat = HandleFile(jcr, ff_pkt, top_level);
@@ -784,12 +868,19 @@ static inline int process_directory(JobControlRecord* jcr,
     link[len + name_length] = '\0';
 
     if (!FileIsExcluded(ff_pkt, link)) {
+      ff_pkt->dir_fd = our_fd;
+      ff_pkt->dir_relname = link + len;
       rtn_stat = FindOneFile(jcr, ff_pkt, HandleFile, link, our_device, false);
       if (ff_pkt->linked) { ff_pkt->linked->FileIndex = ff_pkt->FileIndex; }
     }
   }
 
+  /*
+   * Closing the directory also closes our_fd.
+   */
   closedir(directory);
+  ff_pkt->dir_fd = dir_fd;
+  ff_pkt->dir_relname = dir_relname;
   free(link);
   free(entry);
 
@@ -834,12 +925,19 @@ static inline int process_directory(JobControlRecord* jcr,
     link[len + name_length] = '\0';
 
     if (!FileIsExcluded(ff_pkt, link)) {
+      ff_pkt->dir_fd = our_fd;
+      ff_pkt->dir_relname = link + len;
       rtn_stat = FindOneFile(jcr, ff_pkt, HandleFile, link, our_device, false);
       if (ff_pkt->linked) { ff_pkt->linked->FileIndex = ff_pkt->FileIndex; }
     }
   }
 
+  /*
+   * Closing the directory also closes our_fd.
+   */
   closedir(directory);
+  ff_pkt->dir_fd = dir_fd;
+  ff_pkt->dir_relname = dir_relname;
   free(link);
 #endif
   /*
@@ -987,7 +1085,7 @@ int FindOneFile(JobControlRecord* jcr,
 
   ff_pkt->fname = ff_pkt->link = fname;
   ff_pkt->type = FT_UNSET;
-  if (lstat(fname, &ff_pkt->statp) != 0) {
+  if (LstatFile(ff_pkt, fname, &ff_pkt->statp) != 0) {
     /*
      * Cannot stat file
      */
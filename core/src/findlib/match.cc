@@ -225,6 +225,26 @@ void AddFnameToIncludeList(FindFilesPacket* ff, int prefixed, const char* fname)
                   rp += 2;
                   break;
               }
+              break;
+            case 'g':
+              switch (*(rp + 2)) {
+                case '1':
+                  inc->cipher = CRYPTO_CIPHER_AES_128_GCM;
+                  rp += 2;
+                  break;
+                case '2':
+                  inc->cipher = CRYPTO_CIPHER_AES_256_GCM;
+                  rp += 2;
+                  break;
+              }
+              break;
+            case 'p':
+              switch (*(rp + 2)) {
+                case '1':
+                  inc->cipher = CRYPTO_CIPHER_CHACHA20_POLY1305;
+                  rp += 2;
+                  break;
+              }
           }
           break;
         case 'f':
@@ -282,6 +302,14 @@ void AddFnameToIncludeList(FindFilesPacket* ff, int prefixed, const char* fname)
               rp++;
               break;
 #endif
+            case '4':
+              SetBit(FO_BLAKE3, inc->options);
+              rp++;
+              break;
+            case '5':
+              SetBit(FO_XXH128, inc->options);
+              rp++;
+              break;
             default:
               /*
                * If 2 or 3 is seen here, SHA2 is not configured, so
@@ -315,6 +343,9 @@ void AddFnameToIncludeList(FindFilesPacket* ff, int prefixed, const char* fname)
         case 'X':
           SetBit(FO_XATTR, inc->options);
           break;
+        case 'D':
+          SetBit(FO_ACL_XATTR_DEDUP, inc->options);
+          break;
         case 'Z': /* Compression */
           rp++;   /* Skip Z */
           if (*rp >= '0' && *rp <= '9') {
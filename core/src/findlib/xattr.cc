@@ -94,8 +94,6 @@ BxattrExitCode SendXattrStream(JobControlRecord* jcr,
                                xattr_data_t* xattr_data,
                                int stream)
 {
-  BareosSocket* sd = jcr->store_bsock;
-  POOLMEM* msgsave;
 #ifdef FD_NO_SEND_TEST
   return BxattrExitCode::kSuccess;
 #endif
@@ -107,37 +105,20 @@ BxattrExitCode SendXattrStream(JobControlRecord* jcr,
     return BxattrExitCode::kSuccess;
   }
 
-  /*
-   * Send header
-   */
-  if (!sd->fsend("%ld %d 0", jcr->JobFiles, stream)) {
-    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
-          sd->bstrerror());
-    return BxattrExitCode::kErrorFatal;
-  }
-
   /*
    * Send the buffer to the storage deamon
    */
   Dmsg1(400, "Backing up XATTR <%s>\n", xattr_data->u.build->content);
-  msgsave = sd->msg;
-  sd->msg = xattr_data->u.build->content;
-  sd->message_length = xattr_data->u.build->content_length;
-  if (!sd->send()) {
-    sd->msg = msgsave;
-    sd->message_length = 0;
-    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
-          sd->bstrerror());
+  if (!SendAclXattrStream(jcr,
+                          xattr_data->u.build->deduplicate
+                              ? xattr_data->u.build->blob_cache
+                              : nullptr,
+                          stream,
+                          xattr_data->u.build->content,
+                          xattr_data->u.build->content_length)) {
     return BxattrExitCode::kErrorFatal;
   }
 
-  jcr->JobBytes += sd->message_length;
-  sd->msg = msgsave;
-  if (!sd->signal(BNET_EOD)) {
-    Jmsg1(jcr, M_FATAL, 0, _("Network send error to SD. ERR=%s\n"),
-          sd->bstrerror());
-    return BxattrExitCode::kErrorFatal;
-  }
   Dmsg1(200, "XATTR of file: %s successfully backed up!\n",
         xattr_data->last_fname);
   return BxattrExitCode::kSuccess;
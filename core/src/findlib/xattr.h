@@ -77,6 +77,8 @@ struct xattr_build_data_t {
   POOLMEM* content;
   uint32_t content_length;
   alist* link_cache;
+  AclXattrBlobCache* blob_cache;
+  bool deduplicate; /* use blob_cache for the current file */
 };
 
 struct xattr_parse_data_t {
@@ -71,13 +71,16 @@ enum
   FO_PLUGIN = 29,      /**< Plugin data stream -- return to plugin on restore */
   FO_OFFSETS = 30,     /**< Keep I/O file offsets */
   FO_NO_AUTOEXCL = 31, /**< Don't use autoexclude methods */
-  FO_FORCE_ENCRYPT = 32 /**< Force encryption */
+  FO_FORCE_ENCRYPT = 32, /**< Force encryption */
+  FO_BLAKE3 = 33,        /**< Do BLAKE3 checksum */
+  FO_XXH128 = 34,        /**< Do XXH128 checksum */
+  FO_ACL_XATTR_DEDUP = 35 /**< Send shared ACLs and XATTRs only once */
 };
 
 /**
  * Keep this set to the last entry in the enum.
  */
-#define FO_MAX FO_FORCE_ENCRYPT
+#define FO_MAX FO_ACL_XATTR_DEDUP
 
 /**
  * Make sure you have enough bits to store all above bit fields.
@@ -186,8 +186,7 @@ class JobControlRecord {
   char* where{};                /**< Prefix to restore files to */
   char* RegexWhere{};           /**< File relocation in restore */
   alist* where_bregexp{};       /**< BareosRegex alist for path manipulation */
-  int32_t cached_pnl{};         /**< Cached path length */
-  POOLMEM* cached_path{};   /**< Cached path */
+  htable* known_paths{};        /**< Directories known to exist (used by findlib) */
   bool passive_client{};    /**< Client is a passive client e.g. doesn't initiate any network connection */
   bool prefix_links{};      /**< Prefix links with Where path */
   bool gui{};               /**< Set if gui using console */
@@ -63,10 +63,13 @@
  *
  * STREAM_UNIX_ATTRIBUTES
  * STREAM_UNIX_ATTRIBUTES_EX
+ * STREAM_UNIX_ATTRIBUTES_COMPACT
  * STREAM_MD5_DIGEST
  * STREAM_SHA1_DIGEST
  * STREAM_SHA256_DIGEST
  * STREAM_SHA512_DIGEST
+ * STREAM_BLAKE3_DIGEST
+ * STREAM_XXH128_DIGEST
  */
 #define STREAM_NONE                             0       /**< Reserved Non-Stream */
 #define STREAM_UNIX_ATTRIBUTES                  1       /**< Generic Unix attributes */
@@ -111,6 +114,10 @@
 #define STREAM_ENCRYPTED_FILE_COMPRESSED_DATA  32       /**< Encrypted, compressed data */
 #define STREAM_ENCRYPTED_WIN32_COMPRESSED_DATA 33       /**< Encrypted, compressed Win32 BackupRead data */
 
+#define STREAM_BLAKE3_DIGEST                   34       /**< BLAKE3 digest for the file */
+#define STREAM_XXH128_DIGEST                   35       /**< XXH128 digest for the file (not cryptographic) */
+#define STREAM_UNIX_ATTRIBUTES_COMPACT         36       /**< Unix attributes with a compact binary stat packet */
+
 #define STREAM_NDMP_SEPARATOR                 999       /**< NDMP separator between multiple data streams of one job */
 
 /**
@@ -178,6 +185,10 @@
                                                          * from acl_to_text (POSIX acl) for access acls.
                                                          */
 #define STREAM_ACL_PLUGIN                    1020       /**< Plugin specific acl encoding */
+#define STREAM_ACL_XATTR_BLOB                1021       /**< ACL or extended attributes content
+                                                         * shared by several files of a job
+                                                         */
+#define STREAM_ACL_XATTR_REFERENCE           1022       /**< Reference to a STREAM_ACL_XATTR_BLOB */
 #define STREAM_XATTR_PLUGIN                  1988       /**< Plugin specific extended attributes */
 #define STREAM_XATTR_HURD                    1989       /**< GNU HURD specific extended attributes */
 #define STREAM_XATTR_IRIX                    1990       /**< IRIX specific extended attributes */
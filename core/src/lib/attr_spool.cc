@@ -0,0 +1,328 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Compressed attribute spool files
+ */
+
+#include "include/bareos.h"
+#include "lib/attr_spool.h"
+#include "fastlz/lz4.h"
+
+/* Largest segment accepted when reading, a single message may exceed
+ * the segment size the writer aims for */
+#define MAX_SEGMENT_SIZE (256 * 1024 * 1024)
+
+static void PutVarint(std::vector<char>& buf, uint64_t value)
+{
+  while (value >= 0x80) {
+    buf.push_back((char)((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buf.push_back((char)value);
+}
+
+static bool GetVarint(const std::vector<char>& buf,
+                      size_t& pos,
+                      uint64_t& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < buf.size(); shift += 7) {
+    uint8_t byte = (uint8_t)buf[pos++];
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) { return true; }
+  }
+  return false;
+}
+
+static void PutUint32(char* buf, uint32_t value)
+{
+  value = htonl(value);
+  memcpy(buf, &value, sizeof(value));
+}
+
+static uint32_t GetUint32(const char* buf)
+{
+  uint32_t value;
+  memcpy(&value, buf, sizeof(value));
+  return ntohl(value);
+}
+
+static void PutUint64(char* buf, uint64_t value)
+{
+  PutUint32(buf, (uint32_t)(value >> 32));
+  PutUint32(buf + 4, (uint32_t)value);
+}
+
+static uint64_t GetUint64(const char* buf)
+{
+  return ((uint64_t)GetUint32(buf) << 32) | GetUint32(buf + 4);
+}
+
+/*
+ * Read exactly length bytes unless the end of the file is reached.
+ * Returns the number of bytes read or -1 on error.
+ */
+static ssize_t ReadAll(int fd, char* buf, size_t length)
+{
+  size_t done = 0;
+
+  while (done < length) {
+    ssize_t status = read(fd, buf + done, length - done);
+    if (status < 0) {
+      if (errno == EINTR) { continue; }
+      return -1;
+    }
+    if (status == 0) { break; }
+    done += status;
+  }
+  return done;
+}
+
+bool AttrSpoolWriter::WriteAll(const char* buf, size_t length)
+{
+  while (length > 0) {
+    ssize_t status = write(fd_, buf, length);
+    if (status < 0) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+    buf += status;
+    length -= status;
+  }
+  return true;
+}
+
+/*
+ * Add a message to the current segment. The bytes of the message from
+ * anchor on are front coded against the previous message.
+ */
+bool AttrSpoolWriter::Append(const char* msg,
+                             int32_t message_length,
+                             int32_t anchor)
+{
+  if (message_length < 0) { message_length = 0; }
+  if (anchor < 0 || anchor > message_length) { anchor = 0; }
+
+  size_t shared = 0;
+  size_t prev_length = prev_.size() - prev_anchor_;
+  size_t length = message_length - anchor;
+  while (shared < prev_length && shared < length &&
+         prev_[prev_anchor_ + shared] == msg[anchor + shared]) {
+    shared++;
+  }
+
+  PutVarint(segment_, message_length);
+  PutVarint(segment_, anchor);
+  PutVarint(segment_, shared);
+  segment_.insert(segment_.end(), msg, msg + anchor);
+  segment_.insert(segment_.end(), msg + anchor + shared, msg + message_length);
+
+  prev_.assign(msg, msg + message_length);
+  prev_anchor_ = anchor;
+  plain_size_ += sizeof(int32_t) + message_length;
+
+  if (segment_.size() >= ATTR_SPOOL_SEGMENT_SIZE) { return Flush(); }
+  return true;
+}
+
+/*
+ * Write the current segment, compressed if that makes it smaller.
+ */
+bool AttrSpoolWriter::Flush()
+{
+  char hdr[ATTR_SPOOL_HEADER_LENGTH];
+
+  if (segment_.empty()) { return true; }
+
+  if (!header_written_) {
+    memcpy(hdr, ATTR_SPOOL_MAGIC, ATTR_SPOOL_MAGIC_LENGTH);
+    PutUint64(hdr + ATTR_SPOOL_MAGIC_LENGTH, UINT64_MAX);
+    if (!WriteAll(hdr, ATTR_SPOOL_HEADER_LENGTH)) { return false; }
+    stored_size_ += ATTR_SPOOL_HEADER_LENGTH;
+    header_written_ = true;
+  }
+
+  int size = segment_.size();
+  const char* data = segment_.data();
+  int stored = size;
+
+  compressed_.resize(LZ4_compressBound(size));
+  int compressed_size = LZ4_compress(data, compressed_.data(), size);
+  if (compressed_size > 0 && compressed_size < size) {
+    data = compressed_.data();
+    stored = compressed_size;
+  }
+
+  PutUint32(hdr, size);
+  PutUint32(hdr + 4, stored);
+  if (!WriteAll(hdr, 8) || !WriteAll(data, stored)) { return false; }
+  stored_size_ += 8 + stored;
+
+  segment_.clear();
+  prev_.clear();
+  prev_anchor_ = 0;
+
+  return true;
+}
+
+/*
+ * Only let readers see the messages within the first limit bytes of the
+ * equivalent plain spool file.
+ */
+bool AttrSpoolWriter::SetLimit(uint64_t limit)
+{
+  char buf[8];
+
+  if (!header_written_) { return true; }
+
+  PutUint64(buf, limit);
+  if (lseek(fd_, ATTR_SPOOL_MAGIC_LENGTH, SEEK_SET) == -1) { return false; }
+  bool ok = WriteAll(buf, sizeof(buf));
+  if (lseek(fd_, 0, SEEK_END) == -1) { return false; }
+
+  return ok;
+}
+
+bool AttrSpoolReader::Fail()
+{
+  error_ = true;
+  return false;
+}
+
+bool AttrSpoolReader::ReadHeader()
+{
+  char hdr[ATTR_SPOOL_HEADER_LENGTH];
+
+  header_read_ = true;
+  ssize_t status = ReadAll(fd_, hdr, sizeof(hdr));
+  if (status == 0) {
+    limit_ = 0;
+    return true;
+  }
+  if (status != (ssize_t)sizeof(hdr) ||
+      memcmp(hdr, ATTR_SPOOL_MAGIC, ATTR_SPOOL_MAGIC_LENGTH) != 0) {
+    return Fail();
+  }
+  limit_ = GetUint64(hdr + ATTR_SPOOL_MAGIC_LENGTH);
+
+  return true;
+}
+
+bool AttrSpoolReader::ReadSegment()
+{
+  char hdr[8];
+
+  ssize_t status = ReadAll(fd_, hdr, sizeof(hdr));
+  if (status == 0) { return false; }
+  if (status != (ssize_t)sizeof(hdr)) { return Fail(); }
+
+  uint32_t size = GetUint32(hdr);
+  uint32_t stored = GetUint32(hdr + 4);
+  if (size == 0 || size > MAX_SEGMENT_SIZE || stored == 0 ||
+      stored > (uint32_t)LZ4_compressBound(size)) {
+    return Fail();
+  }
+
+  segment_.resize(size);
+  if (stored == size) {
+    if (ReadAll(fd_, segment_.data(), size) != (ssize_t)size) {
+      return Fail();
+    }
+  } else {
+    compressed_.resize(stored);
+    if (ReadAll(fd_, compressed_.data(), stored) != (ssize_t)stored) {
+      return Fail();
+    }
+    if (LZ4_decompress_safe(compressed_.data(), segment_.data(), stored,
+                            size) != (int)size) {
+      return Fail();
+    }
+  }
+
+  pos_ = 0;
+  prev_.clear();
+  prev_anchor_ = 0;
+
+  return true;
+}
+
+/*
+ * Get the next message. Returns false at the end of the spool file or on
+ * error, which Error() tells apart.
+ */
+bool AttrSpoolReader::Next(POOLMEM*& msg, int32_t* message_length)
+{
+  uint64_t length, anchor, shared;
+
+  if (error_) { return false; }
+  if (!header_read_ && !ReadHeader()) { return false; }
+
+  while (pos_ >= segment_.size()) {
+    if (!ReadSegment()) { return false; }
+  }
+
+  if (!GetVarint(segment_, pos_, length) ||
+      !GetVarint(segment_, pos_, anchor) ||
+      !GetVarint(segment_, pos_, shared) || length > INT32_MAX ||
+      anchor > length || shared > length - anchor ||
+      shared > prev_.size() - prev_anchor_ ||
+      length - shared > segment_.size() - pos_) {
+    return Fail();
+  }
+
+  if (plain_size_ + sizeof(int32_t) + length > limit_) { return false; }
+
+  if (length + 1 > (uint64_t)SizeofPoolMemory(msg)) {
+    msg = ReallocPoolMemory(msg, length + 1);
+  }
+  memcpy(msg, segment_.data() + pos_, anchor);
+  memcpy(msg + anchor, prev_.data() + prev_anchor_, shared);
+  memcpy(msg + anchor + shared, segment_.data() + pos_ + anchor,
+         length - anchor - shared);
+  msg[length] = '\0';
+  pos_ += length - shared;
+
+  prev_.assign(msg, msg + length);
+  prev_anchor_ = anchor;
+  plain_size_ += sizeof(int32_t) + length;
+  *message_length = length;
+
+  return true;
+}
+
+/*
+ * Check whether a spool file is compressed without moving its offset. A
+ * plain spool file starts with the length of a message, which can never
+ * start with the bytes of the magic.
+ */
+bool IsCompressedAttrSpool(int fd)
+{
+  char magic[ATTR_SPOOL_MAGIC_LENGTH];
+
+  boffset_t pos = lseek(fd, 0, SEEK_CUR);
+  if (pos == -1 || lseek(fd, 0, SEEK_SET) == -1) { return false; }
+  ssize_t status = ReadAll(fd, magic, sizeof(magic));
+  lseek(fd, pos, SEEK_SET);
+
+  return status == (ssize_t)sizeof(magic) &&
+         memcmp(magic, ATTR_SPOOL_MAGIC, ATTR_SPOOL_MAGIC_LENGTH) == 0;
+}
@@ -0,0 +1,107 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Compressed attribute spool files
+ *
+ * A plain attribute spool file holds the messages as they would have been
+ * sent to the director: a network order length followed by the message.
+ * A compressed spool file starts with a header (magic and limit) followed
+ * by segments of up to ATTR_SPOOL_SEGMENT_SIZE bytes of front coded
+ * messages, each compressed with LZ4 unless that does not make it smaller.
+ *
+ * Front coding stores of every message the number of bytes it shares with
+ * the previous message of the segment, starting at an anchor given by the
+ * writer. For file attributes the anchor is the start of the filename, so
+ * files of the same directory only store the part of the path that
+ * differs.
+ */
+
+#ifndef BAREOS_LIB_ATTR_SPOOL_H_
+#define BAREOS_LIB_ATTR_SPOOL_H_
+
+#include <vector>
+
+#define ATTR_SPOOL_MAGIC "BareosAttrSpool1"
+#define ATTR_SPOOL_MAGIC_LENGTH 16
+#define ATTR_SPOOL_HEADER_LENGTH (ATTR_SPOOL_MAGIC_LENGTH + 8)
+#define ATTR_SPOOL_SEGMENT_SIZE (1024 * 1024)
+
+/* Value of the SpoolAttr job parameter when the director can read them */
+#define SPOOL_ATTRIBUTES_COMPRESSED 2
+
+class AttrSpoolWriter {
+ public:
+  explicit AttrSpoolWriter(int fd) : fd_(fd) {}
+
+  bool Append(const char* msg, int32_t message_length, int32_t anchor);
+  bool Flush();
+  bool SetLimit(uint64_t limit);
+  /* Size the messages would have taken in a plain spool file */
+  uint64_t PlainSize() const { return plain_size_; }
+  uint64_t StoredSize() const { return stored_size_; }
+  /* Like BareosSocket::SetDataEnd() but in plain spool file bytes */
+  void SetDataEnd() { data_end_ = plain_size_; }
+  uint64_t DataEnd() const { return data_end_; }
+
+ private:
+  bool WriteAll(const char* buf, size_t length);
+
+  int fd_;
+  bool header_written_{false};
+  uint64_t plain_size_{0};
+  uint64_t stored_size_{0};
+  uint64_t data_end_{0};
+  std::vector<char> segment_;
+  std::vector<char> compressed_;
+  std::vector<char> prev_;
+  int32_t prev_anchor_{0};
+};
+
+class AttrSpoolReader {
+ public:
+  explicit AttrSpoolReader(int fd) : fd_(fd) {}
+
+  bool Next(POOLMEM*& msg, int32_t* message_length);
+  bool Error() const { return error_; }
+  /* Size the messages read so far took in a plain spool file */
+  uint64_t PlainSize() const { return plain_size_; }
+
+ private:
+  bool ReadHeader();
+  bool ReadSegment();
+  bool Fail();
+
+  int fd_;
+  bool header_read_{false};
+  bool error_{false};
+  uint64_t limit_{0};
+  uint64_t plain_size_{0};
+  std::vector<char> segment_;
+  std::vector<char> compressed_;
+  size_t pos_{0};
+  std::vector<char> prev_;
+  int32_t prev_anchor_{0};
+};
+
+bool IsCompressedAttrSpool(int fd);
+
+#endif  // BAREOS_LIB_ATTR_SPOOL_H_
@@ -2,7 +2,7 @@
    BAREOS® - Backup Archiving REcovery Open Sourced
 
    Copyright (C) 2002-2011 Free Software Foundation Europe e.V.
-   Copyright (C) 2016-2016 Bareos GmbH & Co. KG
+   Copyright (C) 2016-2020 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -108,6 +108,191 @@ void EncodeStat(char* buf,
   return;
 }
 
+/*
+ * Compact (binary) stat encoding
+ *
+ * The compact form starts with a version marker byte that can never be the
+ * first character of the base64 text form, followed by all fields of the text
+ * form in the same order packed as variable length integers. The atime and
+ * ctime are stored as zigzag encoded delta against the mtime which usually
+ * makes them fit into one or two bytes.
+ *
+ * The attribute record sent to the storage daemon separates its parts with
+ * 0 bytes so the packed integers must never contain a 0 byte. The lowest digit
+ * of a value is therefore stored base 127 offset by one (0x01 - 0x7f) as the
+ * terminating byte and all higher digits are stored base 128 with the high bit
+ * set before it.
+ */
+static const char kCompactStatV1 = '\001';
+static const int kCompactStatFields = 16;
+
+/* Indexes into the field array, same order as the text form */
+enum
+{
+  kStatDev = 0,
+  kStatIno,
+  kStatMode,
+  kStatNlink,
+  kStatUid,
+  kStatGid,
+  kStatRdev,
+  kStatSize,
+  kStatBlksize,
+  kStatBlocks,
+  kStatAtime,
+  kStatMtime,
+  kStatCtime,
+  kStatLinkFI,
+  kStatFlags,
+  kStatDataStream
+};
+
+static inline uint64_t ZigZagEncode(int64_t value)
+{
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t ZigZagDecode(uint64_t value)
+{
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static inline char* PackCompactValue(char* p, uint64_t value)
+{
+  uint64_t high = value / 127;
+
+  while (high) {
+    *p++ = (char)(0x80 | (high & 0x7f));
+    high >>= 7;
+  }
+  *p++ = (char)((value % 127) + 1);
+
+  return p;
+}
+
+static inline const char* UnpackCompactValue(const char* p, uint64_t* value)
+{
+  uint64_t high = 0;
+  int shift = 0;
+
+  while ((uint8_t)*p & 0x80) {
+    if (shift > 56) { return NULL; }
+    high |= (uint64_t)((uint8_t)*p & 0x7f) << shift;
+    shift += 7;
+    p++;
+  }
+
+  /* Premature end of string */
+  if (*p == 0) { return NULL; }
+
+  *value = high * 127 + (uint64_t)((uint8_t)*p - 1);
+
+  return p + 1;
+}
+
+/**
+ * Encode a stat structure into the compact binary form.
+ *   The result is a 0 terminated string that DecodeStat() understands
+ *   like the text form produced by EncodeStat(). It is stored in
+ *   STREAM_UNIX_ATTRIBUTES_COMPACT records, so older programs skip it.
+ */
+void EncodeStatCompact(char* buf,
+                       struct stat* statp,
+                       int stat_size,
+                       int32_t LinkFI,
+                       int data_stream)
+{
+  char* p = buf;
+  int64_t mtime;
+
+  ASSERT(stat_size == (int)sizeof(struct stat));
+
+  *p++ = kCompactStatV1;
+  p = PackCompactValue(p, (uint64_t)statp->st_dev);
+  p = PackCompactValue(p, (uint64_t)statp->st_ino);
+  p = PackCompactValue(p, (uint64_t)statp->st_mode);
+  p = PackCompactValue(p, (uint64_t)statp->st_nlink);
+  p = PackCompactValue(p, (uint64_t)statp->st_uid);
+  p = PackCompactValue(p, (uint64_t)statp->st_gid);
+  p = PackCompactValue(p, (uint64_t)statp->st_rdev);
+  p = PackCompactValue(p, (uint64_t)statp->st_size);
+#ifndef HAVE_MINGW
+  p = PackCompactValue(p, (uint64_t)statp->st_blksize);
+  p = PackCompactValue(p, (uint64_t)statp->st_blocks);
+#else
+  p = PackCompactValue(p, 0); /* place holder */
+  p = PackCompactValue(p, 0); /* place holder */
+#endif
+  mtime = (int64_t)statp->st_mtime;
+  p = PackCompactValue(p, ZigZagEncode((int64_t)statp->st_atime - mtime));
+  p = PackCompactValue(p, ZigZagEncode(mtime));
+  p = PackCompactValue(p, ZigZagEncode((int64_t)statp->st_ctime - mtime));
+  p = PackCompactValue(p, (uint64_t)(uint32_t)LinkFI);
+#ifdef HAVE_CHFLAGS
+  p = PackCompactValue(p, (uint64_t)statp->st_flags);
+#else
+  p = PackCompactValue(p, 0); /* place holder */
+#endif
+  p = PackCompactValue(p, (uint64_t)data_stream);
+  *p = 0;
+}
+
+/**
+ * See if an encoded stat packet uses the compact binary form.
+ */
+bool IsCompactStat(const char* buf) { return buf && *buf == kCompactStatV1; }
+
+/*
+ * Unpack all fields of a compact stat packet into the same representation
+ * the text form uses.
+ */
+static bool DecodeCompactFields(const char* buf,
+                                int64_t fields[kCompactStatFields])
+{
+  const char* p = buf;
+  uint64_t val;
+
+  if (*p++ != kCompactStatV1) { return false; }
+
+  for (int i = 0; i < kCompactStatFields; i++) {
+    if (!(p = UnpackCompactValue(p, &val))) { return false; }
+    fields[i] = (int64_t)val;
+  }
+
+  fields[kStatMtime] = ZigZagDecode((uint64_t)fields[kStatMtime]);
+  fields[kStatAtime] =
+      ZigZagDecode((uint64_t)fields[kStatAtime]) + fields[kStatMtime];
+  fields[kStatCtime] =
+      ZigZagDecode((uint64_t)fields[kStatCtime]) + fields[kStatMtime];
+  fields[kStatLinkFI] = (int32_t)(uint32_t)fields[kStatLinkFI];
+
+  return true;
+}
+
+/**
+ * Convert a compact stat packet into the base64 text form as produced by
+ * EncodeStat(). The conversion doesn't go through a struct stat so no
+ * information gets lost when the platforms of the encoding and converting
+ * side differ. This is used to store the text form in the catalog.
+ */
+bool CompactStatToText(const char* buf, POOLMEM*& dest)
+{
+  int64_t fields[kCompactStatFields];
+  char* p;
+
+  if (!DecodeCompactFields(buf, fields)) { return false; }
+
+  dest = CheckPoolMemorySize(dest, kCompactStatFields * 13 + 1);
+  p = dest;
+  for (int i = 0; i < kCompactStatFields; i++) {
+    if (i > 0) { *p++ = ' '; }
+    p += ToBase64(fields[i], p);
+  }
+  *p = 0;
+
+  return true;
+}
+
 /* Do casting according to unknown type to keep compiler happy */
 #ifdef HAVE_TYPEOF
 #define plug(st, val) st = (typeof st)val
@@ -127,6 +312,43 @@ void plug(T& st, uint64_t val)
 #endif
 #endif
 
+/**
+ * Decode a stat packet in the compact binary form
+ */
+static int DecodeCompactStat(const char* buf,
+                             struct stat* statp,
+                             int32_t* LinkFI)
+{
+  int64_t fields[kCompactStatFields];
+
+  if (!DecodeCompactFields(buf, fields)) {
+    *LinkFI = 0;
+    return 0;
+  }
+
+  plug(statp->st_dev, fields[kStatDev]);
+  plug(statp->st_ino, fields[kStatIno]);
+  plug(statp->st_mode, fields[kStatMode]);
+  plug(statp->st_nlink, fields[kStatNlink]);
+  plug(statp->st_uid, fields[kStatUid]);
+  plug(statp->st_gid, fields[kStatGid]);
+  plug(statp->st_rdev, fields[kStatRdev]);
+  plug(statp->st_size, fields[kStatSize]);
+#ifndef HAVE_MINGW
+  plug(statp->st_blksize, fields[kStatBlksize]);
+  plug(statp->st_blocks, fields[kStatBlocks]);
+#endif
+  plug(statp->st_atime, fields[kStatAtime]);
+  plug(statp->st_mtime, fields[kStatMtime]);
+  plug(statp->st_ctime, fields[kStatCtime]);
+  *LinkFI = (int32_t)fields[kStatLinkFI];
+#ifdef HAVE_CHFLAGS
+  plug(statp->st_flags, fields[kStatFlags]);
+#endif
+
+  return (int)fields[kStatDataStream];
+}
+
 /**
  * Decode a stat packet from base64 characters
  */
@@ -143,6 +365,8 @@ int DecodeStat(char* buf, struct stat* statp, int stat_size, int32_t* LinkFI)
   ASSERT(stat_size == (int)sizeof(struct stat));
   memset(statp, 0, stat_size);
 
+  if (IsCompactStat(p)) { return DecodeCompactStat(p, statp, LinkFI); }
+
   p += FromBase64(&val, p);
   plug(statp->st_dev, val);
   p++;
@@ -236,6 +460,14 @@ int32_t DecodeLinkFI(char* buf, struct stat* statp, int stat_size)
    */
   ASSERT(stat_size == (int)sizeof(struct stat));
 
+  if (IsCompactStat(p)) {
+    int64_t fields[kCompactStatFields];
+
+    if (!DecodeCompactFields(p, fields)) { return 0; }
+    plug(statp->st_mode, fields[kStatMode]);
+    return (int32_t)fields[kStatLinkFI];
+  }
+
   SkipNonspaces(&p); /* st_dev */
   p++;               /* skip space */
   SkipNonspaces(&p); /* st_ino */
@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2018 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2020 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -26,6 +26,13 @@ void EncodeStat(char* buf,
                 int stat_size,
                 int32_t LinkFI,
                 int data_stream);
+void EncodeStatCompact(char* buf,
+                       struct stat* statp,
+                       int stat_size,
+                       int32_t LinkFI,
+                       int data_stream);
+bool IsCompactStat(const char* buf);
+bool CompactStatToText(const char* buf, POOLMEM*& dest);
 int DecodeStat(char* buf, struct stat* statp, int stat_size, int32_t* LinkFI);
 int32_t DecodeLinkFI(char* buf, struct stat* statp, int stat_size);
 
@@ -0,0 +1,449 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * BLAKE3 hash function, following the reference implementation of the
+ * BLAKE3 specification.
+ */
+
+#include "include/bareos.h"
+#include "lib/blake3.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_BLAKE3_SSE2 1
+#endif
+
+enum
+{
+  CHUNK_START = 1 << 0,
+  CHUNK_END = 1 << 1,
+  PARENT = 1 << 2,
+  ROOT = 1 << 3
+};
+
+static const uint32_t blake3_iv[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372,
+                                      0xA54FF53A, 0x510E527F, 0x9B05688C,
+                                      0x1F83D9AB, 0x5BE0CD19};
+
+/*
+ * Message word order of each round, the message permutation applied
+ * repeatedly.
+ */
+static const uint8_t blake3_schedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+/*
+ * The last node of the tree, compressed with the ROOT flag when the hash
+ * is finalized.
+ */
+struct Blake3Output {
+  uint32_t cv[8];
+  uint8_t block[BLAKE3_BLOCK_LEN];
+  uint8_t block_len;
+  uint64_t counter;
+  uint8_t flags;
+};
+
+static inline uint32_t Load32(const uint8_t* p)
+{
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline void Store32(uint8_t* p, uint32_t w)
+{
+  p[0] = (uint8_t)w;
+  p[1] = (uint8_t)(w >> 8);
+  p[2] = (uint8_t)(w >> 16);
+  p[3] = (uint8_t)(w >> 24);
+}
+
+static inline uint32_t Rotr32(uint32_t w, int c)
+{
+  return (w >> c) | (w << (32 - c));
+}
+
+static inline void G(uint32_t* s,
+                     int a,
+                     int b,
+                     int c,
+                     int d,
+                     uint32_t x,
+                     uint32_t y)
+{
+  s[a] = s[a] + s[b] + x;
+  s[d] = Rotr32(s[d] ^ s[a], 16);
+  s[c] = s[c] + s[d];
+  s[b] = Rotr32(s[b] ^ s[c], 12);
+  s[a] = s[a] + s[b] + y;
+  s[d] = Rotr32(s[d] ^ s[a], 8);
+  s[c] = s[c] + s[d];
+  s[b] = Rotr32(s[b] ^ s[c], 7);
+}
+
+static void Compress(const uint32_t cv[8],
+                     const uint8_t block[BLAKE3_BLOCK_LEN],
+                     uint8_t block_len,
+                     uint64_t counter,
+                     uint8_t flags,
+                     uint32_t out[16])
+{
+  uint32_t m[16], s[16];
+
+  for (int i = 0; i < 16; i++) { m[i] = Load32(block + 4 * i); }
+  for (int i = 0; i < 8; i++) { s[i] = cv[i]; }
+  for (int i = 0; i < 4; i++) { s[8 + i] = blake3_iv[i]; }
+  s[12] = (uint32_t)counter;
+  s[13] = (uint32_t)(counter >> 32);
+  s[14] = block_len;
+  s[15] = flags;
+
+  for (int r = 0; r < 7; r++) {
+    const uint8_t* sched = blake3_schedule[r];
+
+    G(s, 0, 4, 8, 12, m[sched[0]], m[sched[1]]);
+    G(s, 1, 5, 9, 13, m[sched[2]], m[sched[3]]);
+    G(s, 2, 6, 10, 14, m[sched[4]], m[sched[5]]);
+    G(s, 3, 7, 11, 15, m[sched[6]], m[sched[7]]);
+    G(s, 0, 5, 10, 15, m[sched[8]], m[sched[9]]);
+    G(s, 1, 6, 11, 12, m[sched[10]], m[sched[11]]);
+    G(s, 2, 7, 8, 13, m[sched[12]], m[sched[13]]);
+    G(s, 3, 4, 9, 14, m[sched[14]], m[sched[15]]);
+  }
+
+  for (int i = 0; i < 8; i++) {
+    out[i] = s[i] ^ s[i + 8];
+    out[i + 8] = s[i + 8] ^ cv[i];
+  }
+}
+
+static inline void CompressInPlace(uint32_t cv[8],
+                                   const uint8_t block[BLAKE3_BLOCK_LEN],
+                                   uint8_t block_len,
+                                   uint64_t counter,
+                                   uint8_t flags)
+{
+  uint32_t out[16];
+
+  Compress(cv, block, block_len, counter, flags, out);
+  memcpy(cv, out, 8 * sizeof(uint32_t));
+}
+
+#ifdef HAVE_BLAKE3_SSE2
+static inline __m128i Rotr16(__m128i x)
+{
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+}
+
+static inline __m128i Rotr(__m128i x, int c)
+{
+  return _mm_or_si128(_mm_srli_epi32(x, c), _mm_slli_epi32(x, 32 - c));
+}
+
+static inline void G4(__m128i* v,
+                      int a,
+                      int b,
+                      int c,
+                      int d,
+                      __m128i x,
+                      __m128i y)
+{
+  v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), x);
+  v[d] = Rotr16(_mm_xor_si128(v[d], v[a]));
+  v[c] = _mm_add_epi32(v[c], v[d]);
+  v[b] = Rotr(_mm_xor_si128(v[b], v[c]), 12);
+  v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), y);
+  v[d] = Rotr(_mm_xor_si128(v[d], v[a]), 8);
+  v[c] = _mm_add_epi32(v[c], v[d]);
+  v[b] = Rotr(_mm_xor_si128(v[b], v[c]), 7);
+}
+
+/*
+ * Load block number "block" of four consecutive chunks, word i of the
+ * block of chunk n ends up in lane n of m[i].
+ */
+static inline void LoadTransposed(const uint8_t* input,
+                                  int block,
+                                  __m128i m[16])
+{
+  for (int i = 0; i < 4; i++) {
+    const uint8_t* p = input + block * BLAKE3_BLOCK_LEN + 16 * i;
+    __m128i a = _mm_loadu_si128((const __m128i*)(p + 0 * BLAKE3_CHUNK_LEN));
+    __m128i b = _mm_loadu_si128((const __m128i*)(p + 1 * BLAKE3_CHUNK_LEN));
+    __m128i c = _mm_loadu_si128((const __m128i*)(p + 2 * BLAKE3_CHUNK_LEN));
+    __m128i d = _mm_loadu_si128((const __m128i*)(p + 3 * BLAKE3_CHUNK_LEN));
+    __m128i ab_lo = _mm_unpacklo_epi32(a, b);
+    __m128i ab_hi = _mm_unpackhi_epi32(a, b);
+    __m128i cd_lo = _mm_unpacklo_epi32(c, d);
+    __m128i cd_hi = _mm_unpackhi_epi32(c, d);
+
+    m[4 * i + 0] = _mm_unpacklo_epi64(ab_lo, cd_lo);
+    m[4 * i + 1] = _mm_unpackhi_epi64(ab_lo, cd_lo);
+    m[4 * i + 2] = _mm_unpacklo_epi64(ab_hi, cd_hi);
+    m[4 * i + 3] = _mm_unpackhi_epi64(ab_hi, cd_hi);
+  }
+}
+
+/*
+ * Compute the chaining values of four complete chunks at once, one chunk
+ * in each 32 bit lane.
+ */
+static void HashFourChunks(const uint8_t* input,
+                           uint64_t counter,
+                           uint32_t out[4][8])
+{
+  __m128i cv[8], m[16], v[16];
+  __m128i counter_lo =
+      _mm_set_epi32((int)(uint32_t)(counter + 3), (int)(uint32_t)(counter + 2),
+                    (int)(uint32_t)(counter + 1), (int)(uint32_t)counter);
+  __m128i counter_hi = _mm_set_epi32((int)(uint32_t)((counter + 3) >> 32),
+                                     (int)(uint32_t)((counter + 2) >> 32),
+                                     (int)(uint32_t)((counter + 1) >> 32),
+                                     (int)(uint32_t)(counter >> 32));
+  uint32_t lanes[4];
+
+  for (int i = 0; i < 8; i++) { cv[i] = _mm_set1_epi32((int)blake3_iv[i]); }
+
+  for (int block = 0; block < BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN; block++) {
+    uint8_t flags = 0;
+
+    if (block == 0) { flags |= CHUNK_START; }
+    if (block == BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN - 1) {
+      flags |= CHUNK_END;
+    }
+
+    LoadTransposed(input, block, m);
+    for (int i = 0; i < 8; i++) { v[i] = cv[i]; }
+    for (int i = 0; i < 4; i++) {
+      v[8 + i] = _mm_set1_epi32((int)blake3_iv[i]);
+    }
+    v[12] = counter_lo;
+    v[13] = counter_hi;
+    v[14] = _mm_set1_epi32(BLAKE3_BLOCK_LEN);
+    v[15] = _mm_set1_epi32(flags);
+
+    for (int r = 0; r < 7; r++) {
+      const uint8_t* sched = blake3_schedule[r];
+
+      G4(v, 0, 4, 8, 12, m[sched[0]], m[sched[1]]);
+      G4(v, 1, 5, 9, 13, m[sched[2]], m[sched[3]]);
+      G4(v, 2, 6, 10, 14, m[sched[4]], m[sched[5]]);
+      G4(v, 3, 7, 11, 15, m[sched[6]], m[sched[7]]);
+      G4(v, 0, 5, 10, 15, m[sched[8]], m[sched[9]]);
+      G4(v, 1, 6, 11, 12, m[sched[10]], m[sched[11]]);
+      G4(v, 2, 7, 8, 13, m[sched[12]], m[sched[13]]);
+      G4(v, 3, 4, 9, 14, m[sched[14]], m[sched[15]]);
+    }
+
+    for (int i = 0; i < 8; i++) { cv[i] = _mm_xor_si128(v[i], v[i + 8]); }
+  }
+
+  for (int i = 0; i < 8; i++) {
+    _mm_storeu_si128((__m128i*)lanes, cv[i]);
+    for (int lane = 0; lane < 4; lane++) { out[lane][i] = lanes[lane]; }
+  }
+}
+#endif
+
+static inline size_t ChunkLength(const BLAKE3_CTX* ctx)
+{
+  return BLAKE3_BLOCK_LEN * ctx->blocks_compressed + ctx->buf_len;
+}
+
+static inline uint8_t ChunkStartFlag(const BLAKE3_CTX* ctx)
+{
+  return ctx->blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+static void ChunkReset(BLAKE3_CTX* ctx, uint64_t chunk_counter)
+{
+  memcpy(ctx->cv, blake3_iv, sizeof(ctx->cv));
+  ctx->chunk_counter = chunk_counter;
+  ctx->buf_len = 0;
+  ctx->blocks_compressed = 0;
+}
+
+/*
+ * Add input to the current chunk, never more than fits into the chunk.
+ * The last block of a chunk always stays buffered, as it is compressed with
+ * different flags.
+ */
+static void ChunkUpdate(BLAKE3_CTX* ctx, const uint8_t* input, size_t length)
+{
+  while (length > 0) {
+    size_t take;
+
+    if (ctx->buf_len == BLAKE3_BLOCK_LEN) {
+      CompressInPlace(ctx->cv, ctx->buf, BLAKE3_BLOCK_LEN, ctx->chunk_counter,
+                      ChunkStartFlag(ctx));
+      ctx->blocks_compressed++;
+      ctx->buf_len = 0;
+    }
+
+    if (ctx->buf_len == 0) {
+      while (length > BLAKE3_BLOCK_LEN) {
+        CompressInPlace(ctx->cv, input, BLAKE3_BLOCK_LEN, ctx->chunk_counter,
+                        ChunkStartFlag(ctx));
+        ctx->blocks_compressed++;
+        input += BLAKE3_BLOCK_LEN;
+        length -= BLAKE3_BLOCK_LEN;
+      }
+    }
+
+    take = BLAKE3_BLOCK_LEN - ctx->buf_len;
+    if (take > length) { take = length; }
+    memcpy(ctx->buf + ctx->buf_len, input, take);
+    ctx->buf_len += take;
+    input += take;
+    length -= take;
+  }
+}
+
+static void ChunkOutput(const BLAKE3_CTX* ctx, Blake3Output* out)
+{
+  memcpy(out->cv, ctx->cv, sizeof(out->cv));
+  memcpy(out->block, ctx->buf, ctx->buf_len);
+  memset(out->block + ctx->buf_len, 0, BLAKE3_BLOCK_LEN - ctx->buf_len);
+  out->block_len = ctx->buf_len;
+  out->counter = ctx->chunk_counter;
+  out->flags = ChunkStartFlag(ctx) | CHUNK_END;
+}
+
+static void ParentOutput(const uint8_t left_cv[32],
+                         const uint32_t right_cv[8],
+                         Blake3Output* out)
+{
+  memcpy(out->cv, blake3_iv, sizeof(out->cv));
+  memcpy(out->block, left_cv, 32);
+  for (int i = 0; i < 8; i++) { Store32(out->block + 32 + 4 * i, right_cv[i]); }
+  out->block_len = BLAKE3_BLOCK_LEN;
+  out->counter = 0;
+  out->flags = PARENT;
+}
+
+static void OutputChainingValue(const Blake3Output* out, uint32_t cv[8])
+{
+  memcpy(cv, out->cv, 8 * sizeof(uint32_t));
+  CompressInPlace(cv, out->block, out->block_len, out->counter, out->flags);
+}
+
+/*
+ * Push the chaining value of a completed chunk, merging all subtrees that
+ * are complete now. The number of trailing zero bits of the total number of
+ * chunks is the number of subtrees to merge.
+ */
+static void AddChunkChainingValue(BLAKE3_CTX* ctx,
+                                  uint32_t cv[8],
+                                  uint64_t total_chunks)
+{
+  Blake3Output parent;
+
+  while ((total_chunks & 1) == 0) {
+    ctx->cv_stack_len--;
+    ParentOutput(ctx->cv_stack + 32 * ctx->cv_stack_len, cv, &parent);
+    OutputChainingValue(&parent, cv);
+    total_chunks >>= 1;
+  }
+
+  for (int i = 0; i < 8; i++) {
+    Store32(ctx->cv_stack + 32 * ctx->cv_stack_len + 4 * i, cv[i]);
+  }
+  ctx->cv_stack_len++;
+}
+
+void Blake3Init(BLAKE3_CTX* ctx)
+{
+  ChunkReset(ctx, 0);
+  ctx->cv_stack_len = 0;
+}
+
+void Blake3Update(BLAKE3_CTX* ctx, const void* data, size_t length)
+{
+  const uint8_t* input = (const uint8_t*)data;
+
+  while (length > 0) {
+    size_t take;
+
+    /*
+     * A full chunk is only finished when more input follows, the last chunk
+     * is part of the root node.
+     */
+    if (ChunkLength(ctx) == BLAKE3_CHUNK_LEN) {
+      uint32_t cv[8];
+      Blake3Output out;
+      uint64_t total_chunks = ctx->chunk_counter + 1;
+
+      ChunkOutput(ctx, &out);
+      OutputChainingValue(&out, cv);
+      AddChunkChainingValue(ctx, cv, total_chunks);
+      ChunkReset(ctx, total_chunks);
+    }
+
+#ifdef HAVE_BLAKE3_SSE2
+    if (ChunkLength(ctx) == 0) {
+      while (length > 4 * BLAKE3_CHUNK_LEN) {
+        uint32_t cvs[4][8];
+
+        HashFourChunks(input, ctx->chunk_counter, cvs);
+        for (int i = 0; i < 4; i++) {
+          AddChunkChainingValue(ctx, cvs[i], ctx->chunk_counter + i + 1);
+        }
+        ChunkReset(ctx, ctx->chunk_counter + 4);
+        input += 4 * BLAKE3_CHUNK_LEN;
+        length -= 4 * BLAKE3_CHUNK_LEN;
+      }
+    }
+#endif
+
+    take = BLAKE3_CHUNK_LEN - ChunkLength(ctx);
+    if (take > length) { take = length; }
+    ChunkUpdate(ctx, input, take);
+    input += take;
+    length -= take;
+  }
+}
+
+void Blake3Final(BLAKE3_CTX* ctx, uint8_t digest[BLAKE3_DIGEST_LENGTH])
+{
+  Blake3Output out;
+  uint32_t words[16];
+  size_t remaining = ctx->cv_stack_len;
+
+  ChunkOutput(ctx, &out);
+  while (remaining > 0) {
+    uint32_t cv[8];
+
+    remaining--;
+    OutputChainingValue(&out, cv);
+    ParentOutput(ctx->cv_stack + 32 * remaining, cv, &out);
+  }
+
+  Compress(out.cv, out.block, out.block_len, 0, out.flags | ROOT, words);
+  for (int i = 0; i < 8; i++) { Store32(digest + 4 * i, words[i]); }
+}
@@ -0,0 +1,55 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * BLAKE3 hash function (unkeyed hashing, 256 bit output).
+ *
+ * The input is split into chunks of 1 KiB which are hashed independently
+ * and combined in a binary tree. When enough input is available, four
+ * chunks are compressed at once using SSE2.
+ */
+
+#ifndef BAREOS_LIB_BLAKE3_H_
+#define BAREOS_LIB_BLAKE3_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLAKE3_DIGEST_LENGTH 32
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_CHUNK_LEN 1024
+#define BLAKE3_MAX_DEPTH 54
+
+typedef struct {
+  uint32_t cv[8];                  /* Chaining value of the current chunk */
+  uint64_t chunk_counter;          /* Index of the current chunk */
+  uint8_t buf[BLAKE3_BLOCK_LEN];   /* Partial block of the current chunk */
+  uint8_t buf_len;                 /* Bytes in buf */
+  uint8_t blocks_compressed;       /* Blocks of the current chunk done */
+  uint8_t cv_stack_len;            /* Entries in cv_stack */
+  uint8_t cv_stack[(BLAKE3_MAX_DEPTH + 1) * 32]; /* Subtree chaining values */
+} BLAKE3_CTX;
+
+void Blake3Init(BLAKE3_CTX* ctx);
+void Blake3Update(BLAKE3_CTX* ctx, const void* data, size_t length);
+void Blake3Final(BLAKE3_CTX* ctx, uint8_t digest[BLAKE3_DIGEST_LENGTH]);
+
+#endif  // BAREOS_LIB_BLAKE3_H_
@@ -80,6 +80,7 @@ BareosSocket::BareosSocket()
     , nb_bytes_(0)
     , last_tick_{0}
     , tls_established_(false)
+    , tls_kernel_offload_(false)
 {
   Dmsg0(100, "Construct BareosSocket\n");
 }
@@ -128,6 +129,7 @@ BareosSocket::BareosSocket(const BareosSocket& other)
   nb_bytes_ = other.nb_bytes_;
   last_tick_ = other.last_tick_;
   tls_established_ = other.tls_established_;
+  tls_kernel_offload_ = other.tls_kernel_offload_;
 }
 
 BareosSocket::~BareosSocket()
@@ -505,6 +507,7 @@ void BareosSocket::ParameterizeTlsCert(Tls* tls_conn_init,
   tls_conn_init->SetDhFile(tls_resource->tls_cert_.dhfile_);
   tls_conn_init->SetCipherList(tls_resource->cipherlist_);
   tls_conn_init->SetVerifyPeer(tls_resource->tls_cert_.verify_peer_);
+  tls_conn_init->SetKernelOffload(tls_kernel_offload_);
 }
 
 bool BareosSocket::ParameterizeAndInitTlsConnectionAsAServer(
@@ -107,6 +107,7 @@ class BareosSocket {
   int64_t nb_bytes_;     /* Bytes sent/recv since the last tick */
   btime_t last_tick_;    /* Last tick used by bwlimit */
   bool tls_established_; /* is true when tls connection is established */
+  bool tls_kernel_offload_; /* Let the kernel encrypt the tls records */
   std::unique_ptr<BnetDump> bnet_dump_;
 
   virtual void FinInit(JobControlRecord* jcr,
@@ -264,6 +265,7 @@ class BareosSocket {
   bool UseBwlimit() { return bwlimit_ > 0; }
   void SetBwlimitBursting() { use_bursting_ = true; }
   void clear_bwlimit_bursting() { use_bursting_ = false; }
+  void SetTlsKernelOffload(bool enable) { tls_kernel_offload_ = enable; }
   void SetKeepalive() { use_keepalive_ = true; }
   void ClearKeepalive() { use_keepalive_ = false; }
   void SetSpooling() { spool_ = true; }
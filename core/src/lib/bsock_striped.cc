@@ -0,0 +1,428 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Socket spreading one message stream over several connections.
+ */
+
+#include "include/bareos.h"
+#include "include/jcr.h"
+#include "lib/bsock_striped.h"
+#include "lib/serial.h"
+
+#include <chrono>
+
+#ifndef SHUT_RD
+#define SHUT_RD 0
+#endif
+#ifndef SHUT_RDWR
+#define SHUT_RDWR 2
+#endif
+
+BareosSocketStriped::BareosSocketStriped(
+    JobControlRecord* jcr,
+    BareosSocket* control,
+    const std::vector<BareosSocket*>& stripes,
+    bool sending)
+    : control_(control),
+      sending_(sending),
+      senders_(sending ? stripes.size() + 1 : 0)
+{
+  jcr_ = jcr;
+  if (control->who()) { who_ = strdup(control->who()); }
+  if (control->host()) { host_ = strdup(control->host()); }
+  port_ = control->port();
+
+  stripes_.push_back(control);
+  stripes_.insert(stripes_.end(), stripes.begin(), stripes.end());
+
+  Dmsg2(100, "Striping data over %d connections (%s)\n", (int)stripes_.size(),
+        sending ? "send" : "receive");
+  if (sending) { Start(); }
+}
+
+/*
+ * The receiving side starts reading on first use, the control connection
+ * may still be used to send the go ahead before that. A TLS connection
+ * cannot be read and written by different threads at the same time.
+ */
+void BareosSocketStriped::Start()
+{
+  started_ = true;
+  for (size_t i = 0; i < stripes_.size(); i++) {
+    if (sending_) {
+      threads_.emplace_back(&BareosSocketStriped::SendWork, this, i);
+    } else {
+      threads_.emplace_back(&BareosSocketStriped::ReceiveWork, this, i);
+    }
+  }
+}
+
+BareosSocketStriped::~BareosSocketStriped()
+{
+  Stop(true);
+  close();
+  for (size_t i = 1; i < stripes_.size(); i++) { delete stripes_[i]; }
+  stripes_.clear();
+}
+
+/*
+ * The heartbeat thread only needs the control connection.
+ */
+BareosSocket* BareosSocketStriped::clone() { return control_->clone(); }
+
+int BareosSocketStriped::GetPeer(char* buf, socklen_t buflen)
+{
+  return control_->GetPeer(buf, buflen);
+}
+
+bool BareosSocketStriped::SetBufferSize(uint32_t size, int rw)
+{
+  bool ok = true;
+
+  message_length = 0;
+  for (auto bs : stripes_) {
+    if (!bs->SetBufferSize(size, rw)) { ok = false; }
+    if (!message_length || bs->message_length < message_length) {
+      message_length = bs->message_length;
+    }
+  }
+
+  /* Our users read and write the messages directly in our buffer. */
+  msg = ReallocPoolMemory(msg, message_length + 100);
+  return ok;
+}
+
+/*
+ * Only the additional connections are closed, the control connection is
+ * still used after the striped data.
+ */
+void BareosSocketStriped::close()
+{
+  for (size_t i = 1; i < stripes_.size(); i++) {
+    if (stripes_[i]->fd_ >= 0) { stripes_[i]->close(); }
+  }
+}
+
+void BareosSocketStriped::Fail()
+{
+  std::lock_guard<std::mutex> l(lock_);
+
+  failed_ = true;
+  for (auto& sender : senders_) { sender.cond.notify_all(); }
+  cond_.notify_all();
+}
+
+bool BareosSocketStriped::send()
+{
+  Frame frame;
+  int32_t length;
+  ser_declare;
+
+  if (!sending_) {
+    /* Replies of the receiving side go over the control connection. */
+    length = message_length > 0 ? message_length : 0;
+    control_->msg = CheckPoolMemorySize(control_->msg, length + 1);
+    memcpy(control_->msg, msg, length);
+    control_->message_length = message_length;
+    return control_->send();
+  }
+
+  if (errors || IsTerminated()) { return false; }
+
+  length = message_length > 0 ? message_length : 0;
+  frame.length = stripe_header_length + length;
+  frame.data = GetPoolMemory(PM_BSOCK);
+  frame.data = CheckPoolMemorySize(frame.data, frame.length);
+  SerBegin(frame.data, stripe_header_length);
+  ser_uint64(seq_);
+  ser_int32(message_length);
+  SerEnd(frame.data, stripe_header_length);
+  if (length > 0) {
+    memcpy(frame.data + stripe_header_length, msg, length);
+    if (UseBwlimit()) { ControlBwlimit(length); }
+  }
+
+  std::unique_lock<std::mutex> l(lock_);
+  Sender& sender = senders_[seq_ % senders_.size()];
+  while (!failed_ && sender.queue.size() >= BSOCK_STRIPE_MAX_QUEUED) {
+    cond_.wait_for(l, std::chrono::seconds(1));
+    if (jcr_ && jcr_->IsJobCanceled()) { failed_ = true; }
+  }
+  if (failed_) {
+    l.unlock();
+    FreePoolMemory(frame.data);
+    errors++;
+    return false;
+  }
+  sender.queue.push_back(frame);
+  sender.cond.notify_one();
+  seq_++;
+  out_msg_no++;
+
+  return true;
+}
+
+void BareosSocketStriped::SendWork(size_t stripe)
+{
+  BareosSocket* bs = stripes_[stripe];
+  Sender& sender = senders_[stripe];
+  POOLMEM* saved_msg;
+  Frame frame;
+  bool failed;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      while (!stopping_ && sender.queue.empty()) { sender.cond.wait(l); }
+      if (sender.queue.empty()) { break; }
+      frame = sender.queue.front();
+      sender.queue.pop_front();
+      failed = failed_;
+      cond_.notify_all();
+    }
+
+    if (!frame.data) {
+      /* End of the striped data on this connection. */
+      if (!failed && !bs->signal(BNET_EOD)) { Fail(); }
+      break;
+    }
+
+    if (!failed) {
+      /*
+       * The heartbeat thread holds a clone of the control connection
+       * sharing its buffer, so only the buffers of the other connections
+       * are swapped instead of copied.
+       */
+      saved_msg = bs->msg;
+      if (bs == control_) {
+        bs->msg = CheckPoolMemorySize(bs->msg, frame.length);
+        memcpy(bs->msg, frame.data, frame.length);
+        saved_msg = bs->msg;
+      } else {
+        bs->msg = frame.data;
+      }
+      bs->message_length = frame.length;
+      if (!bs->send()) {
+        Dmsg1(100, "Sending on stripe %d failed\n", (int)stripe);
+        Fail();
+      }
+      bs->msg = saved_msg;
+    }
+    FreePoolMemory(frame.data);
+  }
+}
+
+int32_t BareosSocketStriped::recv()
+{
+  Frame frame;
+  int32_t length;
+  unser_declare;
+
+  if (sending_) {
+    /* Replies to the sending side come in over the control connection. */
+    length = control_->recv();
+    msg = CheckPoolMemorySize(msg, control_->message_length + 1);
+    if (control_->message_length > 0) {
+      memcpy(msg, control_->msg, control_->message_length);
+      msg[control_->message_length] = 0;
+    }
+    message_length = control_->message_length;
+    return length;
+  }
+
+  if (!started_) { Start(); }
+
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    for (;;) {
+      auto it = pending_.find(seq_);
+      if (it != pending_.end()) {
+        frame = it->second;
+        pending_.erase(it);
+        break;
+      }
+      if (failed_ || ended_ == stripes_.size()) {
+        errors++;
+        b_errno = EIO;
+        msg[0] = 0;
+        message_length = 0;
+        return BNET_HARDEOF;
+      }
+      cond_.wait_for(l, std::chrono::seconds(1));
+      if (jcr_ && jcr_->IsJobCanceled()) { failed_ = true; }
+    }
+    seq_++;
+    cond_.notify_all();
+  }
+
+  read_seqno++;
+  in_msg_no++;
+
+  UnserBegin(frame.data + sizeof(uint64_t), sizeof(int32_t));
+  unser_int32(length);
+  UnserEnd(frame.data + sizeof(uint64_t), sizeof(int32_t));
+
+  if (length < 0) {
+    FreePoolMemory(frame.data);
+    message_length = length;
+    if (length == BNET_TERMINATE) { SetTerminated(); }
+    return BNET_SIGNAL;
+  }
+
+  msg = CheckPoolMemorySize(msg, length + 1);
+  memcpy(msg, frame.data + stripe_header_length, length);
+  msg[length] = 0;
+  message_length = length;
+  FreePoolMemory(frame.data);
+
+  return length;
+}
+
+void BareosSocketStriped::ReceiveWork(size_t stripe)
+{
+  BareosSocket* bs = stripes_[stripe];
+  uint64_t seq;
+  int32_t length;
+  int32_t n;
+  Frame frame;
+  unser_declare;
+
+  for (;;) {
+    n = bs->recv();
+    if (n == BNET_SIGNAL) {
+      if (bs->message_length == BNET_EOD) { break; }
+      if (bs->message_length == BNET_TERMINATE) {
+        Fail();
+        break;
+      }
+      continue;
+    }
+
+    if (n < stripe_header_length) {
+      Dmsg2(100, "Receiving on stripe %d failed: %d\n", (int)stripe, n);
+      Fail();
+      break;
+    }
+
+    UnserBegin(bs->msg, stripe_header_length);
+    unser_uint64(seq);
+    unser_int32(length);
+    UnserEnd(bs->msg, stripe_header_length);
+    if ((length >= 0 && length != n - stripe_header_length)
+        || (length < 0 && n != stripe_header_length)) {
+      Dmsg3(100, "Bad message on stripe %d: length=%d received=%d\n",
+            (int)stripe, length, n);
+      Fail();
+      break;
+    }
+
+    /* Keep the received buffer instead of copying it. */
+    frame.data = bs->msg;
+    frame.length = n;
+    bs->msg = GetPoolMemory(PM_BSOCK);
+
+    std::unique_lock<std::mutex> l(lock_);
+    /* The next expected message is always accepted, so we cannot stall. */
+    while (!stopping_ && seq != seq_
+           && pending_.size() >= BSOCK_STRIPE_MAX_QUEUED * stripes_.size()) {
+      cond_.wait(l);
+    }
+    if (stopping_ || seq < seq_ || !pending_.emplace(seq, frame).second) {
+      l.unlock();
+      FreePoolMemory(frame.data);
+      if (stopping_) { break; }
+      Fail();
+      break;
+    }
+    cond_.notify_all();
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  ended_++;
+  cond_.notify_all();
+}
+
+void BareosSocketStriped::FreeFrames()
+{
+  for (auto& sender : senders_) {
+    for (auto& frame : sender.queue) {
+      if (frame.data) { FreePoolMemory(frame.data); }
+    }
+    sender.queue.clear();
+  }
+  for (auto& entry : pending_) { FreePoolMemory(entry.second.data); }
+  pending_.clear();
+}
+
+void BareosSocketStriped::Stop(bool abort)
+{
+  if (threads_.empty()) { return; }
+
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (abort) {
+      failed_ = true;
+      stopping_ = true;
+      FreeFrames();
+    } else if (sending_) {
+      for (auto& sender : senders_) { sender.queue.push_back({nullptr, 0}); }
+    }
+    for (auto& sender : senders_) { sender.cond.notify_all(); }
+    cond_.notify_all();
+  }
+
+  if (abort) {
+    /*
+     * Unblock threads waiting on the network. The control connection is
+     * still needed to report the failure, so only its reading side is
+     * shut down on the receiving side.
+     */
+    for (size_t i = 1; i < stripes_.size(); i++) {
+      if (stripes_[i]->fd_ >= 0) { shutdown(stripes_[i]->fd_, SHUT_RDWR); }
+    }
+    if (!sending_ && control_->fd_ >= 0) { shutdown(control_->fd_, SHUT_RD); }
+  }
+
+  for (auto& thread : threads_) { thread.join(); }
+  threads_.clear();
+
+  std::lock_guard<std::mutex> l(lock_);
+  stopping_ = true;
+  FreeFrames();
+}
+
+bool BareosSocketStriped::Finish()
+{
+  bool ok;
+
+  Stop(false);
+
+  std::lock_guard<std::mutex> l(lock_);
+  ok = !failed_;
+  if (!ok) { errors++; }
+  Dmsg2(100, "Striped data finished after %llu messages ok=%d\n",
+        (unsigned long long)seq_, ok);
+
+  return ok;
+}
+
+void BareosSocketStriped::Abort() { Stop(true); }
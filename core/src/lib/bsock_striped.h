@@ -0,0 +1,134 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Socket spreading one message stream over several connections.
+ *
+ * A single TCP connection limits the throughput of a job on links with a
+ * high bandwidth delay product. The striped socket hands every message to
+ * one of several connections in turn, prefixed by a sequence number, and
+ * the receiving side puts the messages back in order. To its user it looks
+ * like a single socket carrying the original messages.
+ *
+ * On each connection a striped message is one packet consisting of
+ *
+ *   uint64_t sequence number
+ *   int32_t  length of the data or signal (< 0)
+ *   data
+ *
+ * all in network byte order. The end of the striped data on a connection
+ * is marked by a plain BNET_EOD, after which the connection is used
+ * unstriped again.
+ */
+
+#ifndef BAREOS_LIB_BSOCK_STRIPED_H_
+#define BAREOS_LIB_BSOCK_STRIPED_H_
+
+#include "lib/bsock_tcp.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Maximum number of connections one job may use and number of messages
+ * waiting per connection (sending) or for reordering (receiving).
+ */
+#define BSOCK_MAX_STRIPES 16
+#define BSOCK_STRIPE_MAX_QUEUED 32
+
+class BareosSocketStriped : public BareosSocketTCP {
+ public:
+  static const int32_t stripe_header_length =
+      sizeof(uint64_t) + sizeof(int32_t);
+
+  /*
+   * The first connection is the existing control connection, it is not
+   * owned by the striped socket. The others are closed and deleted with it.
+   */
+  BareosSocketStriped(JobControlRecord* jcr,
+                      BareosSocket* control,
+                      const std::vector<BareosSocket*>& stripes,
+                      bool sending);
+  ~BareosSocketStriped();
+
+  BareosSocket* clone() override;
+  int32_t recv() override;
+  bool send() override;
+  void close() override;
+  int GetPeer(char* buf, socklen_t buflen) override;
+  bool SetBufferSize(uint32_t size, int rw) override;
+
+  /*
+   * Wait until all striped messages are transferred and the end of the
+   * striped data was sent or received on every connection.
+   */
+  bool Finish();
+
+  /*
+   * Stop all transfers, used when the job failed.
+   */
+  void Abort();
+
+  int NumberOfStripes() const { return (int)stripes_.size(); }
+
+ private:
+  struct Frame {
+    POOLMEM* data;   /* Stripe header followed by the message */
+    int32_t length;  /* Length of data, 0 marks the end of a connection */
+  };
+
+  struct Sender {
+    std::deque<Frame> queue;
+    std::condition_variable cond;
+  };
+
+  void Start();
+  void SendWork(size_t stripe);
+  void ReceiveWork(size_t stripe);
+  void Fail();
+  void Stop(bool abort);
+  void FreeFrames();
+
+  BareosSocket* control_;
+  std::vector<BareosSocket*> stripes_;
+  std::vector<std::thread> threads_;
+  bool sending_;
+  bool started_{false};
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  bool failed_{false};
+  bool stopping_{false};
+  uint64_t seq_{0};
+
+  /* Sending side */
+  std::vector<Sender> senders_;
+
+  /* Receiving side */
+  std::map<uint64_t, Frame> pending_;
+  size_t ended_{0};
+};
+
+#endif  // BAREOS_LIB_BSOCK_STRIPED_H_
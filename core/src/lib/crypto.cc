@@ -137,6 +137,10 @@ const char* crypto_digest_name(crypto_digest_t type)
       return "SHA256";
     case CRYPTO_DIGEST_SHA512:
       return "SHA512";
+    case CRYPTO_DIGEST_BLAKE3:
+      return "BLAKE3";
+    case CRYPTO_DIGEST_XXH128:
+      return "XXH128";
     case CRYPTO_DIGEST_NONE:
       return "None";
     default:
@@ -159,6 +163,10 @@ crypto_digest_t CryptoDigestStreamType(int stream)
       return CRYPTO_DIGEST_SHA256;
     case STREAM_SHA512_DIGEST:
       return CRYPTO_DIGEST_SHA512;
+    case STREAM_BLAKE3_DIGEST:
+      return CRYPTO_DIGEST_BLAKE3;
+    case STREAM_XXH128_DIGEST:
+      return CRYPTO_DIGEST_XXH128;
     default:
       return CRYPTO_DIGEST_NONE;
   }
@@ -70,7 +70,9 @@ typedef enum
   CRYPTO_DIGEST_MD5 = 1,
   CRYPTO_DIGEST_SHA1 = 2,
   CRYPTO_DIGEST_SHA256 = 3,
-  CRYPTO_DIGEST_SHA512 = 4
+  CRYPTO_DIGEST_SHA512 = 4,
+  CRYPTO_DIGEST_BLAKE3 = 5,
+  CRYPTO_DIGEST_XXH128 = 6
 } crypto_digest_t;
 
 /* Cipher Types */
@@ -87,7 +89,10 @@ typedef enum
   CRYPTO_CIPHER_CAMELLIA_192_CBC = 7,
   CRYPTO_CIPHER_CAMELLIA_256_CBC = 8,
   CRYPTO_CIPHER_AES_128_CBC_HMAC_SHA1 = 9,
-  CRYPTO_CIPHER_AES_256_CBC_HMAC_SHA1 = 10
+  CRYPTO_CIPHER_AES_256_CBC_HMAC_SHA1 = 10,
+  CRYPTO_CIPHER_AES_128_GCM = 11,
+  CRYPTO_CIPHER_AES_256_GCM = 12,
+  CRYPTO_CIPHER_CHACHA20_POLY1305 = 13
 } crypto_cipher_t;
 
 /* Crypto API Errors */
@@ -108,6 +113,26 @@ typedef enum
 #define CRYPTO_DIGEST_SHA1_SIZE 20   /* 160 bits */
 #define CRYPTO_DIGEST_SHA256_SIZE 32 /* 256 bits */
 #define CRYPTO_DIGEST_SHA512_SIZE 64 /* 512 bits */
+#define CRYPTO_DIGEST_BLAKE3_SIZE 32 /* 256 bits */
+#define CRYPTO_DIGEST_XXH128_SIZE 16 /* 128 bits */
+
+/*
+ * Chunked AEAD ciphers (AES-GCM, ChaCha20-Poly1305) seal every chunk of data
+ * on its own, as
+ *
+ *   uint8_t nonce[CRYPTO_AEAD_NONCE_SIZE]
+ *   ciphertext, as long as the plaintext
+ *   uint8_t tag[CRYPTO_AEAD_TAG_SIZE]
+ *
+ * so chunks can be encrypted and decrypted independently of each other.
+ * The index of a chunk within the stream and whether it is the final one
+ * are authenticated as well, the stream ends with an empty final chunk
+ * written by CryptoCipherFinalize(). Chunks therefore have to be opened in
+ * order and a stream missing its final chunk fails to finalize.
+ */
+#define CRYPTO_AEAD_NONCE_SIZE 12
+#define CRYPTO_AEAD_TAG_SIZE 16
+#define CRYPTO_AEAD_OVERHEAD (CRYPTO_AEAD_NONCE_SIZE + CRYPTO_AEAD_TAG_SIZE)
 
 /* Maximum Message Digest Size */
 #ifdef HAVE_OPENSSL
@@ -123,9 +148,11 @@ typedef enum
  * to CryptoDigestFinalize().
  *      MD5: 128 bits
  *      SHA-1: 160 bits
+ *      BLAKE3: 256 bits
+ *      XXH128: 128 bits
  */
 #ifndef HAVE_SHA2
-#define CRYPTO_DIGEST_MAX_SIZE CRYPTO_DIGEST_SHA1_SIZE
+#define CRYPTO_DIGEST_MAX_SIZE CRYPTO_DIGEST_BLAKE3_SIZE
 #else
 #define CRYPTO_DIGEST_MAX_SIZE CRYPTO_DIGEST_SHA512_SIZE
 #endif
@@ -175,6 +202,17 @@ bool CryptoCipherFinalize(CIPHER_CONTEXT* cipher_ctx,
                           uint8_t* dest,
                           uint32_t* written);
 void CryptoCipherFree(CIPHER_CONTEXT* cipher_ctx);
+bool CryptoCipherIsChunked(CIPHER_CONTEXT* cipher_ctx);
+bool CryptoCipherSealChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written);
+bool CryptoCipherOpenChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written);
 X509_KEYPAIR* crypto_keypair_new(void);
 X509_KEYPAIR* crypto_keypair_dup(X509_KEYPAIR* keypair);
 int CryptoKeypairLoadCert(X509_KEYPAIR* keypair, const char* file);
@@ -38,6 +38,8 @@ struct Digest {
   union {
     SHA1_CTX sha1;
     MD5_CTX md5;
+    BLAKE3_CTX blake3;
+    XXH128_CTX xxh128;
   };
 };
 
@@ -61,6 +63,12 @@ DIGEST* crypto_digest_new(JobControlRecord* jcr, crypto_digest_t type)
     case CRYPTO_DIGEST_SHA1:
       SHA1Init(&digest->sha1);
       break;
+    case CRYPTO_DIGEST_BLAKE3:
+      Blake3Init(&digest->blake3);
+      break;
+    case CRYPTO_DIGEST_XXH128:
+      Xxh128Init(&digest->xxh128);
+      break;
     default:
       Jmsg1(jcr, M_ERROR, 0, _("Unsupported digest type=%d specified\n"), type);
       free(digest);
@@ -81,6 +89,12 @@ bool CryptoDigestUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
       /* Doesn't return anything ... */
       SHA1Update(&digest->sha1, (const uint8_t*)data, (unsigned int)length);
       return true;
+    case CRYPTO_DIGEST_BLAKE3:
+      Blake3Update(&digest->blake3, data, length);
+      return true;
+    case CRYPTO_DIGEST_XXH128:
+      Xxh128Update(&digest->xxh128, data, length);
+      return true;
     default:
       return false;
   }
@@ -104,6 +118,16 @@ bool CryptoDigestFinalize(DIGEST* digest, uint8_t* dest, uint32_t* length)
       *length = CRYPTO_DIGEST_SHA1_SIZE;
       SHA1Final((uint8_t*)dest, &digest->sha1);
       return true;
+    case CRYPTO_DIGEST_BLAKE3:
+      assert(*length >= CRYPTO_DIGEST_BLAKE3_SIZE);
+      *length = CRYPTO_DIGEST_BLAKE3_SIZE;
+      Blake3Final(&digest->blake3, dest);
+      return true;
+    case CRYPTO_DIGEST_XXH128:
+      assert(*length >= CRYPTO_DIGEST_XXH128_SIZE);
+      *length = CRYPTO_DIGEST_XXH128_SIZE;
+      Xxh128Final(&digest->xxh128, dest);
+      return true;
     default:
       return false;
   }
@@ -215,6 +239,26 @@ bool CryptoCipherFinalize(CIPHER_CONTEXT* cipher_ctx,
 
 void CryptoCipherFree(CIPHER_CONTEXT* cipher_ctx) {}
 
+bool CryptoCipherIsChunked(CIPHER_CONTEXT* cipher_ctx) { return false; }
+
+bool CryptoCipherSealChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written)
+{
+  return false;
+}
+
+bool CryptoCipherOpenChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written)
+{
+  return false;
+}
+
 const char* crypto_digest_name(DIGEST* digest)
 {
   return crypto_digest_name(digest->type);
@@ -217,6 +217,26 @@ bool CryptoCipherFinalize(CIPHER_CONTEXT* cipher_ctx,
 
 void CryptoCipherFree(CIPHER_CONTEXT* cipher_ctx) {}
 
+bool CryptoCipherIsChunked(CIPHER_CONTEXT* cipher_ctx) { return false; }
+
+bool CryptoCipherSealChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written)
+{
+  return false;
+}
+
+bool CryptoCipherOpenChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written)
+{
+  return false;
+}
+
 const char* crypto_digest_name(DIGEST* digest)
 {
   return crypto_digest_name(digest->type);
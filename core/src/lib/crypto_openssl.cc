@@ -270,6 +270,12 @@ struct Digest {
   JobControlRecord* jcr;
   crypto_digest_t type;
 
+  /* Digests OpenSSL does not provide are computed natively */
+  union {
+    BLAKE3_CTX blake3;
+    XXH128_CTX xxh128;
+  };
+
 #if OPENSSL_VERSION_NUMBER < 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
   /* Openssl Version < 1.1 */
  private:
@@ -325,12 +331,22 @@ struct Crypto_Session {
 /* Symmetric Cipher Context */
 struct Cipher_Context {
   EVP_CIPHER_CTX* ctx;
+  bool chunked{false}; /* AEAD cipher sealing every chunk on its own */
+  bool encrypt{false};
+  uint8_t nonce[CRYPTO_AEAD_NONCE_SIZE]{}; /* Nonce of the next chunk */
+  uint64_t chunk_index{0};                 /* Index of the next chunk */
+  bool last_chunk{false}; /* The final chunk was sealed or opened */
 
   Cipher_Context() { ctx = EVP_CIPHER_CTX_new(); }
 
   ~Cipher_Context() { EVP_CIPHER_CTX_free(ctx); }
 };
 
+#ifndef EVP_CTRL_AEAD_GET_TAG
+#define EVP_CTRL_AEAD_GET_TAG EVP_CTRL_GCM_GET_TAG
+#define EVP_CTRL_AEAD_SET_TAG EVP_CTRL_GCM_SET_TAG
+#endif
+
 /* PEM Password Dispatch Context */
 typedef struct PEM_CB_Context {
   CRYPTO_PEM_PASSWD_CB* pem_callback;
@@ -635,6 +651,12 @@ DIGEST* crypto_digest_new(JobControlRecord* jcr, crypto_digest_t type)
 
   /* Determine the correct OpenSSL message digest type */
   switch (type) {
+    case CRYPTO_DIGEST_BLAKE3:
+      Blake3Init(&digest->blake3);
+      return digest;
+    case CRYPTO_DIGEST_XXH128:
+      Xxh128Init(&digest->xxh128);
+      return digest;
     case CRYPTO_DIGEST_MD5:
       md = EVP_md5();
       break;
@@ -674,6 +696,17 @@ err:
  */
 bool CryptoDigestUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
 {
+  switch (digest->type) {
+    case CRYPTO_DIGEST_BLAKE3:
+      Blake3Update(&digest->blake3, data, length);
+      return true;
+    case CRYPTO_DIGEST_XXH128:
+      Xxh128Update(&digest->xxh128, data, length);
+      return true;
+    default:
+      break;
+  }
+
   if (EVP_DigestUpdate(&digest->get_ctx(), data, length) == 0) {
     Dmsg0(150, "digest update failed\n");
     OpensslPostErrors(digest->jcr, M_ERROR, _("OpenSSL digest update failed"));
@@ -692,6 +725,21 @@ bool CryptoDigestUpdate(DIGEST* digest, const uint8_t* data, uint32_t length)
  */
 bool CryptoDigestFinalize(DIGEST* digest, uint8_t* dest, uint32_t* length)
 {
+  switch (digest->type) {
+    case CRYPTO_DIGEST_BLAKE3:
+      assert(*length >= CRYPTO_DIGEST_BLAKE3_SIZE);
+      *length = CRYPTO_DIGEST_BLAKE3_SIZE;
+      Blake3Final(&digest->blake3, dest);
+      return true;
+    case CRYPTO_DIGEST_XXH128:
+      assert(*length >= CRYPTO_DIGEST_XXH128_SIZE);
+      *length = CRYPTO_DIGEST_XXH128_SIZE;
+      Xxh128Final(&digest->xxh128, dest);
+      return true;
+    default:
+      break;
+  }
+
   if (!EVP_DigestFinal(&digest->get_ctx(), dest, (unsigned int*)length)) {
     Dmsg0(150, "digest finalize failed\n");
     OpensslPostErrors(digest->jcr, M_ERROR,
@@ -1004,6 +1052,28 @@ void CryptoSignFree(SIGNATURE* sig)
   free(sig);
 }
 
+/*
+ * AEAD ciphers used in the chunked format. The stitched AES-CBC-HMAC-SHA1
+ * ciphers also claim to be AEAD ciphers, so look at the NID.
+ */
+static bool IsChunkedCipher(const EVP_CIPHER* ec)
+{
+  switch (EVP_CIPHER_nid(ec)) {
+#ifndef OPENSSL_NO_AES
+    case NID_aes_128_gcm:
+    case NID_aes_256_gcm:
+      return true;
+#endif
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305) && \
+    defined(NID_chacha20_poly1305)
+    case NID_chacha20_poly1305:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
 /*
  * Create a new encryption session.
  *  Returns: A pointer to a CRYPTO_SESSION object on success.
@@ -1119,6 +1189,27 @@ CRYPTO_SESSION* crypto_session_new(crypto_cipher_t cipher, alist* pubkeys)
       break;
 #endif
 #endif /* !OPENSSL_NO_SHA && !OPENSSL_NO_SHA1 */
+#ifndef OPENSSL_NO_AES
+    case CRYPTO_CIPHER_AES_128_GCM:
+      /* AES 128 bit GCM */
+      cs->cryptoData->contentEncryptionAlgorithm = OBJ_nid2obj(NID_aes_128_gcm);
+      ec = EVP_aes_128_gcm();
+      break;
+    case CRYPTO_CIPHER_AES_256_GCM:
+      /* AES 256 bit GCM */
+      cs->cryptoData->contentEncryptionAlgorithm = OBJ_nid2obj(NID_aes_256_gcm);
+      ec = EVP_aes_256_gcm();
+      break;
+#endif /* OPENSSL_NO_AES */
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305) && \
+    defined(NID_chacha20_poly1305)
+    case CRYPTO_CIPHER_CHACHA20_POLY1305:
+      /* ChaCha20 Poly1305 */
+      cs->cryptoData->contentEncryptionAlgorithm =
+          OBJ_nid2obj(NID_chacha20_poly1305);
+      ec = EVP_chacha20_poly1305();
+      break;
+#endif
     default:
       Jmsg0(NULL, M_ERROR, 0, _("Unsupported cipher type specified\n"));
       CryptoSessionFree(cs);
@@ -1134,8 +1225,12 @@ CRYPTO_SESSION* crypto_session_new(crypto_cipher_t cipher, alist* pubkeys)
     return NULL;
   }
 
-  /* Generate an IV if possible */
-  if ((iv_len = EVP_CIPHER_iv_length(ec))) {
+  /*
+   * Generate an IV if possible. Chunked ciphers use a nonce per chunk and
+   * store no IV, so clients not knowing them refuse the session instead of
+   * decrypting garbage.
+   */
+  if (!IsChunkedCipher(ec) && (iv_len = EVP_CIPHER_iv_length(ec))) {
     iv = (unsigned char*)malloc(iv_len);
 
     /* Generate random IV */
@@ -1394,6 +1489,28 @@ CIPHER_CONTEXT* crypto_cipher_new(CRYPTO_SESSION* cs,
     goto err;
   }
 
+  /*
+   * Chunked ciphers only get the key, the nonce is set for every chunk.
+   * Nonces consist of a random prefix per context and a chunk counter.
+   */
+  if (IsChunkedCipher(ec)) {
+    if (EVP_CIPHER_iv_length(ec) != CRYPTO_AEAD_NONCE_SIZE ||
+        !EVP_CipherInit_ex(cipher_ctx->ctx, NULL, NULL, cs->session_key, NULL,
+                           -1)) {
+      OpensslPostErrors(M_ERROR,
+                        _("OpenSSL cipher context key initialization failed"));
+      goto err;
+    }
+    if (encrypt && RAND_bytes(cipher_ctx->nonce, CRYPTO_AEAD_NONCE_SIZE) <= 0) {
+      OpensslPostErrors(M_ERROR, _("Cannot generate a nonce"));
+      goto err;
+    }
+    cipher_ctx->chunked = true;
+    cipher_ctx->encrypt = encrypt;
+    *blocksize = 1;
+    return cipher_ctx;
+  }
+
   /* Validate the IV length */
   if (EVP_CIPHER_iv_length(ec) != M_ASN1_STRING_length(cs->cryptoData->iv)) {
     OpensslPostErrors(M_ERROR, _("Encryption session provided an invalid IV"));
@@ -1427,6 +1544,8 @@ bool CryptoCipherUpdate(CIPHER_CONTEXT* cipher_ctx,
                         const uint8_t* dest,
                         uint32_t* written)
 {
+  if (cipher_ctx->chunked) { return false; }
+
   if (!EVP_CipherUpdate(cipher_ctx->ctx, (unsigned char*)dest, (int*)written,
                         (const unsigned char*)data, length)) {
     /* This really shouldn't fail */
@@ -1436,6 +1555,69 @@ bool CryptoCipherUpdate(CIPHER_CONTEXT* cipher_ctx,
   }
 }
 
+/*
+ * Authenticate the position of a chunk: its index within the stream and
+ * whether it is the final one. Chunks that are reordered, duplicated,
+ * dropped or cut off after fail to open.
+ */
+static bool SetChunkAad(CIPHER_CONTEXT* cipher_ctx, bool last)
+{
+  uint8_t aad[9];
+  int len = 0;
+
+  for (int i = 0; i < 8; i++) {
+    aad[i] = (uint8_t)(cipher_ctx->chunk_index >> (56 - 8 * i));
+  }
+  aad[8] = last ? 1 : 0;
+
+  return EVP_CipherUpdate(cipher_ctx->ctx, NULL, &len, aad, sizeof(aad));
+}
+
+static bool SealChunk(CIPHER_CONTEXT* cipher_ctx,
+                      const uint8_t* data,
+                      uint32_t length,
+                      uint8_t* dest,
+                      uint32_t* written,
+                      bool last)
+{
+  uint8_t* nonce = dest;
+  uint8_t* ciphertext = dest + CRYPTO_AEAD_NONCE_SIZE;
+  int len = 0, final_len = 0;
+  int i;
+
+  if (cipher_ctx->last_chunk) { return false; }
+
+  memcpy(nonce, cipher_ctx->nonce, CRYPTO_AEAD_NONCE_SIZE);
+
+  /*
+   * Increment the chunk counter in the last four bytes of the nonce, draw
+   * a new prefix when it wraps so no nonce is ever used twice.
+   */
+  for (i = CRYPTO_AEAD_NONCE_SIZE - 1; i >= CRYPTO_AEAD_NONCE_SIZE - 4; i--) {
+    if (++cipher_ctx->nonce[i] != 0) { break; }
+  }
+  if (i < CRYPTO_AEAD_NONCE_SIZE - 4 &&
+      RAND_bytes(cipher_ctx->nonce, CRYPTO_AEAD_NONCE_SIZE - 4) <= 0) {
+    return false;
+  }
+
+  if (!EVP_CipherInit_ex(cipher_ctx->ctx, NULL, NULL, NULL, nonce, 1) ||
+      !SetChunkAad(cipher_ctx, last) ||
+      (length > 0 &&
+       !EVP_CipherUpdate(cipher_ctx->ctx, ciphertext, &len, data, length)) ||
+      !EVP_CipherFinal_ex(cipher_ctx->ctx, ciphertext + len, &final_len) ||
+      !EVP_CIPHER_CTX_ctrl(cipher_ctx->ctx, EVP_CTRL_AEAD_GET_TAG,
+                           CRYPTO_AEAD_TAG_SIZE,
+                           ciphertext + len + final_len)) {
+    return false;
+  }
+
+  cipher_ctx->chunk_index++;
+  cipher_ctx->last_chunk = last;
+  *written = CRYPTO_AEAD_OVERHEAD + len + final_len;
+  return true;
+}
+
 /*
  * Finalize the cipher context, writing any remaining data and necessary padding
  * to dest, and the size in written.
@@ -1448,6 +1630,19 @@ bool CryptoCipherFinalize(CIPHER_CONTEXT* cipher_ctx,
                           uint8_t* dest,
                           uint32_t* written)
 {
+  /*
+   * Chunks are complete, nothing is buffered. The encrypting side seals an
+   * empty final chunk, the decrypting side checks it has seen it so a
+   * truncated stream is detected.
+   */
+  if (cipher_ctx->chunked) {
+    *written = 0;
+    if (cipher_ctx->encrypt && !cipher_ctx->last_chunk) {
+      return SealChunk(cipher_ctx, NULL, 0, dest, written, true);
+    }
+    return cipher_ctx->last_chunk;
+  }
+
   if (!EVP_CipherFinal_ex(cipher_ctx->ctx, (unsigned char*)dest,
                           (int*)written)) {
     /* This really shouldn't fail */
@@ -1462,6 +1657,79 @@ bool CryptoCipherFinalize(CIPHER_CONTEXT* cipher_ctx,
  */
 void CryptoCipherFree(CIPHER_CONTEXT* cipher_ctx) { delete cipher_ctx; }
 
+/*
+ * Returns true when the cipher context seals chunks with an AEAD cipher
+ * and must be used with CryptoCipherSealChunk() and CryptoCipherOpenChunk().
+ */
+bool CryptoCipherIsChunked(CIPHER_CONTEXT* cipher_ctx)
+{
+  return cipher_ctx->chunked;
+}
+
+/*
+ * Encrypt and authenticate length bytes of data as one chunk. dest must
+ * hold length + CRYPTO_AEAD_OVERHEAD bytes. Data chunks are never empty,
+ * only the final chunk sealed by CryptoCipherFinalize() is.
+ * Returns: true on success, number of bytes output in written
+ *          false on failure
+ */
+bool CryptoCipherSealChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written)
+{
+  if (!cipher_ctx->chunked || !cipher_ctx->encrypt || length == 0) {
+    return false;
+  }
+
+  return SealChunk(cipher_ctx, data, length, dest, written, false);
+}
+
+/*
+ * Authenticate and decrypt one chunk of length bytes. dest must hold
+ * length - CRYPTO_AEAD_OVERHEAD bytes. Chunks must be opened in the order
+ * they were sealed, an empty chunk is the final one of the stream.
+ * Returns: true on success, number of bytes output in written
+ *          false on failure, including data that was tampered with,
+ *          reordered or follows the final chunk
+ */
+bool CryptoCipherOpenChunk(CIPHER_CONTEXT* cipher_ctx,
+                           const uint8_t* data,
+                           uint32_t length,
+                           uint8_t* dest,
+                           uint32_t* written)
+{
+  const uint8_t* ciphertext = data + CRYPTO_AEAD_NONCE_SIZE;
+  uint32_t ciphertext_len;
+  int len = 0, final_len = 0;
+  bool last;
+
+  if (!cipher_ctx->chunked || cipher_ctx->encrypt || cipher_ctx->last_chunk ||
+      length < CRYPTO_AEAD_OVERHEAD) {
+    return false;
+  }
+  ciphertext_len = length - CRYPTO_AEAD_OVERHEAD;
+  last = ciphertext_len == 0;
+
+  if (!EVP_CipherInit_ex(cipher_ctx->ctx, NULL, NULL, NULL, data, 0) ||
+      !SetChunkAad(cipher_ctx, last) ||
+      (ciphertext_len > 0 &&
+       !EVP_CipherUpdate(cipher_ctx->ctx, dest, &len, ciphertext,
+                         ciphertext_len)) ||
+      !EVP_CIPHER_CTX_ctrl(cipher_ctx->ctx, EVP_CTRL_AEAD_SET_TAG,
+                           CRYPTO_AEAD_TAG_SIZE,
+                           (void*)(ciphertext + ciphertext_len)) ||
+      EVP_CipherFinal_ex(cipher_ctx->ctx, dest + len, &final_len) <= 0) {
+    return false;
+  }
+
+  cipher_ctx->chunk_index++;
+  cipher_ctx->last_chunk = last;
+  *written = len + final_len;
+  return true;
+}
+
 const char* crypto_digest_name(DIGEST* digest)
 {
   return crypto_digest_name(digest->type);
@@ -54,6 +54,7 @@
 #include "lib/bsock.h"
 #include "lib/recent_job_results_list.h"
 #include "lib/message_queue_item.h"
+#include "lib/path_list.h"
 #include "lib/volume_session_info.h"
 #include "lib/watchdog.h"
 
@@ -337,10 +338,9 @@ static void FreeCommonJcr(JobControlRecord* jcr,
     jcr->where_bregexp = nullptr;
   }
 
-  if (jcr->cached_path) {
-    FreePoolMemory(jcr->cached_path);
-    jcr->cached_path = nullptr;
-    jcr->cached_pnl = 0;
+  if (jcr->known_paths) {
+    FreePathList(jcr->known_paths);
+    jcr->known_paths = nullptr;
   }
 
   if (jcr->id_list) {
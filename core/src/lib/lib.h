@@ -38,8 +38,10 @@
 #ifndef BAREOS_LIB_LIB_H_
 #include "fnmatch.h"
 #endif
+#include "blake3.h"
 #include "md5.h"
 #include "sha1.h"
+#include "xxh3.h"
 #include "bpipe.h"
 #include "attr.h"
 #include "var.h"
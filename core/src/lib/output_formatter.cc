@@ -155,7 +155,7 @@ void OutputFormatter::ObjectEnd(const char* name)
   switch (api) {
 #if HAVE_JANSSON
     case API_MODE_JSON:
-      result_stack_json->pop();
+      JsonStackPop();
       Dmsg1(800, "result stack: %d\n", result_stack_json->size());
       break;
 #endif
@@ -218,7 +218,7 @@ void OutputFormatter::ArrayEnd(const char* name)
   switch (api) {
 #if HAVE_JANSSON
     case API_MODE_JSON:
-      result_stack_json->pop();
+      JsonStackPop();
       Dmsg1(800, "result stack: %d\n", result_stack_json->size());
       break;
 #endif
@@ -741,6 +741,7 @@ bool OutputFormatter::JsonKeyValueAddBool(const char* key, bool value)
   }
   json_object_set_new(json_obj, lkey.c_str(), json_bool);
 #endif
+  JsonStreamPending();
 
   return true;
 }
@@ -756,6 +757,7 @@ bool OutputFormatter::JsonKeyValueAdd(const char* key, uint64_t value)
     Emsg2(M_ERROR, 0, "No json object defined to add %s: %llu", key, value);
   }
   json_object_set_new(json_obj, lkey.c_str(), json_integer(value));
+  JsonStreamPending();
 
   return true;
 }
@@ -772,6 +774,7 @@ bool OutputFormatter::JsonKeyValueAdd(const char* key, const char* value)
     return false;
   }
   json_object_set_new(json_obj, lkey.c_str(), json_string(value));
+  JsonStreamPending();
 
   return true;
 }
@@ -810,21 +813,53 @@ bool OutputFormatter::JsonSendErrorMessage(const char* message)
   return send_func(send_ctx, json_error_message.c_str());
 }
 
+void OutputFormatter::JsonAddMetaRange()
+{
+  json_t* meta_obj = NULL;
+  json_t* range_obj = NULL;
+
+  if (!HasFilters()) { return; }
+
+  meta_obj = json_object();
+  json_object_set_new(result_json, "meta", meta_obj);
+
+  range_obj = json_object();
+
+  of_filter_tuple* tuple = nullptr;
+  foreach_alist (tuple, filters) {
+    if (tuple->type == OF_FILTER_LIMIT) {
+      json_object_set_new(range_obj, "limit",
+                          json_integer(tuple->u.limit_filter.limit));
+    }
+    if (tuple->type == OF_FILTER_OFFSET) {
+      json_object_set_new(range_obj, "offset",
+                          json_integer(tuple->u.offset_filter.offset));
+    }
+  }
+  json_object_set_new(range_obj, "filtered",
+                      json_integer(get_num_rows_filtered()));
+  json_object_set_new(meta_obj, "range", range_obj);
+}
+
 void OutputFormatter::JsonFinalizeResult(bool result)
 {
-  json_t* msg_obj = json_object();
+  json_t* msg_obj = NULL;
   json_t* error_obj = NULL;
   json_t* data_obj = NULL;
-  json_t* meta_obj = NULL;
-  json_t* range_obj = NULL;
   PoolMem ErrorMsg;
   char* string;
   size_t string_length = 0;
 
+  if (IsJsonStreaming()) {
+    JsonStreamFinalizeResult(result);
+    return;
+  }
+
   /*
    * We mimic json-rpc result and error messages,
    * To make it easier to implement real json-rpc later on.
    */
+  msg_obj = json_object();
   json_object_set_new(msg_obj, "jsonrpc", json_string("2.0"));
   json_object_set_new(msg_obj, "id", json_null());
 
@@ -839,27 +874,7 @@ void OutputFormatter::JsonFinalizeResult(bool result)
     json_object_set_new(msg_obj, "error", error_obj);
   } else {
     json_object_set(msg_obj, "result", result_json);
-    if (HasFilters()) {
-      meta_obj = json_object();
-      json_object_set_new(result_json, "meta", meta_obj);
-
-      range_obj = json_object();
-
-      of_filter_tuple* tuple = nullptr;
-      foreach_alist (tuple, filters) {
-        if (tuple->type == OF_FILTER_LIMIT) {
-          json_object_set_new(range_obj, "limit",
-                              json_integer(tuple->u.limit_filter.limit));
-        }
-        if (tuple->type == OF_FILTER_OFFSET) {
-          json_object_set_new(range_obj, "offset",
-                              json_integer(tuple->u.offset_filter.offset));
-        }
-      }
-      json_object_set_new(range_obj, "filtered",
-                          json_integer(get_num_rows_filtered()));
-      json_object_set_new(meta_obj, "range", range_obj);
-    }
+    JsonAddMetaRange();
   }
 
   if (compact) {
@@ -867,14 +882,15 @@ void OutputFormatter::JsonFinalizeResult(bool result)
   } else {
     string = json_dumps(msg_obj, UA_JSON_FLAGS_NORMAL);
   }
-  string_length = strlen(string);
-  Dmsg1(800, "message length (json): %lld\n", string_length);
   if (string == NULL) {
     /*
      * json_dumps return NULL on failure (this should not happen).
      */
     Emsg0(M_ERROR, 0, "Failed to generate json string.\n");
   } else {
+    string_length = strlen(string);
+    Dmsg1(800, "message length (json): %lld\n", string_length);
+
     /*
      * send json string, on failure, send json error message
      */
@@ -898,7 +914,15 @@ void OutputFormatter::JsonFinalizeResult(bool result)
     free(string);
   }
 
-  /* cleanup and reinitialize */
+  JsonResetResult();
+
+  json_object_clear(msg_obj);
+  json_decref(msg_obj);
+  msg_obj = nullptr;
+}
+
+void OutputFormatter::JsonResetResult()
+{
   while (result_stack_json->pop()) {}
 
   json_object_clear(result_json);
@@ -912,8 +936,335 @@ void OutputFormatter::JsonFinalizeResult(bool result)
   message_object_json = nullptr;
   message_object_json = json_object();
 
-  json_object_clear(msg_obj);
-  json_decref(msg_obj);
-  msg_obj = nullptr;
+  json_stream_levels.clear();
+  json_stream_buffer.clear();
+  json_stream_send_failed = false;
+}
+
+/*
+ * Streaming of large JSON results.
+ *
+ * Once an array on the result stack has grown beyond json_stream_min_rows
+ * entries, all levels of the result stack are opened in the output and
+ * everything generated so far is sent. From then on, each completed entry
+ * of a streamed level is serialized and released immediately, so only the
+ * entries still under construction are kept in memory. The generated JSON
+ * is identical to the one JsonFinalizeResult() creates in one piece.
+ */
+void OutputFormatter::JsonStackPop()
+{
+  json_t* json_current = NULL;
+  json_t* json_parent = NULL;
+  int level;
+
+  if (!IsJsonStreaming()) {
+    result_stack_json->pop();
+    json_parent = (json_t*)result_stack_json->last();
+    if (json_stream_min_rows > 0 && json_parent && json_is_array(json_parent) &&
+        json_array_size(json_parent) >= (size_t)json_stream_min_rows) {
+      JsonStreamStart();
+    }
+    return;
+  }
+
+  level = result_stack_json->size() - 1;
+  if (level < 1) { return; }
+
+  json_current = (json_t*)result_stack_json->get(level);
+  json_parent = (json_t*)result_stack_json->get(level - 1);
+  if (level < (int)json_stream_levels.size()) {
+    /*
+     * Level has already been opened in the output, so close it.
+     * Nameless objects added to objects share the level of their parent.
+     */
+    if (json_current != json_parent) {
+      JsonStreamFlushLevel(level);
+      JsonStreamCloseLevel(level, json_is_array(json_current));
+    }
+    result_stack_json->pop();
+    json_stream_levels.pop_back();
+    if (json_current != json_parent) {
+      if (json_is_array(json_parent)) {
+        json_array_clear(json_parent);
+      } else {
+        json_object_clear(json_parent);
+      }
+    }
+  } else {
+    result_stack_json->pop();
+    if (level == (int)json_stream_levels.size()) {
+      /*
+       * A completed entry of a streamed level.
+       */
+      JsonStreamFlushLevel(level - 1);
+    }
+  }
+}
+
+void OutputFormatter::JsonStreamStart()
+{
+  json_t* json_current = NULL;
+  json_t* json_parent = NULL;
+  json_t* json_child = NULL;
+  json_t* value = NULL;
+  const char* key = NULL;
+  std::string parent_key;
+  int levels = result_stack_json->size();
+
+  Dmsg1(800, "start streaming json result (stack size: %d)\n", levels);
+  for (int level = 0; level < levels; level++) {
+    json_current = (json_t*)result_stack_json->get(level);
+    json_stream_levels.push_back(false);
+    if (level > 0 && json_current == result_stack_json->get(level - 1)) {
+      continue;
+    }
+
+    json_parent = NULL;
+    if (level > 0) {
+      json_parent =
+          (json_t*)result_stack_json->get(JsonStreamResolveLevel(level - 1));
+    }
+    if (json_is_object(json_parent)) {
+      JsonStreamOpenLevel(level, parent_key.c_str(),
+                          json_is_array(json_current));
+    } else {
+      JsonStreamOpenLevel(level, NULL, json_is_array(json_current));
+    }
+
+    /*
+     * Send everything but the entry still under construction.
+     */
+    json_child = NULL;
+    for (int i = level + 1; i < levels; i++) {
+      if (result_stack_json->get(i) != json_current) {
+        json_child = (json_t*)result_stack_json->get(i);
+        break;
+      }
+    }
+
+    parent_key.clear();
+    if (json_is_array(json_current)) {
+      for (size_t i = 0; i < json_array_size(json_current); i++) {
+        value = json_array_get(json_current, i);
+        if (value != json_child) { JsonStreamMember(level, NULL, value); }
+      }
+      if (json_child) { json_incref(json_child); }
+      json_array_clear(json_current);
+      if (json_child) { json_array_append_new(json_current, json_child); }
+    } else {
+      std::vector<std::string> keys;
+
+      json_object_foreach(json_current, key, value)
+      {
+        if (value == json_child) {
+          parent_key = key;
+        } else {
+          JsonStreamMember(level, key, value);
+          keys.push_back(key);
+        }
+      }
+      for (const auto& k : keys) { json_object_del(json_current, k.c_str()); }
+    }
+  }
+}
+
+/*
+ * Alias levels of nameless objects added to objects are written into
+ * their parent level.
+ */
+int OutputFormatter::JsonStreamResolveLevel(int level)
+{
+  while (level > 0 &&
+         result_stack_json->get(level) == result_stack_json->get(level - 1)) {
+    level--;
+  }
+  return level;
+}
+
+void OutputFormatter::JsonStreamFlushLevel(int level)
+{
+  json_t* json_current = NULL;
+  json_t* value = NULL;
+  const char* key = NULL;
+
+  level = JsonStreamResolveLevel(level);
+  json_current = (json_t*)result_stack_json->get(level);
+  if (json_is_array(json_current)) {
+    for (size_t i = 0; i < json_array_size(json_current); i++) {
+      JsonStreamMember(level, NULL, json_array_get(json_current, i));
+    }
+    json_array_clear(json_current);
+  } else {
+    json_object_foreach(json_current, key, value)
+    {
+      JsonStreamMember(level, key, value);
+    }
+    json_object_clear(json_current);
+  }
+}
+
+void OutputFormatter::JsonStreamPending()
+{
+  if (IsJsonStreaming() &&
+      result_stack_json->size() == (int)json_stream_levels.size()) {
+    JsonStreamFlushLevel(result_stack_json->size() - 1);
+  }
+}
+
+/*
+ * Start a new member of the streamed level, including the separator to its
+ * predecessor and the indentation json_dumps() would use.
+ */
+void OutputFormatter::JsonStreamMemberStart(int level, const char* key)
+{
+  std::string string;
+
+  if (json_stream_levels[level]) { string += ","; }
+  if (!compact) {
+    string += "\n";
+    string.append(2 * (level + 2), ' ');
+  }
+  if (key) {
+    json_t* json_key = json_string(key);
+
+    string += JsonStreamDump(json_key, 0);
+    string += compact ? ":" : ": ";
+    json_decref(json_key);
+  }
+  json_stream_levels[level] = true;
+  JsonStreamWrite(string);
+}
+
+void OutputFormatter::JsonStreamMember(int level,
+                                       const char* key,
+                                       json_t* value)
+{
+  JsonStreamMemberStart(level, key);
+  JsonStreamWrite(JsonStreamDump(value, level + 2));
+}
+
+void OutputFormatter::JsonStreamOpenLevel(int level,
+                                          const char* key,
+                                          bool array)
+{
+  if (level == 0) {
+    /*
+     * Same json-rpc envelope as in JsonFinalizeResult().
+     */
+    if (compact) {
+      JsonStreamWrite("{\"jsonrpc\":\"2.0\",\"id\":null,\"result\":{");
+    } else {
+      JsonStreamWrite(
+          "{\n  \"jsonrpc\": \"2.0\",\n  \"id\": null,\n  \"result\": {");
+    }
+    return;
+  }
+
+  JsonStreamMemberStart(JsonStreamResolveLevel(level - 1), key);
+  JsonStreamWrite(array ? "[" : "{");
+}
+
+void OutputFormatter::JsonStreamCloseLevel(int level, bool array)
+{
+  std::string string;
+
+  if (json_stream_levels[level] && !compact) {
+    string += "\n";
+    string.append(2 * (level + 1), ' ');
+  }
+  string += array ? "]" : "}";
+  JsonStreamWrite(string);
+}
+
+void OutputFormatter::JsonStreamWrite(const std::string& string, bool flush)
+{
+  json_stream_buffer += string;
+  if (!flush && json_stream_buffer.size() < OF_JSON_STREAM_BUFFER_SIZE) {
+    return;
+  }
+
+  if (!json_stream_buffer.empty() && !json_stream_send_failed) {
+    if (!send_func(send_ctx, json_stream_buffer.c_str())) {
+      Dmsg1(100, "Failed to send json message (length=%lld).\n",
+            json_stream_buffer.size());
+      json_stream_send_failed = true;
+    }
+  }
+  json_stream_buffer.clear();
+}
+
+/*
+ * Serialize a value the way json_dumps() would do it at the given depth
+ * of the result message.
+ */
+std::string OutputFormatter::JsonStreamDump(json_t* value, int depth)
+{
+  std::string result;
+  char* string;
+
+  if (compact) {
+    string = json_dumps(value, UA_JSON_FLAGS_COMPACT | JSON_ENCODE_ANY);
+  } else {
+    string = json_dumps(value, UA_JSON_FLAGS_NORMAL | JSON_ENCODE_ANY);
+  }
+  if (string == NULL) {
+    Emsg0(M_ERROR, 0, "Failed to generate json string.\n");
+    return result;
+  }
+
+  if (compact || depth == 0) {
+    result = string;
+  } else {
+    /*
+     * Strings are escaped, so all newlines belong to the indentation.
+     */
+    for (const char* p = string; *p; p++) {
+      result += *p;
+      if (*p == '\n') { result.append(2 * depth, ' '); }
+    }
+  }
+  free(string);
+
+  return result;
+}
+
+void OutputFormatter::JsonStreamFinalizeResult(bool result)
+{
+  json_t* error_obj = NULL;
+  json_t* data_obj = NULL;
+  bool failed = !result || JsonHasErrorMessage();
+
+  while (result_stack_json->size() > 1) { JsonStackPop(); }
+
+  if (!failed) { JsonAddMetaRange(); }
+  JsonStreamFlushLevel(0);
+  JsonStreamCloseLevel(0, false);
+
+  if (failed) {
+    /*
+     * The result has already been sent,
+     * so the error can only carry the messages.
+     */
+    error_obj = json_object();
+    json_object_set_new(error_obj, "code", json_integer(1));
+    json_object_set_new(error_obj, "message", json_string("failed"));
+    data_obj = json_object();
+    json_object_set(data_obj, "messages", message_object_json);
+    json_object_set_new(error_obj, "data", data_obj);
+    if (compact) {
+      JsonStreamWrite(",\"error\":");
+    } else {
+      JsonStreamWrite(",\n  \"error\": ");
+    }
+    JsonStreamWrite(JsonStreamDump(error_obj, 1));
+    json_decref(error_obj);
+  }
+  JsonStreamWrite(compact ? "}" : "\n}", true);
+
+  if (json_stream_send_failed) {
+    Dmsg0(100, "Failed to send streamed json message.\n");
+  }
+
+  JsonResetResult();
 }
 #endif
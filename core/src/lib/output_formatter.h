@@ -36,6 +36,13 @@
 
 #define OF_MAX_NR_HIDDEN_COLUMNS 64
 
+/*
+ * In JSON API mode, results with arrays of more than this number of entries
+ * are not kept in memory but streamed to the client while they are generated.
+ */
+#define OF_JSON_STREAM_MIN_ROWS 1000
+#define OF_JSON_STREAM_BUFFER_SIZE (64 * 1024)
+
 #if HAVE_JANSSON
 /**
  * See if the source file needs the full JANSSON namespace or that we can
@@ -55,6 +62,9 @@ typedef struct json_t json_t;
 #include "lib/alist.h"
 #include "lib/api_mode.h"
 
+#include <string>
+#include <vector>
+
 class PoolMem;
 
 /**
@@ -140,6 +150,16 @@ class OutputFormatter {
   json_t* result_json = nullptr;
   alist* result_stack_json = nullptr;
   json_t* message_object_json = nullptr;
+
+  /*
+   * State of a streamed result. Every level of result_stack_json below
+   * json_stream_levels.size() has already been opened in the output,
+   * json_stream_levels remembers whether something was written into it.
+   */
+  int json_stream_min_rows = OF_JSON_STREAM_MIN_ROWS;
+  std::vector<bool> json_stream_levels;
+  std::string json_stream_buffer;
+  bool json_stream_send_failed = false;
 #endif
 
  private:
@@ -164,6 +184,20 @@ class OutputFormatter {
 
 #if HAVE_JANSSON
   bool JsonSendErrorMessage(const char* message);
+  void JsonStackPop();
+  void JsonAddMetaRange();
+  void JsonStreamStart();
+  int JsonStreamResolveLevel(int level);
+  void JsonStreamFlushLevel(int level);
+  void JsonStreamPending();
+  void JsonStreamMemberStart(int level, const char* key);
+  void JsonStreamMember(int level, const char* key, json_t* value);
+  void JsonStreamOpenLevel(int level, const char* key, bool array);
+  void JsonStreamCloseLevel(int level, bool array);
+  void JsonStreamWrite(const std::string& string, bool flush = false);
+  std::string JsonStreamDump(json_t* value, int depth);
+  void JsonStreamFinalizeResult(bool result);
+  void JsonResetResult();
 #endif
 
  public:
@@ -187,6 +221,15 @@ class OutputFormatter {
   void SetCompact(bool value) { compact = value; }
   bool GetCompact() { return compact; }
 
+#if HAVE_JANSSON
+  /*
+   * Number of array entries after which a JSON result gets streamed.
+   * A value of 0 disables streaming.
+   */
+  void SetJsonStreamMinRows(int value) { json_stream_min_rows = value; }
+  bool IsJsonStreaming() { return !json_stream_levels.empty(); }
+#endif
+
   void ObjectStart(const char* name = NULL);
   void ObjectEnd(const char* name = NULL);
   void ArrayStart(const char* name);
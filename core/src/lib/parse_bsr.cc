@@ -32,6 +32,8 @@
 #include "lib/berrno.h"
 #include "lib/parse_bsr.h"
 
+#include <algorithm>
+
 namespace libbareos {
 
 typedef storagedaemon::BootStrapRecord*(
@@ -243,6 +245,63 @@ static inline bool IsPositioningOk(storagedaemon::BootStrapRecord* bsr)
   return true;
 }
 
+/*
+ * Build the sorted FileIndex table of each bsr and, when fast rejection
+ *  is possible, the session lookup on the root bsr. These are used by the
+ *  match code instead of walking the (possibly huge) linked lists.
+ */
+static void IndexBsr(storagedaemon::BootStrapRecord* root_bsr)
+{
+  storagedaemon::BootStrapRecord* bsr;
+
+  if (root_bsr->use_fast_rejection) {
+    root_bsr->session_index = new storagedaemon::BsrSessionIndex;
+  }
+  root_bsr->first_active = root_bsr;
+
+  for (bsr = root_bsr; bsr; bsr = bsr->next) {
+    if (bsr->FileIndex) {
+      storagedaemon::BsrFileIndexTable* table =
+          new storagedaemon::BsrFileIndexTable;
+      auto& ranges = table->ranges;
+
+      for (storagedaemon::BsrFileIndex* fi = bsr->FileIndex; fi;
+           fi = fi->next) {
+        if (fi->findex <= fi->findex2) {
+          ranges.emplace_back(fi->findex, fi->findex2);
+        }
+      }
+      std::sort(ranges.begin(), ranges.end());
+
+      /*
+       * Merge overlapping and adjacent ranges.
+       */
+      size_t last = 0;
+      for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first <= (int64_t)ranges[last].second + 1) {
+          ranges[last].second =
+              std::max(ranges[last].second, ranges[i].second);
+        } else {
+          ranges[++last] = ranges[i];
+        }
+      }
+      if (!ranges.empty()) { ranges.resize(last + 1); }
+      ranges.shrink_to_fit();
+      bsr->findex_table = table;
+    }
+
+    if (root_bsr->session_index) {
+      for (storagedaemon::BsrSessionTime* st = bsr->sesstime; st;
+           st = st->next) {
+        auto& ids = root_bsr->session_index->sessions[st->sesstime];
+        for (storagedaemon::BsrSessionId* si = bsr->sessid; si; si = si->next) {
+          ids.emplace_back(si->sessid, si->sessid2);
+        }
+      }
+    }
+  }
+}
+
 /*
  * Parse Bootstrap file
  */
@@ -298,6 +357,7 @@ storagedaemon::BootStrapRecord* parse_bsr(JobControlRecord* jcr, char* fname)
   if (root_bsr) {
     root_bsr->use_fast_rejection = IsFastRejectionOk(root_bsr);
     root_bsr->use_positioning = IsPositioningOk(root_bsr);
+    IndexBsr(root_bsr);
   }
   for (bsr = root_bsr; bsr; bsr = bsr->next) { bsr->root = root_bsr; }
   return root_bsr;
@@ -482,18 +542,15 @@ static storagedaemon::BootStrapRecord* store_findex(
     findex->findex2 = lc->u2.pint32_val;
 
     /*
-     * Add it to the end of the chain
+     * Add it to the end of the chain, a single bsr can carry a very
+     *  long list of FileIndex ranges so keep track of the last one.
      */
     if (!bsr->FileIndex) {
       bsr->FileIndex = findex;
     } else {
-      /*
-       * Add to end of chain
-       */
-      storagedaemon::BsrFileIndex* bs = bsr->FileIndex;
-      for (; bs->next; bs = bs->next) {}
-      bs->next = findex;
+      bsr->FileIndex_tail->next = findex;
     }
+    bsr->FileIndex_tail = findex;
     token = LexGetToken(lc, BCT_ALL);
     if (token != BCT_COMMA) { break; }
   }
@@ -981,9 +1038,12 @@ void DumpBsr(storagedaemon::BootStrapRecord* bsr, bool recurse)
  */
 static inline void FreeBsrItem(storagedaemon::BootStrapRecord* bsr)
 {
-  if (bsr) {
-    FreeBsrItem(bsr->next);
+  storagedaemon::BootStrapRecord* next;
+
+  while (bsr) {
+    next = bsr->next;
     free(bsr);
+    bsr = next;
   }
 }
 
@@ -1010,6 +1070,8 @@ static inline void RemoveBsr(storagedaemon::BootStrapRecord* bsr)
     free(bsr->fileregex_re);
   }
   if (bsr->attr) { FreeAttr(bsr->attr); }
+  delete bsr->findex_table;
+  delete bsr->session_index;
   if (bsr->next) { bsr->next->prev = bsr->prev; }
   if (bsr->prev) { bsr->prev->next = bsr->next; }
   free(bsr);
@@ -1022,18 +1084,15 @@ void FreeBsr(storagedaemon::BootStrapRecord* bsr)
 {
   storagedaemon::BootStrapRecord* next_bsr;
 
-  if (!bsr) { return; }
-  next_bsr = bsr->next;
+  while (bsr) {
+    next_bsr = bsr->next;
 
-  /*
-   * Remove (free) current bsr
-   */
-  RemoveBsr(bsr);
-
-  /*
-   * Now get the next one
-   */
-  FreeBsr(next_bsr);
+    /*
+     * Remove (free) current bsr
+     */
+    RemoveBsr(bsr);
+    bsr = next_bsr;
+  }
 }
 
 } /* namespace libbareos */
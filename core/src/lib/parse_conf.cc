@@ -140,6 +140,7 @@ ConfigurationParser::ConfigurationParser(
   r_last_ = r_last;
   resources_ = resources;
   res_head_ = res_head;
+  res_index_.resize(r_last_ - r_first_ + 1);
   config_default_filename_ =
       config_default_filename == nullptr ? "" : config_default_filename;
   config_include_dir_ = config_include_dir == nullptr ? "" : config_include_dir;
@@ -153,7 +154,13 @@ ConfigurationParser::ConfigurationParser(
   FreeResourceCb_ = FreeResourceCb;
 }
 
-ConfigurationParser::~ConfigurationParser()
+ConfigurationParser::~ConfigurationParser() { FreeResources(); }
+
+/*
+ * Free all resources. Must be called with the resource lock held or when
+ * nobody else uses the configuration anymore.
+ */
+void ConfigurationParser::FreeResources()
 {
   if (res_head_) {
     for (int i = r_first_; i <= r_last_; i++) {
@@ -163,6 +170,7 @@ ConfigurationParser::~ConfigurationParser()
       res_head_[i - r_first_] = nullptr;
     }
   }
+  InvalidateResourceNameIndex();
 }
 
 void ConfigurationParser::InitializeQualifiedResourceNameTypeConverter(
@@ -291,31 +299,87 @@ bool ConfigurationParser::AppendToResourcesChain(BareosResource* new_resource,
     return false;
   }
 
+  LockRes(this);
+
+  ResourceNameIndex& index = GetResourceNameIndex(rindex);
+
+  if (index.by_name.find(new_resource->resource_name_) !=
+      index.by_name.end()) {
+    UnlockRes(this);
+    Emsg2(M_ERROR, 0,
+          _("Attempt to define second %s resource named \"%s\" is not "
+            "permitted.\n"),
+          resources_[rindex].name, new_resource->resource_name_);
+    return false;
+  }
+
   if (!res_head_[rindex]) {
     res_head_[rindex] = new_resource;
     Dmsg3(900, "Inserting first %s res: %s index=%d\n", ResToStr(rcode),
           new_resource->resource_name_, rindex);
   } else {  // append
-    BareosResource* last = nullptr;
-    BareosResource* current = res_head_[rindex];
-    do {
-      if (bstrcmp(current->resource_name_, new_resource->resource_name_)) {
-        Emsg2(M_ERROR, 0,
-              _("Attempt to define second %s resource named \"%s\" is not "
-                "permitted.\n"),
-              resources_[rindex].name, new_resource->resource_name_);
-        return false;
-      }
-      last = current;
-      current = last->next_;
-    } while (current);
-    last->next_ = new_resource;
+    index.tail->next_ = new_resource;
     Dmsg3(900, _("Inserting %s res: %s index=%d\n"), ResToStr(rcode),
           new_resource->resource_name_, rindex);
   }
+  index.tail = new_resource;
+  index.by_name.emplace(new_resource->resource_name_, new_resource);
+
+  UnlockRes(this);
+
   return true;
 }
 
+/*
+ * Get the name index for a resource type, rebuilding it when it was
+ * invalidated. Must be called with the resource lock held.
+ */
+ResourceNameIndex& ConfigurationParser::GetResourceNameIndex(int rindex)
+{
+  ResourceNameIndex& index = res_index_[rindex];
+
+  if (!index.valid) { RebuildResourceNameIndex(rindex); }
+
+  return index;
+}
+
+void ConfigurationParser::RebuildResourceNameIndex(int rindex)
+{
+  ResourceNameIndex& index = res_index_[rindex];
+
+  index.by_name.clear();
+  index.tail = nullptr;
+  for (BareosResource* res = res_head_[rindex]; res; res = res->next_) {
+    if (res->resource_name_) { index.by_name.emplace(res->resource_name_, res); }
+    index.tail = res;
+  }
+  index.valid = true;
+}
+
+/*
+ * Drop the name index of all resource types, e.g. when the resource chains
+ * are freed or swapped. Lookups walk the chains until it is rebuilt.
+ */
+void ConfigurationParser::InvalidateResourceNameIndex()
+{
+  for (auto& index : res_index_) {
+    index.valid = false;
+    index.tail = nullptr;
+    index.by_name.clear();
+  }
+}
+
+/*
+ * Must be called after renaming a resource that is already in the
+ * resource chain, so lookups by the new name find it.
+ */
+void ConfigurationParser::ResourceRenamed(int rcode)
+{
+  LockRes(this);
+  RebuildResourceNameIndex(rcode - r_first_);
+  UnlockRes(this);
+}
+
 int ConfigurationParser::GetResourceTableIndex(int resource_type)
 {
   int rindex = -1;
@@ -554,14 +618,32 @@ BareosResource** ConfigurationParser::SaveResources()
   BareosResource** res =
       (BareosResource**)malloc(num * sizeof(BareosResource*));
 
+  LockRes(this);
   for (int i = 0; i < num; i++) {
     res[i] = res_head_[i];
     res_head_[i] = nullptr;
   }
+  InvalidateResourceNameIndex();
+  UnlockRes(this);
 
   return res;
 }
 
+/*
+ * Put back resources saved by SaveResources().
+ */
+void ConfigurationParser::RestoreResources(BareosResource** res)
+{
+  int num = r_last_ - r_first_ + 1;
+
+  LockRes(this);
+  for (int i = 0; i < num; i++) {
+    res_head_[i] = res[i];
+    RebuildResourceNameIndex(i);
+  }
+  UnlockRes(this);
+}
+
 bool ConfigurationParser::RemoveResource(int rcode, const char* name)
 {
   int rindex = rcode - r_first_;
@@ -575,6 +657,7 @@ bool ConfigurationParser::RemoveResource(int rcode, const char* name)
    * For a general approach, a check if this resource is referenced by other
    * resources must be added. If it is referenced, don't remove it.
    */
+  LockRes(this);
   last = nullptr;
   for (BareosResource* res = res_head_[rindex]; res; res = res->next_) {
     if (bstrcmp(res->resource_name_, name)) {
@@ -589,10 +672,13 @@ bool ConfigurationParser::RemoveResource(int rcode, const char* name)
       }
       res->next_ = nullptr;
       FreeResourceCb_(res, rcode);
+      RebuildResourceNameIndex(rindex);
+      UnlockRes(this);
       return true;
     }
     last = res;
   }
+  UnlockRes(this);
 
   /*
    * Resource with this name not found
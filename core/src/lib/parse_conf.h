@@ -39,6 +39,9 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 struct ResourceItem;
 class ConfigParserStateMachine;
@@ -199,6 +202,20 @@ typedef void(PRINT_RES_HANDLER)(ResourceItem* items,
 
 class QualifiedResourceNameTypeConverter;
 
+/*
+ * Index of the resources of one type by name, maintained alongside the
+ * resource chain in res_head_ and protected by the resource lock. Every
+ * change of the chain must go through the ConfigurationParser, which keeps
+ * the index up to date or invalidates it. Renaming a resource in the chain
+ * requires a call to ResourceRenamed(). While the index is not valid
+ * lookups walk the chain.
+ */
+struct ResourceNameIndex {
+  bool valid{false};
+  BareosResource* tail{nullptr};
+  std::unordered_map<std::string, BareosResource*> by_name;
+};
+
 class ConfigurationParser {
   friend class ConfiguredTlsPolicyGetterPrivate;
   friend class ConfigParserStateMachine;
@@ -263,12 +280,14 @@ class ConfigurationParser {
   const std::string& get_base_config_path() const { return used_config_path_; }
   void FreeResources();
   BareosResource** SaveResources();
+  void RestoreResources(BareosResource** res);
   void InitResource(int rcode,
                     ResourceItem items[],
                     int pass,
                     std::function<void()> ResourceSpecificInitializer);
   bool AppendToResourcesChain(BareosResource* new_resource, int rcode);
   bool RemoveResource(int rcode, const char* name);
+  void ResourceRenamed(int rcode);
   void DumpResources(void sendit(void* sock, const char* fmt, ...),
                      void* sock,
                      bool hide_sensitive_data = false);
@@ -350,6 +369,7 @@ class ConfigurationParser {
   ParseConfigReadyCb_t ParseConfigReadyCb_;
   bool parser_first_run_;
   BStringList warnings_;
+  std::vector<ResourceNameIndex> res_index_;
 
 
   const char* GetDefaultConfigDir();
@@ -358,6 +378,9 @@ class ConfigurationParser {
                      const char* config_filename);
   bool GetConfigIncludePath(PoolMem& full_path, const char* config_dir);
   bool FindConfigPath(PoolMem& full_path);
+  ResourceNameIndex& GetResourceNameIndex(int rindex);
+  void RebuildResourceNameIndex(int rindex);
+  void InvalidateResourceNameIndex();
   int GetResourceTableIndex(int resource_type);
   void StoreMsgs(LEX* lc, ResourceItem* item, int index, int pass);
   void StoreName(LEX* lc, ResourceItem* item, int index, int pass);
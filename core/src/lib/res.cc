@@ -99,10 +99,19 @@ BareosResource* ConfigurationParser::GetResWithName(int rcode,
 
   if (lock) { LockRes(this); }
 
-  res = res_head_[rindex];
-  while (res) {
-    if (bstrcmp(res->resource_name_, name)) { break; }
-    res = res->next_;
+  res = nullptr;
+  if (name) {
+    const ResourceNameIndex& index = res_index_[rindex];
+
+    if (index.valid) {
+      auto found = index.by_name.find(name);
+
+      if (found != index.by_name.end()) { res = found->second; }
+    } else {
+      for (res = res_head_[rindex]; res; res = res->next_) {
+        if (bstrcmp(res->resource_name_, name)) { break; }
+      }
+    }
   }
 
   if (lock) { UnlockRes(this); }
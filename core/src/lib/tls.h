@@ -70,6 +70,7 @@ class Tls {
                               int port,
                               const char* who) const = 0;
   virtual std::string TlsCipherGetName() const { return std::string(); }
+  virtual bool TlsKernelOffloadActive() const { return false; }
 
   virtual void SetCipherList(const std::string& cipherlist) = 0;
 
@@ -82,6 +83,7 @@ class Tls {
   virtual void SetPemUserdata(void* pem_userdata) = 0;
   virtual void SetDhFile(const std::string& dhfile_) = 0;
   virtual void SetVerifyPeer(const bool& verify_peer) = 0;
+  virtual void SetKernelOffload(const bool& kernel_offload) = 0;
   virtual void SetTcpFileDescriptor(const int& fd) = 0;
 };
 
@@ -119,6 +119,11 @@ std::string TlsOpenSsl::TlsCipherGetName() const
   return std::string();
 }
 
+bool TlsOpenSsl::TlsKernelOffloadActive() const
+{
+  return d_->KernelOffloadActive();
+}
+
 void TlsOpenSsl::TlsLogConninfo(JobControlRecord* jcr,
                                 const char* host,
                                 int port,
@@ -127,6 +132,12 @@ void TlsOpenSsl::TlsLogConninfo(JobControlRecord* jcr,
   if (!d_->openssl_) {
     Qmsg(jcr, M_INFO, 0, _("No openssl to %s at %s:%d established\n"), who,
          host, port);
+  } else if (d_->kernel_offload_) {
+    std::string cipher_name = TlsCipherGetName();
+    Qmsg(jcr, M_INFO, 0,
+         _("Connected %s at %s:%d, encryption: %s, kernel offload: %s\n"),
+         who, host, port, cipher_name.empty() ? "Unknown" : cipher_name.c_str(),
+         d_->KernelOffloadActive() ? _("active") : _("not available"));
   } else {
     std::string cipher_name = TlsCipherGetName();
     Qmsg(jcr, M_INFO, 0, _("Connected %s at %s:%d, encryption: %s\n"), who,
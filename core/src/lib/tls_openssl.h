@@ -49,6 +49,7 @@ class TlsOpenSsl : public Tls {
   void TlsBsockShutdown(BareosSocket* bsock) override;
 
   std::string TlsCipherGetName() const override;
+  bool TlsKernelOffloadActive() const override;
   void SetCipherList(const std::string& cipherlist) override;
   void TlsLogConninfo(JobControlRecord* jcr,
                       const char* host,
@@ -66,6 +67,7 @@ class TlsOpenSsl : public Tls {
   void SetPemUserdata(void* pem_userdata) override;
   void SetDhFile(const std::string& dhfile_) override;
   void SetVerifyPeer(const bool& verify_peer) override;
+  void SetKernelOffload(const bool& kernel_offload) override;
   void SetTcpFileDescriptor(const int& fd) override;
 
  private:
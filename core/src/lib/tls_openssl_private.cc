@@ -59,6 +59,7 @@ TlsOpenSslPrivate::TlsOpenSslPrivate()
     , pem_callback_(nullptr)
     , pem_userdata_(nullptr)
     , verify_peer_(false)
+    , kernel_offload_(false)
 {
   Dmsg0(100, "Construct TlsOpenSslPrivate\n");
 }
@@ -198,6 +199,20 @@ bool TlsOpenSslPrivate::init()
   SSL_set_mode(openssl_, SSL_MODE_ENABLE_PARTIAL_WRITE |
                              SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
+  if (kernel_offload_) {
+    /*
+     * Let the kernel encrypt and decrypt the records after the handshake
+     * (kTLS), so SSL_write() and SSL_read() no longer copy the data through
+     * user space. OpenSSL silently keeps doing it itself when the kernel
+     * lacks the tls module or does not support the negotiated cipher.
+     */
+#if defined(SSL_OP_ENABLE_KTLS)
+    SSL_set_options(openssl_, SSL_OP_ENABLE_KTLS);
+#else
+    Dmsg0(100, "TLS kernel offload is not supported by this OpenSSL\n");
+#endif
+  }
+
   BIO* bio = BIO_new(BIO_s_socket());
   if (!bio) {
     OpensslPostErrors(M_FATAL, _("Error creating file descriptor-based BIO"));
@@ -341,6 +356,10 @@ bool TlsOpenSslPrivate::OpensslBsockSessionStart(BareosSocket* bsock,
     switch (ssl_error) {
       case SSL_ERROR_NONE:
         bsock->SetTlsEstablished();
+        if (kernel_offload_) {
+          Dmsg2(100, "TLS kernel offload with %s: %s\n", bsock->who(),
+                KernelOffloadActive() ? "active" : "not available");
+        }
         status = true;
         goto cleanup;
       case SSL_ERROR_ZERO_RETURN:
@@ -374,6 +393,18 @@ cleanup:
   return status;
 }
 
+bool TlsOpenSslPrivate::KernelOffloadActive() const
+{
+#if defined(SSL_OP_ENABLE_KTLS)
+  if (!openssl_) { return false; }
+
+  return BIO_get_ktls_send(SSL_get_wbio(openssl_)) ||
+         BIO_get_ktls_recv(SSL_get_rbio(openssl_));
+#else
+  return false;
+#endif
+}
+
 int TlsOpenSslPrivate::tls_pem_callback_dispatch(char* buf,
                                                  int size,
                                                  int rwflag,
@@ -545,6 +576,12 @@ void TlsOpenSsl::SetVerifyPeer(const bool& verify_peer)
   d_->verify_peer_ = verify_peer;
 }
 
+void TlsOpenSsl::SetKernelOffload(const bool& kernel_offload)
+{
+  Dmsg1(100, "Set Kernel Offload:\t<%s>\n", kernel_offload ? "true" : "false");
+  d_->kernel_offload_ = kernel_offload;
+}
+
 void TlsOpenSsl::SetTcpFileDescriptor(const int& fd)
 {
   Dmsg1(100, "Set tcp filedescriptor: <%d>\n", fd);
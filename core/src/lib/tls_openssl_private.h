@@ -45,6 +45,7 @@ class TlsOpenSslPrivate {
                             int nbytes,
                             bool write);
   bool OpensslBsockSessionStart(BareosSocket* bsock, bool server);
+  bool KernelOffloadActive() const;
 
   void ClientContextInsertCredentials(const PskCredentials& cred);
   void ServerContextInsertCredentials(const PskCredentials& cred);
@@ -90,6 +91,7 @@ class TlsOpenSslPrivate {
   std::string dhfile_;
   std::string cipherlist_;
   bool verify_peer_;
+  bool kernel_offload_;
   /* *************** */
 };
 
@@ -0,0 +1,498 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * XXH3 128 bit hash function, following the XXH3 algorithm of xxHash 0.8
+ * with the default secret and seed 0. The canonical (big endian) form of
+ * the hash is returned, so digests match the ones of the xxhsum tool.
+ */
+
+#include "include/bareos.h"
+#include "lib/xxh3.h"
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+#define PRIME_MX1 0x165667919E3779F9ULL
+#define PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define STRIPE_LEN 64
+#define SECRET_CONSUME_RATE 8
+#define ACC_NB 8
+#define SECRET_SIZE 192
+#define SECRET_LIMIT (SECRET_SIZE - STRIPE_LEN)
+#define STRIPES_PER_BLOCK (SECRET_LIMIT / SECRET_CONSUME_RATE)
+#define BLOCK_LEN (STRIPE_LEN * STRIPES_PER_BLOCK)
+#define SECRET_LASTACC_START 7
+#define SECRET_MERGEACCS_START 11
+#define SECRET_SIZE_MIN 136
+#define MIDSIZE_MAX 240
+#define MIDSIZE_STARTOFFSET 3
+#define MIDSIZE_LASTOFFSET 17
+#define INTERNAL_BUFFER_STRIPES (XXH3_INTERNAL_BUFFER_SIZE / STRIPE_LEN)
+
+static const uint8_t xxh3_secret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+struct Hash128 {
+  uint64_t low;
+  uint64_t high;
+};
+
+static inline uint32_t Load32(const uint8_t* p)
+{
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t Load64(const uint8_t* p)
+{
+  return ((uint64_t)Load32(p)) | ((uint64_t)Load32(p + 4) << 32);
+}
+
+static inline uint32_t Swap32(uint32_t x)
+{
+  return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) |
+         ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+static inline uint64_t Swap64(uint64_t x)
+{
+  return ((uint64_t)Swap32((uint32_t)x) << 32) | Swap32((uint32_t)(x >> 32));
+}
+
+static inline uint32_t Rotl32(uint32_t x, int r)
+{
+  return (x << r) | (x >> (32 - r));
+}
+
+static inline Hash128 Mult64to128(uint64_t lhs, uint64_t rhs)
+{
+  Hash128 r;
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = (unsigned __int128)lhs * rhs;
+
+  r.low = (uint64_t)product;
+  r.high = (uint64_t)(product >> 64);
+#else
+  uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+
+  r.high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  r.low = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+#endif
+  return r;
+}
+
+static inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs)
+{
+  Hash128 product = Mult64to128(lhs, rhs);
+
+  return product.low ^ product.high;
+}
+
+static inline uint64_t XorShift64(uint64_t v, int shift)
+{
+  return v ^ (v >> shift);
+}
+
+static inline uint64_t Xxh64Avalanche(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+static inline uint64_t Avalanche(uint64_t h)
+{
+  h = XorShift64(h, 37);
+  h *= PRIME_MX1;
+  h = XorShift64(h, 32);
+  return h;
+}
+
+static Hash128 Len1To3(const uint8_t* input, size_t len, const uint8_t* secret)
+{
+  uint8_t c1 = input[0];
+  uint8_t c2 = input[len >> 1];
+  uint8_t c3 = input[len - 1];
+  uint32_t combinedl = ((uint32_t)c1 << 16) | ((uint32_t)c2 << 24) |
+                       ((uint32_t)c3 << 0) | ((uint32_t)len << 8);
+  uint32_t combinedh = Rotl32(Swap32(combinedl), 13);
+  uint64_t bitflipl = Load32(secret) ^ Load32(secret + 4);
+  uint64_t bitfliph = Load32(secret + 8) ^ Load32(secret + 12);
+  Hash128 h;
+
+  h.low = Xxh64Avalanche((uint64_t)combinedl ^ bitflipl);
+  h.high = Xxh64Avalanche((uint64_t)combinedh ^ bitfliph);
+  return h;
+}
+
+static Hash128 Len4To8(const uint8_t* input, size_t len, const uint8_t* secret)
+{
+  uint32_t input_lo = Load32(input);
+  uint32_t input_hi = Load32(input + len - 4);
+  uint64_t input_64 = input_lo + ((uint64_t)input_hi << 32);
+  uint64_t bitflip = Load64(secret + 16) ^ Load64(secret + 24);
+  Hash128 m = Mult64to128(input_64 ^ bitflip, PRIME64_1 + (len << 2));
+
+  m.high += (m.low << 1);
+  m.low ^= (m.high >> 3);
+  m.low = XorShift64(m.low, 35);
+  m.low *= PRIME_MX2;
+  m.low = XorShift64(m.low, 28);
+  m.high = Avalanche(m.high);
+  return m;
+}
+
+static Hash128 Len9To16(const uint8_t* input, size_t len, const uint8_t* secret)
+{
+  uint64_t bitflipl = Load64(secret + 32) ^ Load64(secret + 40);
+  uint64_t bitfliph = Load64(secret + 48) ^ Load64(secret + 56);
+  uint64_t input_lo = Load64(input);
+  uint64_t input_hi = Load64(input + len - 8);
+  Hash128 m = Mult64to128(input_lo ^ input_hi ^ bitflipl, PRIME64_1);
+  Hash128 h;
+
+  m.low += (uint64_t)(len - 1) << 54;
+  input_hi ^= bitfliph;
+  m.high += input_hi + (uint64_t)(uint32_t)input_hi * (PRIME32_2 - 1);
+  m.low ^= Swap64(m.high);
+
+  h = Mult64to128(m.low, PRIME64_2);
+  h.high += m.high * PRIME64_2;
+  h.low = Avalanche(h.low);
+  h.high = Avalanche(h.high);
+  return h;
+}
+
+static Hash128 Len0To16(const uint8_t* input, size_t len, const uint8_t* secret)
+{
+  Hash128 h;
+
+  if (len > 8) { return Len9To16(input, len, secret); }
+  if (len >= 4) { return Len4To8(input, len, secret); }
+  if (len) { return Len1To3(input, len, secret); }
+
+  h.low = Xxh64Avalanche(Load64(secret + 64) ^ Load64(secret + 72));
+  h.high = Xxh64Avalanche(Load64(secret + 80) ^ Load64(secret + 88));
+  return h;
+}
+
+static inline uint64_t Mix16B(const uint8_t* input,
+                              const uint8_t* secret,
+                              uint64_t seed)
+{
+  return Mul128Fold64(Load64(input) ^ (Load64(secret) + seed),
+                      Load64(input + 8) ^ (Load64(secret + 8) - seed));
+}
+
+static inline void Mix32B(Hash128* acc,
+                          const uint8_t* input_1,
+                          const uint8_t* input_2,
+                          const uint8_t* secret,
+                          uint64_t seed)
+{
+  acc->low += Mix16B(input_1, secret, seed);
+  acc->low ^= Load64(input_2) + Load64(input_2 + 8);
+  acc->high += Mix16B(input_2, secret + 16, seed);
+  acc->high ^= Load64(input_1) + Load64(input_1 + 8);
+}
+
+static Hash128 FinishShort(const Hash128& acc, size_t len)
+{
+  Hash128 h;
+
+  h.low = acc.low + acc.high;
+  h.high = (acc.low * PRIME64_1) + (acc.high * PRIME64_4) + (len * PRIME64_2);
+  h.low = Avalanche(h.low);
+  h.high = (uint64_t)0 - Avalanche(h.high);
+  return h;
+}
+
+static Hash128 Len17To128(const uint8_t* input,
+                          size_t len,
+                          const uint8_t* secret)
+{
+  Hash128 acc;
+
+  acc.low = len * PRIME64_1;
+  acc.high = 0;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        Mix32B(&acc, input + 48, input + len - 64, secret + 96, 0);
+      }
+      Mix32B(&acc, input + 32, input + len - 48, secret + 64, 0);
+    }
+    Mix32B(&acc, input + 16, input + len - 32, secret + 32, 0);
+  }
+  Mix32B(&acc, input, input + len - 16, secret, 0);
+
+  return FinishShort(acc, len);
+}
+
+static Hash128 Len129To240(const uint8_t* input,
+                           size_t len,
+                           const uint8_t* secret)
+{
+  int nb_rounds = (int)len / 32;
+  Hash128 acc;
+
+  acc.low = len * PRIME64_1;
+  acc.high = 0;
+  for (int i = 0; i < 4; i++) {
+    Mix32B(&acc, input + 32 * i, input + 32 * i + 16, secret + 32 * i, 0);
+  }
+  acc.low = Avalanche(acc.low);
+  acc.high = Avalanche(acc.high);
+  for (int i = 4; i < nb_rounds; i++) {
+    Mix32B(&acc, input + 32 * i, input + 32 * i + 16,
+           secret + MIDSIZE_STARTOFFSET + 32 * (i - 4), 0);
+  }
+  Mix32B(&acc, input + len - 16, input + len - 32,
+         secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16, 0);
+
+  return FinishShort(acc, len);
+}
+
+static inline void Accumulate512(uint64_t* acc,
+                                 const uint8_t* input,
+                                 const uint8_t* secret)
+{
+  for (int i = 0; i < ACC_NB; i++) {
+    uint64_t data_val = Load64(input + 8 * i);
+    uint64_t data_key = data_val ^ Load64(secret + 8 * i);
+
+    acc[i ^ 1] += data_val;
+    acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+  }
+}
+
+static inline void Accumulate(uint64_t* acc,
+                              const uint8_t* input,
+                              const uint8_t* secret,
+                              size_t nb_stripes)
+{
+  for (size_t n = 0; n < nb_stripes; n++) {
+    Accumulate512(acc, input + n * STRIPE_LEN,
+                  secret + n * SECRET_CONSUME_RATE);
+  }
+}
+
+static inline void ScrambleAcc(uint64_t* acc, const uint8_t* secret)
+{
+  for (int i = 0; i < ACC_NB; i++) {
+    uint64_t acc64 = acc[i];
+
+    acc64 = XorShift64(acc64, 47);
+    acc64 ^= Load64(secret + 8 * i);
+    acc64 *= PRIME32_1;
+    acc[i] = acc64;
+  }
+}
+
+static uint64_t MergeAccs(const uint64_t* acc,
+                          const uint8_t* secret,
+                          uint64_t start)
+{
+  uint64_t result = start;
+
+  for (int i = 0; i < 4; i++) {
+    result += Mul128Fold64(acc[2 * i] ^ Load64(secret + 16 * i),
+                           acc[2 * i + 1] ^ Load64(secret + 16 * i + 8));
+  }
+
+  return Avalanche(result);
+}
+
+static Hash128 MergeLong(const uint64_t* acc, uint64_t len)
+{
+  Hash128 h;
+
+  h.low =
+      MergeAccs(acc, xxh3_secret + SECRET_MERGEACCS_START, len * PRIME64_1);
+  h.high = MergeAccs(
+      acc, xxh3_secret + SECRET_SIZE - 8 * ACC_NB - SECRET_MERGEACCS_START,
+      ~(len * PRIME64_2));
+  return h;
+}
+
+static Hash128 HashShort(const uint8_t* input, size_t len)
+{
+  if (len <= 16) { return Len0To16(input, len, xxh3_secret); }
+  if (len <= 128) { return Len17To128(input, len, xxh3_secret); }
+  return Len129To240(input, len, xxh3_secret);
+}
+
+/*
+ * Accumulate nb_stripes stripes, scrambling the accumulators whenever a
+ * block of stripes is complete.
+ */
+static void ConsumeStripes(uint64_t* acc,
+                           uint32_t* nb_stripes_so_far,
+                           const uint8_t* input,
+                           size_t nb_stripes)
+{
+  if (STRIPES_PER_BLOCK - *nb_stripes_so_far <= nb_stripes) {
+    size_t to_end = STRIPES_PER_BLOCK - *nb_stripes_so_far;
+
+    Accumulate(acc, input,
+               xxh3_secret + *nb_stripes_so_far * SECRET_CONSUME_RATE, to_end);
+    ScrambleAcc(acc, xxh3_secret + SECRET_LIMIT);
+    Accumulate(acc, input + to_end * STRIPE_LEN, xxh3_secret,
+               nb_stripes - to_end);
+    *nb_stripes_so_far = nb_stripes - to_end;
+  } else {
+    Accumulate(acc, input,
+               xxh3_secret + *nb_stripes_so_far * SECRET_CONSUME_RATE,
+               nb_stripes);
+    *nb_stripes_so_far += nb_stripes;
+  }
+}
+
+void Xxh128Init(XXH128_CTX* ctx)
+{
+  ctx->acc[0] = PRIME32_3;
+  ctx->acc[1] = PRIME64_1;
+  ctx->acc[2] = PRIME64_2;
+  ctx->acc[3] = PRIME64_3;
+  ctx->acc[4] = PRIME64_4;
+  ctx->acc[5] = PRIME32_2;
+  ctx->acc[6] = PRIME64_5;
+  ctx->acc[7] = PRIME32_1;
+  ctx->buffered_size = 0;
+  ctx->nb_stripes_so_far = 0;
+  ctx->total_len = 0;
+}
+
+/*
+ * Input is consumed in multiples of the internal buffer size, at least one
+ * byte always stays buffered for the final (partial) stripe.
+ */
+void Xxh128Update(XXH128_CTX* ctx, const void* data, size_t length)
+{
+  const uint8_t* input = (const uint8_t*)data;
+  const uint8_t* end = input + length;
+
+  if (length == 0) { return; }
+  ctx->total_len += length;
+
+  if (length <= XXH3_INTERNAL_BUFFER_SIZE - ctx->buffered_size) {
+    memcpy(ctx->buffer + ctx->buffered_size, input, length);
+    ctx->buffered_size += length;
+    return;
+  }
+
+  if (ctx->buffered_size) {
+    size_t load_size = XXH3_INTERNAL_BUFFER_SIZE - ctx->buffered_size;
+
+    memcpy(ctx->buffer + ctx->buffered_size, input, load_size);
+    input += load_size;
+    ConsumeStripes(ctx->acc, &ctx->nb_stripes_so_far, ctx->buffer,
+                   INTERNAL_BUFFER_STRIPES);
+    ctx->buffered_size = 0;
+  }
+
+  if (input + XXH3_INTERNAL_BUFFER_SIZE < end) {
+    const uint8_t* limit = end - XXH3_INTERNAL_BUFFER_SIZE;
+
+    do {
+      ConsumeStripes(ctx->acc, &ctx->nb_stripes_so_far, input,
+                     INTERNAL_BUFFER_STRIPES);
+      input += XXH3_INTERNAL_BUFFER_SIZE;
+    } while (input < limit);
+
+    /*
+     * Keep the last stripe consumed, it may be needed for the final
+     * partial stripe.
+     */
+    memcpy(ctx->buffer + XXH3_INTERNAL_BUFFER_SIZE - STRIPE_LEN,
+           input - STRIPE_LEN, STRIPE_LEN);
+  }
+
+  memcpy(ctx->buffer, input, end - input);
+  ctx->buffered_size = end - input;
+}
+
+void Xxh128Final(XXH128_CTX* ctx, uint8_t digest[XXH128_DIGEST_LENGTH])
+{
+  Hash128 h;
+
+  if (ctx->total_len > MIDSIZE_MAX) {
+    uint64_t acc[ACC_NB];
+    const uint8_t* last_acc_secret =
+        xxh3_secret + SECRET_LIMIT - SECRET_LASTACC_START;
+
+    memcpy(acc, ctx->acc, sizeof(acc));
+    if (ctx->buffered_size >= STRIPE_LEN) {
+      uint32_t nb_stripes_so_far = ctx->nb_stripes_so_far;
+
+      ConsumeStripes(acc, &nb_stripes_so_far, ctx->buffer,
+                     (ctx->buffered_size - 1) / STRIPE_LEN);
+      Accumulate512(acc, ctx->buffer + ctx->buffered_size - STRIPE_LEN,
+                    last_acc_secret);
+    } else {
+      uint8_t last_stripe[STRIPE_LEN];
+      size_t catchup = STRIPE_LEN - ctx->buffered_size;
+
+      memcpy(last_stripe, ctx->buffer + XXH3_INTERNAL_BUFFER_SIZE - catchup,
+             catchup);
+      memcpy(last_stripe + catchup, ctx->buffer, ctx->buffered_size);
+      Accumulate512(acc, last_stripe, last_acc_secret);
+    }
+    h = MergeLong(acc, ctx->total_len);
+  } else {
+    h = HashShort(ctx->buffer, ctx->total_len);
+  }
+
+  for (int i = 0; i < 8; i++) {
+    digest[i] = (uint8_t)(h.high >> (56 - 8 * i));
+    digest[8 + i] = (uint8_t)(h.low >> (56 - 8 * i));
+  }
+}
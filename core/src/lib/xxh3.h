@@ -0,0 +1,51 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * XXH3 128 bit hash function (default secret, seed 0).
+ *
+ * XXH3 is not a cryptographic hash. It is only meant for detecting
+ * changed files, never for signing or verifying the integrity of data
+ * that may have been tampered with.
+ */
+
+#ifndef BAREOS_LIB_XXH3_H_
+#define BAREOS_LIB_XXH3_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define XXH128_DIGEST_LENGTH 16
+#define XXH3_INTERNAL_BUFFER_SIZE 256
+
+typedef struct {
+  uint64_t acc[8];                           /* Accumulators */
+  uint8_t buffer[XXH3_INTERNAL_BUFFER_SIZE]; /* Input not yet consumed */
+  uint32_t buffered_size;                    /* Bytes in buffer */
+  uint32_t nb_stripes_so_far;                /* Stripes of the current block */
+  uint64_t total_len;                        /* Total input length */
+} XXH128_CTX;
+
+void Xxh128Init(XXH128_CTX* ctx);
+void Xxh128Update(XXH128_CTX* ctx, const void* data, size_t length);
+void Xxh128Final(XXH128_CTX* ctx, uint8_t digest[XXH128_DIGEST_LENGTH]);
+
+#endif  // BAREOS_LIB_XXH3_H_
@@ -46,6 +46,7 @@
 #include "include/jcr.h"
 #include "stored/block.h"
 #include "stored/jcr_private.h"
+#include "stored/volume_index.h"
 
 #include <algorithm>
 
@@ -634,7 +635,8 @@ bool ReleaseDevice(DeviceControlRecord* dcr)
               dev->getVolCatName(), dev->print_name());
       }
       if (dev->num_writers == 0) { /* if not being used */
-        VolumeUnused(dcr);         /*  we obviously are not using the volume */
+        if (!dev->AtWeot()) { VolumeIndexEndAppend(dcr); }
+        VolumeUnused(dcr); /*  we obviously are not using the volume */
       }
     }
 
@@ -776,6 +778,18 @@ void SetupNewDcrDevice(JobControlRecord* jcr,
       dev->max_block_size = blocksizes->max_block_size;
     }
 
+    /*
+     * Blocks still queued belong to the old device, write them out before
+     * switching so no data of the job is lost.
+     */
+    if (!dcr->queued_blocks.empty() && dcr->dev &&
+        !dcr->WriteQueuedBlocks()) {
+      Jmsg1(jcr, M_FATAL, 0,
+            _("Could not write queued blocks to device %s before switching "
+              "devices.\n"),
+            dcr->dev->print_name());
+    }
+    dcr->FreeQueuedBlocks();
     if (dcr->block) { FreeBlock(dcr->block); }
     dcr->block = new_block(dev);
 
@@ -883,10 +897,15 @@ void FreeDeviceControlRecord(DeviceControlRecord* dcr)
 
   LockedDetachDcrFromDev(dcr);
 
+  dcr->FreeQueuedBlocks();
   if (dcr->block) { FreeBlock(dcr->block); }
 
   if (dcr->rec) { FreeRecord(dcr->rec); }
 
+  delete dcr->volume_index;
+  VolumeIndexFlushBlocks(dcr);
+  delete dcr->volume_index_blocks;
+
   if (jcr && jcr->impl->dcr == dcr) { jcr->impl->dcr = NULL; }
 
   if (jcr && jcr->impl->read_dcr == dcr) { jcr->impl->read_dcr = NULL; }
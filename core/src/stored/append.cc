@@ -40,6 +40,7 @@
 #include "lib/edit.h"
 #include "include/jcr.h"
 #include "lib/bsock.h"
+#include "lib/bsock_striped.h"
 #include "lib/berrno.h"
 #include "lib/berrno.h"
 
@@ -56,10 +57,17 @@ void PossibleIncompleteJob(JobControlRecord* jcr, int32_t last_file_index) {}
 
 /**
  * Append Data sent from File daemon
+ *
+ * When the data is striped over several connections, it is read through
+ * striped while replies still go to bs.
  */
-bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
+bool DoAppendData(JobControlRecord* jcr,
+                  BareosSocket* bs,
+                  const char* what,
+                  BareosSocketStriped* striped)
 {
   int32_t n, file_index, stream, last_file_index, job_elapsed;
+  BareosSocket* data = striped ? striped : bs;
   bool ok = true;
   char buf1[100];
   DeviceControlRecord* dcr = jcr->impl->dcr;
@@ -79,8 +87,8 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
 
   Dmsg1(100, "Start append data. res=%d\n", dev->NumReserved());
 
-  if (!bs->SetBufferSize(dcr->device_resource->max_network_buffer_size,
-                         BNET_SETBUF_WRITE)) {
+  if (!data->SetBufferSize(dcr->device_resource->max_network_buffer_size,
+                           BNET_SETBUF_WRITE)) {
     Jmsg0(jcr, M_FATAL, 0, _("Unable to set network buffer size.\n"));
     goto bail_out;
   }
@@ -151,6 +159,7 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
    * and 3. for the MD5 if any.
    */
   dcr->VolFirstIndex = dcr->VolLastIndex = 0;
+  dcr->max_queued_blocks = dcr->device_resource->queued_write_blocks;
   jcr->run_time = time(NULL); /* start counting time for rates */
   for (last_file_index = 0; ok && !jcr->IsJobCanceled();) {
     /*
@@ -162,20 +171,20 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
      * - info       (Info for Storage daemon -- compressed, encrypted, ...)
      *               info is not currently used, so is read, but ignored!
      */
-    if ((n = BgetMsg(bs)) <= 0) {
-      if (n == BNET_SIGNAL && bs->message_length == BNET_EOD) {
+    if ((n = BgetMsg(data)) <= 0) {
+      if (n == BNET_SIGNAL && data->message_length == BNET_EOD) {
         break; /* end of data */
       }
       Jmsg2(jcr, M_FATAL, 0, _("Error reading data header from %s. ERR=%s\n"),
-            what, bs->bstrerror());
+            what, data->bstrerror());
       PossibleIncompleteJob(jcr, last_file_index);
       ok = false;
       break;
     }
 
-    if (sscanf(bs->msg, "%ld %ld", &file_index, &stream) != 2) {
+    if (sscanf(data->msg, "%ld %ld", &file_index, &stream) != 2) {
       Jmsg2(jcr, M_FATAL, 0, _("Malformed data header from %s: %s\n"), what,
-            bs->msg);
+            data->msg);
       ok = false;
       PossibleIncompleteJob(jcr, last_file_index);
       break;
@@ -213,14 +222,14 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
      * that after the loop ends.
      */
     rec_data = dcr->rec->data;
-    while ((n = BgetMsg(bs)) > 0 && !jcr->IsJobCanceled()) {
+    while ((n = BgetMsg(data)) > 0 && !jcr->IsJobCanceled()) {
       dcr->rec->VolSessionId = jcr->VolSessionId;
       dcr->rec->VolSessionTime = jcr->VolSessionTime;
       dcr->rec->FileIndex = file_index;
       dcr->rec->Stream = stream;
       dcr->rec->maskedStream = stream & STREAMMASK_TYPE; /* strip high bits */
-      dcr->rec->data_len = bs->message_length;
-      dcr->rec->data = bs->msg; /* use message buffer */
+      dcr->rec->data_len = data->message_length;
+      dcr->rec->data = data->msg; /* use message buffer */
 
       Dmsg4(850, "before writ_rec FI=%d SessId=%d Strm=%s len=%d\n",
             dcr->rec->FileIndex, dcr->rec->VolSessionId,
@@ -244,12 +253,12 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
      */
     dcr->rec->data = rec_data;
 
-    if (bs->IsError()) {
+    if (data->IsError()) {
       if (!jcr->IsJobCanceled()) {
         Dmsg2(350, "Network read error from %s. ERR=%s\n", what,
-              bs->bstrerror());
+              data->bstrerror());
         Jmsg2(jcr, M_FATAL, 0, _("Network error reading from %s. ERR=%s\n"),
-              what, bs->bstrerror());
+              what, data->bstrerror());
         PossibleIncompleteJob(jcr, last_file_index);
       }
       ok = false;
@@ -257,6 +266,20 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
     }
   }
 
+  if (striped) {
+    /*
+     * Wait for the end of the striped data on all connections before the
+     * control connection is used again.
+     */
+    if (!ok || jcr->IsJobCanceled()) {
+      striped->Abort();
+    } else if (!striped->Finish()) {
+      Jmsg1(jcr, M_FATAL, 0, _("Network error reading from %s.\n"), what);
+      PossibleIncompleteJob(jcr, last_file_index);
+      ok = false;
+    }
+  }
+
   /*
    * Create Job status for end of session label
    */
@@ -281,6 +304,19 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
    * if we are at the end of the tape or we got a fatal I/O error.
    */
   if (ok || dev->CanWrite()) {
+    /*
+     * Write out any blocks still queued before the end of session label
+     */
+    if (!dcr->WriteQueuedBlocks()) {
+      if (ok && !jcr->IsJobCanceled()) {
+        Jmsg2(jcr, M_FATAL, 0, _("Fatal append error on device %s: ERR=%s\n"),
+              dev->print_name(), dev->bstrerror());
+        PossibleIncompleteJob(jcr, last_file_index);
+      }
+      jcr->setJobStatus(JS_ErrorTerminated);
+      ok = false;
+    }
+
     if (!WriteSessionLabel(dcr, EOS_LABEL)) {
       /*
        * Print only if ok and not cancelled to avoid spurious messages
@@ -322,6 +358,9 @@ bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what)
     CommitDataSpool(dcr);
   }
 
+  dcr->max_queued_blocks = 0;
+  dcr->FreeQueuedBlocks();
+
   /*
    * Release the device -- and send final Vol info to DIR and unlock it.
    */
@@ -362,6 +401,7 @@ bool SendAttrsToDir(JobControlRecord* jcr, DeviceRecord* rec)
 {
   if (rec->maskedStream == STREAM_UNIX_ATTRIBUTES ||
       rec->maskedStream == STREAM_UNIX_ATTRIBUTES_EX ||
+      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_COMPACT ||
       rec->maskedStream == STREAM_RESTORE_OBJECT ||
       CryptoDigestStreamType(rec->maskedStream) != CRYPTO_DIGEST_NONE) {
     if (!jcr->impl->no_attributes) {
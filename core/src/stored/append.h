@@ -21,9 +21,14 @@
 #ifndef BAREOS_STORED_APPEND_H_
 #define BAREOS_STORED_APPEND_H_
 
+class BareosSocketStriped;
+
 namespace storagedaemon {
 
-bool DoAppendData(JobControlRecord* jcr, BareosSocket* bs, const char* what);
+bool DoAppendData(JobControlRecord* jcr,
+                  BareosSocket* bs,
+                  const char* what,
+                  BareosSocketStriped* striped = nullptr);
 bool SendAttrsToDir(JobControlRecord* jcr, DeviceRecord* rec);
 
 }  // namespace storagedaemon
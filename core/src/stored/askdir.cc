@@ -39,6 +39,9 @@
 #include "stored/sd_device_control_record.h"
 #include "stored/wait.h"
 #include "stored/dev.h"
+#include "stored/jcr_private.h"
+#include "stored/spool.h"
+#include "stored/volume_index.h"
 #include "lib/edit.h"
 #include "lib/util.h"
 #include "lib/berrno.h"
@@ -401,9 +404,32 @@ bool StorageDaemonDeviceControlRecord::DirCreateJobmediaRecord(bool zero)
     return false;
   }
 
+  if (!zero) { VolumeIndexAddJobMedia(this); }
+
   return true;
 }
 
+/**
+ * Offset of the filename in an attributes message, where the front
+ * coding of a compressed attribute spool file starts.
+ */
+static int32_t AttributesAnchor(DeviceRecord* record, int32_t data_offset)
+{
+  int spaces = 0;
+
+  if (record->maskedStream != STREAM_UNIX_ATTRIBUTES &&
+      record->maskedStream != STREAM_UNIX_ATTRIBUTES_EX &&
+      record->maskedStream != STREAM_UNIX_ATTRIBUTES_COMPACT) {
+    return 0;
+  }
+
+  /* FileIndex Type Filename ... */
+  for (uint32_t i = 0; i < record->data_len; i++) {
+    if (record->data[i] == ' ' && ++spaces == 2) { return data_offset + i + 1; }
+  }
+  return 0;
+}
+
 /**
  * Update File Attribute data
  * We do the following:
@@ -448,6 +474,13 @@ bool StorageDaemonDeviceControlRecord::DirUpdateFileAttributes(
   dir->message_length = SerLength(dir->msg);
   Dmsg1(1800, ">dird %s", dir->msg); /* Attributes */
 
+  if (jcr->impl->attr_spool && dir->IsSpooling()) {
+    return WriteCompressedAttributes(
+        jcr, dir, record->FileIndex,
+        AttributesAnchor(record, dir->message_length - record->data_len));
+  }
+
+  dir->SetDataEnd(record->FileIndex);
   return dir->send();
 }
 
@@ -198,6 +198,31 @@ bool AuthenticateFiledaemon(JobControlRecord* jcr)
   return true;
 }
 
+/**
+ * Authenticate an additional data connection of a remote File daemon.
+ *
+ * The connection belongs to an already authenticated job, so its state is
+ * not touched and failures are only reported to the daemon.
+ */
+bool AuthenticateFiledaemonStripe(JobControlRecord* jcr, BareosSocket* fd)
+{
+  s_password password;
+
+  password.encoding = p_encoding_md5;
+  password.value = jcr->sd_auth_key;
+
+  if (!fd->AuthenticateInboundConnection(nullptr, my_config, jcr->client_name,
+                                         password, me)) {
+    Jmsg2(nullptr, M_ERROR, 0,
+          _("Authorization problem: Two way security handshake failed for "
+            "data connection of Job %s from File daemon at %s\n"),
+          jcr->Job, fd->who());
+    return false;
+  }
+
+  return true;
+}
+
 /**
  * Authenticate with a remote file daemon.
  *
@@ -28,6 +28,7 @@ bool AuthenticateDirector(JobControlRecord* jcr);
 bool AuthenticateStoragedaemon(JobControlRecord* jcr);
 bool AuthenticateWithStoragedaemon(JobControlRecord* jcr);
 bool AuthenticateFiledaemon(JobControlRecord* jcr);
+bool AuthenticateFiledaemonStripe(JobControlRecord* jcr, BareosSocket* fd);
 bool AuthenticateWithFiledaemon(JobControlRecord* jcr);
 
 } /* namespace storagedaemon */
@@ -26,6 +26,7 @@
  */
 
 #include "include/bareos.h"
+#include "include/make_unique.h"
 #include "lib/edit.h"
 #include "stored/device_status_information.h"
 
@@ -34,6 +35,9 @@
 
 #include "stored/stored_globals.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace storagedaemon {
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -66,6 +70,13 @@ static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
  * ChunkedVolumeSize() - Get the current size of a volume.
  * LoadChunk() - Make sure we have the right chunk in memory.
  *
+ * When io-threads are used and adaptive_uploads_ is set the number of
+ * io-threads uploading at the same time is adapted to the throughput and
+ * latency observed for the uploads. When reading sequentially the io-threads
+ * fetch the next readahead_chunks_ chunks from the backing store in the
+ * background. These reads are put on the ordered circular buffer in front
+ * of the uploads, so they are picked up in chunk order.
+ *
  * It also demands that the inheriting class implements the
  * following methods:
  *
@@ -159,6 +170,19 @@ bool chunked_device::StartIoThreads()
     cb_ = new storagedaemon::ordered_circbuf(io_threads_ * OQSIZE);
   }
 
+  /*
+   * All io-threads upload at the same time, unless the upload concurrency
+   * is adapted. That starts with half of them and lets the tuner find the
+   * best value.
+   */
+  if (adaptive_uploads_) {
+    upload_tuner_ = std::make_unique<UploadConcurrencyTuner>(
+        (io_threads_ + 1) / 2, io_threads_);
+    io_concurrency_ = upload_tuner_->Concurrency();
+  } else {
+    io_concurrency_ = io_threads_;
+  }
+
   /*
    * Start all IO threads and keep track of their thread ids in thread_ids_.
    */
@@ -197,6 +221,7 @@ void chunked_device::StopThreads()
    * As such they will get a NULL chunk_io_request back and exit.
    */
   cb_->flush();
+  io_cv_.notify_all();
 
   /*
    * Wait for all threads to exit.
@@ -320,6 +345,14 @@ static int CompareChunkIoRequest(void* item1, void* item2)
   chunk_io_request* chunk1 = (chunk_io_request*)ocbuf1->data;
   chunk_io_request* chunk2 = (chunk_io_request*)ocbuf2->data;
 
+  /*
+   * Reads ahead go first, the reading thread is waiting for them.
+   * The same chunk is never read ahead twice at the same time.
+   */
+  if (!chunk1->readahead != !chunk2->readahead) {
+    return (chunk1->readahead) ? -1 : 1;
+  }
+
   /*
    * Same volume name ?
    */
@@ -454,11 +487,29 @@ bool chunked_device::DequeueChunk()
         &ts, DEFAULT_RECHECK_INTERVAL);
     if (!new_request) { return false; }
 
+    if (new_request->readahead) {
+      ReadAheadChunk(new_request);
+      cb_->unreserve_slot();
+      FreeChunkIoRequest(new_request);
+      return true;
+    }
+
+    /*
+     * Wait until we are allowed to upload. The slot is only taken once there
+     * is a chunk, an io-thread waiting for work or for the retry of a requeued
+     * chunk must not keep other io-threads from uploading.
+     */
+    AcquireUploadSlot();
+
     Dmsg3(100, "Flushing chunk %d of volume %s by thread %s\n",
           new_request->chunk, new_request->volname,
           edit_pthread(pthread_self(), ed1, sizeof(ed1)));
 
-    if (!FlushRemoteChunk(new_request)) {
+    btime_t start = GetCurrentBtime();
+    bool flushed = FlushRemoteChunk(new_request);
+    ReleaseUploadSlot(new_request->wbuflen, GetCurrentBtime() - start, flushed);
+
+    if (!flushed) {
       chunk_io_request* enqueued_request;
 
       /*
@@ -533,6 +584,117 @@ bool chunked_device::DequeueChunk()
   }
 }
 
+/*
+ * Wait until the io-thread is allowed to upload a chunk.
+ * When the ordered circular buffer is being flushed don't wait any longer.
+ */
+void chunked_device::AcquireUploadSlot()
+{
+  std::unique_lock<std::mutex> lock(io_mutex_);
+
+  while (active_uploads_ >= io_concurrency_ && !cb_->IsFlushing()) {
+    io_cv_.wait_for(lock, std::chrono::seconds(1));
+  }
+  active_uploads_++;
+}
+
+/*
+ * Account an upload and give the upload slot back.
+ * A bytes value of 0 means nothing was uploaded.
+ */
+void chunked_device::ReleaseUploadSlot(uint32_t bytes, btime_t elapsed, bool ok)
+{
+  std::lock_guard<std::mutex> lock(io_mutex_);
+
+  active_uploads_--;
+  if (bytes) {
+    if (ok) {
+      if (!upload_stats_.transfers || elapsed < upload_stats_.min_time) {
+        upload_stats_.min_time = elapsed;
+      }
+      upload_stats_.max_time = std::max(upload_stats_.max_time, elapsed);
+      upload_stats_.transfers++;
+      upload_stats_.bytes += bytes;
+      upload_stats_.total_time += elapsed;
+
+      if (upload_tuner_ && upload_tuner_->Sample(bytes, elapsed,
+                                                 GetCurrentBtime(),
+                                                 !cb_->empty())) {
+        /*
+         * More than one io-thread may now get an upload slot.
+         */
+        io_concurrency_ = upload_tuner_->Concurrency();
+        io_cv_.notify_all();
+      }
+    } else {
+      upload_stats_.failures++;
+    }
+  }
+  io_cv_.notify_one();
+}
+
+UploadConcurrencyTuner::UploadConcurrencyTuner(uint8_t initial,
+                                               uint8_t maximum)
+    : concurrency_(initial), maximum_(maximum)
+{
+}
+
+bool UploadConcurrencyTuner::Sample(uint32_t bytes,
+                                    btime_t elapsed,
+                                    btime_t now,
+                                    bool backlog)
+{
+  if (!window_transfers_) { window_start_ = now - elapsed; }
+  window_transfers_++;
+  window_bytes_ += bytes;
+  window_time_ += elapsed;
+  if (window_transfers_ < IO_CONCURRENCY_SAMPLES * concurrency_) {
+    return false;
+  }
+
+  btime_t duration = std::max<btime_t>(now - window_start_, 1);
+  double rate = (double)window_bytes_ / duration;
+  double latency = (double)window_time_ / window_transfers_;
+  uint8_t previous = concurrency_;
+  int step = 0;
+
+  if (best_latency_ == 0 || latency < best_latency_) {
+    best_latency_ = latency;
+  }
+
+  if (latency > 2 * best_latency_) {
+    step = -1;
+  } else if (rate > last_window_rate_ * 1.05) {
+    step = step_;
+  } else if (rate < last_window_rate_ * 0.95) {
+    step = -step_;
+  }
+
+  /*
+   * Only grow when there is a backlog of chunks to upload.
+   */
+  if (step > 0 && !backlog) { step = 0; }
+
+  if (step) {
+    concurrency_ = std::min(std::max(concurrency_ + step, 1), (int)maximum_);
+    step_ = step;
+  }
+
+  last_window_rate_ = rate;
+  window_transfers_ = 0;
+  window_bytes_ = 0;
+  window_time_ = 0;
+
+  if (concurrency_ == previous) { return false; }
+
+  Dmsg4(100,
+        "Changing upload concurrency from %d to %d (%.0f bytes/s, %.0f "
+        "usec/chunk)\n",
+        previous, concurrency_, rate * 1000000, latency);
+
+  return true;
+}
+
 /*
  * Internal method for flushing a chunk to the backing store.
  * The retry logic is in the io-threads but if those are not
@@ -605,11 +767,22 @@ bool chunked_device::ReadChunk()
   request.wbuflen = current_chunk_->chunk_size;
   request.rbuflen = &current_chunk_->buflen;
   request.release = false;
+  request.readahead = nullptr;
 
   current_chunk_->end_offset =
       current_chunk_->start_offset + (current_chunk_->chunk_size - 1);
 
-  if (!ReadRemoteChunk(&request)) {
+  /*
+   * See if the chunk was already read ahead.
+   */
+  if (readahead_chunks_ > 0 && !current_chunk_->writing) {
+    if (TakeReadaheadChunk(request.chunk)) {
+      StartReadahead(request.chunk + 1);
+      return true;
+    }
+  }
+
+  if (!ReadRemoteChunkTimed(&request)) {
     /*
      * If the chunk doesn't exist on the backing store it has a size of 0 bytes.
      */
@@ -617,9 +790,213 @@ bool chunked_device::ReadChunk()
     return false;
   }
 
+  if (readahead_chunks_ > 0 && !current_chunk_->writing) {
+    StartReadahead(request.chunk + 1);
+  }
+
   return true;
 }
 
+/*
+ * Read a chunk from the backing store and account the transfer.
+ */
+bool chunked_device::ReadRemoteChunkTimed(chunk_io_request* request)
+{
+  btime_t start, elapsed;
+  bool ok;
+
+  start = GetCurrentBtime();
+  ok = ReadRemoteChunk(request);
+  elapsed = GetCurrentBtime() - start;
+
+  std::lock_guard<std::mutex> lock(io_mutex_);
+
+  if (ok) {
+    if (!download_stats_.transfers || elapsed < download_stats_.min_time) {
+      download_stats_.min_time = elapsed;
+    }
+    download_stats_.max_time = std::max(download_stats_.max_time, elapsed);
+    download_stats_.transfers++;
+    download_stats_.bytes += *request->rbuflen;
+    download_stats_.total_time += elapsed;
+  } else {
+    download_stats_.failures++;
+  }
+
+  return ok;
+}
+
+static int CompareVolumeName(void* item1, void* item2)
+{
+  const char* volname = (const char*)item2;
+  chunk_io_request* request = (chunk_io_request*)item1;
+
+  /*
+   * Reads ahead hold no data of the volume.
+   */
+  if (request->readahead) { return -1; }
+
+  return strcmp(request->volname, volname);
+}
+
+/*
+ * Read a chunk ahead for the reading thread, called by the io-threads.
+ */
+void chunked_device::ReadAheadChunk(chunk_io_request* request)
+{
+  chunk_readahead* ra = request->readahead;
+  bool cancelled;
+  bool ok = false;
+
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    cancelled = ra->cancelled;
+  }
+
+  if (!cancelled) { ok = ReadRemoteChunkTimed(request); }
+
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  ra->ok = ok;
+  ra->done = true;
+  readahead_cv_.notify_all();
+}
+
+/*
+ * See if the wanted chunk was read ahead. If so swap its data into the
+ * current chunk buffer. Read ahead chunks before the wanted one are
+ * dropped, after a backward seek all read ahead chunks are dropped.
+ */
+bool chunked_device::TakeReadaheadChunk(uint16_t chunk)
+{
+  while (!readahead_.empty()) {
+    chunk_readahead* ra = readahead_.front();
+    bool ok;
+
+    if (ra->chunk > chunk) {
+      CancelReadahead();
+      return false;
+    }
+
+    readahead_.pop_front();
+    {
+      std::unique_lock<std::mutex> lock(io_mutex_);
+
+      if (ra->chunk != chunk) { ra->cancelled = true; }
+      readahead_cv_.wait(lock, [ra] { return ra->done; });
+      ok = ra->ok;
+      if (ra->chunk == chunk && ok) { readahead_hits_++; }
+    }
+
+    if (ra->chunk == chunk && ok) {
+      std::swap(current_chunk_->buffer, ra->buffer);
+      current_chunk_->buflen = ra->buflen;
+      FreeChunkbuffer(ra->buffer);
+      delete ra;
+      return true;
+    }
+
+    bool wanted = (ra->chunk == chunk);
+    FreeChunkbuffer(ra->buffer);
+    delete ra;
+
+    /*
+     * After a failed read ahead (e.g. past the end of the volume) the
+     * remaining ones are of no use either. The wanted chunk is then read
+     * synchronously so the caller sees the proper error.
+     */
+    if (wanted) {
+      CancelReadahead();
+      return false;
+    }
+  }
+
+  return false;
+}
+
+/*
+ * Let the io-threads read ahead the chunks following the one just read.
+ * At most readahead_chunks_ chunks are read ahead at any time.
+ */
+void chunked_device::StartReadahead(uint16_t chunk)
+{
+  uint16_t last = std::min<int>(chunk + readahead_chunks_, MAX_CHUNKS);
+
+  if (!io_threads_) { return; }
+  if (!io_threads_started_ && !StartIoThreads()) { return; }
+
+  /*
+   * Chunks of the volume still being uploaded are not on the backing store
+   * yet, LoadChunk() picks those up.
+   */
+  if (NrInflightChunks() > 0) { return; }
+  if (!cb_->empty()) {
+    chunk_io_request* request = (chunk_io_request*)cb_->peek(
+        storagedaemon::PEEK_FIRST, current_volname_, CompareVolumeName);
+
+    if (request) {
+      free(request);
+      return;
+    }
+  }
+
+  if (!readahead_.empty()) {
+    chunk = std::max<uint16_t>(chunk, readahead_.back()->chunk + 1);
+  }
+
+  for (; chunk < last; chunk++) {
+    chunk_readahead* ra = new chunk_readahead;
+    chunk_io_request* request;
+
+    ra->chunk = chunk;
+    ra->buffer = allocate_chunkbuffer();
+
+    request = (chunk_io_request*)malloc(sizeof(chunk_io_request));
+    memset(request, 0, sizeof(chunk_io_request));
+    request->volname = strdup(current_volname_);
+    request->chunk = chunk;
+    request->buffer = ra->buffer;
+    request->wbuflen = current_chunk_->chunk_size;
+    request->rbuflen = &ra->buflen;
+    request->readahead = ra;
+
+    Dmsg2(200, "Reading ahead chunk %d of volume %s\n", chunk,
+          current_volname_);
+    readahead_.push_back(ra);
+
+    if (!cb_->enqueue(request, sizeof(chunk_io_request), CompareChunkIoRequest,
+                      UpdateChunkIoRequest, false, /* use_reserved_slot */
+                      false /* no_signal */)) {
+      FreeChunkIoRequest(request);
+      ra->done = true;
+      break;
+    }
+  }
+}
+
+/*
+ * Drop all chunks being read ahead. The ones not read yet are skipped by
+ * the io-threads, the ones being read are waited for.
+ */
+void chunked_device::CancelReadahead()
+{
+  if (readahead_.empty()) { return; }
+
+  {
+    std::unique_lock<std::mutex> lock(io_mutex_);
+
+    for (auto ra : readahead_) { ra->cancelled = true; }
+    for (auto ra : readahead_) {
+      readahead_cv_.wait(lock, [ra] { return ra->done; });
+    }
+  }
+
+  for (auto ra : readahead_) {
+    FreeChunkbuffer(ra->buffer);
+    delete ra;
+  }
+  readahead_.clear();
+}
+
 /*
  * Setup a chunked volume for reading or writing.
  * return:
@@ -657,6 +1034,11 @@ int chunked_device::SetupChunk(const char* pathname, int flags, int mode)
     current_chunk_->end_offset = -1;
   }
 
+  /*
+   * Drop anything read ahead for a previous open.
+   */
+  CancelReadahead();
+
   /*
    * Reopen of a device.
    */
@@ -999,6 +1381,8 @@ int chunked_device::CloseChunk()
 {
   int retval = -1;
 
+  CancelReadahead();
+
   if (current_chunk_->opened) {
     if (current_chunk_->need_flushing) {
       if (FlushChunk(true /* release */, false /* move_to_next_chunk */)) {
@@ -1053,6 +1437,7 @@ bool chunked_device::TruncateChunkedVolume(DeviceControlRecord* dcr)
     current_chunk_->buflen = 0;
     current_chunk_->chunk_setup = true;
     current_chunk_->need_flushing = false;
+    CancelReadahead();
 
     /*
      * Reinitialize the volume name on a relabel we could get a new name.
@@ -1065,14 +1450,6 @@ bool chunked_device::TruncateChunkedVolume(DeviceControlRecord* dcr)
   return true;
 }
 
-static int CompareVolumeName(void* item1, void* item2)
-{
-  const char* volname = (const char*)item2;
-  chunk_io_request* request = (chunk_io_request*)item1;
-
-  return strcmp(request->volname, volname);
-}
-
 /*
  * Get the current size of a volume.
  */
@@ -1262,7 +1639,8 @@ static int CloneIoRequest(void* item1, void* item2)
   chunk_io_request* src = (chunk_io_request*)item1;
   chunk_io_request* dst = (chunk_io_request*)item2;
 
-  if (bstrcmp(src->volname, dst->volname) && src->chunk == dst->chunk) {
+  if (!src->readahead && bstrcmp(src->volname, dst->volname) &&
+      src->chunk == dst->chunk) {
     memcpy(dst->buffer, src->buffer, src->wbuflen);
     *dst->rbuflen = src->wbuflen;
 
@@ -1405,6 +1783,8 @@ static int ListIoRequest(void* request, void* data)
   DeviceStatusInformation* dst = (DeviceStatusInformation*)data;
   PoolMem status(PM_MESSAGE);
 
+  if (io_request->readahead) { return 0; }
+
   status.bsprintf("   /%s/%04d - %ld (try=%d)\n", io_request->volname,
                   io_request->chunk, io_request->wbuflen, io_request->tries);
   dst->status_length = PmStrcat(dst->status, status.c_str());
@@ -1412,11 +1792,41 @@ static int ListIoRequest(void* request, void* data)
   return 0;
 }
 
+/*
+ * Add a line with the transfer statistics to the device status.
+ */
+static void ListChunkIoStats(DeviceStatusInformation* dst,
+                             const char* what,
+                             const chunk_io_stats& stats)
+{
+  char ed1[50], ed2[50], ed3[50], ed4[50];
+  uint64_t rate;
+  PoolMem status(PM_MESSAGE);
+
+  if (!stats.transfers && !stats.failures) { return; }
+
+  rate = stats.total_time
+             ? (uint64_t)((double)stats.bytes * 1000000 / stats.total_time)
+             : 0;
+  status.bsprintf(
+      _("%s chunks: %s (%sB), failed: %s, latency avg/min/max: %lld/%lld/%lld "
+        "ms, %sB/s\n"),
+      what, edit_uint64(stats.transfers, ed1),
+      edit_uint64_with_suffix(stats.bytes, ed2),
+      edit_uint64(stats.failures, ed3),
+      (long long)(stats.transfers ? stats.total_time / stats.transfers / 1000
+                                  : 0),
+      (long long)(stats.min_time / 1000), (long long)(stats.max_time / 1000),
+      edit_uint64_with_suffix(rate, ed4));
+  dst->status_length = PmStrcat(dst->status, status.c_str());
+}
+
 /**
  * Return specific device status information.
  */
 bool chunked_device::DeviceStatus(DeviceStatusInformation* dst)
 {
+  char ed1[50];
   bool pending = false;
   int inflight_chunks = 0;
   PoolMem inflights(PM_MESSAGE);
@@ -1455,11 +1865,31 @@ bool chunked_device::DeviceStatus(DeviceStatusInformation* dst)
         PmStrcat(dst->status, _("No pending IO flush requests.\n"));
   }
 
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    PoolMem stats(PM_MESSAGE);
+
+    if (io_threads_ > 0) {
+      stats.bsprintf(_("Upload concurrency: %d of %d IO-threads\n"),
+                     io_concurrency_, io_threads_);
+      dst->status_length = PmStrcat(dst->status, stats.c_str());
+    }
+    ListChunkIoStats(dst, _("Uploaded"), upload_stats_);
+    ListChunkIoStats(dst, _("Downloaded"), download_stats_);
+    if (readahead_chunks_ > 0) {
+      stats.bsprintf(_("Read ahead: %d chunks, %s hits\n"), readahead_chunks_,
+                     edit_uint64(readahead_hits_, ed1));
+      dst->status_length = PmStrcat(dst->status, stats.c_str());
+    }
+  }
+
   return (dst->status_length > 0);
 }
 
 chunked_device::~chunked_device()
 {
+  CancelReadahead();
+
   if (thread_ids_) { StopThreads(); }
 
   if (cb_) {
@@ -1494,9 +1924,11 @@ chunked_device::chunked_device()
 {
   current_volname_ = NULL;
   current_chunk_ = NULL;
+  thread_ids_ = NULL;
   io_threads_ = 0;
   io_slots_ = 0;
   retries_ = 0;
+  readahead_chunks_ = 0;
   chunk_size_ = 0;
   io_threads_started_ = false;
   end_of_media_ = false;
@@ -1506,6 +1938,7 @@ chunked_device::chunked_device()
   chunk_size_ = 0;
   offset_ = 0;
   use_mmap_ = false;
+  adaptive_uploads_ = false;
 }
 
 } /* namespace storagedaemon */
@@ -31,6 +31,12 @@
 class alist;
 
 #include "ordered_cbuf.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
 namespace storagedaemon {
 
 /*
@@ -65,6 +71,17 @@ namespace storagedaemon {
 #define INFLIGHT_RETRIES 120
 #define INFLIGT_RETRY_TIME 5
 
+/*
+ * Number of finished uploads per io-thread allowed to run after which
+ * the upload concurrency is reevaluated.
+ */
+#define IO_CONCURRENCY_SAMPLES 4
+
+/*
+ * Maximum number of chunks read ahead when reading sequentially.
+ */
+#define MAX_READAHEAD_CHUNKS 16
+
 enum thread_wait_type
 {
   WAIT_CANCEL_THREAD, /* Perform a pthread_cancel() on exit. */
@@ -76,6 +93,8 @@ struct thread_handle {
   pthread_t thread_id;   /* Actual threadid */
 };
 
+struct chunk_readahead;
+
 struct chunk_io_request {
   const char* volname; /* VolumeName */
   uint16_t chunk;      /* Chunk number */
@@ -84,6 +103,7 @@ struct chunk_io_request {
   uint32_t* rbuflen;   /* Size of the actual valid data in the chunk (Read) */
   uint8_t tries; /* Number of times the flush was tried to the backing store */
   bool release;  /* Should we release the data to which the buffer points ? */
+  chunk_readahead* readahead; /* Read the chunk ahead into this (io-threads) */
 };
 
 struct chunk_descriptor {
@@ -99,6 +119,65 @@ struct chunk_descriptor {
 };
 
 
+/*
+ * Transfer statistics of chunks to or from the backing store.
+ */
+struct chunk_io_stats {
+  uint64_t transfers = 0; /* Number of successful transfers */
+  uint64_t failures = 0;  /* Number of failed transfers */
+  uint64_t bytes = 0;     /* Number of bytes transferred */
+  btime_t total_time = 0; /* Time spent in transfers (usec) */
+  btime_t min_time = 0;   /* Fastest transfer (usec) */
+  btime_t max_time = 0;   /* Slowest transfer (usec) */
+};
+
+/*
+ * Chunk being read ahead from the backing store by an io-thread.
+ * The done, ok and cancelled flags are protected by io_mutex_.
+ */
+struct chunk_readahead {
+  uint16_t chunk = 0;     /* Chunk number */
+  char* buffer = nullptr; /* Data */
+  uint32_t buflen = 0;    /* Size of the actual valid data in the chunk */
+  bool done = false;      /* The io-thread is finished with it */
+  bool ok = false;        /* Outcome of the read */
+  bool cancelled = false; /* No longer wanted, don't read it */
+};
+
+/*
+ * Hill climbs the number of concurrent uploads on the throughput of each
+ * sample window. It keeps going in the same direction as long as the
+ * throughput improves, turns around when it drops and backs off when the
+ * average latency of an upload more than doubles compared to the best seen,
+ * which indicates the backing store is getting saturated.
+ *
+ * Not thread safe, the chunked_device calls it with its io_mutex_ held.
+ */
+class UploadConcurrencyTuner {
+ public:
+  UploadConcurrencyTuner(uint8_t initial, uint8_t maximum);
+
+  uint8_t Concurrency() const { return concurrency_; }
+
+  /*
+   * Account an upload of bytes that took elapsed usec and ended at now.
+   * Backlog tells if there are more chunks waiting to be uploaded.
+   * Returns true when the concurrency changed.
+   */
+  bool Sample(uint32_t bytes, btime_t elapsed, btime_t now, bool backlog);
+
+ private:
+  uint8_t concurrency_;
+  uint8_t maximum_;
+  int8_t step_{1};               /* last change of concurrency_ */
+  uint32_t window_transfers_{0}; /* uploads in current sample window */
+  uint64_t window_bytes_{0};     /* bytes in current sample window */
+  btime_t window_time_{0};       /* upload time in current sample window */
+  btime_t window_start_{0};      /* start of current sample window */
+  double last_window_rate_{0};   /* throughput of previous window */
+  double best_latency_{0};       /* lowest average upload latency seen */
+};
+
 class chunked_device : public Device {
  private:
   /*
@@ -113,6 +192,25 @@ class chunked_device : public Device {
   alist* thread_ids_;
   chunk_descriptor* current_chunk_;
 
+  /*
+   * Upload concurrency, transfer statistics and the state of the chunks
+   * being read ahead, protected by io_mutex_.
+   */
+  std::mutex io_mutex_;
+  std::condition_variable io_cv_;
+  std::condition_variable readahead_cv_;
+  uint8_t io_concurrency_{0}; /* io-threads allowed to upload */
+  uint8_t active_uploads_{0}; /* io-threads currently uploading */
+  std::unique_ptr<UploadConcurrencyTuner> upload_tuner_;
+  chunk_io_stats upload_stats_;
+  chunk_io_stats download_stats_;
+  uint64_t readahead_hits_{0};
+
+  /*
+   * Chunks being read ahead in chunk order, only used by the reading thread.
+   */
+  std::deque<chunk_readahead*> readahead_;
+
   /*
    * Private Methods
    */
@@ -125,6 +223,13 @@ class chunked_device : public Device {
   bool FlushChunk(bool release_chunk, bool move_to_next_chunk);
   bool ReadChunk();
   bool is_written();
+  void AcquireUploadSlot();
+  void ReleaseUploadSlot(uint32_t bytes, btime_t elapsed, bool ok);
+  bool ReadRemoteChunkTimed(chunk_io_request* request);
+  void ReadAheadChunk(chunk_io_request* request);
+  bool TakeReadaheadChunk(uint16_t chunk);
+  void StartReadahead(uint16_t chunk);
+  void CancelReadahead();
 
  protected:
   /*
@@ -133,9 +238,11 @@ class chunked_device : public Device {
   uint8_t io_threads_;
   uint8_t io_slots_;
   uint8_t retries_;
+  uint8_t readahead_chunks_;
   uint64_t chunk_size_;
   boffset_t offset_;
   bool use_mmap_;
+  bool adaptive_uploads_;
 
   /*
    * Protected Methods
@@ -159,6 +266,11 @@ class chunked_device : public Device {
   virtual bool CheckRemote() = 0;
   virtual bool remote_chunked_volume_exists() = 0;
   virtual bool FlushRemoteChunk(chunk_io_request* request) = 0;
+  /*
+   * Called by the reading thread and, for reading ahead, by the io-threads
+   * at the same time. On failure only the reading thread (request->readahead
+   * not set) may set errmsg and dev_errno.
+   */
   virtual bool ReadRemoteChunk(chunk_io_request* request) = 0;
   virtual ssize_t chunked_remote_volume_size() = 0;
   virtual bool TruncateRemoteChunkedVolume(DeviceControlRecord* dcr) = 0;
@@ -67,7 +67,9 @@ enum device_option_type
   argument_iothreads,
   argument_ioslots,
   argument_retries,
-  argument_mmap
+  argument_mmap,
+  argument_readahead,
+  argument_adaptive_uploads
 };
 
 struct device_option {
@@ -87,6 +89,8 @@ static device_option device_options[] = {
     {"ioslots=", argument_ioslots, 8},
     {"retries=", argument_retries, 8},
     {"mmap", argument_mmap, 4},
+    {"readahead=", argument_readahead, 10},
+    {"adaptiveuploads", argument_adaptive_uploads, 15},
     {NULL, argument_none}};
 
 static int droplet_reference_count = 0;
@@ -557,6 +561,8 @@ bool droplet_device::ReadRemoteChunk(chunk_io_request* request)
   dpl_range_t dpl_range;
   dpl_sysmd_t* sysmd = NULL;
   PoolMem chunk_name(PM_FNAME);
+  PoolMem error(PM_MESSAGE);
+  int error_no = 0;
 
   Mmsg(chunk_name, "/%s/%04d", request->volname, request->chunk);
   Dmsg1(100, "Reading chunk %s\n", chunk_name.c_str());
@@ -574,19 +580,18 @@ bool droplet_device::ReadRemoteChunk(chunk_io_request* request)
     case DPL_SUCCESS:
       break;
     default:
-      Mmsg1(errmsg, _("Failed to open %s doesn't exist\n"), chunk_name.c_str());
-      Dmsg1(100, "%s", errmsg);
-      dev_errno = EIO;
+      Mmsg(error, _("Failed to open %s doesn't exist\n"), chunk_name.c_str());
+      Dmsg1(100, "%s", error.c_str());
+      error_no = EIO;
       goto bail_out;
   }
 
   if (sysmd->size > request->wbuflen) {
-    Mmsg3(
-        errmsg,
-        _("Failed to read %s (%ld) to big to fit in chunksize of %ld bytes\n"),
-        chunk_name.c_str(), sysmd->size, request->wbuflen);
-    Dmsg1(100, "%s", errmsg);
-    dev_errno = EINVAL;
+    Mmsg(error,
+         _("Failed to read %s (%ld) to big to fit in chunksize of %ld bytes\n"),
+         chunk_name.c_str(), sysmd->size, request->wbuflen);
+    Dmsg1(100, "%s", error.c_str());
+    error_no = EINVAL;
     goto bail_out;
   }
 
@@ -619,20 +624,29 @@ bool droplet_device::ReadRemoteChunk(chunk_io_request* request)
     case DPL_SUCCESS:
       break;
     case DPL_ENOENT:
-      Mmsg1(errmsg, _("Failed to open %s doesn't exist\n"), chunk_name.c_str());
-      Dmsg1(100, "%s", errmsg);
-      dev_errno = EIO;
+      Mmsg(error, _("Failed to open %s doesn't exist\n"), chunk_name.c_str());
+      Dmsg1(100, "%s", error.c_str());
+      error_no = EIO;
       goto bail_out;
     default:
-      Mmsg2(errmsg, _("Failed to read %s using dpl_fget(): ERR=%s.\n"),
-            chunk_name.c_str(), dpl_status_str(status));
-      dev_errno = DropletErrnoToSystemErrno(status);
+      Mmsg(error, _("Failed to read %s using dpl_fget(): ERR=%s.\n"),
+           chunk_name.c_str(), dpl_status_str(status));
+      error_no = DropletErrnoToSystemErrno(status);
       goto bail_out;
   }
 
   retval = true;
 
 bail_out:
+  /*
+   * Reads ahead run on the io-threads, the error is reported when the
+   * reading thread reads the chunk itself.
+   */
+  if (!retval && !request->readahead) {
+    PmStrcpy(errmsg, error.c_str());
+    dev_errno = error_no;
+  }
+
   if (sysmd) { dpl_sysmd_free(sysmd); }
 
   return retval;
@@ -772,6 +786,15 @@ bool droplet_device::initialize()
               use_mmap_ = true;
               done = true;
               break;
+            case argument_readahead:
+              size_to_uint64(bp + device_options[i].compare_size, &value);
+              readahead_chunks_ = MIN(value, (uint64_t)MAX_READAHEAD_CHUNKS);
+              done = true;
+              break;
+            case argument_adaptive_uploads:
+              adaptive_uploads_ = true;
+              done = true;
+              break;
             default:
               break;
           }
@@ -82,6 +82,7 @@ static DirectorResource* director = NULL;
 static struct acl_data_t acl_data;
 static struct xattr_data_t xattr_data;
 static alist* delayed_streams = NULL;
+static AclXattrBlobStore acl_xattr_blobs;
 
 static char* wbuf;            /* write buffer address */
 static uint32_t wsize;        /* write size */
@@ -501,6 +502,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
 
       /* If extracting, it was from previous stream, so
        * close the output file.
@@ -654,6 +656,8 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
     case STREAM_SHA1_DIGEST:
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
+    case STREAM_BLAKE3_DIGEST:
+    case STREAM_XXH128_DIGEST:
       break;
 
     case STREAM_SIGNED_DIGEST:
@@ -716,6 +720,32 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
       }
       break;
 
+    case STREAM_ACL_XATTR_BLOB:
+      if (!acl_xattr_blobs.Add(rec->data, rec->data_len)) {
+        Jmsg(jcr, M_WARNING, 0, _("Invalid ACL/XATTR blob record ignored.\n"));
+      }
+      break;
+
+    case STREAM_ACL_XATTR_REFERENCE:
+      if (extract) {
+        const std::string* blob;
+        int stream;
+
+        blob = acl_xattr_blobs.Lookup(rec->data, &stream);
+        if (!blob) {
+          Jmsg(jcr, M_WARNING, 0,
+               _("Missing ACL/XATTR blob for file %s ignored.\n"),
+               attr->fname);
+          break;
+        }
+
+        PmStrcpy(acl_data.last_fname, attr->fname);
+        PmStrcpy(xattr_data.last_fname, attr->fname);
+        PushDelayedDataStream(stream, const_cast<char*>(blob->data()),
+                              blob->size());
+      }
+      break;
+
     case STREAM_NDMP_SEPARATOR:
       break;
 
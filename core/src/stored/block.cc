@@ -38,6 +38,7 @@
 #include "stored/label.h"
 #include "stored/socket_server.h"
 #include "stored/spool.h"
+#include "stored/volume_index.h"
 #include "lib/berrno.h"
 #include "lib/edit.h"
 #include "include/jcr.h"
@@ -195,6 +196,7 @@ void EmptyBlock(DeviceBlock* block)
   block->write_failed = false;
   block->block_read = false;
   block->FirstIndex = block->LastIndex = 0;
+  block->acl_xattr_blob = false;
 }
 
 /**
@@ -493,6 +495,7 @@ static bool TerminateWritingVolume(DeviceControlRecord* dcr)
   }
   Dmsg1(50, "DirUpdateVolumeInfo Terminate writing -- %s\n",
         ok ? "OK" : "ERROR");
+  VolumeIndexEndAppend(dcr);
 
   /*
    * Walk through all attached dcrs setting flag to call
@@ -879,6 +882,7 @@ bool DeviceControlRecord::WriteBlockToDev()
   }
   if (block->LastIndex > 0) { dcr->VolLastIndex = block->LastIndex; }
   dcr->WroteVol = true;
+  VolumeIndexAddBlock(dcr, block, dev->file_addr);
   dev->file_addr += wlen; /* update file address */
   dev->file_size += wlen;
 
@@ -964,6 +968,75 @@ bail_out:
   return status;
 }
 
+/**
+ * Hand a full block over for writing.
+ *
+ * When the job may queue blocks the full block is put on the queue of the
+ * dcr and a fresh block is set up to receive further records. Once the queue
+ * holds max_queued_blocks blocks they are written all at once, so jobs
+ * sharing a device only contend for the device lock once per batch instead
+ * of once per block. Otherwise the block is written right away.
+ */
+bool DeviceControlRecord::QueueBlockForWrite()
+{
+  if (spooling || max_queued_blocks <= 1) { return WriteBlockToDevice(); }
+
+  queued_blocks.push_back(block);
+  if (spare_blocks.empty()) {
+    block = new_block(dev);
+  } else {
+    block = spare_blocks.back();
+    spare_blocks.pop_back();
+  }
+  Dmsg2(850, "Queued block for write, %d of %d queued\n",
+        (int)queued_blocks.size(), max_queued_blocks);
+
+  if (queued_blocks.size() < max_queued_blocks) { return true; }
+
+  return WriteQueuedBlocks();
+}
+
+/**
+ * Write all queued blocks in order while holding the device lock only once.
+ * The block being filled is put back in place when done.
+ */
+bool DeviceControlRecord::WriteQueuedBlocks()
+{
+  bool status = true;
+  DeviceBlock* current_block = block;
+
+  if (queued_blocks.empty()) { return true; }
+
+  dev->rLock();
+  SetDevLocked();
+  for (DeviceBlock* queued_block : queued_blocks) {
+    if (status) {
+      block = queued_block;
+      status = WriteBlockToDevice();
+    }
+    EmptyBlock(queued_block);
+    spare_blocks.push_back(queued_block);
+  }
+  ClearDevLocked();
+  dev->Unlock();
+
+  queued_blocks.clear();
+  block = current_block;
+
+  return status;
+}
+
+/**
+ * Free all blocks used for queuing, any queued data is lost.
+ */
+void DeviceControlRecord::FreeQueuedBlocks()
+{
+  for (DeviceBlock* queued_block : queued_blocks) { FreeBlock(queued_block); }
+  queued_blocks.clear();
+  for (DeviceBlock* spare_block : spare_blocks) { FreeBlock(spare_block); }
+  spare_blocks.clear();
+}
+
 /**
  * Read block with locking
  */
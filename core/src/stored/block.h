@@ -109,6 +109,7 @@ struct DeviceBlock {
   bool block_read;         /* set when block read */
   int32_t FirstIndex;      /* first index this block */
   int32_t LastIndex;       /* last index this block */
+  bool acl_xattr_blob;     /* set if block holds an ACL/xattr blob record */
   char* bufp;              /* pointer into buffer */
   POOLMEM* buf;            /* actual data buffer */
 };
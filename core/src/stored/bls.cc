@@ -411,6 +411,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
       if (!UnpackAttributesRecord(jcr, rec->Stream, rec->data, rec->data_len,
                                   attr)) {
         if (!forge_on) {
@@ -48,12 +48,20 @@
 #include "lib/attribs.h"
 #include "lib/edit.h"
 #include "lib/parse_bsr.h"
+#include "lib/berrno.h"
 #include "lib/bsignal.h"
 #include "include/jcr.h"
 #include "lib/bsock.h"
 #include "lib/parse_conf.h"
 #include "lib/util.h"
 
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
 /* Dummy functions */
 namespace storagedaemon {
 extern bool ParseSdConfig(const char* configfile, int exit_code);
@@ -94,6 +102,9 @@ static bool UpdateDigestRecord(BareosDb* db,
                                char* digest,
                                DeviceRecord* rec,
                                int type);
+static bool FlushCachedAttributes(JobId_t JobId);
+static bool FlushCachedAttributes();
+static bool WriteBatchFileRecords();
 
 /* Local variables */
 static Device* dev = NULL;
@@ -135,13 +146,72 @@ static int num_pools = 0;
 static int num_media = 0;
 static int num_files = 0;
 static int num_restoreobjects = 0;
+static uint64_t scanned_bytes = 0;
+static time_t volume_start_time = 0;
+
+/*
+ * With -j the Volumes are scanned by several worker processes, see
+ * StartWorkers().
+ */
+static int num_workers = 1;
+static int worker_volumes = 0; /* Volumes of this worker, 0 if no worker */
+static int worker_fd = -1;     /* pipe to pass the counters to the parent */
+static int catalog_lock_fd = -1;
+static int skipped_records = 0;
+
+/* Counters a worker passes to the parent at its end */
+struct ScanCounters {
+  int num_media;
+  int num_pools;
+  int num_jobs;
+  int num_files;
+  int num_restoreobjects;
+  uint64_t scanned_bytes;
+};
+
+/*
+ * The attributes of the last file of a Job are held back until the next
+ * file of the Job starts, so the digest following the file data can be
+ * inserted together with them. This allows to use the batch insert of the
+ * catalog, which does not return the FileId to add the digest later.
+ */
+struct CachedAttributes {
+  AttributesDbRecord ar;
+  std::string fname;
+  std::string link;
+  std::string attr;
+  std::string digest;
+};
+
+static std::map<JobId_t, CachedAttributes> cached_attributes;
+
+/*
+ * Serializes the lookup and creation of Pool, Media, Client, FileSet and
+ * Job records between the workers, which may see the same Pool or Volume.
+ */
+class CatalogLock {
+ public:
+  CatalogLock() { SetLock(F_WRLCK); }
+  ~CatalogLock() { SetLock(F_UNLCK); }
+
+ private:
+  void SetLock(short type)
+  {
+    struct flock fl {};
+
+    if (catalog_lock_fd < 0) { return; }
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(catalog_lock_fd, F_SETLKW, &fl) < 0 && errno == EINTR) {}
+  }
+};
 
 static void usage()
 {
   kBareosVersionStrings.PrintCopyrightWithFsfAndPlanets(stderr, 2001);
   fprintf(
       stderr,
-      _("Usage: bscan [ options ] <device-name>\n"
+      _("Usage: bscan [ options ] <device-name> [<device-name> ...]\n"
         "       -B <drivername>   specify the database driver name (default "
         "NULL) <postgresql|mysql|sqlite3>\n"
         "       -b <bootstrap>    specify a bootstrap file\n"
@@ -149,6 +219,8 @@ static void usage()
         "directory\n"
         "       -d <nnn>          set debug level to <nnn>\n"
         "       -dt               print timestamp in debug output\n"
+        "       -j <n>            scan the Volumes with <n> parallel workers,\n"
+        "                         using the given devices in turn\n"
         "       -m                update media info in database\n"
         "       -D <director>     specify a director name specified in the "
         "storage daemon\n"
@@ -176,12 +248,186 @@ static void usage()
   exit(1);
 }
 
+/**
+ * Print the amount of data scanned since start and the throughput.
+ */
+static void PrintScanRate(const char* what, uint64_t bytes, time_t start)
+{
+  char ed1[50], ed2[50];
+  time_t elapsed = time(NULL) - start;
+
+  if (elapsed <= 0) { elapsed = 1; }
+  Pmsg4(000, _("%s: %sB scanned in %d secs, %sB/s\n"), what,
+        edit_uint64_with_suffix(bytes, ed1), (int)elapsed,
+        edit_uint64_with_suffix(bytes / elapsed, ed2));
+}
+
+static void PrintSummary(time_t start)
+{
+  char ed1[50], ed2[50];
+  time_t elapsed = time(NULL) - start;
+
+  if (elapsed <= 0) { elapsed = 1; }
+  if (update_db) {
+    printf(
+        "Records added or updated in the catalog:\n%7d Media\n"
+        "%7d Pool\n%7d Job\n%7d File\n%7d RestoreObject\n",
+        num_media, num_pools, num_jobs, num_files, num_restoreobjects);
+  } else {
+    printf(
+        "Records would have been added or updated in the catalog:\n"
+        "%7d Media\n%7d Pool\n%7d Job\n%7d File\n%7d RestoreObject\n",
+        num_media, num_pools, num_jobs, num_files, num_restoreobjects);
+  }
+  printf(_("Scanned %sB in %d secs: %sB/s, %d files/s\n"),
+         edit_uint64_with_suffix(scanned_bytes, ed1), (int)elapsed,
+         edit_uint64_with_suffix(scanned_bytes / elapsed, ed2),
+         (int)(num_files / elapsed));
+}
+
+/**
+ * Split the Volumes into consecutive groups and fork a worker for every
+ * group, which scans it with its own device and catalog connection.
+ *
+ * A Job written to the last Volume of a group may continue on the Volumes
+ * of the next group, so every worker gets all Volumes following its own
+ * ones as well. It only reads on there until the Jobs it has seen the
+ * start of are complete, the Jobs starting on those Volumes are left to
+ * the next worker, which in turn skips the records of the Jobs it has not
+ * seen the start of.
+ *
+ * Returns in the workers with VolumeName and DeviceName set for them, the
+ * parent waits for the workers, prints the totals and exits.
+ */
+static void StartWorkers(char** VolumeName,
+                         char** DeviceName,
+                         int num_devices,
+                         char* devices[])
+{
+  std::vector<std::string> volumes;
+  std::vector<pid_t> pids;
+  std::vector<int> fds;
+  ScanCounters total{};
+  time_t start_time = time(NULL);
+  bool ok = true;
+
+  if (bsr) {
+    Emsg0(M_ERROR_TERM, 0, _("A bootstrap file cannot be used with -j.\n"));
+  }
+  if (!*VolumeName) {
+    Emsg0(M_ERROR_TERM, 0, _("The Volumes to scan must be given with -V.\n"));
+  }
+
+  for (char *p = *VolumeName, *n; p; p = n) {
+    if ((n = strchr(p, '|'))) { *n++ = 0; }
+    volumes.emplace_back(p);
+  }
+  if (num_workers > (int)volumes.size()) { num_workers = volumes.size(); }
+
+  fflush(stdout);
+  fflush(stderr);
+  for (int i = 0; i < num_workers; i++) {
+    size_t first = volumes.size() * i / num_workers;
+    size_t next = volumes.size() * (i + 1) / num_workers;
+    int pfd[2];
+    pid_t pid;
+
+    if (pipe(pfd) < 0 || (pid = fork()) < 0) {
+      BErrNo be;
+      Emsg1(M_ERROR_TERM, 0, _("Cannot start worker. ERR=%s\n"),
+            be.bstrerror());
+    }
+
+    if (pid == 0) {
+      PoolMem lock_file(PM_FNAME);
+      std::string list;
+
+      for (int fd : fds) { close(fd); }
+      close(pfd[0]);
+      worker_fd = pfd[1];
+      worker_volumes = next - first;
+
+      for (size_t v = first; v < volumes.size(); v++) {
+        if (!list.empty()) { list += '|'; }
+        list += volumes[v];
+      }
+      *VolumeName = strdup(list.c_str());
+      *DeviceName = devices[i % num_devices];
+
+      Mmsg(lock_file, "%s/bscan.lock", working_directory);
+      catalog_lock_fd = open(lock_file.c_str(), O_RDWR | O_CREAT, 0640);
+      if (catalog_lock_fd < 0) {
+        BErrNo be;
+        Emsg2(M_ERROR_TERM, 0, _("Cannot open %s. ERR=%s\n"),
+              lock_file.c_str(), be.bstrerror());
+      }
+      return;
+    }
+
+    close(pfd[1]);
+    pids.push_back(pid);
+    fds.push_back(pfd[0]);
+  }
+
+  for (int i = 0; i < num_workers; i++) {
+    ScanCounters counters;
+    int status;
+
+    if (read(fds[i], &counters, sizeof(counters)) == sizeof(counters)) {
+      total.num_media += counters.num_media;
+      total.num_pools += counters.num_pools;
+      total.num_jobs += counters.num_jobs;
+      total.num_files += counters.num_files;
+      total.num_restoreobjects += counters.num_restoreobjects;
+      total.scanned_bytes += counters.scanned_bytes;
+    }
+    close(fds[i]);
+
+    waitpid(pids[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      Pmsg1(000, _("Worker %d failed.\n"), i + 1);
+      ok = false;
+    }
+  }
+
+  num_media = total.num_media;
+  num_pools = total.num_pools;
+  num_jobs = total.num_jobs;
+  num_files = total.num_files;
+  num_restoreobjects = total.num_restoreobjects;
+  scanned_bytes = total.scanned_bytes;
+  PrintSummary(start_time);
+
+  exit(ok ? 0 : 1);
+}
+
+/**
+ * Is the Volume being read one of the Volumes of the next worker?
+ */
+static bool IsForeignVolume()
+{
+  return worker_volumes > 0 && bjcr->impl->CurReadVolume > worker_volumes;
+}
+
+/**
+ * Are there Jobs of which the start but not the end has been seen?
+ */
+static bool HaveOpenJobs(Device* dev)
+{
+  for (auto mdcr : dev->attached_dcrs) {
+    if (mdcr->jcr && mdcr->jcr->JobId != 0) { return true; }
+  }
+  return false;
+}
+
 int main(int argc, char* argv[])
 {
   int ch;
   struct stat stat_buf;
   char* VolumeName = NULL;
   char* DirectorName = NULL;
+  char* DeviceName;
+  time_t start_time;
   DirectorResource* director = NULL;
   DeviceControlRecord* dcr;
 #if defined(HAVE_DYNAMIC_CATS_BACKENDS)
@@ -199,7 +445,7 @@ int main(int argc, char* argv[])
 
   OSDependentInit();
 
-  while ((ch = getopt(argc, argv, "a:B:b:c:d:D:h:p:mn:pP:q:rsSt:u:vV:w:?")) !=
+  while ((ch = getopt(argc, argv, "a:B:b:c:d:D:h:j:p:mn:pP:q:rsSt:u:vV:w:?")) !=
          -1) {
     switch (ch) {
       case 'a':
@@ -241,6 +487,11 @@ int main(int argc, char* argv[])
         db_port = atoi(optarg);
         break;
 
+      case 'j':
+        num_workers = atoi(optarg);
+        if (num_workers <= 0) { num_workers = 1; }
+        break;
+
       case 'm':
         update_vol_info = true;
         break;
@@ -293,7 +544,7 @@ int main(int argc, char* argv[])
   argc -= optind;
   argv += optind;
 
-  if (argc != 1) {
+  if (argc < 1 || (argc > 1 && num_workers < 2)) {
     Pmsg0(0, _("Wrong number of arguments: \n"));
     usage();
   }
@@ -341,8 +592,11 @@ int main(int argc, char* argv[])
           working_directory);
   }
 
+  DeviceName = argv[0];
+  if (num_workers > 1) { StartWorkers(&VolumeName, &DeviceName, argc, argv); }
+
   dcr = new DeviceControlRecord;
-  bjcr = SetupJcr("bscan", argv[0], bsr, director, dcr, VolumeName, true);
+  bjcr = SetupJcr("bscan", DeviceName, bsr, director, dcr, VolumeName, true);
   if (!bjcr) { exit(1); }
   dev = bjcr->impl->read_dcr->dev;
 
@@ -371,17 +625,24 @@ int main(int argc, char* argv[])
     Pmsg2(000, _("Using Database: %s, User: %s\n"), db_name, db_user);
   }
 
+  start_time = time(NULL);
   do_scan();
-  if (update_db) {
-    printf(
-        "Records added or updated in the catalog:\n%7d Media\n"
-        "%7d Pool\n%7d Job\n%7d File\n%7d RestoreObject\n",
-        num_media, num_pools, num_jobs, num_files, num_restoreobjects);
+  if (worker_fd >= 0) {
+    ScanCounters counters{num_media, num_pools,          num_jobs,
+                          num_files, num_restoreobjects, scanned_bytes};
+
+    if (skipped_records > 0) {
+      Pmsg1(000, _("%d records of Jobs scanned by another worker skipped.\n"),
+            skipped_records);
+    }
+    if (write(worker_fd, &counters, sizeof(counters)) != sizeof(counters)) {
+      BErrNo be;
+      Pmsg1(000, _("Cannot pass counters to parent. ERR=%s\n"),
+            be.bstrerror());
+    }
+    close(worker_fd);
   } else {
-    printf(
-        "Records would have been added or updated in the catalog:\n"
-        "%7d Media\n%7d Pool\n%7d Job\n%7d File\n%7d RestoreObject\n",
-        num_media, num_pools, num_jobs, num_files, num_restoreobjects);
+    PrintSummary(start_time);
   }
   DbFlushBackends();
 
@@ -423,7 +684,20 @@ static bool BscanMountNextReadVolume(DeviceControlRecord* dcr)
     }
   }
 
-  UpdateMediaRecord(db, &mr);
+  if (!IsForeignVolume()) { UpdateMediaRecord(db, &mr); }
+  if (update_db) { WriteBatchFileRecords(); }
+  if (showProgress || verbose) {
+    PrintScanRate(mr.VolumeName, mr.VolBytes, volume_start_time);
+  }
+
+  /*
+   * A worker only reads on the Volumes of the next worker while there are
+   * Jobs continuing on them.
+   */
+  if (worker_volumes > 0 && dcr->jcr->impl->CurReadVolume >= worker_volumes &&
+      !HaveOpenJobs(dev)) {
+    return false;
+  }
 
   /* Now let common read routine get up next tape. Note,
    * we call mount_next... with bscan's jcr because that is where we
@@ -465,7 +739,13 @@ static void do_scan()
   ReadRecords(bjcr->impl->read_dcr, RecordCb, BscanMountNextReadVolume);
 
   if (update_db) {
-    db->WriteBatchFileRecords(bjcr); /* used by bulk batch file insert */
+    FlushCachedAttributes();
+    if (bjcr->db_batch) {
+      /* used by bulk batch file insert */
+      WriteBatchFileRecords();
+      bjcr->db_batch->CloseDatabase(bjcr);
+      bjcr->db_batch = NULL;
+    }
   }
 
   FreeAttr(attr);
@@ -528,10 +808,15 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   if (rec->data_len > 0) {
     mr.VolBytes +=
         rec->data_len + WRITE_RECHDR_LENGTH; /* Accumulate Volume bytes */
+    scanned_bytes += rec->data_len + WRITE_RECHDR_LENGTH;
     if (showProgress && currentVolumeSize > 0) {
       int pct = (mr.VolBytes * 100) / currentVolumeSize;
       if (pct != last_pct) {
-        fprintf(stdout, _("done: %d%%\n"), pct);
+        if (worker_volumes > 0) {
+          fprintf(stdout, _("%s done: %d%%\n"), mr.VolumeName, pct);
+        } else {
+          fprintf(stdout, _("done: %d%%\n"), pct);
+        }
         fflush(stdout);
         last_pct = pct;
       }
@@ -550,6 +835,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
    */
   if (rec->FileIndex < 0) {
     bool save_update_db = update_db;
+    CatalogLock catalog_lock;
 
     if (verbose > 1) { DumpLabelRecord(dev, rec, true); }
     switch (rec->FileIndex) {
@@ -565,7 +851,8 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
          */
         bstrncpy(pr.Name, dev->VolHdr.PoolName, sizeof(pr.Name));
         bstrncpy(pr.PoolType, dev->VolHdr.PoolType, sizeof(pr.PoolType));
-        num_pools++;
+        volume_start_time = time(NULL);
+        if (!IsForeignVolume()) { num_pools++; }
         if (db->GetPoolRecord(bjcr, &pr)) {
           if (verbose) {
             Pmsg1(000, _("Pool record for %s found in DB.\n"), pr.Name);
@@ -591,7 +878,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
         mr = MediaDbRecord{};
         bstrncpy(mr.VolumeName, dev->VolHdr.VolumeName, sizeof(mr.VolumeName));
         mr.PoolId = pr.PoolId;
-        num_media++;
+        if (!IsForeignVolume()) { num_media++; }
         if (db->GetMediaRecord(bjcr, &mr)) {
           if (verbose) {
             Pmsg1(000, _("Media record for %s found in DB.\n"), mr.VolumeName);
@@ -631,7 +918,12 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
         break;
 
       case SOS_LABEL:
-        if (bsr && rec->match_stat < 1) {
+        if (IsForeignVolume()) {
+          /*
+           * Jobs starting on the Volumes of the next worker are its job
+           */
+          Dmsg0(200, "SOS_LABEL skipped. Volume of the next worker.\n");
+        } else if (bsr && rec->match_stat < 1) {
           /*
            * Skipping record, because does not match BootStrapRecord filter
            */
@@ -742,6 +1034,19 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
         } else {
           UnserSessionLabel(&elabel, rec);
 
+          mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
+          if (!mjcr) {
+            if (worker_volumes > 0) {
+              skipped_records++;
+            } else {
+              Pmsg2(000,
+                    _("Could not find SessId=%d SessTime=%d for EOS "
+                      "record.\n"),
+                    rec->VolSessionId, rec->VolSessionTime);
+            }
+            break;
+          }
+
           /*
            * Create FileSet record
            */
@@ -750,13 +1055,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
           CreateFilesetRecord(db, &fsr);
           jr.FileSetId = fsr.FileSetId;
 
-          mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
-          if (!mjcr) {
-            Pmsg2(000,
-                  _("Could not find SessId=%d SessTime=%d for EOS record.\n"),
-                  rec->VolSessionId, rec->VolSessionTime);
-            break;
-          }
+          if (update_db) { FlushCachedAttributes(mjcr->JobId); }
 
           /*
            * Do the final update to the Job record
@@ -775,6 +1074,18 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
           }
           FreeDeviceControlRecord(mjcr->impl->read_dcr);
           FreeJcr(mjcr);
+
+          /*
+           * A worker is done with the Volumes of the next worker when all
+           * Jobs continued on them are complete.
+           */
+          if (IsForeignVolume() && !HaveOpenJobs(dev)) {
+            if (verbose) {
+              Pmsg1(000, _("All Jobs continued on Volume %s are complete.\n"),
+                    dev->getVolCatName());
+            }
+            return false;
+          }
         }
         break;
 
@@ -786,6 +1097,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
          * Wiffle through all jobs still open and close them.
          */
         if (update_db) {
+          FlushCachedAttributes();
           for (auto mdcr : dev->attached_dcrs) {
             JobControlRecord* mjcr = mdcr->jcr;
             if (!mjcr || mjcr->JobId == 0) { continue; }
@@ -807,7 +1119,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
         mr.VolBlocks = rec->Block;
         mr.VolBytes += mr.VolBlocks * WRITE_BLKHDR_LENGTH; /* approx. */
         mr.VolMounts++;
-        UpdateMediaRecord(db, &mr);
+        if (!IsForeignVolume()) { UpdateMediaRecord(db, &mr); }
         Pmsg3(0,
               _("End of all Volumes. VolFiles=%u VolBlocks=%u VolBytes=%s\n"),
               mr.VolFiles, mr.VolBlocks,
@@ -821,7 +1133,9 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
 
   mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
   if (!mjcr) {
-    if (mr.VolJobs > 0) {
+    if (worker_volumes > 0) {
+      skipped_records++;
+    } else if (mr.VolJobs > 0) {
       Pmsg2(000, _("Could not find Job for SessId=%d SessTime=%d record.\n"),
             rec->VolSessionId, rec->VolSessionTime);
     } else {
@@ -838,6 +1152,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
       if (!UnpackAttributesRecord(bjcr, rec->Stream, rec->data, rec->data_len,
                                   attr)) {
         Emsg0(M_ERROR_TERM, 0, _("Cannot continue.\n"));
@@ -870,7 +1185,7 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
                                &rop)) {
         Emsg0(M_ERROR_TERM, 0, _("Cannot continue.\n"));
       }
-      rop.FileIndex = mjcr->FileId;
+      rop.FileIndex = rec->FileIndex;
       rop.JobId = mjcr->JobId;
       rop.FileType = FT_RESTORE_FIRST;
 
@@ -961,6 +1276,20 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
       UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_SHA512);
       break;
 
+    case STREAM_BLAKE3_DIGEST:
+      BinToBase64(digest, sizeof(digest), (char*)rec->data,
+                  CRYPTO_DIGEST_BLAKE3_SIZE, true);
+      if (verbose > 1) { Pmsg1(000, _("Got BLAKE3 record: %s\n"), digest); }
+      UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_BLAKE3);
+      break;
+
+    case STREAM_XXH128_DIGEST:
+      BinToBase64(digest, sizeof(digest), (char*)rec->data,
+                  CRYPTO_DIGEST_XXH128_SIZE, true);
+      if (verbose > 1) { Pmsg1(000, _("Got XXH128 record: %s\n"), digest); }
+      UpdateDigestRecord(db, digest, rec, CRYPTO_DIGEST_XXH128);
+      break;
+
     case STREAM_ENCRYPTED_SESSION_DATA:
       // TODO landonf: Investigate crypto support in bscan
       if (verbose > 1) { Pmsg0(000, _("Got signed digest record\n")); }
@@ -1016,6 +1345,11 @@ static bool RecordCb(DeviceControlRecord* dcr, DeviceRecord* rec)
       /* Ignore Unix ACL attributes */
       break;
 
+    case STREAM_ACL_XATTR_BLOB:
+    case STREAM_ACL_XATTR_REFERENCE:
+      /* Ignore shared ACL and extended attributes */
+      break;
+
     case STREAM_XATTR_PLUGIN:
     case STREAM_XATTR_HURD:
     case STREAM_XATTR_IRIX:
@@ -1100,6 +1434,8 @@ static bool CreateFileAttributesRecord(BareosDb* db,
                                        DeviceRecord* rec)
 {
   DeviceControlRecord* dcr = mjcr->impl->read_dcr;
+  PoolMem lstat_text(PM_NAME);
+
   ar.fname = fname;
   ar.link = lname;
   ar.ClientId = mjcr->ClientId;
@@ -1111,24 +1447,105 @@ static bool CreateFileAttributesRecord(BareosDb* db,
     ar.FileIndex = rec->FileIndex;
   }
   ar.attr = ap;
+  if (rec->maskedStream == STREAM_UNIX_ATTRIBUTES_COMPACT) {
+    /* The catalog always holds the text form */
+    if (CompactStatToText(ap, lstat_text.addr())) {
+      ar.attr = lstat_text.c_str();
+    }
+    ar.Stream = STREAM_UNIX_ATTRIBUTES;
+  }
   if (dcr->VolFirstIndex == 0) { dcr->VolFirstIndex = rec->FileIndex; }
   dcr->FileIndex = rec->FileIndex;
   mjcr->JobFiles++;
 
   if (!update_db) { return true; }
 
-  if (!db->CreateFileAttributesRecord(bjcr, &ar)) {
+  /*
+   * Insert the previous file of the Job and keep this one until its
+   * digest has been seen.
+   */
+  bool retval = FlushCachedAttributes(mjcr->JobId);
+  CachedAttributes& cached = cached_attributes[mjcr->JobId];
+
+  cached.ar = ar;
+  cached.ar.Digest = NULL;
+  cached.ar.DigestType = CRYPTO_DIGEST_NONE;
+  cached.fname = fname;
+  cached.link = lname ? lname : "";
+  cached.attr = ar.attr;
+  cached.digest.clear();
+
+  return retval;
+}
+
+/**
+ * Insert the held back attributes of a Job into the catalog.
+ */
+static bool InsertCachedAttributes(CachedAttributes& cached)
+{
+  AttributesDbRecord* ar = &cached.ar;
+
+  ar->fname = &cached.fname[0];
+  ar->link = &cached.link[0];
+  ar->attr = &cached.attr[0];
+  if (!cached.digest.empty()) { ar->Digest = &cached.digest[0]; }
+
+  /*
+   * Uses the batch insert when the catalog backend supports it.
+   */
+  if (!db->CreateAttributesRecord(bjcr, ar)) {
     Pmsg1(0, _("Could not create File Attributes record. ERR=%s\n"),
           db->strerror());
     return false;
   }
-  mjcr->FileId = ar.FileId;
 
-  if (verbose > 1) { Pmsg1(000, _("Created File record: %s\n"), fname); }
+  if (verbose > 1) { Pmsg1(000, _("Created File record: %s\n"), ar->fname); }
 
   return true;
 }
 
+static bool FlushCachedAttributes(JobId_t JobId)
+{
+  bool retval;
+  auto it = cached_attributes.find(JobId);
+
+  if (it == cached_attributes.end()) { return true; }
+  retval = InsertCachedAttributes(it->second);
+  cached_attributes.erase(it);
+
+  return retval;
+}
+
+static bool FlushCachedAttributes()
+{
+  bool retval = true;
+
+  for (auto& it : cached_attributes) {
+    if (!InsertCachedAttributes(it.second)) { retval = false; }
+  }
+  cached_attributes.clear();
+
+  return retval;
+}
+
+/**
+ * Move the File records collected in the batch table into the File table.
+ * This is done after every Volume, so the batch table does not grow with
+ * all files of all Volumes and the Volumes already scanned stay in the
+ * catalog when bscan is interrupted.
+ */
+static bool WriteBatchFileRecords()
+{
+  if (!bjcr->db_batch) { return true; }
+
+  /*
+   * The workers would otherwise insert the same new Path records.
+   */
+  CatalogLock catalog_lock;
+
+  return bjcr->db_batch->WriteBatchFileRecords(bjcr);
+}
+
 /**
  * For each Volume we see, we create a Medium record
  */
@@ -1507,7 +1924,9 @@ static bool UpdateDigestRecord(BareosDb* db,
 
   mjcr = get_jcr_by_session(rec->VolSessionId, rec->VolSessionTime);
   if (!mjcr) {
-    if (mr.VolJobs > 0) {
+    if (worker_volumes > 0) {
+      skipped_records++;
+    } else if (mr.VolJobs > 0) {
       Pmsg2(000,
             _("Could not find SessId=%d SessTime=%d for MD5/SHA1 record.\n"),
             rec->VolSessionId, rec->VolSessionTime);
@@ -1517,20 +1936,17 @@ static bool UpdateDigestRecord(BareosDb* db,
     return false;
   }
 
-  if (!update_db || mjcr->FileId == 0) {
-    FreeJcr(mjcr);
-    return true;
-  }
+  /*
+   * The digest belongs to the held back attributes of the Job.
+   */
+  auto it = cached_attributes.find(mjcr->JobId);
+  FreeJcr(mjcr);
+  if (!update_db || it == cached_attributes.end()) { return true; }
 
-  if (!db->AddDigestToFileRecord(bjcr, mjcr->FileId, digest, type)) {
-    Pmsg1(0, _("Could not add MD5/SHA1 to File record. ERR=%s\n"),
-          db->strerror());
-    FreeJcr(mjcr);
-    return false;
-  }
+  it->second.digest = digest;
+  it->second.ar.DigestType = type;
 
   if (verbose > 1) { Pmsg0(000, _("Updated MD5/SHA1 record\n")); }
-  FreeJcr(mjcr);
 
   return true;
 }
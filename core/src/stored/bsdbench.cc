@@ -0,0 +1,618 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Storage benchmark program
+ *
+ * Writes a Volume on a configured device with one or more concurrent
+ * writers, reads it back sequentially and at random block positions and
+ * reports the results as JSON, or as text when built without JANSSON.
+ * Unlike the speed test of btape it works with every device type and uses
+ * the same block write and read path as the Storage daemon, so it measures
+ * the complete device layer.
+ */
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+#include "stored/stored_globals.h"
+#include "lib/berrno.h"
+#include "lib/crypto_cache.h"
+#include "stored/acquire.h"
+#include "stored/butil.h"
+#include "stored/device.h"
+#include "stored/device_control_record.h"
+#include "stored/jcr_private.h"
+#include "stored/label.h"
+#include "lib/address_conf.h"
+#include "lib/bsignal.h"
+#include "lib/edit.h"
+#include "lib/output_formatter.h"
+#include "lib/parse_conf.h"
+#include "include/jcr.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace storagedaemon {
+extern bool ParseSdConfig(const char* configfile, int exit_code);
+}
+
+using namespace storagedaemon;
+
+/* Size of the data records, like the data packets sent by the File daemon */
+static const uint32_t kRecordSize = 64 * 1024;
+
+/* Size of the per writer buffer the record data is taken from */
+static const uint32_t kDataPoolSize = 1024 * 1024;
+
+struct BenchWriter {
+  JobControlRecord* jcr{nullptr};
+  DeviceControlRecord* dcr{nullptr};
+  std::vector<char> pool;
+  uint64_t bytes{0};
+  uint32_t records{0};
+  bool ok{true};
+};
+
+struct BlockPosition {
+  uint32_t file;
+  uint32_t block;
+};
+
+struct PhaseResult {
+  bool done{false};
+  bool ok{true};
+  uint64_t bytes{0};
+  uint64_t blocks{0};
+  btime_t usecs{0};
+  std::vector<btime_t> latencies;
+};
+
+static DirectorResource* director = NULL;
+static uint32_t block_size = 0;
+static uint64_t write_size = 1024 * 1024 * 1024;
+static int num_writers = 1;
+static int compressibility = 0;
+static uint32_t num_random_reads = 1000;
+static bool write_only = false;
+static const char* VolumeName = "bsdbench";
+
+static void usage()
+{
+  kBareosVersionStrings.PrintCopyright(stderr, 2020);
+  fprintf(
+      stderr,
+      _("Usage: bsdbench [options] <device-name>\n"
+        "       -b <size>       block size (default Maximum Block Size of "
+        "the device)\n"
+        "       -c <path>       specify a Storage configuration file or "
+        "directory\n"
+        "       -D <director>   specify a director name specified in the "
+        "Storage\n"
+        "                       configuration file for the Key Encryption Key "
+        "selection\n"
+        "       -d <nn>         set debug level to <nn>\n"
+        "       -dt             print timestamp in debug output\n"
+        "       -j <n>          write with <n> concurrent jobs (default 1)\n"
+        "       -o <file>       write the result to <file>\n"
+        "       -r <n>          number of random block reads (default "
+        "1000)\n"
+        "       -s <size>       amount of data to write (default 1G)\n"
+        "       -V <name>       Volume name (default bsdbench), the Volume "
+        "is overwritten\n"
+        "       -v              be verbose\n"
+        "       -w              write only, do not read the Volume back\n"
+        "       -z <percent>    compressible part of the data (default 0)\n"
+        "       -?              print this message\n\n"));
+  exit(1);
+}
+
+/*
+ * Fill the data pool of a writer. The given percentage of every 1 KiB is
+ * zeroed, the rest is pseudo random data that does not compress.
+ */
+static void FillDataPool(std::vector<char>& pool, uint64_t seed)
+{
+  uint32_t zero_bytes = 1024 * compressibility / 100;
+  uint64_t x = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+  pool.resize(kDataPoolSize);
+  for (uint32_t i = 0; i < kDataPoolSize; i += sizeof(uint64_t)) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    memcpy(pool.data() + i, &x, sizeof(uint64_t));
+  }
+  for (uint32_t i = 0; i < kDataPoolSize; i += 1024) {
+    memset(pool.data() + i, 0, zero_bytes);
+  }
+}
+
+static double Seconds(btime_t usecs) { return (double)usecs / 1000000.0; }
+
+static uint64_t Rate(uint64_t value, btime_t usecs)
+{
+  if (usecs <= 0) { usecs = 1; }
+  return (uint64_t)(value * 1000000.0 / usecs);
+}
+
+/*
+ * Write records to the Volume like a backup job, bracketed by session
+ * labels.
+ */
+static void WriteData(BenchWriter* w, uint64_t size)
+{
+  DeviceControlRecord* dcr = w->dcr;
+  DeviceRecord* rec = new_record();
+  uint32_t offset;
+
+  if (!WriteSessionLabel(dcr, SOS_LABEL)) {
+    Jmsg1(w->jcr, M_FATAL, 0, _("Write session label failed. ERR=%s\n"),
+          dcr->dev->bstrerror());
+    w->ok = false;
+    goto bail_out;
+  }
+
+  rec->data = CheckPoolMemorySize(rec->data, kRecordSize);
+  rec->VolSessionId = w->jcr->VolSessionId;
+  rec->VolSessionTime = w->jcr->VolSessionTime;
+  rec->Stream = STREAM_FILE_DATA;
+  rec->maskedStream = STREAM_FILE_DATA;
+
+  while (w->bytes < size) {
+    rec->FileIndex = ++w->records;
+    rec->data_len = MIN(kRecordSize, size - w->bytes);
+    offset = (w->records * 4099) % (kDataPoolSize - kRecordSize);
+    memcpy(rec->data, w->pool.data() + offset, rec->data_len);
+
+    while (!WriteRecordToBlock(dcr, rec)) {
+      if (!dcr->WriteBlockToDevice()) {
+        Jmsg1(w->jcr, M_FATAL, 0, _("Write of block failed. ERR=%s\n"),
+              dcr->dev->bstrerror());
+        w->ok = false;
+        goto bail_out;
+      }
+    }
+    w->bytes += rec->data_len;
+  }
+
+  w->jcr->JobFiles = w->records;
+  w->jcr->JobBytes = w->bytes;
+  if (!WriteSessionLabel(dcr, EOS_LABEL)) {
+    Jmsg1(w->jcr, M_FATAL, 0, _("Write session label failed. ERR=%s\n"),
+          dcr->dev->bstrerror());
+    w->ok = false;
+  } else if (!dcr->WriteBlockToDevice()) {
+    Jmsg1(w->jcr, M_FATAL, 0, _("Write of last block failed. ERR=%s\n"),
+          dcr->dev->bstrerror());
+    w->ok = false;
+  }
+
+bail_out:
+  FreeRecord(rec);
+}
+
+/*
+ * Label the Volume and write it with the configured number of concurrent
+ * writers, each with its own jcr and dcr on the same device.
+ */
+static bool WritePhase(char* dev_name, PhaseResult& result)
+{
+  std::vector<BenchWriter> writers(num_writers);
+  std::vector<std::thread> threads;
+  DeviceControlRecord* dcr = new DeviceControlRecord;
+  JobControlRecord* jcr;
+  Device* dev;
+  uint64_t start_bytes, start_blocks;
+  btime_t start;
+  bool relabel;
+  char ed1[50];
+
+  jcr = SetupJcr("bsdbench", dev_name, NULL, director, dcr, VolumeName,
+                 false); /* write device */
+  if (!jcr) { return false; }
+  dev = jcr->impl->dcr->dev;
+  if (!dev) { return false; }
+  if (block_size) { dev->device_resource->max_block_size = block_size; }
+
+  /*
+   * Overwrite an existing Volume, the label is written with relabel
+   * when the Volume can be opened. Streaming devices get labeled when
+   * they are acquired for append.
+   */
+  dev->setVolCatName(VolumeName);
+  dcr->setVolCatName(VolumeName);
+  if (!dev->HasCap(CAP_STREAM)) {
+    dev->rLock(false);
+    relabel = dev->open(dcr, DeviceMode::OPEN_READ_WRITE);
+    dev->Unlock();
+    if (!WriteNewVolumeLabelToDev(dcr, VolumeName, "Default", relabel)) {
+      Pmsg2(0, _("Labeling Volume \"%s\" failed: %s\n"), VolumeName,
+            dev->print_errmsg());
+      return false;
+    }
+  }
+
+  writers[0].jcr = jcr;
+  writers[0].dcr = dcr;
+  for (int i = 1; i < num_writers; i++) {
+    writers[i].dcr = new DeviceControlRecord;
+    writers[i].jcr = SetupWriteJcr("bsdbench", director, dev, writers[i].dcr);
+    writers[i].jcr->VolSessionId = i + 1;
+    writers[i].jcr->VolSessionTime = jcr->VolSessionTime;
+  }
+  for (int i = 0; i < num_writers; i++) {
+    bstrncpy(writers[i].dcr->VolumeName, VolumeName,
+             sizeof(writers[i].dcr->VolumeName));
+    if (!AcquireDeviceForAppend(writers[i].dcr)) { return false; }
+    FillDataPool(writers[i].pool, i + 1);
+  }
+  block_size = dev->max_block_size ? dev->max_block_size : DEFAULT_BLOCK_SIZE;
+
+  /*
+   * What was written to a fifo cannot be read back.
+   */
+  if (dev->IsFifo()) { write_only = true; }
+
+  start_bytes = dev->VolCatInfo.VolCatBytes;
+  start_blocks = dev->VolCatInfo.VolCatBlocks;
+  Pmsg3(0, _("Writing %s bytes to Volume \"%s\" with %d jobs.\n"),
+        edit_uint64_with_commas(write_size, ed1), VolumeName,
+        num_writers);
+
+  start = GetCurrentBtime();
+  for (int i = 0; i < num_writers; i++) {
+    uint64_t size = write_size / num_writers;
+
+    if (i == 0) { size += write_size % num_writers; }
+    threads.emplace_back(WriteData, &writers[i], size);
+  }
+  for (auto& thread : threads) { thread.join(); }
+  result.usecs = GetCurrentBtime() - start;
+
+  result.bytes = dev->VolCatInfo.VolCatBytes - start_bytes;
+  result.blocks = dev->VolCatInfo.VolCatBlocks - start_blocks;
+  for (auto& w : writers) {
+    if (!w.ok) { result.ok = false; }
+    ReleaseDevice(w.dcr);
+    FreeJcr(w.jcr);
+  }
+  delete dev;
+  result.done = true;
+
+  return result.ok;
+}
+
+/*
+ * Position of the block that is read next, in the form Reposition()
+ * expects it.
+ */
+static BlockPosition CurrentPosition(Device* dev)
+{
+  if (dev->IsTape()) { return BlockPosition{dev->file, dev->block_num}; }
+  return BlockPosition{(uint32_t)(dev->file_addr >> 32),
+                       (uint32_t)dev->file_addr};
+}
+
+/*
+ * Read the Volume back sequentially, remembering the position of every
+ * block, and then read blocks at random positions.
+ */
+static bool ReadPhases(char* dev_name,
+                       PhaseResult& sequential,
+                       PhaseResult& random)
+{
+  DeviceControlRecord* dcr = new DeviceControlRecord;
+  std::vector<BlockPosition> positions;
+  JobControlRecord* jcr;
+  Device* dev;
+  btime_t start, now;
+  uint64_t x = 88172645463325252ULL;
+  bool ok = true;
+
+  jcr = SetupJcr("bsdbench", dev_name, NULL, director, dcr, VolumeName,
+                 true); /* read device */
+  if (!jcr) { return false; }
+  dev = jcr->impl->dcr->dev;
+  if (!dev) { return false; }
+
+  start = GetCurrentBtime();
+  for (bool done = false; !done;) {
+    BlockPosition pos = CurrentPosition(dev);
+
+    switch (dcr->ReadBlockFromDevice(NO_BLOCK_NUMBER_CHECK)) {
+      case DeviceControlRecord::ReadStatus::Ok:
+        positions.push_back(pos);
+        sequential.blocks++;
+        sequential.bytes += dcr->block->block_len;
+        break;
+      case DeviceControlRecord::ReadStatus::EndOfFile:
+        continue;
+      case DeviceControlRecord::ReadStatus::EndOfTape:
+        done = true;
+        break;
+      default:
+        Pmsg2(0, _("Read of block %u failed: %s\n"), sequential.blocks + 1,
+              dev->print_errmsg());
+        sequential.ok = ok = false;
+        done = true;
+        break;
+    }
+  }
+  sequential.usecs = GetCurrentBtime() - start;
+  sequential.done = true;
+
+  if (ok && num_random_reads > 0 && !positions.empty()) {
+    /*
+     * The sequential read left the device at the end of the Volume.
+     */
+    dev->ClearEot();
+    dev->ClearEof();
+    random.latencies.reserve(num_random_reads);
+    start = GetCurrentBtime();
+    for (uint32_t i = 0; i < num_random_reads; i++) {
+      BlockPosition pos;
+
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      pos = positions[x % positions.size()];
+
+      now = GetCurrentBtime();
+      if (!dev->Reposition(dcr, pos.file, pos.block) ||
+          dcr->ReadBlockFromDevice(NO_BLOCK_NUMBER_CHECK) !=
+              DeviceControlRecord::ReadStatus::Ok) {
+        Pmsg3(0, _("Read of block at %u:%u failed: %s\n"), pos.file,
+              pos.block, dev->print_errmsg());
+        random.ok = ok = false;
+        break;
+      }
+      random.latencies.push_back(GetCurrentBtime() - now);
+      random.blocks++;
+      random.bytes += dcr->block->block_len;
+    }
+    random.usecs = GetCurrentBtime() - start;
+    random.done = true;
+  }
+
+  CleanDevice(dcr);
+  delete dev;
+  FreeJcr(jcr);
+
+  return ok;
+}
+
+/*
+ * Send handler of the output formatter.
+ */
+static bool SendToFile(void* ctx, const char* msg)
+{
+  return fputs(msg, (FILE*)ctx) >= 0;
+}
+
+static void PrintPhase(OutputFormatter& out,
+                       const char* name,
+                       PhaseResult& result)
+{
+  if (!result.done) { return; }
+
+  out.Decoration("%s:\n", name);
+  out.ObjectStart(name);
+  out.ObjectKeyValueBool("ok", result.ok, "  ok:                 %s\n");
+  out.ObjectKeyValue("bytes", result.bytes, "  bytes:              %llu\n");
+  out.ObjectKeyValue("blocks", result.blocks,
+                     "  blocks:             %llu\n");
+  out.ObjectKeyValue("usecs", result.usecs, NULL);
+  out.Decoration("  seconds:            %.3f\n", Seconds(result.usecs));
+  out.ObjectKeyValue("bytes_per_second", Rate(result.bytes, result.usecs),
+                     "  bytes per second:   %llu\n");
+  out.ObjectKeyValue("blocks_per_second", Rate(result.blocks, result.usecs),
+                     "  blocks per second:  %llu\n");
+
+  if (!result.latencies.empty()) {
+    std::vector<btime_t>& l = result.latencies;
+
+    std::sort(l.begin(), l.end());
+    out.Decoration("  latency usecs:\n");
+    out.ObjectStart("latency_usecs");
+    out.ObjectKeyValue("min", l.front(), "    min:              %llu\n");
+    out.ObjectKeyValue("median", l[l.size() / 2],
+                       "    median:           %llu\n");
+    out.ObjectKeyValue("p99", l[l.size() * 99 / 100],
+                       "    p99:              %llu\n");
+    out.ObjectKeyValue("max", l.back(), "    max:              %llu\n");
+    out.ObjectEnd("latency_usecs");
+  }
+  out.ObjectEnd(name);
+}
+
+/*
+ * Print the results, as JSON when it is available, else as text.
+ */
+static void PrintResult(FILE* fp,
+                        const char* dev_name,
+                        PhaseResult& write,
+                        PhaseResult& sequential,
+                        PhaseResult& random)
+{
+#if HAVE_JANSSON
+  OutputFormatter out(SendToFile, fp, NULL, NULL, API_MODE_JSON);
+#else
+  OutputFormatter out(SendToFile, fp, NULL, NULL, API_MODE_OFF);
+#endif
+
+  out.ObjectKeyValue("device", dev_name, "device:               %s\n");
+  out.ObjectKeyValue("volume", VolumeName, "volume:               %s\n");
+  out.ObjectKeyValue("block_size", block_size,
+                     "block size:           %llu\n");
+  out.ObjectKeyValue("record_size", kRecordSize,
+                     "record size:          %llu\n");
+  out.ObjectKeyValue("jobs", num_writers, "jobs:                 %llu\n");
+  out.ObjectKeyValue("compressibility", compressibility,
+                     "compressibility:      %llu\n");
+  out.ObjectKeyValue("size", write_size, "size:                 %llu\n");
+  PrintPhase(out, "write", write);
+  PrintPhase(out, "read", sequential);
+  PrintPhase(out, "random_read", random);
+  out.FinalizeResult(true);
+}
+
+int main(int argc, char* argv[])
+{
+  int ch;
+  char* DirectorName = NULL;
+  char* result_file = NULL;
+  PhaseResult write, sequential, random;
+  FILE* fp = stdout;
+  bool ok;
+
+  setlocale(LC_ALL, "");
+  tzset();
+  bindtextdomain("bareos", LOCALEDIR);
+  textdomain("bareos");
+  InitStackDump();
+
+  working_directory = "/tmp";
+  MyNameIs(argc, argv, "bsdbench");
+  InitMsg(NULL, NULL); /* initialize message handler */
+
+  OSDependentInit();
+
+  while ((ch = getopt(argc, argv, "b:c:D:d:j:o:r:s:V:vwz:?")) != -1) {
+    switch (ch) {
+      case 'b': {
+        uint64_t size;
+
+        if (!size_to_uint64(optarg, &size) || size == 0 ||
+            size > MAX_BLOCK_LENGTH || size % TAPE_BSIZE != 0) {
+          Pmsg1(0, _("Invalid block size: %s\n"), optarg);
+          usage();
+        }
+        block_size = (uint32_t)size;
+        break;
+      }
+
+      case 'c': /* specify config file */
+        if (configfile != NULL) { free(configfile); }
+        configfile = strdup(optarg);
+        break;
+
+      case 'D': /* specify director name */
+        if (DirectorName != NULL) { free(DirectorName); }
+        DirectorName = strdup(optarg);
+        break;
+
+      case 'd': /* debug level */
+        if (*optarg == 't') {
+          dbg_timestamp = true;
+        } else {
+          debug_level = atoi(optarg);
+          if (debug_level <= 0) { debug_level = 1; }
+        }
+        break;
+
+      case 'j':
+        num_writers = atoi(optarg);
+        if (num_writers < 1) { usage(); }
+        break;
+
+      case 'o':
+        result_file = optarg;
+        break;
+
+      case 'r':
+        num_random_reads = (uint32_t)str_to_uint64(optarg);
+        break;
+
+      case 's':
+        if (!size_to_uint64(optarg, &write_size) || write_size == 0) {
+          Pmsg1(0, _("Invalid size: %s\n"), optarg);
+          usage();
+        }
+        break;
+
+      case 'V': /* Volume name */
+        VolumeName = optarg;
+        break;
+
+      case 'v':
+        verbose++;
+        break;
+
+      case 'w':
+        write_only = true;
+        break;
+
+      case 'z':
+        compressibility = atoi(optarg);
+        if (compressibility < 0 || compressibility > 100) { usage(); }
+        break;
+
+      case '?':
+      default:
+        usage();
+
+    } /* end switch */
+  }   /* end while */
+  argc -= optind;
+  argv += optind;
+
+  if (argc != 1) {
+    Pmsg0(0, _("No archive name specified\n"));
+    usage();
+  }
+
+  my_config = InitSdConfig(configfile, M_ERROR_TERM);
+  ParseSdConfig(configfile, M_ERROR_TERM);
+
+  if (DirectorName) {
+    foreach_res (director, R_DIRECTOR) {
+      if (bstrcmp(director->resource_name_, DirectorName)) { break; }
+    }
+    if (!director) {
+      Emsg2(
+          M_ERROR_TERM, 0,
+          _("No Director resource named %s defined in %s. Cannot continue.\n"),
+          DirectorName, configfile);
+    }
+  }
+
+  LoadSdPlugins(me->plugin_directory, me->plugin_names);
+
+  ReadCryptoCache(me->working_directory, "bareos-sd",
+                  GetFirstPortHostOrder(me->SDaddrs));
+
+  if (result_file && !(fp = fopen(result_file, "w"))) {
+    BErrNo be;
+    Emsg2(M_ERROR_TERM, 0, _("Could not open %s: ERR=%s\n"), result_file,
+          be.bstrerror());
+  }
+
+  ok = WritePhase(argv[0], write);
+  if (ok && !write_only) { ok = ReadPhases(argv[0], sequential, random); }
+
+  PrintResult(fp, argv[0], write, sequential, random);
+  if (fp != stdout) { fclose(fp); }
+
+  return ok ? 0 : 1;
+}
@@ -45,6 +45,8 @@
 #include "stored/stored.h"
 #include "include/jcr.h"
 
+#include <algorithm>
+
 namespace storagedaemon {
 
 const int dbglevel = 500;
@@ -85,6 +87,9 @@ static int MatchFindex(BootStrapRecord* bsr,
                        BsrFileIndex* findex,
                        DeviceRecord* rec,
                        bool done);
+static int MatchFindexTable(BootStrapRecord* bsr,
+                            BsrFileIndexTable* table,
+                            DeviceRecord* rec);
 static int MatchVolfile(BootStrapRecord* bsr,
                         BsrVolumeFile* volfile,
                         DeviceRecord* rec,
@@ -101,8 +106,13 @@ static int MatchAll(BootStrapRecord* bsr,
                     DeviceRecord* rec,
                     Volume_Label* volrec,
                     Session_Label* sessrec,
-                    bool done,
                     JobControlRecord* jcr);
+static bool MatchOneBsr(BootStrapRecord* bsr,
+                        DeviceRecord* rec,
+                        Volume_Label* volrec,
+                        Session_Label* sessrec,
+                        JobControlRecord* jcr);
+static int MatchBlockSession(BsrSessionIndex* index, DeviceBlock* block);
 static int MatchBlockSesstime(BootStrapRecord* bsr,
                               BsrSessionTime* sesstime,
                               DeviceBlock* block);
@@ -140,6 +150,10 @@ int MatchBsrBlock(BootStrapRecord* bsr, DeviceBlock* block)
     return 1; /* cannot fast reject */
   }
 
+  if (bsr->session_index) {
+    return MatchBlockSession(bsr->session_index, block);
+  }
+
   for (; bsr; bsr = bsr->next) {
     if (!MatchBlockSesstime(bsr, bsr->sesstime, block)) { continue; }
     if (!MatchBlockSessid(bsr, bsr->sessid, block)) { continue; }
@@ -148,6 +162,22 @@ int MatchBsrBlock(BootStrapRecord* bsr, DeviceBlock* block)
   return 0;
 }
 
+/**
+ * Fast block rejection using the session index of the root bsr,
+ *  equivalent to checking sesstime and sessid of every bsr in the chain.
+ */
+static int MatchBlockSession(BsrSessionIndex* index, DeviceBlock* block)
+{
+  auto found = index->sessions.find(block->VolSessionTime);
+  if (found == index->sessions.end()) { return 0; }
+  for (const auto& ids : found->second) {
+    if (ids.first <= block->VolSessionId && ids.second >= block->VolSessionId) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
 static int MatchBlockSesstime(BootStrapRecord* bsr,
                               BsrSessionTime* sesstime,
                               DeviceBlock* block)
@@ -184,7 +214,8 @@ static int MatchFileregex(BootStrapRecord* bsr,
    * not of this type
    */
   if (rec->maskedStream == STREAM_UNIX_ATTRIBUTES ||
-      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_EX) {
+      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_EX ||
+      rec->maskedStream == STREAM_UNIX_ATTRIBUTES_COMPACT) {
     bsr->skip_file = false;
     if (UnpackAttributesRecord(jcr, rec->Stream, rec->data, rec->data_len,
                                bsr->attr)) {
@@ -224,7 +255,7 @@ int MatchBsr(BootStrapRecord* bsr,
    */
   if (bsr) {
     bsr->Reposition = false;
-    status = MatchAll(bsr, rec, volrec, sessrec, true, jcr);
+    status = MatchAll(bsr, rec, volrec, sessrec, jcr);
     /*
      * Note, bsr->Reposition is set by MatchAll when
      *  a bsr is done. We turn it off if a match was
@@ -261,7 +292,8 @@ BootStrapRecord* find_next_bsr(BootStrapRecord* root_bsr, Device* dev)
         root_bsr->Reposition);
   root_bsr->mount_next_volume = false;
   /* Walk through all bsrs to find the next one to use => smallest file,block */
-  for (bsr = root_bsr; bsr; bsr = bsr->next) {
+  bsr = root_bsr->first_active ? root_bsr->first_active : root_bsr;
+  for (; bsr; bsr = bsr->next) {
     if (bsr->done || !MatchVolume(bsr, bsr->volume, &dev->VolHdr, 1)) {
       continue;
     }
@@ -402,7 +434,7 @@ bool IsThisBsrDone(BootStrapRecord* bsr, DeviceRecord* rec)
 }
 
 /**
- * Match all the components of current record
+ * Match the current record against each bsr of the chain
  *   returns  1 on match
  *   returns  0 no match
  *   returns -1 no additional matches possible
@@ -411,10 +443,49 @@ static int MatchAll(BootStrapRecord* bsr,
                     DeviceRecord* rec,
                     Volume_Label* volrec,
                     Session_Label* sessrec,
-                    bool done,
                     JobControlRecord* jcr)
 {
+  bool done = true;
+
   Dmsg0(dbglevel, "Enter MatchAll\n");
+
+  /*
+   * Bsrs that are done never match again, so skip the leading run of
+   *  them instead of walking it for every record.
+   */
+  if (bsr->root == bsr && bsr->first_active) {
+    while (bsr->first_active && bsr->first_active->done) {
+      bsr->first_active = bsr->first_active->next;
+    }
+    if (!bsr->first_active) {
+      Dmsg0(dbglevel, "Leave match all -1\n");
+      return -1;
+    }
+    bsr = bsr->first_active;
+  }
+
+  for (; bsr; bsr = bsr->next) {
+    if (MatchOneBsr(bsr, rec, volrec, sessrec, jcr)) { return 1; }
+    done = done && bsr->done;
+  }
+  if (done) {
+    Dmsg0(dbglevel, "Leave match all -1\n");
+    return -1;
+  }
+  Dmsg0(dbglevel, "Leave match all 0\n");
+  return 0;
+}
+
+/**
+ * Match all the components of current record against a single bsr
+ *   returns true on match
+ */
+static bool MatchOneBsr(BootStrapRecord* bsr,
+                        DeviceRecord* rec,
+                        Volume_Label* volrec,
+                        Session_Label* sessrec,
+                        JobControlRecord* jcr)
+{
   if (bsr->done) {
     //    Dmsg0(dbglevel, "bsr->done set\n");
     goto no_match;
@@ -427,6 +498,22 @@ static int MatchAll(BootStrapRecord* bsr,
   Dmsg2(dbglevel, "OK bsr match bsr_vol=%s read_vol=%s\n",
         bsr->volume->VolumeName, volrec->VolumeName);
 
+  /*
+   * Shared ACL and extended attribute contents are needed by all files of
+   * the session referencing them, selected or not. They may be stored
+   * before the volume addresses of the selected files, the volume index
+   * makes the read start at them, see GetVolumeIndexStartAddr().
+   */
+  if (rec->maskedStream == STREAM_ACL_XATTR_BLOB) {
+    if (!MatchSesstime(bsr, bsr->sesstime, rec, 0) ||
+        !MatchSessid(bsr, bsr->sessid, rec)) {
+      goto no_match;
+    }
+    Dmsg1(dbglevel, "match shared acl/xattr blob of findex=%d\n",
+          rec->FileIndex);
+    return true;
+  }
+
   if (!MatchVolfile(bsr, bsr->volfile, rec, 1)) {
     if (bsr->volfile) {
       Dmsg3(dbglevel, "Fail on file=%u. bsr=%u,%u\n", rec->File,
@@ -457,7 +544,8 @@ static int MatchAll(BootStrapRecord* bsr,
   }
 
   /* NOTE!! This test MUST come after sesstime and sessid tests */
-  if (!MatchFindex(bsr, bsr->FileIndex, rec, 1)) {
+  if (bsr->findex_table ? !MatchFindexTable(bsr, bsr->findex_table, rec)
+                        : !MatchFindex(bsr, bsr->FileIndex, rec, 1)) {
     if (bsr->FileIndex) {
       Dmsg3(dbglevel, "Fail on findex=%d. bsr=%d,%d\n", rec->FileIndex,
             bsr->FileIndex->findex, bsr->FileIndex->findex2);
@@ -491,7 +579,7 @@ static int MatchAll(BootStrapRecord* bsr,
   if (bsr->count && bsr->FileIndex) {
     rec->bsr = bsr;
     Dmsg0(dbglevel, "Leave MatchAll 1\n");
-    return 1; /* this is a complete match */
+    return true; /* this is a complete match */
   }
 
   /*
@@ -523,18 +611,10 @@ static int MatchAll(BootStrapRecord* bsr,
     Dmsg0(dbglevel, "fail on stream\n");
     goto no_match;
   }
-  return 1;
+  return true;
 
 no_match:
-  if (bsr->next) {
-    return MatchAll(bsr->next, rec, volrec, sessrec, bsr->done && done, jcr);
-  }
-  if (bsr->done && done) {
-    Dmsg0(dbglevel, "Leave match all -1\n");
-    return -1;
-  }
-  Dmsg0(dbglevel, "Leave match all 0\n");
-  return 0;
+  return false;
 }
 
 static int MatchVolume(BootStrapRecord* bsr,
@@ -750,6 +830,46 @@ static int MatchFindex(BootStrapRecord* bsr,
   return 0;
 }
 
+/**
+ * Same as MatchFindex() but using the sorted and merged FileIndex
+ *  table built when the bsr was parsed. As FileIndexes are read in
+ *  sequential order, every range ending before the current one is done.
+ */
+static int MatchFindexTable(BootStrapRecord* bsr,
+                            BsrFileIndexTable* table,
+                            DeviceRecord* rec)
+{
+  auto& ranges = table->ranges;
+  int32_t FileIndex = rec->FileIndex;
+
+  auto range = std::lower_bound(
+      ranges.begin() + table->done_upto, ranges.end(), FileIndex,
+      [](const std::pair<int32_t, int32_t>& r, int32_t fi) {
+        return r.second < fi;
+      });
+  table->done_upto = range - ranges.begin();
+
+  if (range != ranges.end() && range->first <= FileIndex) {
+    Dmsg3(dbglevel, "Match on findex=%d. bsrFIs=%d,%d\n", FileIndex,
+          range->first, range->second);
+    return 1;
+  }
+  if (range == ranges.end()) {
+    bsr->done = true;
+    bsr->root->Reposition = true;
+    Dmsg1(dbglevel, "bsr done from findex %d\n", FileIndex);
+  } else if (bsr->root->use_volume_index &&
+             GetRecordAddress(rec) != table->reposition_addr) {
+    /*
+     * Between two wanted ranges, once per block see if the volume index
+     * knows where the next range starts.
+     */
+    table->reposition_addr = GetRecordAddress(rec);
+    bsr->root->Reposition = true;
+  }
+  return 0;
+}
+
 uint64_t GetBsrStartAddr(BootStrapRecord* bsr, uint32_t* file, uint32_t* block)
 {
   uint64_t bsr_addr = 0;
@@ -757,7 +877,10 @@ uint64_t GetBsrStartAddr(BootStrapRecord* bsr, uint32_t* file, uint32_t* block)
 
   if (bsr) {
     if (bsr->voladdr) {
-      bsr_addr = bsr->voladdr->saddr;
+      /* Position to the first part not read yet */
+      if (!GetSmallestVoladdr(bsr->voladdr, &bsr_addr)) {
+        bsr_addr = bsr->voladdr->saddr;
+      }
       sfile = bsr_addr >> 32;
       sblock = (uint32_t)bsr_addr;
 
@@ -829,12 +952,14 @@ static bool AddRestoreVolume(JobControlRecord* jcr, VolumeList* vol)
 
 /**
  * Create a list of Volumes (and Slots and Start positions) to be
- *  used in the current restore job.
+ *  used in the current restore job. Without a bsr the Volumes are
+ *  taken from VolumeNames if given, otherwise from the dcr.
  */
-void CreateRestoreVolumeList(JobControlRecord* jcr)
+void CreateRestoreVolumeList(JobControlRecord* jcr, const char* VolumeNames)
 {
   char *p, *n;
   VolumeList* vol;
+  PoolMem names(PM_NAME);
 
   /*
    * Build a list of volumes to be processed
@@ -874,7 +999,13 @@ void CreateRestoreVolumeList(JobControlRecord* jcr)
     }
   } else {
     /* This is the old way -- deprecated */
-    for (p = jcr->impl->dcr->VolumeName; p && *p;) {
+    if (VolumeNames) {
+      PmStrcpy(names, VolumeNames);
+      p = names.c_str();
+    } else {
+      p = jcr->impl->dcr->VolumeName;
+    }
+    while (p && *p) {
       n = strchr(p, '|'); /* volume name separator */
       if (n) { *n++ = 0; /* Terminate name */ }
       vol = new_restore_volume();
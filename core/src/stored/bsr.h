@@ -36,6 +36,10 @@
 #include <regex.h>
 #endif
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace storagedaemon {
 
 /**
@@ -140,6 +144,27 @@ struct BsrStream {
   int32_t stream; /* stream desired */
 };
 
+/**
+ * Sorted and merged copy of the FileIndex ranges of a single bsr.
+ *  Built once after parsing so MatchFindex() can do a binary search
+ *  instead of walking a list that may hold millions of entries.
+ *  All ranges before done_upto have been passed by the reader.
+ */
+struct BsrFileIndexTable {
+  std::vector<std::pair<int32_t, int32_t>> ranges;
+  size_t done_upto{0};
+  uint64_t reposition_addr{0}; /* block repositioning was last tried in */
+};
+
+/**
+ * VolSessionTime -> VolSessionId ranges of all bsrs in a chain.
+ *  Only built (on the root bsr) when fast block rejection is possible.
+ */
+struct BsrSessionIndex {
+  std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>>
+      sessions;
+};
+
 struct BootStrapRecord {
   /* NOTE!!! next must be the first item */
   BootStrapRecord* next;   /* pointer to next one */
@@ -150,6 +175,7 @@ struct BootStrapRecord {
   bool done;               /* set when everything found for this bsr */
   bool use_fast_rejection; /* set if fast rejection can be used */
   bool use_positioning;    /* set if we can position the archive */
+  bool use_volume_index;   /* root only: volume read has a block index */
   bool skip_file;          /* skip all records for current file */
   BsrVolume* volume;
   uint32_t count; /* count of files to restore this bsr */
@@ -163,16 +189,21 @@ struct BootStrapRecord {
   BsrJob* job;
   BsrClient* client;
   BsrFileIndex* FileIndex;
+  BsrFileIndex* FileIndex_tail; /* last item of FileIndex, used by parser */
   BsrJobType* JobType;
   BsrJoblevel* JobLevel;
   BsrStream* stream;
   char* fileregex; /* set if restore is filtered on filename */
   regex_t* fileregex_re;
   Attributes* attr; /* scratch space for unpacking */
+  BsrFileIndexTable* findex_table; /* indexed copy of FileIndex */
+  BsrSessionIndex* session_index;  /* root only: session lookup */
+  BootStrapRecord* first_active;   /* root only: first bsr not done */
 };
 
 
-void CreateRestoreVolumeList(JobControlRecord* jcr);
+void CreateRestoreVolumeList(JobControlRecord* jcr,
+                             const char* VolumeNames = NULL);
 void FreeRestoreVolumeList(JobControlRecord* jcr);
 
 } /* namespace storagedaemon */
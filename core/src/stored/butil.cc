@@ -58,16 +58,11 @@ static DeviceResource* find_device_res(char* device_name, bool readonly);
 static void MyFreeJcr(JobControlRecord* jcr);
 
 /**
- * Setup a "daemon" JobControlRecord for the various standalone tools (e.g. bls,
- * bextract, bscan, ...)
+ * Create a "daemon" JobControlRecord with dummy job values.
  */
-JobControlRecord* SetupJcr(const char* name,
-                           char* dev_name,
-                           BootStrapRecord* bsr,
-                           DirectorResource* director,
-                           DeviceControlRecord* dcr,
-                           const char* VolumeName,
-                           bool readonly)
+static JobControlRecord* NewToolJcr(const char* name,
+                                    BootStrapRecord* bsr,
+                                    DirectorResource* director)
 {
   JobControlRecord* jcr = new_jcr(MyFreeJcr);
   jcr->impl = new JobControlRecordPrivate;
@@ -93,6 +88,23 @@ JobControlRecord* SetupJcr(const char* name,
   jcr->impl->fileset_md5 = GetPoolMemory(PM_FNAME);
   PmStrcpy(jcr->impl->fileset_md5, "Dummy.fileset.md5");
 
+  return jcr;
+}
+
+/**
+ * Setup a "daemon" JobControlRecord for the various standalone tools (e.g. bls,
+ * bextract, bscan, ...)
+ */
+JobControlRecord* SetupJcr(const char* name,
+                           char* dev_name,
+                           BootStrapRecord* bsr,
+                           DirectorResource* director,
+                           DeviceControlRecord* dcr,
+                           const char* VolumeName,
+                           bool readonly)
+{
+  JobControlRecord* jcr = NewToolJcr(name, bsr, director);
+
   NewPlugins(jcr); /* instantiate plugins */
 
   InitAutochangers();
@@ -112,6 +124,31 @@ JobControlRecord* SetupJcr(const char* name,
   return jcr;
 }
 
+/**
+ * Setup a further "daemon" JobControlRecord writing to a device that was
+ * already setup by SetupJcr(), like another job appending to the same
+ * Volume. The caller still has to acquire the device for append.
+ */
+JobControlRecord* SetupWriteJcr(const char* name,
+                                DirectorResource* director,
+                                Device* dev,
+                                DeviceControlRecord* dcr)
+{
+  JobControlRecord* jcr = NewToolJcr(name, NULL, director);
+
+  NewPlugins(jcr); /* instantiate plugins */
+
+  jcr->impl->dcr = dcr;
+  SetupNewDcrDevice(jcr, dcr, dev, NULL);
+  dcr->SetWillWrite();
+  bstrncpy(dcr->dev_name, dev->device_resource->device_name,
+           sizeof(dcr->dev_name));
+  bstrncpy(dcr->pool_name, "Default", sizeof(dcr->pool_name));
+  bstrncpy(dcr->pool_type, "Backup", sizeof(dcr->pool_type));
+
+  return jcr;
+}
+
 /**
  * Setup device, jcr, and prepare to access device.
  *   If the caller wants read access, acquire the device, otherwise,
@@ -136,10 +173,6 @@ static bool setup_to_access_device(DeviceControlRecord* dcr,
    */
   if (VolumeName) {
     bstrncpy(VolName, VolumeName, sizeof(VolName));
-    if (strlen(VolumeName) >= MAX_NAME_LENGTH) {
-      Jmsg0(jcr, M_ERROR, 0,
-            _("Volume name or names is too long. Please use a .bsr file.\n"));
-    }
   } else {
     VolName[0] = 0;
   }
@@ -177,7 +210,10 @@ static bool setup_to_access_device(DeviceControlRecord* dcr,
   }
   bstrncpy(dcr->dev_name, device_resource->device_name, sizeof(dcr->dev_name));
 
-  CreateRestoreVolumeList(jcr);
+  /*
+   * The list of Volume names may be longer than the dcr can hold.
+   */
+  CreateRestoreVolumeList(jcr, VolumeName);
 
   if (readonly) { /* read only access? */
     Dmsg0(100, "Acquire device for read\n");
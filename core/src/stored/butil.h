@@ -35,6 +35,10 @@ JobControlRecord* SetupJcr(const char* name,
                            DeviceControlRecord* dcr,
                            const char* VolumeName,
                            bool readonly);
+JobControlRecord* SetupWriteJcr(const char* name,
+                                DirectorResource* director,
+                                Device* dev,
+                                DeviceControlRecord* dcr);
 void DisplayTapeErrorStatus(JobControlRecord* jcr, Device* dev);
 
 } /* namespace storagedaemon */
@@ -80,6 +80,7 @@
 #include "stored/device_control_record.h"
 #include "stored/jcr_private.h"
 #include "stored/sd_backends.h"
+#include "stored/volume_index.h"
 #include "lib/btimers.h"
 #include "include/jcr.h"
 #include "lib/berrno.h"
@@ -819,7 +820,15 @@ bool Device::eod(DeviceControlRecord* dcr)
   file_size = 0;
   file_addr = 0;
 
-  pos = lseek(dcr, (boffset_t)0, SEEK_END);
+  /*
+   * A clean volume index saves asking the backend for the volume size
+   */
+  uint64_t index_eod;
+  if (GetVolumeIndexEod(dcr, &index_eod)) {
+    pos = lseek(dcr, (boffset_t)index_eod, SEEK_SET);
+  } else {
+    pos = lseek(dcr, (boffset_t)0, SEEK_END);
+  }
   Dmsg1(200, "====== Seek to %lld\n", pos);
 
   if (pos >= 0) {
@@ -56,6 +56,7 @@
 #include "stored/device_control_record.h"
 #include "stored/jcr_private.h"
 #include "stored/match_bsr.h"
+#include "stored/volume_index.h"
 #include "lib/edit.h"
 #include "include/jcr.h"
 #include "lib/berrno.h"
@@ -309,6 +310,7 @@ BootStrapRecord* PositionDeviceToFirstFile(JobControlRecord* jcr,
   BootStrapRecord* bsr = NULL;
   Device* dev = dcr->dev;
   uint32_t file, block;
+  uint64_t bsr_addr, addr;
   /*
    * Now find and position to first file and block
    *   on this tape.
@@ -316,7 +318,18 @@ BootStrapRecord* PositionDeviceToFirstFile(JobControlRecord* jcr,
   if (jcr->impl->read_session.bsr) {
     jcr->impl->read_session.bsr->Reposition = true;
     bsr = find_next_bsr(jcr->impl->read_session.bsr, dev);
-    if (GetBsrStartAddr(bsr, &file, &block) > 0) {
+    bsr_addr = GetBsrStartAddr(bsr, &file, &block);
+    addr = VolumeIndexStartAddr(dcr, jcr->impl->read_session.bsr, 0);
+    jcr->impl->read_session.bsr->use_volume_index = VolumeIndexHasBlocks(dcr);
+    if (addr > bsr_addr) {
+      file = (uint32_t)(addr >> 32);
+      block = (uint32_t)addr;
+      Jmsg(jcr, M_INFO, 0,
+           _("Forward spacing Volume \"%s\" to file:block %u:%u from the "
+             "volume index.\n"),
+           dev->VolHdr.VolumeName, file, block);
+      dev->Reposition(dcr, file, block);
+    } else if (bsr_addr > 0) {
       Jmsg(jcr, M_INFO, 0,
            _("Forward spacing Volume \"%s\" to file:block %u:%u.\n"),
            dev->VolHdr.VolumeName, file, block);
@@ -363,7 +376,24 @@ bool TryDeviceRepositioning(JobControlRecord* jcr,
     /* TODO: use dev->file_addr ? */
     uint64_t dev_addr = (((uint64_t)dev->file) << 32) | dev->block_num;
     uint64_t bsr_addr = GetBsrStartAddr(bsr, &file, &block);
+    uint64_t block_addr = dev->file_addr > dcr->block->read_len
+                              ? dev->file_addr - dcr->block->read_len
+                              : 0;
+    uint64_t index_addr = 0;
 
+    /*
+     * The volume index may know that the next wanted file starts later,
+     * blob blocks from the current block on are still read
+     */
+    if (jcr->impl->read_session.bsr->use_volume_index) {
+      index_addr = VolumeIndexStartAddr(dcr, jcr->impl->read_session.bsr,
+                                        block_addr);
+    }
+    if (index_addr > bsr_addr) {
+      bsr_addr = index_addr;
+      file = (uint32_t)(index_addr >> 32);
+      block = (uint32_t)index_addr;
+    }
     if (dev_addr > bsr_addr) { return false; }
     Dmsg4(500, "Try_Reposition from (file:block) %u:%u to %u:%u\n", dev->file,
           dev->block_num, file, block);
@@ -56,6 +56,8 @@ enum get_vol_info_rw
 class Device;
 class DeviceResource;
 struct DeviceBlock;
+struct VolumeIndex;
+struct VolumeIndexBlockBuffer;
 struct DeviceRecord;
 
 /* clang-format off */
@@ -75,6 +77,9 @@ class DeviceControlRecord {
   Device* volatile dev{};          /**< Pointer to device */
   DeviceResource* device_resource{};    /**< Pointer to device resource */
   DeviceBlock* block{};            /**< Pointer to current block */
+  std::vector<DeviceBlock*> queued_blocks; /**< Full blocks not yet written */
+  std::vector<DeviceBlock*> spare_blocks;  /**< Written blocks for reuse */
+  uint32_t max_queued_blocks{};    /**< Queue full blocks up to this number */
   DeviceRecord* rec{};             /**< Pointer to record being processed */
   DeviceRecord* before_rec{};      /**< Pointer to record before translation */
   DeviceRecord* after_rec{};       /**< Pointer to record after translation */
@@ -113,6 +118,9 @@ class DeviceControlRecord {
   int Copy{};                         /**< Identical copy number */
   int Stripe{};                       /**< RAIT stripe */
   VolumeCatalogInfo VolCatInfo;       /**< Catalog info for desired volume */
+  uint64_t volume_index_next{};       /**< Next block address to index */
+  VolumeIndex* volume_index{};        /**< Index of the volume being read */
+  VolumeIndexBlockBuffer* volume_index_blocks{}; /**< Blocks to index */
 
   DeviceControlRecord();
   virtual ~DeviceControlRecord() = default;
@@ -127,6 +135,8 @@ class DeviceControlRecord {
 
   bool IsReserved() const { return reserved_; }
   bool IsDevLocked() { return dev_locked_; }
+  void SetDevLocked() { dev_locked_ = true; }
+  void ClearDevLocked() { dev_locked_ = false; }
   bool IsWriting() const { return will_write_; }
 
   void IncDevLock() { dev_lock_++; }
@@ -204,6 +214,9 @@ class DeviceControlRecord {
    */
   bool WriteBlockToDevice();
   bool WriteBlockToDev();
+  bool QueueBlockForWrite();
+  bool WriteQueuedBlocks();
+  void FreeQueuedBlocks();
 
   enum ReadStatus
   {
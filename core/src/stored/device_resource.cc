@@ -37,6 +37,7 @@ DeviceResource::DeviceResource()
     , changer_command(nullptr)
     , alert_command(nullptr)
     , spool_directory(nullptr)
+    , volume_index_directory(nullptr)
     , dev_type(DeviceType::B_UNKNOWN_DEV)
     , label_type(B_BAREOS_LABEL)
     , autoselect(true)
@@ -58,6 +59,7 @@ DeviceResource::DeviceResource()
     , max_block_size(0)
     , max_network_buffer_size(0)
     , max_concurrent_jobs(0)
+    , queued_write_blocks(1)
     , autodeflate_algorithm(0)
     , autodeflate_level(6)
     , autodeflate(AutoXflateMode::IO_DIRECTION_NONE)
@@ -68,6 +70,7 @@ DeviceResource::DeviceResource()
     , volume_capacity(0)
     , max_spool_size(0)
     , max_job_spool_size(0)
+    , volume_index_interval(16 * 1024 * 1024)
 
     , max_part_size(0)
     , mount_point(nullptr)
@@ -76,7 +79,12 @@ DeviceResource::DeviceResource()
     , write_part_command(nullptr)
     , free_space_command(nullptr)
     , count(1)
+    , maximum_count(0)
+    , retire_idle_time(600)
     , multiplied_device_resource(nullptr)
+    , elastic(false)
+    , retired(false)
+    , idle_since(0)
 
     , dev(nullptr)
     , changer_res(nullptr)
@@ -97,6 +105,7 @@ DeviceResource::DeviceResource(const DeviceResource& other)
     , changer_command(nullptr)
     , alert_command(nullptr)
     , spool_directory(nullptr)
+    , volume_index_directory(nullptr)
     , mount_point(nullptr)
     , mount_command(nullptr)
     , unmount_command(nullptr)
@@ -118,6 +127,9 @@ DeviceResource::DeviceResource(const DeviceResource& other)
   if (other.spool_directory) {
     spool_directory = strdup(other.spool_directory);
   }
+  if (other.volume_index_directory) {
+    volume_index_directory = strdup(other.volume_index_directory);
+  }
   dev_type = other.dev_type;
   label_type = other.label_type;
   autoselect = other.autoselect;
@@ -139,6 +151,7 @@ DeviceResource::DeviceResource(const DeviceResource& other)
   max_block_size = other.max_block_size;
   max_network_buffer_size = other.max_network_buffer_size;
   max_concurrent_jobs = other.max_concurrent_jobs;
+  queued_write_blocks = other.queued_write_blocks;
   autodeflate_algorithm = other.autodeflate_algorithm;
   autodeflate_level = other.autodeflate_level;
   autodeflate = other.autodeflate;
@@ -149,6 +162,7 @@ DeviceResource::DeviceResource(const DeviceResource& other)
   volume_capacity = other.volume_capacity;
   max_spool_size = other.max_spool_size;
   max_job_spool_size = other.max_job_spool_size;
+  volume_index_interval = other.volume_index_interval;
 
   max_part_size = other.max_part_size;
   if (other.mount_point) { mount_point = strdup(other.mount_point); }
@@ -163,7 +177,12 @@ DeviceResource::DeviceResource(const DeviceResource& other)
     free_space_command = strdup(other.free_space_command);
   }
   count = other.count;
+  maximum_count = other.maximum_count;
+  retire_idle_time = other.retire_idle_time;
   multiplied_device_resource = other.multiplied_device_resource;
+  elastic = other.elastic;
+  retired = other.retired;
+  idle_since = other.idle_since;
   multiplied_device_resource_base_name =
       other.multiplied_device_resource_base_name;
   dev = other.dev;
@@ -181,6 +200,7 @@ DeviceResource& DeviceResource::operator=(const DeviceResource& rhs)
   changer_command = rhs.changer_command;
   alert_command = rhs.alert_command;
   spool_directory = rhs.spool_directory;
+  volume_index_directory = rhs.volume_index_directory;
   dev_type = rhs.dev_type;
   label_type = rhs.label_type;
   autoselect = rhs.autoselect;
@@ -202,6 +222,7 @@ DeviceResource& DeviceResource::operator=(const DeviceResource& rhs)
   max_block_size = rhs.max_block_size;
   max_network_buffer_size = rhs.max_network_buffer_size;
   max_concurrent_jobs = rhs.max_concurrent_jobs;
+  queued_write_blocks = rhs.queued_write_blocks;
   autodeflate_algorithm = rhs.autodeflate_algorithm;
   autodeflate_level = rhs.autodeflate_level;
   autodeflate = rhs.autodeflate;
@@ -212,6 +233,7 @@ DeviceResource& DeviceResource::operator=(const DeviceResource& rhs)
   volume_capacity = rhs.volume_capacity;
   max_spool_size = rhs.max_spool_size;
   max_job_spool_size = rhs.max_job_spool_size;
+  volume_index_interval = rhs.volume_index_interval;
 
   max_part_size = rhs.max_part_size;
   mount_point = rhs.mount_point;
@@ -220,7 +242,12 @@ DeviceResource& DeviceResource::operator=(const DeviceResource& rhs)
   write_part_command = rhs.write_part_command;
   free_space_command = rhs.free_space_command;
   count = rhs.count;
+  maximum_count = rhs.maximum_count;
+  retire_idle_time = rhs.retire_idle_time;
   multiplied_device_resource = rhs.multiplied_device_resource;
+  elastic = rhs.elastic;
+  retired = rhs.retired;
+  idle_since = rhs.idle_since;
   multiplied_device_resource_base_name =
       rhs.multiplied_device_resource_base_name;
   dev = rhs.dev;
@@ -43,6 +43,7 @@ class DeviceResource : public BareosResource {
   char* changer_command;        /**< Changer command  -- external program */
   char* alert_command;          /**< Alert command -- external program */
   char* spool_directory;        /**< Spool file directory */
+  char* volume_index_directory; /**< Directory of the volume indexes */
   DeviceType dev_type;          /**< device type */
   uint32_t label_type;          /**< label type */
   bool autoselect;              /**< Automatically select from AutoChanger */
@@ -64,6 +65,8 @@ class DeviceResource : public BareosResource {
   uint32_t max_block_size;      /**< Current Maximum block size */
   uint32_t max_network_buffer_size; /**< Max network buf size */
   uint32_t max_concurrent_jobs;     /**< Maximum concurrent jobs this drive */
+  uint32_t queued_write_blocks; /**< Full blocks a job collects before
+                                   writing them under one device lock */
   uint32_t autodeflate_algorithm;   /**< Compression algorithm to use for
                                        compression */
   uint16_t autodeflate_level; /**< Compression level to use for compression
@@ -77,6 +80,7 @@ class DeviceResource : public BareosResource {
   int64_t volume_capacity; /**< Advisory capacity */
   int64_t max_spool_size;  /**< Max spool size for all jobs */
   int64_t max_job_spool_size; /**< Max spool size for any single job */
+  int64_t volume_index_interval; /**< Bytes between volume index entries */
 
   int64_t max_part_size;    /**< Max part size */
   char* mount_point;        /**< Mount point for require mount devices */
@@ -85,7 +89,14 @@ class DeviceResource : public BareosResource {
   char* write_part_command; /**< Write part command */
   char* free_space_command; /**< Free space command */
   uint32_t count;           /**< Total number of multiplied devices */
+  uint32_t maximum_count;   /**< Upper limit of multiplied devices added
+                                 on demand */
+  utime_t retire_idle_time; /**< Idle time before an added device is
+                                 retired again */
   DeviceResource* multiplied_device_resource; /**< Copied from this device */
+  bool elastic; /**< Multiplied device beyond Count, only used on demand */
+  bool retired; /**< Elastic device currently not in use -- set at runtime */
+  time_t idle_since; /**< Elastic device found idle at -- set at runtime */
 
   Device* dev; /* Pointer to physical dev -- set at runtime */
   AutochangerResource* changer_res; /* Pointer to changer res if any */
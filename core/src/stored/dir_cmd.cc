@@ -914,6 +914,11 @@ static DeviceControlRecord* FindDevice(JobControlRecord* jcr,
         foreach_alist (device_resource, changer->device_resources) {
           Dmsg1(100, "Try changer device %s\n",
                 device_resource->resource_name_);
+          if (device_resource->retired) {
+            Dmsg1(100, "Device %s retired. Skipped\n",
+                  device_resource->resource_name_);
+            continue;
+          }
           if (!device_resource->dev) {
             device_resource->dev = FactoryCreateDevice(jcr, device_resource);
           }
@@ -1663,6 +1668,7 @@ static bool ReplicateCmd(JobControlRecord* jcr)
         tls_policy);
 
   storage_daemon_socket->SetSourceAddress(me->SDsrc_addr);
+  storage_daemon_socket->SetTlsKernelOffload(me->tls_kernel_offload);
 
   if (!jcr->max_bandwidth) {
     if (jcr->impl->director->max_bandwidth_per_job) {
@@ -1766,6 +1772,7 @@ static bool PassiveCmd(JobControlRecord* jcr)
   fd = new BareosSocketTCP;
   if (me->nokeepalive) { fd->ClearKeepalive(); }
   fd->SetSourceAddress(me->SDsrc_addr);
+  fd->SetTlsKernelOffload(me->tls_kernel_offload);
 
   /*
    * Open command communications with passive filedaemon
@@ -45,6 +45,7 @@
 #include "stored/sd_stats.h"
 #include "lib/bnet.h"
 #include "lib/bsock.h"
+#include "lib/bsock_striped.h"
 #include "lib/edit.h"
 #include "include/jcr.h"
 
@@ -52,6 +53,13 @@ namespace storagedaemon {
 
 /* Static variables */
 static char ferrmsg[] = "3900 Invalid command\n";
+static pthread_mutex_t stripe_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Time to wait for the additional data connections of a backup after the
+ * File daemon announced them.
+ */
+#define STRIPE_WAIT_TIME 30
 
 /* Imported functions */
 
@@ -82,6 +90,7 @@ static struct s_cmds fd_cmds[] = {
 };
 
 /* Commands from the File daemon that require additional scanning */
+static char append_data_stripes[] = "append data %d stripes=%d";
 static char read_open[] = "read open session = %127s %ld %ld %ld %ld %ld %ld\n";
 
 /* Responses sent to the File daemon */
@@ -161,6 +170,66 @@ void* HandleFiledConnection(BareosSocket* fd, char* job_name)
   return NULL;
 }
 
+/**
+ * After receiving a connection (in dircmd.c) if it is an additional data
+ * connection of the File daemon for a running backup, this routine is
+ * called. The connection is kept until the append data command uses it.
+ */
+void* HandleFiledStripeConnection(BareosSocket* fd, char* job_name, int stripe)
+{
+  JobControlRecord* jcr;
+
+  if (!(jcr = get_jcr_by_full_name(job_name))) {
+    Jmsg1(NULL, M_ERROR, 0,
+          _("FD data connection failed: Job name not found: %s\n"), job_name);
+    fd->close();
+    delete fd;
+    return NULL;
+  }
+
+  /*
+   * The session key is cleared once the append data command collected the
+   * data connections, no key means no further connections are accepted.
+   */
+  if (!jcr->authenticated || !jcr->is_JobType(JT_BACKUP) || stripe < 1 ||
+      stripe >= BSOCK_MAX_STRIPES || !jcr->sd_auth_key ||
+      *jcr->sd_auth_key == 0 || jcr->impl->stripes_collected) {
+    Jmsg1(jcr, M_ERROR, 0, _("Unexpected data connection %d from FD.\n"),
+          stripe);
+    fd->close();
+    delete fd;
+    FreeJcr(jcr);
+    return NULL;
+  }
+
+  fd->SetJcr(jcr);
+  if (!AuthenticateFiledaemonStripe(jcr, fd)) {
+    Dmsg2(50, "Authentication of data connection %d failed Job %s\n", stripe,
+          jcr->Job);
+    fd->close();
+    delete fd;
+    FreeJcr(jcr);
+    return NULL;
+  }
+
+  P(stripe_mutex);
+  if (jcr->impl->stripes_collected) {
+    V(stripe_mutex);
+    Jmsg1(jcr, M_ERROR, 0, _("Late data connection %d from FD.\n"), stripe);
+    fd->close();
+    delete fd;
+    FreeJcr(jcr);
+    return NULL;
+  }
+  Dmsg2(50, "Data connection %d for Job %s\n", stripe, jcr->Job);
+  jcr->impl->stripes.push_back(fd);
+  pthread_cond_broadcast(&jcr->impl->stripe_wait);
+  V(stripe_mutex);
+  FreeJcr(jcr);
+
+  return NULL;
+}
+
 /**
  * Run a File daemon Job -- File daemon already authorized
  * Director sends us this command.
@@ -254,20 +323,92 @@ void DoFdCommands(JobControlRecord* jcr)
   fd->signal(BNET_TERMINATE); /* signal to FD job is done */
 }
 
+/**
+ * Wait for the additional data connections announced by the File daemon
+ * and combine them with the control connection.
+ */
+static BareosSocketStriped* OpenStripes(JobControlRecord* jcr, int32_t count)
+{
+  std::vector<BareosSocket*> stripes;
+  struct timeval tv;
+  struct timezone tz;
+  struct timespec timeout;
+  int errstat = 0;
+  int32_t arrived;
+
+  if (count > BSOCK_MAX_STRIPES) {
+    Mmsg(jcr->errmsg, _("Too many data connections requested: %d\n"), count);
+    return nullptr;
+  }
+
+  gettimeofday(&tv, &tz);
+  timeout.tv_nsec = tv.tv_usec * 1000;
+  timeout.tv_sec = tv.tv_sec + STRIPE_WAIT_TIME;
+
+  P(stripe_mutex);
+  while ((int32_t)jcr->impl->stripes.size() < count - 1 && !JobCanceled(jcr)) {
+    errstat = pthread_cond_timedwait(&jcr->impl->stripe_wait, &stripe_mutex,
+                                     &timeout);
+    if (errstat == ETIMEDOUT || errstat == EINVAL || errstat == EPERM) {
+      break;
+    }
+  }
+  arrived = jcr->impl->stripes.size() + 1;
+  if (arrived == count) { stripes.swap(jcr->impl->stripes); }
+  jcr->impl->stripes_collected = true;
+  V(stripe_mutex);
+
+  if (stripes.empty()) {
+    Mmsg(jcr->errmsg, _("Only %d of %d data connections of FD arrived.\n"),
+         arrived, count);
+    return nullptr;
+  }
+
+  return new BareosSocketStriped(jcr, jcr->file_bsock, stripes, false);
+}
+
 /**
  * Append Data command
  *    Open Data Channel and receive Data for archiving
  *    Write the Data to the archive device
+ *
+ *    The File daemon may send the data over additional connections,
+ *    which it announces with the number of connections to use.
  */
 static bool AppendDataCmd(JobControlRecord* jcr)
 {
   BareosSocket* fd = jcr->file_bsock;
+  BareosSocketStriped* striped = nullptr;
+  int32_t ticket, stripes = 1;
+  bool ok;
 
   Dmsg1(120, "Append data: %s", fd->msg);
   if (jcr->impl->session_opened) {
     Dmsg1(110, "<filed: %s", fd->msg);
     jcr->setJobType(JT_BACKUP);
-    if (DoAppendData(jcr, fd, "FD")) {
+    if (sscanf(fd->msg, append_data_stripes, &ticket, &stripes) == 2 &&
+        stripes > 1) {
+      striped = OpenStripes(jcr, stripes);
+    }
+
+    /*
+     * No further connections of the File daemon are accepted.
+     */
+    P(stripe_mutex);
+    jcr->impl->stripes_collected = true;
+    V(stripe_mutex);
+    memset(jcr->sd_auth_key, 0, strlen(jcr->sd_auth_key));
+
+    if (stripes > 1 && !striped) {
+      Jmsg1(jcr, M_FATAL, 0, "%s", jcr->errmsg);
+      BnetSuppressErrorMessages(fd, 1);
+      fd->fsend(ERROR_append);
+      return false;
+    }
+
+    ok = DoAppendData(jcr, fd, "FD", striped);
+    if (striped) { delete striped; }
+    if (ok) {
       return true;
     } else {
       PmStrcpy(jcr->errmsg, _("Append data error.\n"));
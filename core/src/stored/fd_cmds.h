@@ -24,6 +24,9 @@
 namespace storagedaemon {
 
 void* HandleFiledConnection(BareosSocket* fd, char* job_name);
+void* HandleFiledStripeConnection(BareosSocket* fd,
+                                  char* job_name,
+                                  int stripe);
 void RunJob(JobControlRecord* jcr);
 void DoFdCommands(JobControlRecord* jcr);
 
@@ -26,6 +26,11 @@
 
 #include "stored/read_ctx.h"
 
+#include <vector>
+
+class BareosSocket;
+class AttrSpoolWriter;
+
 #define SD_APPEND 1
 #define SD_READ 0
 
@@ -66,6 +71,9 @@ struct JobControlRecordPrivate {
   JobControlRecord* prev_dev{}; /**< Previous JobControlRecord attached to device */
   pthread_cond_t job_start_wait = PTHREAD_COND_INITIALIZER; /**< Wait for FD to start Job */
   pthread_cond_t job_end_wait = PTHREAD_COND_INITIALIZER;   /**< Wait for Job to end */
+  pthread_cond_t stripe_wait = PTHREAD_COND_INITIALIZER;    /**< Wait for FD data connections */
+  std::vector<BareosSocket*> stripes; /**< Additional data connections of the FD */
+  bool stripes_collected{}; /**< No further data connections are accepted */
   storagedaemon::DeviceControlRecord* read_dcr{}; /**< Device context for reading */
   storagedaemon::DeviceControlRecord* dcr{};      /**< Device context record */
   POOLMEM* job_name{};            /**< Base Job name (not unique) */
@@ -82,6 +90,8 @@ struct JobControlRecordPrivate {
   int32_t Ticket{};               /**< Ticket for this job */
   bool ignore_label_errors{};     /**< Ignore Volume label errors */
   bool spool_attributes{};        /**< Set if spooling attributes */
+  bool compress_attr_spool{};     /**< Set if the Director reads compressed attr spool files */
+  AttrSpoolWriter* attr_spool{};  /**< Writer of a compressed attr spool file */
   bool no_attributes{};           /**< Set if no attributes wanted */
   int64_t spool_size{};           /**< Spool size for this job */
   bool spool_data{};              /**< Set to spool data */
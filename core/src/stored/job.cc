@@ -37,6 +37,7 @@
 #include "stored/ndmp_tape.h"
 #include "stored/read_record.h"
 #include "stored/stored_globals.h"
+#include "lib/attr_spool.h"
 #include "lib/bsock.h"
 #include "lib/edit.h"
 #include "lib/parse_bsr.h"
@@ -148,6 +149,8 @@ bool job_cmd(JobControlRecord* jcr)
   jcr->setJobLevel(level);
   jcr->impl->no_attributes = no_attributes;
   jcr->impl->spool_attributes = spool_attributes;
+  jcr->impl->compress_attr_spool =
+      spool_attributes == SPOOL_ATTRIBUTES_COMPRESSED;
   jcr->impl->spool_data = spool_data;
   jcr->impl->spool_size = str_to_int64(spool_size);
   jcr->impl->fileset_md5 = GetPoolMemory(PM_NAME);
@@ -213,7 +216,13 @@ bool DoJobRun(JobControlRecord* jcr)
   V(mutex);
   Dmsg2(800, "Auth fail or cancel for jid=%d %p\n", jcr->JobId, jcr);
 
-  memset(jcr->sd_auth_key, 0, strlen(jcr->sd_auth_key));
+  /*
+   * A backup may open additional data connections, which authenticate with
+   * the same key. It is cleared by the append data command then.
+   */
+  if (!jcr->authenticated || JobCanceled(jcr) || !jcr->is_JobType(JT_BACKUP)) {
+    memset(jcr->sd_auth_key, 0, strlen(jcr->sd_auth_key));
+  }
   switch (jcr->getJobProtocol()) {
     case PT_NDMP_BAREOS:
       if (jcr->authenticated && !JobCanceled(jcr)) {
@@ -417,6 +426,21 @@ void StoredFreeJcr(JobControlRecord* jcr)
     jcr->file_bsock = NULL;
   }
 
+  for (auto stripe : jcr->impl->stripes) {
+    stripe->close();
+    delete stripe;
+  }
+  jcr->impl->stripes.clear();
+
+  if (jcr->impl->attr_spool) {
+    delete jcr->impl->attr_spool;
+    jcr->impl->attr_spool = nullptr;
+  }
+
+  if (jcr->sd_auth_key) {
+    memset(jcr->sd_auth_key, 0, strlen(jcr->sd_auth_key));
+  }
+
   if (jcr->impl->job_name) { FreePoolMemory(jcr->impl->job_name); }
 
   if (jcr->client_name) {
@@ -460,6 +484,7 @@ void StoredFreeJcr(JobControlRecord* jcr)
 
   pthread_cond_destroy(&jcr->impl->job_start_wait);
   pthread_cond_destroy(&jcr->impl->job_end_wait);
+  pthread_cond_destroy(&jcr->impl->stripe_wait);
 
   /*
    * Avoid a double free
@@ -36,6 +36,7 @@
 #include "stored/device_control_record.h"
 #include "stored/jcr_private.h"
 #include "stored/label.h"
+#include "stored/volume_index.h"
 #include "lib/edit.h"
 #include "include/jcr.h"
 
@@ -381,6 +382,7 @@ bool WriteNewVolumeLabelToDev(DeviceControlRecord* dcr,
   dev->setVolCatName(VolName);
   dcr->setVolCatName(VolName);
   Dmsg1(150, "New VolName=%s\n", VolName);
+  VolumeIndexRemove(dcr, VolName);
 
 
   if (!dev->open(dcr, DeviceMode::OPEN_READ_WRITE)) {
@@ -1116,6 +1118,7 @@ bool DeviceControlRecord::RewriteVolumeLabel(bool recycle)
 
   dev->VolHdr.LabelType = VOL_LABEL; /* set Volume label */
   dev->SetAppend();
+  VolumeIndexRemove(dcr, dcr->VolumeName);
   if (!WriteVolumeLabelToBlock(dcr)) {
     Dmsg0(200, "Error from write volume label.\n");
     return false;
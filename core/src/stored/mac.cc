@@ -198,17 +198,24 @@ static bool CloneRecordInternally(DeviceControlRecord* dcr, DeviceRecord* rec)
    */
   if (rec->FileIndex >= 0) {
     /*
-     * If something changed, increment FileIndex
+     * If something changed, increment FileIndex. A file's shared ACL/xattr
+     * blob always follows its attributes, a blob with a new FileIndex
+     * belongs to a file that is not copied. It is kept for the files that
+     * reference it by writing it with the current or the next output file.
      */
-    if (rec->VolSessionId != rec->last_VolSessionId ||
-        rec->VolSessionTime != rec->last_VolSessionTime ||
-        rec->FileIndex != rec->last_FileIndex) {
+    if (rec->VolSessionId == rec->last_VolSessionId &&
+        rec->VolSessionTime == rec->last_VolSessionTime &&
+        rec->FileIndex == rec->last_FileIndex) {
+      rec->FileIndex = jcr->JobFiles;
+    } else if (rec->maskedStream == STREAM_ACL_XATTR_BLOB) {
+      rec->FileIndex = jcr->JobFiles > 0 ? jcr->JobFiles : 1;
+    } else {
       jcr->JobFiles++;
       rec->last_VolSessionId = rec->VolSessionId;
       rec->last_VolSessionTime = rec->VolSessionTime;
       rec->last_FileIndex = rec->FileIndex;
+      rec->FileIndex = jcr->JobFiles; /* set sequential output FileIndex */
     }
-    rec->FileIndex = jcr->JobFiles; /* set sequential output FileIndex */
   }
 
   /*
@@ -35,6 +35,7 @@
 #include "stored/device_control_record.h"
 #include "stored/jcr_private.h"
 #include "stored/label.h"
+#include "stored/volume_index.h"
 #include "lib/edit.h"
 #include "include/jcr.h"
 #include "lib/bsock.h"
@@ -377,6 +378,7 @@ read_volume:
     /* Return an empty block */
     EmptyBlock(block); /* we used it for reading so set for write */
   }
+  VolumeIndexStartAppend(dcr);
   dev->SetAppend();
   Dmsg1(150, "set APPEND, normal return from MountNextWriteVolume. dev=%s\n",
         dev->print_name());
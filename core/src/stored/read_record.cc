@@ -377,6 +377,12 @@ bool ReadNextRecordFromBlock(DeviceControlRecord* dcr,
       return false; /* read second part of record */
     }
 
+    /*
+     * Shared ACL and extended attribute blobs are also passed for files that
+     * are not selected, they do not start a file of the bsr.
+     */
+    if (rec->maskedStream == STREAM_ACL_XATTR_BLOB) { return true; }
+
     if (rctx->lastFileIndex != READ_NO_FILEINDEX &&
         rctx->lastFileIndex != rec->FileIndex) {
       if (IsThisBsrDone(jcr->impl->read_session.bsr, rec) &&
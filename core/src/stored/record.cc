@@ -204,6 +204,14 @@ static const char* record_digest_to_str(PoolMem& resultbuffer,
       BinToBase64(digest, sizeof(digest), (char*)rec->data,
                   CRYPTO_DIGEST_SHA512_SIZE, true);
       break;
+    case STREAM_BLAKE3_DIGEST:
+      BinToBase64(digest, sizeof(digest), (char*)rec->data,
+                  CRYPTO_DIGEST_BLAKE3_SIZE, true);
+      break;
+    case STREAM_XXH128_DIGEST:
+      BinToBase64(digest, sizeof(digest), (char*)rec->data,
+                  CRYPTO_DIGEST_XXH128_SIZE, true);
+      break;
     default:
       return "";
   }
@@ -259,6 +267,8 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
         return "contCOMPRESSED";
       case STREAM_UNIX_ATTRIBUTES_EX:
         return "contUNIX-Attributes-EX";
+      case STREAM_UNIX_ATTRIBUTES_COMPACT:
+        return "contUATTR-COMPACT";
       case STREAM_RESTORE_OBJECT:
         return "contRESTORE-OBJECT";
       case STREAM_SPARSE_DATA:
@@ -279,6 +289,10 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
         return "contSHA256";
       case STREAM_SHA512_DIGEST:
         return "contSHA512";
+      case STREAM_BLAKE3_DIGEST:
+        return "contBLAKE3";
+      case STREAM_XXH128_DIGEST:
+        return "contXXH128";
       case STREAM_SIGNED_DIGEST:
         return "contSIGNED-DIGEST";
       case STREAM_ENCRYPTED_SESSION_DATA:
@@ -326,6 +340,8 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
       return "COMPRESSED";
     case STREAM_UNIX_ATTRIBUTES_EX:
       return "UNIX-Attributes-EX";
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
+      return "UATTR-COMPACT";
     case STREAM_RESTORE_OBJECT:
       return "RESTORE-OBJECT";
     case STREAM_SPARSE_DATA:
@@ -348,6 +364,10 @@ const char* stream_to_ascii(char* buf, int stream, int fi)
       return "SHA256";
     case STREAM_SHA512_DIGEST:
       return "SHA512";
+    case STREAM_BLAKE3_DIGEST:
+      return "BLAKE3";
+    case STREAM_XXH128_DIGEST:
+      return "XXH128";
     case STREAM_SIGNED_DIGEST:
       return "SIGNED-DIGEST";
     case STREAM_ENCRYPTED_SESSION_DATA:
@@ -431,12 +451,15 @@ static const char* get_record_short_info(PoolMem& resultbuffer,
   switch (rec->maskedStream) {
     case STREAM_UNIX_ATTRIBUTES:
     case STREAM_UNIX_ATTRIBUTES_EX:
+    case STREAM_UNIX_ATTRIBUTES_COMPACT:
       record_unix_attributes_to_str(resultbuffer, jcr, rec);
       break;
     case STREAM_MD5_DIGEST:
     case STREAM_SHA1_DIGEST:
     case STREAM_SHA256_DIGEST:
     case STREAM_SHA512_DIGEST:
+    case STREAM_BLAKE3_DIGEST:
+    case STREAM_XXH128_DIGEST:
       record_digest_to_str(resultbuffer, rec);
       break;
     case STREAM_PLUGIN_NAME: {
@@ -623,6 +646,9 @@ static inline ssize_t WriteHeaderToBlock(DeviceBlock* block,
      */
     if (block->FirstIndex == 0) { block->FirstIndex = rec->FileIndex; }
     block->LastIndex = rec->FileIndex;
+    if (rec->maskedStream == STREAM_ACL_XATTR_BLOB) {
+      block->acl_xattr_blob = true;
+    }
   }
 
   return WRITE_RECHDR_LENGTH;
@@ -678,7 +704,7 @@ bool DeviceControlRecord::WriteRecord()
   while (!WriteRecordToBlock(this, after_rec)) {
     Dmsg2(850, "!WriteRecordToBlock data_len=%d rem=%d\n", after_rec->data_len,
           after_rec->remainder);
-    if (!WriteBlockToDevice()) {
+    if (!QueueBlockForWrite()) {
       Dmsg2(90, "Got WriteBlockToDev error on device %s. %s\n",
             dev->print_name(), dev->bstrerror());
       goto bail_out;
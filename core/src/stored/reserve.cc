@@ -38,20 +38,62 @@
 #include "stored/jcr_private.h"
 #include "stored/wait.h"
 #include "lib/berrno.h"
+#include "lib/edit.h"
 #include "lib/util.h"
 #include "lib/bsock.h"
+#include "lib/status_packet.h"
 #include "include/jcr.h"
 #include "lib/parse_conf.h"
 
+#include <atomic>
+
 namespace storagedaemon {
 
 const int debuglevel = 150;
 
 /* Global static variables */
-static int reservations_lock_count = 0;
+static std::atomic<int> reservations_lock_count{0};
 
 static brwlock_t reservation_lock;
 
+/*
+ * Devices are created on first use, serialize this for reservations
+ * that only hold the reservation lock shared.
+ */
+static pthread_mutex_t create_device_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Idle elastic devices are looked for at most once per interval */
+static const time_t retire_check_interval = 60;
+static std::atomic<time_t> next_retire_check{0};
+
+/*
+ * Reservation latency statistics shown by the status command.
+ * Jobs are counted by the way their reservation ended.
+ */
+enum
+{
+  RESERVED_FREE_DRIVE = 0, /* free drive, reservation lock shared */
+  RESERVED_SEARCH,         /* search with exclusive reservation lock */
+  RESERVATION_FAILED,
+  NUM_RESERVATION_RESULTS
+};
+
+static const char* reservation_result_names[NUM_RESERVATION_RESULTS] = {
+    "free drive", "search", "failed"};
+
+/* Upper limits of the latency buckets in microseconds */
+static const btime_t reservation_latency_limits[] = {
+    1000, 10000, 100000, 1000000, 10000000, 60000000};
+static const int num_latency_buckets =
+    sizeof(reservation_latency_limits) / sizeof(btime_t) + 1;
+static const char* reservation_latency_names[num_latency_buckets] = {
+    "<1ms", "<10ms", "<100ms", "<1s", "<10s", "<1m", ">=1m"};
+
+static pthread_mutex_t reservation_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t reservation_latency[NUM_RESERVATION_RESULTS]
+                                   [num_latency_buckets];
+static btime_t reservation_latency_max[NUM_RESERVATION_RESULTS];
+
 /* Forward referenced functions */
 static int CanReserveDrive(DeviceControlRecord* dcr, ReserveContext& rctx);
 static int ReserveDevice(ReserveContext& rctx);
@@ -59,6 +101,9 @@ static bool ReserveDeviceForRead(DeviceControlRecord* dcr);
 static bool ReserveDeviceForAppend(DeviceControlRecord* dcr,
                                    ReserveContext& rctx);
 static bool UseDeviceCmd(JobControlRecord* jcr);
+static bool ReserveFreeDeviceForAppend(JobControlRecord* jcr,
+                                       ReserveContext& rctx);
+static bool AddElasticDevice(JobControlRecord* jcr, ReserveContext& rctx);
 static void QueueReserveMessage(JobControlRecord* jcr);
 static void PopReserveMessages(JobControlRecord* jcr);
 // void SwitchDevice(DeviceControlRecord *dcr, Device *dev);
@@ -136,6 +181,86 @@ void _unLockReservations()
   }
 }
 
+/**
+ * Shared reservation lock, held while reserving a drive nobody uses.
+ * Any number of these reservations run in parallel, a search for a drive
+ * with LockReservations() waits until they are done.
+ */
+static void LockReservationsShared()
+{
+  int errstat;
+  if ((errstat = RwlReadlock(&reservation_lock)) != 0) {
+    BErrNo be;
+    Emsg2(M_ABORT, 0, "RwlReadlock failure. stat=%d: ERR=%s\n", errstat,
+          be.bstrerror(errstat));
+  }
+}
+
+static void UnlockReservationsShared()
+{
+  int errstat;
+  if ((errstat = RwlReadunlock(&reservation_lock)) != 0) {
+    BErrNo be;
+    Emsg2(M_ABORT, 0, "RwlReadunlock failure. stat=%d: ERR=%s\n", errstat,
+          be.bstrerror(errstat));
+  }
+}
+
+static void UpdateReservationStats(int result, btime_t latency)
+{
+  int bucket = 0;
+
+  while (bucket < num_latency_buckets - 1 &&
+         latency >= reservation_latency_limits[bucket]) {
+    bucket++;
+  }
+
+  P(reservation_stats_mutex);
+  reservation_latency[result][bucket]++;
+  if (latency > reservation_latency_max[result]) {
+    reservation_latency_max[result] = latency;
+  }
+  V(reservation_stats_mutex);
+}
+
+void ListReservationStats(StatusPacket* sp)
+{
+  PoolMem msg(PM_MESSAGE), line(PM_MESSAGE);
+  uint64_t latency[NUM_RESERVATION_RESULTS][num_latency_buckets];
+  btime_t latency_max[NUM_RESERVATION_RESULTS];
+  char ed1[50];
+  int len;
+
+  P(reservation_stats_mutex);
+  memcpy(latency, reservation_latency, sizeof(latency));
+  memcpy(latency_max, reservation_latency_max, sizeof(latency_max));
+  V(reservation_stats_mutex);
+
+  if (!sp->api) {
+    len = Mmsg(msg, _("Reservation latency:\n"));
+    sp->send(msg, len);
+  }
+
+  PmStrcpy(msg, "           ");
+  for (int bucket = 0; bucket < num_latency_buckets; bucket++) {
+    Mmsg(line, " %7s", reservation_latency_names[bucket]);
+    PmStrcat(msg, line.c_str());
+  }
+  len = PmStrcat(msg, "      max\n");
+  sp->send(msg, len);
+
+  for (int result = 0; result < NUM_RESERVATION_RESULTS; result++) {
+    Mmsg(msg, "%-11s", reservation_result_names[result]);
+    for (int bucket = 0; bucket < num_latency_buckets; bucket++) {
+      Mmsg(line, " %7s", edit_uint64(latency[result][bucket], ed1));
+      PmStrcat(msg, line.c_str());
+    }
+    Mmsg(line, " %7.3fs\n", (double)latency_max[result] / 1000000.0);
+    len = PmStrcat(msg, line.c_str());
+    sp->send(msg, len);
+  }
+}
+
 void DeviceControlRecord::SetReserved()
 {
   reserved_ = true;
@@ -274,6 +399,7 @@ static bool UseDeviceCmd(JobControlRecord* jcr)
     int wait_for_device_retries = 0;
     int repeat = 0;
     bool fail = false;
+    btime_t reserve_start;
     rctx.notify_dir = true;
 
     /*
@@ -285,82 +411,105 @@ static bool UseDeviceCmd(JobControlRecord* jcr)
       rctx.jcr->impl->read_dcr = jcr->impl->dcr;
     }
 
-    LockReservations();
-    for (; !fail && !JobCanceled(jcr);) {
-      PopReserveMessages(jcr);
-      rctx.suitable_device = false;
-      rctx.have_volume = false;
-      rctx.VolumeName[0] = 0;
-      rctx.any_drive = false;
-      if (!jcr->impl->PreferMountedVols) {
+    RetireIdleElasticDevices(time(NULL));
+
+    reserve_start = GetCurrentBtime();
+    if (rctx.append && ReserveFreeDeviceForAppend(jcr, rctx)) {
+      ok = true;
+      UpdateReservationStats(RESERVED_FREE_DRIVE,
+                             GetCurrentBtime() - reserve_start);
+    } else {
+      LockReservations();
+      for (; !fail && !JobCanceled(jcr);) {
+        PopReserveMessages(jcr);
+        rctx.suitable_device = false;
+        rctx.have_volume = false;
+        rctx.VolumeName[0] = 0;
+        rctx.any_drive = false;
+        rctx.volume_in_use = false;
+        if (!jcr->impl->PreferMountedVols) {
+          /*
+           * Here we try to find a drive that is not used.
+           * This will maximize the use of available drives.
+           */
+          rctx.num_writers = 20000000; /* start with impossible number */
+          rctx.low_use_drive = NULL;
+          rctx.PreferMountedVols = false;
+          rctx.exact_match = false;
+          rctx.autochanger_only = true;
+          if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
+
+          /*
+           * Look through all drives possibly for low_use drive
+           */
+          if (rctx.low_use_drive) {
+            rctx.try_low_use_drive = true;
+            if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
+            rctx.try_low_use_drive = false;
+          }
+          rctx.autochanger_only = false;
+          if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
+        }
+
         /*
-         * Here we try to find a drive that is not used.
-         * This will maximize the use of available drives.
+         * Now we look for a drive that may or may not be in use.
+         * Look for an exact Volume match all drives
          */
-        rctx.num_writers = 20000000; /* start with impossible number */
-        rctx.low_use_drive = NULL;
-        rctx.PreferMountedVols = false;
-        rctx.exact_match = false;
-        rctx.autochanger_only = true;
+        rctx.PreferMountedVols = true;
+        rctx.exact_match = true;
+        rctx.autochanger_only = false;
         if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
 
         /*
-         * Look through all drives possibly for low_use drive
+         * Look for any mounted drive
          */
-        if (rctx.low_use_drive) {
-          rctx.try_low_use_drive = true;
-          if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
-          rctx.try_low_use_drive = false;
-        }
-        rctx.autochanger_only = false;
+        rctx.exact_match = false;
         if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
-      }
-
-      /*
-       * Now we look for a drive that may or may not be in use.
-       * Look for an exact Volume match all drives
-       */
-      rctx.PreferMountedVols = true;
-      rctx.exact_match = true;
-      rctx.autochanger_only = false;
-      if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
 
-      /*
-       * Look for any mounted drive
-       */
-      rctx.exact_match = false;
-      if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
+        /*
+         * Try any drive
+         */
+        rctx.any_drive = true;
+        if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
 
-      /*
-       * Try any drive
-       */
-      rctx.any_drive = true;
-      if ((ok = FindSuitableDeviceForJob(jcr, rctx))) { break; }
+        /*
+         * Add a device instead of waiting for a busy one. This only helps
+         * a backup that is not waiting for a volume mounted elsewhere, and
+         * one device per job is enough.
+         */
+        if (rctx.append && rctx.suitable_device && !rctx.volume_in_use &&
+            !rctx.elastic_added && AddElasticDevice(jcr, rctx)) {
+          rctx.elastic_added = true;
+          continue;
+        }
 
-      /*
-       * Keep reservations locked *except* during WaitForDevice()
-       */
-      UnlockReservations();
+        /*
+         * Keep reservations locked *except* during WaitForDevice()
+         */
+        UnlockReservations();
 
-      /*
-       * The idea of looping on repeat a few times it to ensure
-       * that if there is some subtle timing problem between two
-       * jobs, we will simply try again, and most likely succeed.
-       * This can happen if one job reserves a drive or finishes using
-       * a drive at the same time a second job wants it.
-       */
-      if (repeat++ > 1) {   /* try algorithm 3 times */
-        Bmicrosleep(30, 0); /* wait a bit */
-        Dmsg0(debuglevel, "repeat reserve algorithm\n");
-      } else if (!rctx.suitable_device ||
-                 !WaitForDevice(jcr, wait_for_device_retries)) {
-        Dmsg0(debuglevel, "Fail. !suitable_device || !WaitForDevice\n");
-        fail = true;
+        /*
+         * The idea of looping on repeat a few times it to ensure
+         * that if there is some subtle timing problem between two
+         * jobs, we will simply try again, and most likely succeed.
+         * This can happen if one job reserves a drive or finishes using
+         * a drive at the same time a second job wants it.
+         */
+        if (repeat++ > 1) {   /* try algorithm 3 times */
+          Bmicrosleep(30, 0); /* wait a bit */
+          Dmsg0(debuglevel, "repeat reserve algorithm\n");
+        } else if (!rctx.suitable_device ||
+                   !WaitForDevice(jcr, wait_for_device_retries)) {
+          Dmsg0(debuglevel, "Fail. !suitable_device || !WaitForDevice\n");
+          fail = true;
+        }
+        LockReservations();
+        dir->signal(BNET_HEARTBEAT); /* Inform Dir that we are alive */
       }
-      LockReservations();
-      dir->signal(BNET_HEARTBEAT); /* Inform Dir that we are alive */
+      UnlockReservations();
+      UpdateReservationStats(ok ? RESERVED_SEARCH : RESERVATION_FAILED,
+                             GetCurrentBtime() - reserve_start);
     }
-    UnlockReservations();
 
     if (!ok) {
       /*
@@ -388,6 +537,256 @@ static bool UseDeviceCmd(JobControlRecord* jcr)
   return ok;
 }
 
+/**
+ * See if a Volume in use can take another job on its drive.
+ * Such a job may want to share that drive, which only the search
+ * with the exclusive reservation lock handles.
+ */
+static bool IsMountedVolumeAvailable()
+{
+  VolumeReservationItem* vol;
+  bool available = false;
+
+  if (IsVolListEmpty()) { return false; }
+
+  foreach_vol (vol) {
+    Device* dev = vol->dev;
+
+    if (dev && !dev->CanRead() &&
+        (dev->max_concurrent_jobs == 0 ||
+         dev->max_concurrent_jobs >
+             (uint32_t)(dev->num_writers + dev->NumReserved()))) {
+      available = true;
+      break;
+    }
+  }
+  endeach_vol(vol);
+
+  return available;
+}
+
+/**
+ * Try to reserve a drive nobody uses, a device with the given name or a
+ * member of the autochanger with that name.
+ *
+ * Returns: true  if a drive was reserved
+ *          false otherwise
+ */
+static bool ReserveFreeDevice(ReserveContext& rctx)
+{
+  AutochangerResource* changer;
+  DeviceResource* device_resource;
+  alist* device_resources = nullptr;
+  alist single_device(1, not_owned_by_alist);
+
+  foreach_res (changer, R_AUTOCHANGER) {
+    if (bstrcmp(rctx.device_name, changer->resource_name_)) {
+      device_resources = changer->device_resources;
+      break;
+    }
+  }
+
+  if (!device_resources) {
+    foreach_res (device_resource, R_DEVICE) {
+      if (bstrcmp(rctx.device_name, device_resource->resource_name_)) {
+        single_device.append(device_resource);
+        break;
+      }
+    }
+    device_resources = &single_device;
+  }
+
+  foreach_alist (device_resource, device_resources) {
+    Device* dev = device_resource->dev;
+
+    if (!device_resource->autoselect && device_resources != &single_device) {
+      continue;
+    }
+
+    /*
+     * Skip drives that are obviously in use, ReserveDeviceForAppend()
+     * checks again with the device locked.
+     */
+    if (dev && (dev->IsBusy() || (dev->vol && dev->vol->IsInUse()))) {
+      continue;
+    }
+
+    rctx.device_resource = device_resource;
+    if (ReserveDevice(rctx) == 1) {
+      Dmsg1(debuglevel, "Free device %s reserved for append.\n",
+            device_resource->resource_name_);
+      return true;
+    }
+
+    if (rctx.jcr->impl->dcr->IsReserved()) {
+      rctx.jcr->impl->dcr->UnreserveDevice();
+    }
+
+    /*
+     * Our Volume is in use on another drive, the search has to look at
+     * that drive.
+     */
+    if (rctx.PreferMountedVols) { return false; }
+  }
+
+  return false;
+}
+
+/**
+ * Try to reserve a drive nobody uses for an append job.
+ *
+ * This is the common case when many jobs start at the same time on many
+ * (e.g. multiplied) disk devices. These reservations hold the reservation
+ * lock only shared and take the drive while the device is locked, so they
+ * run in parallel without getting the same drive. Everything else, like
+ * sharing a drive or waiting for one, is left to the search in
+ * UseDeviceCmd() which holds the reservation lock exclusively. While such
+ * a search runs or waits, new jobs queue behind it.
+ *
+ * Returns: true  if a drive was reserved
+ *          false if the search is needed
+ */
+static bool ReserveFreeDeviceForAppend(JobControlRecord* jcr,
+                                       ReserveContext& rctx)
+{
+  DirectorStorage* store = nullptr;
+  char* device_name = nullptr;
+  bool ok = false;
+
+  if (reservations_lock_count > 0) { return false; }
+
+  /*
+   * With PreferMountedVols the job would rather share a drive with a
+   * mounted Volume, only take a free drive if no such Volume exists.
+   */
+  if (jcr->impl->PreferMountedVols && IsMountedVolumeAvailable()) {
+    return false;
+  }
+
+  LockReservationsShared();
+  rctx.suitable_device = false;
+  rctx.have_volume = false;
+  rctx.VolumeName[0] = 0;
+  rctx.PreferMountedVols = false;
+  rctx.exact_match = false;
+  rctx.autochanger_only = false;
+  rctx.try_low_use_drive = false;
+  rctx.any_drive = true;
+  rctx.free_drive_only = true;
+
+  foreach_alist (store, jcr->impl->write_store) {
+    rctx.store = store;
+    foreach_alist (device_name, store->device) {
+      rctx.device_name = device_name;
+      if ((ok = ReserveFreeDevice(rctx))) { break; }
+      if (rctx.PreferMountedVols || JobCanceled(jcr)) { break; }
+    }
+    if (ok || rctx.PreferMountedVols || JobCanceled(jcr)) { break; }
+  }
+
+  rctx.free_drive_only = false;
+  rctx.any_drive = false;
+  UnlockReservationsShared();
+
+  return ok;
+}
+
+/**
+ * All drives suitable for a backup are busy. Rather than let the job wait,
+ * activate a retired elastic device (a multiplied device beyond Count) of
+ * an autochanger the Director asked for. Must be called with the
+ * reservation lock held exclusively.
+ *
+ * Returns: true  if a device was added
+ *          false if there is none left
+ */
+static bool AddElasticDevice(JobControlRecord* jcr, ReserveContext& rctx)
+{
+  AutochangerResource* changer;
+  DeviceResource* device_resource;
+  DirectorStorage* store = nullptr;
+  char* device_name = nullptr;
+
+  foreach_alist (store, jcr->impl->write_store) {
+    foreach_alist (device_name, store->device) {
+      foreach_res (changer, R_AUTOCHANGER) {
+        if (!bstrcmp(device_name, changer->resource_name_)) { continue; }
+
+        foreach_alist (device_resource, changer->device_resources) {
+          if (!device_resource->retired || !device_resource->autoselect ||
+              !bstrcmp(device_resource->media_type, store->media_type)) {
+            continue;
+          }
+
+          P(create_device_mutex);
+          if (!device_resource->dev) {
+            device_resource->dev = FactoryCreateDevice(jcr, device_resource);
+          }
+          V(create_device_mutex);
+          if (!device_resource->dev) { continue; }
+
+          device_resource->retired = false;
+          device_resource->idle_since = 0;
+          Jmsg(jcr, M_INFO, 0,
+               _("All devices of autochanger \"%s\" are busy, added device "
+                 "%s.\n"),
+               changer->resource_name_, device_resource->dev->print_name());
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Retire the elastic devices that have been idle for their Retire Idle
+ * Time. A device counts as idle from the first check that finds it
+ * without jobs, a reservation restarts the count.
+ */
+void RetireIdleElasticDevices(time_t now)
+{
+  DeviceResource* device_resource;
+  time_t next_check = next_retire_check;
+
+  /*
+   * Only the thread that moves the next check forward does this check,
+   * the others see the new value and skip it.
+   */
+  if (now < next_check ||
+      !next_retire_check.compare_exchange_strong(
+          next_check, now + retire_check_interval)) {
+    return;
+  }
+
+  LockReservations();
+  foreach_res (device_resource, R_DEVICE) {
+    Device* dev = device_resource->dev;
+
+    if (!device_resource->elastic || device_resource->retired || !dev) {
+      continue;
+    }
+
+    dev->Lock();
+    if (dev->IsBusy() || dev->blocked() != BST_NOT_BLOCKED ||
+        (dev->vol && dev->vol->IsInUse())) {
+      device_resource->idle_since = 0;
+    } else if (device_resource->idle_since == 0) {
+      device_resource->idle_since = now;
+    } else if (now - device_resource->idle_since >=
+               (time_t)device_resource->retire_idle_time) {
+      Dmsg1(debuglevel, "retire idle device %s\n", dev->print_name());
+      FreeVolume(dev);
+      if (dev->IsOpen()) { dev->close(nullptr); }
+      device_resource->retired = true;
+      device_resource->idle_since = 0;
+    }
+    dev->Unlock();
+  }
+  UnlockReservations();
+}
+
 /**
  * Walk through the autochanger resources and check if the volume is in one of
  * them.
@@ -461,6 +860,17 @@ bool FindSuitableDeviceForJob(JobControlRecord* jcr, ReserveContext& rctx)
         continue;
       }
 
+      /*
+       * Don't ask the Director about Volumes on drives running the maximum
+       * number of jobs, we could not reserve them anyway.
+       */
+      if (vol->dev->max_concurrent_jobs > 0 &&
+          vol->dev->max_concurrent_jobs <=
+              (uint32_t)(vol->dev->num_writers + vol->dev->NumReserved())) {
+        Dmsg1(debuglevel, "vol=%s drive at max jobs\n", vol->vol_name);
+        continue;
+      }
+
       /*
        * Check with Director if this Volume is OK
        */
@@ -705,13 +1115,24 @@ static int ReserveDevice(ReserveContext& rctx)
     return -1;
   }
 
+  /*
+   * Elastic devices are only used after AddElasticDevice() activated them
+   */
+  if (rctx.device_resource->retired) {
+    Dmsg1(debuglevel, "device %s is retired\n",
+          rctx.device_resource->resource_name_);
+    return -1;
+  }
+
   /*
    * Make sure device_resource exists -- i.e. we can stat() it
    */
+  P(create_device_mutex);
   if (!rctx.device_resource->dev) {
     rctx.device_resource->dev =
         FactoryCreateDevice(rctx.jcr, rctx.device_resource);
   }
+  V(create_device_mutex);
   if (!rctx.device_resource->dev) {
     if (rctx.device_resource->changer_res) {
       Jmsg(rctx.jcr, M_WARNING, 0,
@@ -795,6 +1216,7 @@ static int ReserveDevice(ReserveContext& rctx)
          * non-used drive and our one and only volume is mounted
          * elsewhere, so we bail out and retry using that drive.
          */
+        if (dcr->FoundInUse()) { rctx.volume_in_use = true; }
         if (dcr->FoundInUse() && !rctx.PreferMountedVols) {
           rctx.PreferMountedVols = true;
           if (dcr->VolumeName[0]) { dcr->UnreserveDevice(); }
@@ -897,6 +1319,7 @@ static bool ReserveDeviceForRead(DeviceControlRecord* dcr)
   dev->ClearAppend();
   dev->SetRead();
   dcr->SetReserved();
+  dev->device_resource->idle_since = 0;
   ok = true;
 
 bail_out:
@@ -954,6 +1377,17 @@ static bool ReserveDeviceForAppend(DeviceControlRecord* dcr,
     goto bail_out;
   }
 
+  /*
+   * Someone else got this drive since we looked at it
+   */
+  if (rctx.free_drive_only &&
+      (dev->IsBusy() || (dev->vol && dev->vol->IsInUse()))) {
+    Mmsg(jcr->errmsg, _("3611 JobId=%u device %s is no longer free.\n"),
+         jcr->JobId, dev->print_name());
+    Dmsg1(debuglevel, "Failed: %s", jcr->errmsg);
+    goto bail_out;
+  }
+
   Dmsg1(debuglevel, "reserve_append device is %s\n", dev->print_name());
 
   /*
@@ -972,6 +1406,7 @@ static bool ReserveDeviceForAppend(DeviceControlRecord* dcr,
     goto bail_out;
   }
   dcr->SetReserved();
+  dev->device_resource->idle_since = 0;
   ok = true;
 
 bail_out:
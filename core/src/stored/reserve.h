@@ -41,6 +41,7 @@
 #define BAREOS_STORED_RESERVE_H_ 1
 
 class alist;
+class StatusPacket;
 
 namespace storagedaemon {
 
@@ -72,6 +73,9 @@ class ReserveContext {
   bool autochanger_only;            /**< look at autochangers only */
   bool notify_dir;                  /**< Notify DIR about device */
   bool append;                      /**< set if append device */
+  bool free_drive_only;             /**< only take a drive nobody uses */
+  bool volume_in_use;               /**< next volume is mounted elsewhere */
+  bool elastic_added;               /**< activated an elastic device */
   char VolumeName[MAX_NAME_LENGTH]; /**< Vol name suggested by DIR */
 };
 
@@ -88,6 +92,8 @@ void UnreserveDevice(DeviceControlRecord* dcr);
 bool FindSuitableDeviceForJob(JobControlRecord* jcr, ReserveContext& rctx);
 int SearchResForDevice(ReserveContext& rctx);
 void ReleaseReserveMessages(JobControlRecord* jcr);
+void ListReservationStats(StatusPacket* sp);
+void RetireIdleElasticDevices(time_t now);
 
 #define LockReservations() _lockReservations(__FILE__, __LINE__)
 #define UnlockReservations() _unLockReservations()
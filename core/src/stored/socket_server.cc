@@ -69,7 +69,13 @@ void* HandleConnectionRequest(ConfigurationParser* config, void* arg)
   BareosSocket* bs = (BareosSocket*)arg;
   char name[MAX_NAME_LENGTH];
   char tbuf[MAX_TIME_LENGTH];
+  int stripe;
 
+  /*
+   * The kind of connection is only known after the TLS handshake, so all
+   * connections accepted by the daemon use the kernel offload if enabled.
+   */
+  bs->SetTlsKernelOffload(me->tls_kernel_offload);
   if (!TryTlsHandshakeAsAServer(bs, config)) {
     bs->signal(BNET_TERMINATE);
     bs->close();
@@ -100,6 +106,16 @@ void* HandleConnectionRequest(ConfigurationParser* config, void* arg)
 
   Dmsg1(110, "Conn: %s", bs->msg);
 
+  /*
+   * See if this is an additional data connection of a File daemon. This must
+   * be checked first as the normal File daemon hello matches it too.
+   */
+  if (sscanf(bs->msg, "Hello Start Job Stripe %d %127s", &stripe, name) == 2) {
+    Dmsg1(110, "Got a FD data connection at %s\n",
+          bstrftimes(tbuf, sizeof(tbuf), (utime_t)time(NULL)));
+    return HandleFiledStripeConnection(bs, name, stripe);
+  }
+
   /*
    * See if this is a File daemon connection. If so call FD handler.
    */
@@ -34,6 +34,7 @@
 #include "stored/device.h"
 #include "stored/device_control_record.h"
 #include "stored/jcr_private.h"
+#include "lib/attr_spool.h"
 #include "lib/berrno.h"
 #include "lib/bsock.h"
 #include "lib/edit.h"
@@ -77,6 +78,7 @@ struct spool_hdr {
   int32_t FirstIndex; /* FirstIndex for buffer */
   int32_t LastIndex;  /* LastIndex for buffer */
   uint32_t len;       /* length of next buffer */
+  uint32_t acl_xattr_blob; /* set if buffer holds an ACL/xattr blob */
 };
 
 enum
@@ -491,6 +493,7 @@ static int ReadBlockFromSpoolFile(DeviceControlRecord* dcr)
   block->bufp = block->buf + block->binbuf;
   block->FirstIndex = hdr.FirstIndex;
   block->LastIndex = hdr.LastIndex;
+  block->acl_xattr_blob = hdr.acl_xattr_blob != 0;
   block->VolSessionId = dcr->jcr->VolSessionId;
   block->VolSessionTime = dcr->jcr->VolSessionTime;
   Dmsg2(800, "Read block FI=%d LI=%d\n", block->FirstIndex, block->LastIndex);
@@ -580,6 +583,7 @@ static bool WriteSpoolHeader(DeviceControlRecord* dcr)
   hdr.FirstIndex = block->FirstIndex;
   hdr.LastIndex = block->LastIndex;
   hdr.len = block->binbuf;
+  hdr.acl_xattr_blob = block->acl_xattr_blob ? 1 : 0;
 
   /* Write header */
   for (int retry = 0; retry <= 1; retry++) {
@@ -761,10 +765,81 @@ static bool BlastAttrSpoolFile(JobControlRecord* jcr, boffset_t size)
   return true;
 }
 
+/**
+ * Add the attributes message in the socket buffer to a compressed
+ * spool file. The front coding of the message starts at anchor.
+ */
+bool WriteCompressedAttributes(JobControlRecord* jcr,
+                               BareosSocket* bs,
+                               int32_t FileIndex,
+                               int32_t anchor)
+{
+  /*
+   * The data end of the socket is a file offset, which means nothing in a
+   * compressed spool file, so the writer keeps it in plain spool file bytes.
+   */
+  if (FileIndex > bs->get_FileIndex()) {
+    bs->SetDataEnd(FileIndex);
+    jcr->impl->attr_spool->SetDataEnd();
+  }
+
+  if (!jcr->impl->attr_spool->Append(bs->msg, bs->message_length, anchor)) {
+    BErrNo be;
+    bs->b_errno = errno;
+    Qmsg1(jcr, M_FATAL, 0, _("Attr spool write error. ERR=%s\n"),
+          be.bstrerror());
+    errno = bs->b_errno;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Send the content of a compressed spool file over the network
+ * message by message, like bsock->despool() does for a plain one.
+ * The messages are sent decompressed, the compression of the spool file
+ * only saves local disk space and what the director reads from a shared
+ * spool directory.
+ */
+static bool DespoolCompressedAttributes(JobControlRecord* jcr,
+                                        BareosSocket* dir,
+                                        boffset_t size)
+{
+  int32_t message_length;
+  bool retval = true;
+
+  if (lseek(dir->spool_fd_, 0, SEEK_SET) == -1) {
+    Qmsg(jcr, M_FATAL, 0, _("attr spool I/O error.\n"));
+    return false;
+  }
+
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+  posix_fadvise(dir->spool_fd_, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+  AttrSpoolReader reader(dir->spool_fd_);
+  while (reader.Next(dir->msg, &message_length)) {
+    dir->message_length = message_length;
+    dir->send();
+    if (JobCanceled(jcr)) {
+      retval = false;
+      break;
+    }
+  }
+
+  if (reader.Error()) {
+    Qmsg(jcr, M_FATAL, 0, _("Error reading compressed attr spool file.\n"));
+    retval = false;
+  }
+  UpdateAttrSpoolSize(size);
+
+  return retval;
+}
+
 bool CommitAttributeSpool(JobControlRecord* jcr)
 {
   boffset_t size, data_end;
-  char ec1[30];
+  char ec1[30], ec2[30];
   char tbuf[MAX_TIME_LENGTH];
   BareosSocket* dir;
 
@@ -772,6 +847,15 @@ bool CommitAttributeSpool(JobControlRecord* jcr)
         bstrftimes(tbuf, sizeof(tbuf), (utime_t)time(NULL)));
   if (AreAttributesSpooled(jcr)) {
     dir = jcr->dir_bsock;
+    if (jcr->impl->attr_spool && !jcr->impl->attr_spool->Flush()) {
+      BErrNo be;
+
+      Jmsg(jcr, M_FATAL, 0, _("Attr spool write error. ERR=%s\n"),
+           be.bstrerror());
+      jcr->forceJobStatus(JS_FatalError); /* override any Incomplete */
+      goto bail_out;
+    }
+
     if ((size = lseek(dir->spool_fd_, 0, SEEK_END)) == -1) {
       BErrNo be;
 
@@ -785,9 +869,23 @@ bool CommitAttributeSpool(JobControlRecord* jcr)
       data_end = dir->get_data_end();
 
       /*
-       * Check and truncate to last valid data_end if necssary
+       * Check and truncate to last valid data_end if necssary, a
+       * compressed spool file gets a limit in plain spool file bytes.
        */
-      if (size > data_end) {
+      if (jcr->impl->attr_spool) {
+        AttrSpoolWriter* attr_spool = jcr->impl->attr_spool;
+
+        if (attr_spool->DataEnd() < attr_spool->PlainSize() &&
+            !attr_spool->SetLimit(attr_spool->DataEnd())) {
+          BErrNo be;
+
+          Jmsg(jcr, M_FATAL, 0,
+               _("Truncate on attributes file failed: ERR=%s\n"),
+               be.bstrerror());
+          jcr->forceJobStatus(JS_FatalError); /* override any Incomplete */
+          goto bail_out;
+        }
+      } else if (size > data_end) {
         if (ftruncate(dir->spool_fd_, data_end) != 0) {
           BErrNo be;
 
@@ -824,11 +922,21 @@ bool CommitAttributeSpool(JobControlRecord* jcr)
          _("Sending spooled attrs to the Director. Despooling %s bytes ...\n"),
          edit_uint64_with_commas(size, ec1));
 
+    if (jcr->impl->attr_spool) {
+      Dmsg2(100, "Compressed attr spool holds %s bytes of attributes in %s\n",
+            edit_uint64(jcr->impl->attr_spool->PlainSize(), ec1),
+            edit_uint64(size, ec2));
+    }
+
     if (!BlastAttrSpoolFile(jcr, size)) {
       /* Can't read spool file from director side,
        * send content over network.
        */
-      dir->despool(UpdateAttrSpoolSize, size);
+      if (jcr->impl->attr_spool) {
+        DespoolCompressedAttributes(jcr, dir, size);
+      } else {
+        dir->despool(UpdateAttrSpoolSize, size);
+      }
     }
     return CloseAttrSpoolFile(jcr, dir);
   }
@@ -861,6 +969,10 @@ static bool OpenAttrSpoolFile(JobControlRecord* jcr, BareosSocket* bs)
 
   FreePoolMemory(name);
 
+  if (jcr->impl->compress_attr_spool) {
+    jcr->impl->attr_spool = new AttrSpoolWriter(bs->spool_fd_);
+  }
+
   return true;
 }
 
@@ -882,6 +994,10 @@ static bool CloseAttrSpoolFile(JobControlRecord* jcr, BareosSocket* bs)
 
   MakeUniqueSpoolFilename(jcr, name, bs->fd_);
 
+  if (jcr->impl->attr_spool) {
+    delete jcr->impl->attr_spool;
+    jcr->impl->attr_spool = nullptr;
+  }
   close(bs->spool_fd_);
   SecureErase(jcr, name);
   FreePoolMemory(name);
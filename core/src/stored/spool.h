@@ -32,6 +32,10 @@ bool AreAttributesSpooled(JobControlRecord* jcr);
 bool BeginAttributeSpool(JobControlRecord* jcr);
 bool DiscardAttributeSpool(JobControlRecord* jcr);
 bool CommitAttributeSpool(JobControlRecord* jcr);
+bool WriteCompressedAttributes(JobControlRecord* jcr,
+                               BareosSocket* bs,
+                               int32_t FileIndex,
+                               int32_t anchor);
 bool WriteBlockToSpoolFile(DeviceControlRecord* dcr);
 void ListSpoolStats(StatusPacket* sp);
 
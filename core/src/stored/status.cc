@@ -118,6 +118,12 @@ static void OutputStatus(JobControlRecord* jcr,
     len = PmStrcpy(msg, "====\n\n");
     sp->send(msg, len);
   }
+
+  ListReservationStats(sp);
+  if (!sp->api) {
+    len = PmStrcpy(msg, "====\n\n");
+    sp->send(msg, len);
+  }
 }
 
 static void ListResources(StatusPacket* sp)
@@ -357,7 +363,11 @@ static void ListDevices(JobControlRecord* jcr,
       trigger_device_status_hook(jcr, device_resource, sp,
                                  bsdEventVolumeStatus);
     } else {
-      if (dev) {
+      if (device_resource->retired) {
+        len = Mmsg(msg, _("\nDevice \"%s\" is retired, added when needed.\n"),
+                   device_resource->resource_name_);
+        sp->send(msg, len);
+      } else if (dev) {
         len = Mmsg(msg, _("\nDevice %s is not open.\n"), dev->print_name());
         sp->send(msg, len);
         SendBlockedStatus(dev, sp);
@@ -1045,6 +1055,9 @@ bool DotstatusCmd(JobControlRecord* jcr)
   } else if (Bstrcasecmp(cmd.c_str(), "spooling")) {
     sp.api = true;
     ListSpoolStats(&sp);
+  } else if (Bstrcasecmp(cmd.c_str(), "reservations")) {
+    sp.api = true;
+    ListReservationStats(&sp);
   } else if (Bstrcasecmp(cmd.c_str(), "terminated")) {
     sp.api = true;
     ListTerminatedJobs(&sp);
@@ -565,6 +565,11 @@ extern "C" void* device_initialization(void* arg)
   }
 
   foreach_res (device_resource, R_DEVICE) {
+    if (device_resource->retired) {
+      Dmsg1(90, "elastic device %s is created on demand\n",
+            device_resource->resource_name_);
+      continue;
+    }
     Dmsg1(90, "calling FactoryCreateDevice %s\n", device_resource->device_name);
     dev = FactoryCreateDevice(NULL, device_resource);
     Dmsg1(10, "SD init done %s\n", device_resource->device_name);
@@ -118,6 +118,10 @@ static ResourceItem store_items[] = {
   {"StatisticsCollectInterval", CFG_TYPE_PINT32, ITEM(res_store, stats_collect_interval), 0, CFG_ITEM_DEFAULT, "30", NULL, NULL},
   {"DeviceReserveByMediaType", CFG_TYPE_BOOL, ITEM(res_store, device_reserve_by_mediatype), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL},
   {"FileDeviceConcurrentRead", CFG_TYPE_BOOL, ITEM(res_store, filedevice_concurrent_read), 0, CFG_ITEM_DEFAULT, "false", NULL, NULL},
+  {"TlsKernelOffload", CFG_TYPE_BOOL, ITEM(res_store, tls_kernel_offload), 0, CFG_ITEM_DEFAULT, "false", "20.0.0-",
+      "Let the kernel encrypt and decrypt the TLS records (kTLS) of the connections accepted by the Storage Daemon "
+      "and of its connections to File Daemons and other Storage Daemons, which saves copying the data through "
+      "OpenSSL. Connections fall back to OpenSSL when the kernel or OpenSSL does not support it."},
   {"SecureEraseCommand", CFG_TYPE_STR, ITEM(res_store, secure_erase_cmdline), 0, 0, NULL, "15.2.1-",
       "Specify command that will be called when bareos unlinks files."},
   {"LogTimestampFormat", CFG_TYPE_STR, ITEM(res_store, log_timestamp_format), 0, 0, NULL, "15.2.3-", NULL},
@@ -199,7 +203,18 @@ static ResourceItem dev_items[] = {
   {"MaximumFileSize", CFG_TYPE_SIZE64, ITEM(res_dev, max_file_size), 0, CFG_ITEM_DEFAULT, "1000000000", NULL, NULL},
   {"VolumeCapacity", CFG_TYPE_SIZE64, ITEM(res_dev, volume_capacity), 0, 0, NULL, NULL, NULL},
   {"MaximumConcurrentJobs", CFG_TYPE_PINT32, ITEM(res_dev, max_concurrent_jobs), 0, 0, NULL, NULL, NULL},
+  {"QueuedWriteBlocks", CFG_TYPE_PINT32, ITEM(res_dev, queued_write_blocks), 0, CFG_ITEM_DEFAULT, "1", "20.0.0-",
+      "Number of full blocks a backup job collects before it locks the device and writes them all at once. "
+      "Raising it reduces lock contention when many jobs write interleaved to the same device."},
   {"SpoolDirectory", CFG_TYPE_DIR, ITEM(res_dev, spool_directory), 0, 0, NULL, NULL, NULL},
+  {"VolumeIndexDirectory", CFG_TYPE_DIR, ITEM(res_dev, volume_index_directory), 0, 0, NULL, "20.0.0-",
+      "Directory where a small index is kept for every volume written by this device. "
+      "It lets the Storage Daemon position to the end of data without asking the backend for the volume size "
+      "and lets bls and bextract skip to the sessions selected by a bootstrap file."},
+  {"VolumeIndexInterval", CFG_TYPE_SIZE64, ITEM(res_dev, volume_index_interval), 0, CFG_ITEM_DEFAULT, "16777216",
+      "20.0.0-",
+      "A job adds the position of one of its blocks to the volume index every this many bytes written to the volume. "
+      "Restores use these positions to skip to the files they need. Only used with a Volume Index Directory."},
   {"MaximumSpoolSize", CFG_TYPE_SIZE64, ITEM(res_dev, max_spool_size), 0, 0, NULL, NULL, NULL},
   {"MaximumJobSpoolSize", CFG_TYPE_SIZE64, ITEM(res_dev, max_job_spool_size), 0, 0, NULL, NULL, NULL},
   {"DriveIndex", CFG_TYPE_PINT16, ITEM(res_dev, drive_index), 0, 0, NULL, NULL, NULL},
@@ -225,6 +240,12 @@ static ResourceItem dev_items[] = {
   {"Count", CFG_TYPE_PINT32, ITEM(res_dev, count), 0, CFG_ITEM_DEFAULT, "1", NULL, "If Count is set to (1 < Count < 10000), "
   "this resource will be multiplied Count times. The names of multiplied resources will have a serial number (0001, 0002, ...) attached. "
   "If set to 1 only this single resource will be used and its name will not be altered."},
+  {"MaximumCount", CFG_TYPE_PINT32, ITEM(res_dev, maximum_count), 0, CFG_ITEM_DEFAULT, "0", "20.0.0-",
+      "If set to a value greater than Count, up to MaximumCount multiplied devices are available. "
+      "The devices beyond Count are only used when all other devices of the autochanger are busy "
+      "and are retired again when they have been idle for RetireIdleTime."},
+  {"RetireIdleTime", CFG_TYPE_TIME, ITEM(res_dev, retire_idle_time), 0, CFG_ITEM_DEFAULT, "600" /* 10 minutes */, "20.0.0-",
+      "Time a multiplied device beyond Count has to be idle before it is retired."},
   {nullptr, 0, 0, nullptr, 0, 0, nullptr, nullptr, nullptr}
 };
 
@@ -494,14 +515,21 @@ static void MultiplyDevice(DeviceResource& multiplied_device_resource)
 {
   /* append 0001 to the name of the existing resource */
   multiplied_device_resource.CreateAndAssignSerialNumber(1);
+  my_config->ResourceRenamed(multiplied_device_resource.rcode_);
 
   multiplied_device_resource.multiplied_device_resource =
       std::addressof(multiplied_device_resource);
 
   uint32_t count = multiplied_device_resource.count - 1;
+  uint32_t maximum_count = multiplied_device_resource.maximum_count;
+  if (maximum_count > multiplied_device_resource.count) {
+    maximum_count = maximum_count - 1;
+  } else {
+    maximum_count = count;
+  }
 
   /* create the copied devices */
-  for (uint32_t i = 0; i < count; i++) {
+  for (uint32_t i = 0; i < maximum_count; i++) {
     DeviceResource* copied_device_resource =
         new DeviceResource(multiplied_device_resource);
 
@@ -511,6 +539,13 @@ static void MultiplyDevice(DeviceResource& multiplied_device_resource)
     copied_device_resource->multiplied_device_resource =
         std::addressof(multiplied_device_resource);
     copied_device_resource->count = 0;
+    copied_device_resource->maximum_count = 0;
+
+    /* devices beyond Count are added on demand */
+    if (i >= count) {
+      copied_device_resource->elastic = true;
+      copied_device_resource->retired = true;
+    }
 
     my_config->AppendToResourcesChain(copied_device_resource,
                                       copied_device_resource->rcode_);
@@ -529,7 +564,7 @@ static void MultiplyConfiguredDevices(ConfigurationParser& my_config)
   BareosResource* p = nullptr;
   while ((p = my_config.GetNextRes(R_DEVICE, p))) {
     DeviceResource& d = dynamic_cast<DeviceResource&>(*p);
-    if (d.count > 1) { MultiplyDevice(d); }
+    if (d.count > 1 || d.maximum_count > d.count) { MultiplyDevice(d); }
   }
 }
 
@@ -947,6 +982,7 @@ static void FreeResource(BareosResource* res, int type)
       if (p->changer_command) { free(p->changer_command); }
       if (p->alert_command) { free(p->alert_command); }
       if (p->spool_directory) { free(p->spool_directory); }
+      if (p->volume_index_directory) { free(p->volume_index_directory); }
       if (p->mount_point) { free(p->mount_point); }
       if (p->mount_command) { free(p->mount_command); }
       if (p->unmount_command) { free(p->unmount_command); }
@@ -133,6 +133,7 @@ class StorageResource
                                        on a matching mediatype */
   bool filedevice_concurrent_read = false;  /**< Allow filedevices to be read
                                        concurrently */
+  bool tls_kernel_offload = false; /**< Use kTLS for data connections */
   char* verid = nullptr; /**< Custom Id to print in version command */
   char* secure_erase_cmdline = nullptr; /**< Cmdline to execute to perform
                                  secure erase of file */
@@ -0,0 +1,747 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Sidecar index of a volume
+ *
+ * When a Volume Index Directory is configured for a device, a small text
+ * file <VolumeName>.idx is kept there for every volume written. It holds
+ * the end of data of the volume and the address range of every session
+ * written to it. The file is always replaced as a whole (write to a
+ * temporary file, then rename) so it is never seen half written.
+ *
+ * While jobs append to a volume the index is marked dirty. When the last
+ * writer releases the volume the end of data is stored and the index is
+ * marked clean. A clean index whose end of data matches the catalog lets
+ * Device::eod() seek there directly instead of asking the backend for the
+ * size of the volume, which is expensive for chunked volumes. Plain file
+ * volumes always seek to their real end, so is_eod_valid() still notices a
+ * volume changed outside of Bareos. The session
+ * ranges let bls and bextract skip to the sessions a bootstrap file asks
+ * for when it has no volume addresses.
+ *
+ * Next to it, <VolumeName>.blk lists the address and the FileIndex range
+ * of one block of a session every Volume Index Interval bytes and of every
+ * block holding an ACL/xattr blob record. Writers collect these lines and
+ * append them whenever a JobMedia record is created. A restore uses it to
+ * start reading at the last listed block before the first file it wants
+ * instead of at the start of the JobMedia range, but never after a blob
+ * block of the session it has not read yet.
+ */
+
+#include "include/bareos.h"
+#include "stored/stored.h"
+#include "stored/bsr.h"
+#include "stored/block.h"
+#include "stored/device_control_record.h"
+#include "stored/match_bsr.h"
+#include "stored/volume_index.h"
+#include "lib/edit.h"
+#include "lib/berrno.h"
+#include "lib/scan.h"
+#include "include/jcr.h"
+
+#include <algorithm>
+
+namespace storagedaemon {
+
+static const int debuglevel = 150;
+
+static const char* volume_index_header = "BareosVolumeIndex 1\n";
+static const char* volume_block_index_header = "BareosVolumeBlockIndex 1\n";
+
+/* Serializes all updates of index files */
+static pthread_mutex_t volume_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void MakeVolumeIndexFilename(const char* directory,
+                                    const char* volume_name,
+                                    PoolMem& path)
+{
+  Mmsg(path, "%s/%s.idx", directory, volume_name);
+}
+
+static void MakeVolumeBlockIndexFilename(const char* directory,
+                                         const char* volume_name,
+                                         PoolMem& path)
+{
+  Mmsg(path, "%s/%s.blk", directory, volume_name);
+}
+
+/* Order of VolumeIndex::block_index: by session, then by address */
+static bool BlockIndexBefore(const VolumeIndexBlock& a,
+                             const VolumeIndexBlock& b)
+{
+  if (a.VolSessionTime != b.VolSessionTime) {
+    return a.VolSessionTime < b.VolSessionTime;
+  }
+  if (a.VolSessionId != b.VolSessionId) {
+    return a.VolSessionId < b.VolSessionId;
+  }
+  return a.addr < b.addr;
+}
+
+/**
+ * Merge a session range into the index, a session written in several
+ * parts (e.g. one JobMedia record per file) gets one entry.
+ */
+void VolumeIndex::AddSession(const VolumeIndexSession& session)
+{
+  for (auto& s : sessions) {
+    if (s.VolSessionId == session.VolSessionId &&
+        s.VolSessionTime == session.VolSessionTime) {
+      if (session.start_addr < s.start_addr) {
+        s.start_addr = session.start_addr;
+      }
+      if (session.end_addr > s.end_addr) { s.end_addr = session.end_addr; }
+      return;
+    }
+  }
+  sessions.push_back(session);
+}
+
+/**
+ * Read the index of a volume.
+ *
+ * Returns: true  if the index exists and belongs to the volume
+ *          false otherwise
+ */
+bool LoadVolumeIndex(const char* directory,
+                     const char* volume_name,
+                     VolumeIndex& index)
+{
+  PoolMem path(PM_FNAME);
+  PoolMem line(PM_MESSAGE);
+  FILE* fp;
+  bool ok = false;
+
+  index = VolumeIndex{};
+  MakeVolumeIndexFilename(directory, volume_name, path);
+  if (!(fp = fopen(path.c_str(), "r"))) {
+    Dmsg1(debuglevel, "No volume index %s\n", path.c_str());
+    return false;
+  }
+
+  if (!bfgets(line.addr(), fp) || !bstrcmp(line.c_str(), volume_index_header)) {
+    Dmsg1(debuglevel, "Bad header in volume index %s\n", path.c_str());
+    goto bail_out;
+  }
+
+  while (bfgets(line.addr(), fp)) {
+    char* p = line.c_str();
+
+    StripTrailingNewline(p);
+    if (bstrncmp(p, "Volume ", 7)) {
+      index.volume_name = p + 7;
+    } else if (bstrncmp(p, "Eod ", 4)) {
+      uint32_t clean;
+
+      if (sscanf(p, "Eod %u %llu %u %u", &clean, &index.eod_addr,
+                 &index.blocks, &index.files) != 4) {
+        goto bail_out;
+      }
+      index.clean = clean != 0;
+    } else if (bstrncmp(p, "Session ", 8)) {
+      VolumeIndexSession session;
+
+      if (sscanf(p, "Session %u %u %u %llu %llu", &session.VolSessionId,
+                 &session.VolSessionTime, &session.JobId, &session.start_addr,
+                 &session.end_addr) != 5) {
+        goto bail_out;
+      }
+      index.sessions.push_back(session);
+    }
+  }
+
+  if (index.volume_name != volume_name) {
+    Dmsg2(debuglevel, "Volume index %s is for volume %s\n", path.c_str(),
+          index.volume_name.c_str());
+    goto bail_out;
+  }
+  ok = true;
+
+bail_out:
+  fclose(fp);
+  if (!ok) { index = VolumeIndex{}; }
+  return ok;
+}
+
+/**
+ * Write the index of a volume, replacing the old one at once.
+ */
+bool SaveVolumeIndex(const char* directory, const VolumeIndex& index)
+{
+  PoolMem path(PM_FNAME);
+  PoolMem tmp_path(PM_FNAME);
+  char ed1[50], ed2[50];
+  FILE* fp;
+  bool ok;
+
+  MakeVolumeIndexFilename(directory, index.volume_name.c_str(), path);
+  Mmsg(tmp_path, "%s.tmp", path.c_str());
+  if (!(fp = fopen(tmp_path.c_str(), "w"))) {
+    BErrNo be;
+    Dmsg2(debuglevel, "Cannot create volume index %s: ERR=%s\n",
+          tmp_path.c_str(), be.bstrerror());
+    return false;
+  }
+
+  fputs(volume_index_header, fp);
+  fprintf(fp, "Volume %s\n", index.volume_name.c_str());
+  fprintf(fp, "Eod %u %s %u %u\n", index.clean ? 1 : 0,
+          edit_uint64(index.eod_addr, ed1), index.blocks, index.files);
+  for (const auto& s : index.sessions) {
+    fprintf(fp, "Session %u %u %u %s %s\n", s.VolSessionId, s.VolSessionTime,
+            s.JobId, edit_uint64(s.start_addr, ed1),
+            edit_uint64(s.end_addr, ed2));
+  }
+
+  ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+  if (fclose(fp) != 0) { ok = false; }
+  if (ok && rename(tmp_path.c_str(), path.c_str()) != 0) { ok = false; }
+  if (!ok) {
+    BErrNo be;
+    Dmsg2(debuglevel, "Cannot write volume index %s: ERR=%s\n", path.c_str(),
+          be.bstrerror());
+    unlink(tmp_path.c_str());
+  }
+
+  return ok;
+}
+
+void RemoveVolumeIndex(const char* directory, const char* volume_name)
+{
+  PoolMem path(PM_FNAME);
+
+  MakeVolumeIndexFilename(directory, volume_name, path);
+  if (unlink(path.c_str()) == 0) {
+    Dmsg1(debuglevel, "Removed volume index %s\n", path.c_str());
+  }
+  MakeVolumeBlockIndexFilename(directory, volume_name, path);
+  unlink(path.c_str());
+}
+
+/**
+ * Read the block index of the volume named in the index.
+ *
+ * Returns: true  if the block index was read
+ *          false otherwise, index.block_index is empty then
+ */
+bool LoadVolumeBlockIndex(const char* directory, VolumeIndex& index)
+{
+  PoolMem path(PM_FNAME);
+  PoolMem line(PM_MESSAGE);
+  FILE* fp;
+  bool ok = false;
+
+  index.block_index.clear();
+  index.blob_blocks.clear();
+  MakeVolumeBlockIndexFilename(directory, index.volume_name.c_str(), path);
+  if (!(fp = fopen(path.c_str(), "r"))) { return false; }
+
+  if (!bfgets(line.addr(), fp) ||
+      !bstrcmp(line.c_str(), volume_block_index_header)) {
+    Dmsg1(debuglevel, "Bad header in volume block index %s\n", path.c_str());
+    goto bail_out;
+  }
+
+  while (bfgets(line.addr(), fp)) {
+    char* p = line.c_str();
+    VolumeIndexBlock entry;
+    uint32_t blob;
+
+    if (!bstrncmp(p, "Block ", 6)) { continue; }
+    /*
+     * A line cut short by a crash while it was appended is skipped
+     */
+    if (sscanf(p, "Block %u %u %d %d %llu %u", &entry.VolSessionId,
+               &entry.VolSessionTime, &entry.FirstIndex, &entry.LastIndex,
+               &entry.addr, &blob) != 6 ||
+        !strchr(p, '\n') || entry.FirstIndex <= 0) {
+      continue;
+    }
+    entry.acl_xattr_blob = blob != 0;
+    index.block_index.push_back(entry);
+    if (entry.acl_xattr_blob) { index.blob_blocks.push_back(entry); }
+  }
+  std::sort(index.block_index.begin(), index.block_index.end(),
+            BlockIndexBefore);
+  std::sort(index.blob_blocks.begin(), index.blob_blocks.end(),
+            BlockIndexBefore);
+  ok = true;
+
+bail_out:
+  fclose(fp);
+  if (!ok) {
+    index.block_index.clear();
+    index.blob_blocks.clear();
+  }
+  return ok;
+}
+
+/**
+ * Add blocks to the block index of a volume.
+ */
+bool AppendVolumeBlockIndex(const char* directory,
+                            const char* volume_name,
+                            const std::vector<VolumeIndexBlock>& entries)
+{
+  PoolMem path(PM_FNAME);
+  char ed1[50];
+  FILE* fp;
+  bool ok;
+
+  MakeVolumeBlockIndexFilename(directory, volume_name, path);
+  if (!(fp = fopen(path.c_str(), "a"))) {
+    BErrNo be;
+    Dmsg2(debuglevel, "Cannot open volume block index %s: ERR=%s\n",
+          path.c_str(), be.bstrerror());
+    return false;
+  }
+
+  if (ftell(fp) == 0) { fputs(volume_block_index_header, fp); }
+  for (const auto& entry : entries) {
+    fprintf(fp, "Block %u %u %d %d %s %d\n", entry.VolSessionId,
+            entry.VolSessionTime, entry.FirstIndex, entry.LastIndex,
+            edit_uint64(entry.addr, ed1), entry.acl_xattr_blob ? 1 : 0);
+  }
+  ok = fclose(fp) == 0;
+
+  return ok;
+}
+
+static bool BsrMatchesSession(BootStrapRecord* bsr,
+                              const VolumeIndexSession& session)
+{
+  if (bsr->sessid) {
+    bool found = false;
+
+    for (BsrSessionId* sid = bsr->sessid; sid; sid = sid->next) {
+      if (session.VolSessionId >= sid->sessid &&
+          session.VolSessionId <= sid->sessid2) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) { return false; }
+  }
+
+  if (bsr->sesstime) {
+    bool found = false;
+
+    for (BsrSessionTime* stime = bsr->sesstime; stime; stime = stime->next) {
+      if (session.VolSessionTime == stime->sesstime) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) { return false; }
+  }
+
+  if (bsr->JobId) {
+    bool found = false;
+
+    for (BsrJobid* job = bsr->JobId; job; job = job->next) {
+      if (session.JobId >= job->JobId && session.JobId <= job->JobId2) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) { return false; }
+  }
+
+  return true;
+}
+
+static bool BsrIsForVolume(BootStrapRecord* bsr, const char* volume_name)
+{
+  for (BsrVolume* volume = bsr->volume; volume; volume = volume->next) {
+    if (bstrcmp(volume->VolumeName, volume_name)) { return true; }
+  }
+  return false;
+}
+
+/**
+ * The smallest FileIndex the bootstrap record still wants, 0 for all.
+ */
+static int32_t FirstWantedFileIndex(BootStrapRecord* bsr)
+{
+  int32_t first = 0;
+
+  if (bsr->findex_table) {
+    const auto& ranges = bsr->findex_table->ranges;
+
+    if (bsr->findex_table->done_upto < ranges.size()) {
+      return ranges[bsr->findex_table->done_upto].first;
+    }
+    return 0;
+  }
+
+  for (BsrFileIndex* fi = bsr->FileIndex; fi; fi = fi->next) {
+    if (fi->done) { continue; }
+    if (first == 0 || fi->findex < first) { first = fi->findex; }
+  }
+  return first;
+}
+
+/**
+ * Where to start reading a session for the files from first_findex on:
+ * the last indexed block of the session that starts with an earlier file,
+ * as FileIndexes only grow within a session. The earliest blob block of
+ * the session from from_addr on comes first, as the files wanted may
+ * reference the blobs it holds.
+ */
+static uint64_t GetSessionStartAddr(const VolumeIndex& index,
+                                    const VolumeIndexSession& session,
+                                    int32_t first_findex,
+                                    uint64_t from_addr)
+{
+  uint64_t addr = session.start_addr;
+  VolumeIndexBlock key;
+
+  if (first_findex <= 0 || index.block_index.empty()) { return addr; }
+
+  key.VolSessionId = session.VolSessionId;
+  key.VolSessionTime = session.VolSessionTime;
+  auto first = std::lower_bound(index.block_index.begin(),
+                                index.block_index.end(), key,
+                                BlockIndexBefore);
+  auto last = std::partition_point(
+      first, index.block_index.end(), [&](const VolumeIndexBlock& b) {
+        return b.VolSessionTime == session.VolSessionTime &&
+               b.VolSessionId == session.VolSessionId &&
+               b.FirstIndex < first_findex;
+      });
+
+  if (last != first && std::prev(last)->addr > addr) {
+    addr = std::prev(last)->addr;
+  }
+
+  key.addr = from_addr;
+  auto blob = std::lower_bound(index.blob_blocks.begin(),
+                               index.blob_blocks.end(), key,
+                               BlockIndexBefore);
+  if (blob != index.blob_blocks.end() &&
+      blob->VolSessionTime == session.VolSessionTime &&
+      blob->VolSessionId == session.VolSessionId && blob->addr < addr) {
+    addr = blob->addr;
+  }
+  return addr;
+}
+
+/**
+ * Find the address where reading this volume can start for the bootstrap
+ * records that are not done yet.
+ *
+ * A bootstrap record starts at its first volume address, moved forward to
+ * the first matching session the index knows and, with the block index,
+ * to the last block before the first file it wants. Blob blocks before
+ * from_addr are taken as read already.
+ *
+ * Returns: the smallest such address over all bootstrap records
+ *          0 if the whole volume has to be read, e.g. because a bsr does
+ *          not select sessions or selects one the index does not know
+ */
+uint64_t GetVolumeIndexStartAddr(const VolumeIndex& index,
+                                 BootStrapRecord* root_bsr,
+                                 uint64_t from_addr)
+{
+  uint64_t start_addr = 0;
+  bool have_addr = false;
+
+  for (BootStrapRecord* bsr = root_bsr; bsr; bsr = bsr->next) {
+    uint64_t bsr_addr, session_addr = 0;
+    bool found = false;
+
+    if (bsr->done || !BsrIsForVolume(bsr, index.volume_name.c_str())) {
+      continue;
+    }
+
+    bsr_addr = GetBsrStartAddr(bsr, nullptr, nullptr);
+    if (bsr->sessid || bsr->sesstime || bsr->JobId) {
+      int32_t first_findex = FirstWantedFileIndex(bsr);
+
+      for (const auto& s : index.sessions) {
+        uint64_t addr;
+
+        if (!BsrMatchesSession(bsr, s)) { continue; }
+        addr = GetSessionStartAddr(index, s, first_findex, from_addr);
+        if (!found || addr < session_addr) { session_addr = addr; }
+        found = true;
+      }
+    }
+    if (found && session_addr > bsr_addr) { bsr_addr = session_addr; }
+    if (bsr_addr == 0) { return 0; }
+
+    if (!have_addr || bsr_addr < start_addr) {
+      start_addr = bsr_addr;
+      have_addr = true;
+    }
+  }
+
+  return start_addr;
+}
+
+static const char* VolumeIndexDirectory(DeviceControlRecord* dcr)
+{
+  if (!dcr || !dcr->dev || !dcr->dev->device_resource) { return nullptr; }
+  if (dcr->dev->IsTape() || dcr->dev->IsFifo()) { return nullptr; }
+  return dcr->dev->device_resource->volume_index_directory;
+}
+
+/**
+ * Get the end of data of the mounted volume from a clean index that
+ * agrees with the catalog. Not used for plain files, where the real end
+ * is a single lseek() away and is what the catalog gets checked against.
+ */
+bool GetVolumeIndexEod(DeviceControlRecord* dcr, uint64_t* addr)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+  Device* dev;
+  VolumeIndex index;
+  bool ok;
+
+  if (!directory) { return false; }
+  dev = dcr->dev;
+  if (dev->dev_type == DeviceType::B_FILE_DEV) { return false; }
+
+  P(volume_index_mutex);
+  ok = LoadVolumeIndex(directory, dev->VolHdr.VolumeName, index);
+  V(volume_index_mutex);
+
+  if (!ok || !index.clean || index.eod_addr == 0 ||
+      index.eod_addr != dev->VolCatInfo.VolCatBytes) {
+    Dmsg2(debuglevel, "Volume index of %s not usable for eod clean=%d\n",
+          dev->VolHdr.VolumeName, index.clean);
+    return false;
+  }
+
+  *addr = index.eod_addr;
+  return true;
+}
+
+/**
+ * A volume is mounted for append, mark its index dirty until the last
+ * writer releases it.
+ */
+void VolumeIndexStartAppend(DeviceControlRecord* dcr)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+  Device* dev;
+  VolumeIndex index;
+
+  if (!directory) { return; }
+  dev = dcr->dev;
+  VolumeIndexFlushBlocks(dcr);
+  dcr->volume_index_next = 0;
+
+  P(volume_index_mutex);
+  if (!LoadVolumeIndex(directory, dev->VolHdr.VolumeName, index)) {
+    index.volume_name = dev->VolHdr.VolumeName;
+  }
+  index.clean = false;
+  if (!SaveVolumeIndex(directory, index)) {
+    Jmsg(dcr->jcr, M_WARNING, 0, _("Could not write volume index for %s.\n"),
+         dev->VolHdr.VolumeName);
+  }
+  V(volume_index_mutex);
+}
+
+/**
+ * Nobody appends to the volume any more, store its end of data.
+ */
+void VolumeIndexEndAppend(DeviceControlRecord* dcr)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+  Device* dev;
+  VolumeIndex index;
+
+  if (!directory) { return; }
+  dev = dcr->dev;
+  VolumeIndexFlushBlocks(dcr);
+
+  P(volume_index_mutex);
+  if (!LoadVolumeIndex(directory, dev->VolHdr.VolumeName, index)) {
+    index.volume_name = dev->VolHdr.VolumeName;
+  }
+  index.eod_addr = dev->VolCatInfo.VolCatBytes;
+  index.blocks = dev->VolCatInfo.VolCatBlocks;
+  index.files = dev->VolCatInfo.VolCatFiles;
+
+  /*
+   * Only trust the end of data if the device is positioned there
+   */
+  index.clean = dev->file_addr == index.eod_addr;
+  SaveVolumeIndex(directory, index);
+  V(volume_index_mutex);
+}
+
+/**
+ * Record the part of the volume a JobMedia record was created for, along
+ * with the blocks indexed since the last one.
+ */
+void VolumeIndexAddJobMedia(DeviceControlRecord* dcr)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+  Device* dev;
+  VolumeIndex index;
+  VolumeIndexSession session;
+
+  if (!directory) { return; }
+  dev = dcr->dev;
+  VolumeIndexFlushBlocks(dcr);
+
+  session.VolSessionId = dcr->jcr->VolSessionId;
+  session.VolSessionTime = dcr->jcr->VolSessionTime;
+  session.JobId = dcr->jcr->JobId;
+  session.start_addr = (((uint64_t)dcr->StartFile) << 32) | dcr->StartBlock;
+  session.end_addr = (((uint64_t)dcr->EndFile) << 32) | dcr->EndBlock;
+
+  P(volume_index_mutex);
+  if (!LoadVolumeIndex(directory, dev->VolHdr.VolumeName, index)) {
+    index.volume_name = dev->VolHdr.VolumeName;
+  }
+  index.clean = false;
+  index.AddSession(session);
+  SaveVolumeIndex(directory, index);
+  V(volume_index_mutex);
+}
+
+/**
+ * A block was written at addr, add it to the block index if the job wrote
+ * Volume Index Interval bytes to the volume since it added the last one.
+ * The entry is kept in the dcr until VolumeIndexFlushBlocks().
+ */
+void VolumeIndexAddBlock(DeviceControlRecord* dcr,
+                         DeviceBlock* block,
+                         uint64_t addr)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+  const char* volume_name;
+  VolumeIndexBlockBuffer* buffer;
+  VolumeIndexBlock entry;
+
+  if (!directory || block->FirstIndex <= 0) { return; }
+  if (addr < dcr->volume_index_next && !block->acl_xattr_blob) { return; }
+
+  if (!dcr->volume_index_blocks) {
+    dcr->volume_index_blocks = new VolumeIndexBlockBuffer;
+  }
+  buffer = dcr->volume_index_blocks;
+  volume_name = dcr->dev->VolHdr.VolumeName;
+  if (buffer->volume_name != volume_name || buffer->directory != directory) {
+    VolumeIndexFlushBlocks(dcr);
+    buffer->directory = directory;
+    buffer->volume_name = volume_name;
+  }
+
+  entry.VolSessionId = dcr->jcr->VolSessionId;
+  entry.VolSessionTime = dcr->jcr->VolSessionTime;
+  entry.FirstIndex = block->FirstIndex;
+  entry.LastIndex = block->LastIndex;
+  entry.addr = addr;
+  entry.acl_xattr_blob = block->acl_xattr_blob;
+  buffer->blocks.push_back(entry);
+
+  dcr->volume_index_next =
+      addr + dcr->dev->device_resource->volume_index_interval;
+}
+
+/**
+ * Append the blocks the dcr indexed to the block index of their volume.
+ */
+void VolumeIndexFlushBlocks(DeviceControlRecord* dcr)
+{
+  VolumeIndexBlockBuffer* buffer = dcr->volume_index_blocks;
+
+  if (!buffer || buffer->blocks.empty()) { return; }
+
+  P(volume_index_mutex);
+  AppendVolumeBlockIndex(buffer->directory.c_str(),
+                         buffer->volume_name.c_str(), buffer->blocks);
+  V(volume_index_mutex);
+  buffer->blocks.clear();
+}
+
+/**
+ * The volume is (re)labeled, everything the index knew is gone.
+ */
+void VolumeIndexRemove(DeviceControlRecord* dcr, const char* volume_name)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+
+  if (!directory) { return; }
+
+  if (dcr->volume_index_blocks &&
+      dcr->volume_index_blocks->volume_name == volume_name) {
+    dcr->volume_index_blocks->blocks.clear();
+  }
+
+  P(volume_index_mutex);
+  RemoveVolumeIndex(directory, volume_name);
+  V(volume_index_mutex);
+}
+
+/**
+ * Where to start reading the mounted volume for the given bootstrap
+ * records, see GetVolumeIndexStartAddr().
+ */
+uint64_t VolumeIndexStartAddr(DeviceControlRecord* dcr,
+                              BootStrapRecord* root_bsr,
+                              uint64_t from_addr)
+{
+  const char* directory = VolumeIndexDirectory(dcr);
+  const char* volume_name;
+
+  if (!directory || !root_bsr) { return 0; }
+  volume_name = dcr->dev->VolHdr.VolumeName;
+
+  /*
+   * Keep the index of the volume read, this is asked every time a
+   * bootstrap record is done.
+   */
+  if (!dcr->volume_index || dcr->volume_index->volume_name != volume_name) {
+    if (!dcr->volume_index) { dcr->volume_index = new VolumeIndex; }
+
+    P(volume_index_mutex);
+    if (LoadVolumeIndex(directory, volume_name, *dcr->volume_index)) {
+      LoadVolumeBlockIndex(directory, *dcr->volume_index);
+    }
+    V(volume_index_mutex);
+    dcr->volume_index->volume_name = volume_name;
+  }
+  if (dcr->volume_index->sessions.empty()) { return 0; }
+
+  return GetVolumeIndexStartAddr(*dcr->volume_index, root_bsr, from_addr);
+}
+
+/**
+ * See if the block index of the volume read by VolumeIndexStartAddr() can
+ * move the reader forward between two wanted files.
+ */
+bool VolumeIndexHasBlocks(DeviceControlRecord* dcr)
+{
+  if (!VolumeIndexDirectory(dcr) || !dcr->volume_index) { return false; }
+
+  return dcr->volume_index->volume_name == dcr->dev->VolHdr.VolumeName &&
+         !dcr->volume_index->block_index.empty();
+}
+
+} /* namespace storagedaemon */
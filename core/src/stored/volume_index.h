@@ -0,0 +1,116 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+/**
+ * @file
+ * Sidecar index of a volume, kept in the Volume Index Directory
+ */
+
+#ifndef BAREOS_STORED_VOLUME_INDEX_H_
+#define BAREOS_STORED_VOLUME_INDEX_H_
+
+#include <string>
+#include <vector>
+
+namespace storagedaemon {
+
+class DeviceControlRecord;
+struct DeviceBlock;
+struct BootStrapRecord;
+
+/* Part of a volume written by one session (job) */
+struct VolumeIndexSession {
+  uint32_t VolSessionId{0};
+  uint32_t VolSessionTime{0};
+  uint32_t JobId{0};
+  uint64_t start_addr{0}; /**< first block written by the session */
+  uint64_t end_addr{0};   /**< last byte written by the session */
+};
+
+/*
+ * A block written by a session, kept every Volume Index Interval bytes so
+ * a restore can start close to the first file it needs. Blocks holding an
+ * ACL/xattr blob are always kept as a restore must not skip them.
+ */
+struct VolumeIndexBlock {
+  uint32_t VolSessionId{0};
+  uint32_t VolSessionTime{0};
+  int32_t FirstIndex{0}; /**< first FileIndex of a data record in the block */
+  int32_t LastIndex{0};  /**< last FileIndex of a data record in the block */
+  uint64_t addr{0};      /**< start of the block */
+  bool acl_xattr_blob{false};
+};
+
+/*
+ * Blocks a writer indexed but did not add to the block index file yet.
+ */
+struct VolumeIndexBlockBuffer {
+  std::string directory;
+  std::string volume_name;
+  std::vector<VolumeIndexBlock> blocks;
+};
+
+/*
+ * What the index knows about a volume. The end of data is only valid
+ * when the index is clean, i.e. nobody appended since it was stored.
+ */
+struct VolumeIndex {
+  std::string volume_name;
+  bool clean{false};
+  uint64_t eod_addr{0}; /**< end of data */
+  uint32_t blocks{0};   /**< number of blocks on the volume */
+  uint32_t files{0};    /**< number of files on the volume */
+  std::vector<VolumeIndexSession> sessions;
+  std::vector<VolumeIndexBlock> block_index; /**< by session and address */
+  std::vector<VolumeIndexBlock> blob_blocks; /**< same, blob blocks only */
+
+  void AddSession(const VolumeIndexSession& session);
+};
+
+bool LoadVolumeIndex(const char* directory,
+                     const char* volume_name,
+                     VolumeIndex& index);
+bool SaveVolumeIndex(const char* directory, const VolumeIndex& index);
+void RemoveVolumeIndex(const char* directory, const char* volume_name);
+bool LoadVolumeBlockIndex(const char* directory, VolumeIndex& index);
+bool AppendVolumeBlockIndex(const char* directory,
+                            const char* volume_name,
+                            const std::vector<VolumeIndexBlock>& entries);
+uint64_t GetVolumeIndexStartAddr(const VolumeIndex& index,
+                                 BootStrapRecord* root_bsr,
+                                 uint64_t from_addr = 0);
+
+bool GetVolumeIndexEod(DeviceControlRecord* dcr, uint64_t* addr);
+void VolumeIndexStartAppend(DeviceControlRecord* dcr);
+void VolumeIndexEndAppend(DeviceControlRecord* dcr);
+void VolumeIndexAddJobMedia(DeviceControlRecord* dcr);
+void VolumeIndexAddBlock(DeviceControlRecord* dcr,
+                         DeviceBlock* block,
+                         uint64_t addr);
+void VolumeIndexFlushBlocks(DeviceControlRecord* dcr);
+void VolumeIndexRemove(DeviceControlRecord* dcr, const char* volume_name);
+uint64_t VolumeIndexStartAddr(DeviceControlRecord* dcr,
+                              BootStrapRecord* root_bsr,
+                              uint64_t from_addr);
+bool VolumeIndexHasBlocks(DeviceControlRecord* dcr);
+
+} /* namespace storagedaemon */
+
+#endif  // BAREOS_STORED_VOLUME_INDEX_H_
@@ -32,6 +32,10 @@
 
 #include <chrono>
 #include <future>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define STORAGE_DAEMON 1
 #include "include/jcr.h"
@@ -313,3 +317,221 @@ TEST_F(ReservationTest, use_cmd_reserve_read_twice_wait)
   ASSERT_EQ(use_cmd(job2->jcr), true);
   ASSERT_STREQ(bsock->msg, "3000 OK use device device=single3\n");
 }
+
+#define VOLUME_INFO(name)                                                    \
+  "1000 OK VolName=" name                                                    \
+  " VolJobs=0 VolFiles=0 VolBlocks=0 VolBytes=0 VolMounts=0 VolErrors=0"     \
+  " VolWrites=0 MaxVolBytes=0 VolCapacityBytes=0 VolStatus=Append Slot=0"    \
+  " MaxVolJobs=0 MaxVolFiles=0 InChanger=0 VolReadTime=0 VolWriteTime=0"     \
+  " EndFile=0 EndBlock=0 LabelType=0 MediaId=1 EncryptionKey= MinBlocksize=0" \
+  " MaxBlocksize=0\n"
+
+/*
+ * Test that append jobs get different free drives of an autochanger
+ */
+TEST_F(ReservationTest, use_cmd_reserve_append_free_drives)
+{
+  auto bsock = std::make_unique<BareosSocketMock>();
+  auto job1 = std::make_unique<TestJob>(111u);
+  auto job2 = std::make_unique<TestJob>(222u);
+  job1->jcr->dir_bsock = job2->jcr->dir_bsock = bsock.get();
+
+  EXPECT_CALL(*bsock, recv())
+      .WillOnce(BSOCK_RECV(bsock.get(),
+                           "use storage=sssss media_type=File pool_name=ppppp "
+                           "pool_type=ptptp append=1 copy=0 stripe=0"))
+      .WillOnce(BSOCK_RECV(bsock.get(), "use device=auto1"))
+      .WillOnce(Return(BNET_EOD))  // end of device commands
+      .WillOnce(Return(BNET_EOD))  // end of storage command
+      .WillOnce(BSOCK_RECV(bsock.get(), VOLUME_INFO("vol1")))
+      .WillOnce(BSOCK_RECV(bsock.get(),
+                           "use storage=sssss media_type=File pool_name=ppppp "
+                           "pool_type=ptptp append=1 copy=0 stripe=0"))
+      .WillOnce(BSOCK_RECV(bsock.get(), "use device=auto1"))
+      .WillOnce(Return(BNET_EOD))  // end of device commands
+      .WillOnce(Return(BNET_EOD))  // end of storage command
+      .WillOnce(BSOCK_RECV(bsock.get(), VOLUME_INFO("vol2")));
+
+  // find media request and device answer per job
+  EXPECT_CALL(*bsock, send()).Times(4).WillRepeatedly(Return(true));
+
+  bsock->recv();
+  ASSERT_EQ(use_cmd(job1->jcr), true);
+  ASSERT_STREQ(bsock->msg, "3000 OK use device device=auto1dev2\n");
+  EXPECT_STREQ(job1->jcr->impl->dcr->VolumeName, "vol1");
+
+  bsock->recv();
+  ASSERT_EQ(use_cmd(job2->jcr), true);
+  ASSERT_STREQ(bsock->msg, "3000 OK use device device=auto1dev3\n");
+  EXPECT_STREQ(job2->jcr->impl->dcr->VolumeName, "vol2");
+
+  job1->jcr->impl->dcr->UnreserveDevice();
+  job2->jcr->impl->dcr->UnreserveDevice();
+}
+
+/*
+ * Test that append jobs starting at the same time never share a free drive
+ */
+TEST_F(ReservationTest, use_cmd_reserve_append_parallel)
+{
+  const std::vector<std::string> volumes{"vol1", "vol2", "vol3"};
+  std::vector<std::unique_ptr<BareosSocketMock>> sockets;
+  std::vector<std::unique_ptr<TestJob>> jobs;
+  std::vector<std::string> volume_infos;
+  std::vector<std::future<bool>> results;
+  std::set<std::string> devices;
+
+  for (const std::string& volume : volumes) {
+    volume_infos.push_back(VOLUME_INFO("XXXX"));
+    volume_infos.back().replace(volume_infos.back().find("XXXX"), 4, volume);
+  }
+
+  for (size_t i = 0; i < volumes.size(); i++) {
+    sockets.push_back(std::make_unique<BareosSocketMock>());
+    jobs.push_back(std::make_unique<TestJob>(111u + i));
+    BareosSocketMock* bsock = sockets.back().get();
+    const char* volume_info = volume_infos[i].c_str();
+
+    jobs.back()->jcr->dir_bsock = bsock;
+
+    EXPECT_CALL(*bsock, recv())
+        .WillOnce(BSOCK_RECV(bsock,
+                             "use storage=sssss media_type=File "
+                             "pool_name=ppppp pool_type=ptptp append=1 copy=0 "
+                             "stripe=0"))
+        .WillOnce(BSOCK_RECV(bsock, "use device=auto1"))
+        .WillOnce(Return(BNET_EOD))  // end of device commands
+        .WillOnce(Return(BNET_EOD))  // end of storage command
+        .WillOnce(BSOCK_RECV(bsock, volume_info));
+    EXPECT_CALL(*bsock, send()).WillRepeatedly(Return(true));
+  }
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    JobControlRecord* jcr = jobs[i]->jcr;
+
+    results.push_back(std::async(std::launch::async, [jcr] {
+      jcr->dir_bsock->recv();
+      return use_cmd(jcr);
+    }));
+  }
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    ASSERT_TRUE(results[i].get());
+    devices.insert(jobs[i]->jcr->dir_bsock->msg);
+  }
+  EXPECT_EQ(devices.size(), jobs.size());
+  EXPECT_EQ(devices.count("3000 OK use device device=auto1dev4\n"), 1u);
+
+  for (auto& job : jobs) { job->jcr->impl->dcr->UnreserveDevice(); }
+}
+
+/*
+ * Test that a job gets an elastic device when all other devices are busy
+ */
+TEST_F(ReservationTest, use_cmd_reserve_append_elastic_device)
+{
+  auto bsock = std::make_unique<BareosSocketMock>();
+  auto job1 = std::make_unique<TestJob>(111u);
+  auto job2 = std::make_unique<TestJob>(222u);
+  job1->jcr->dir_bsock = job2->jcr->dir_bsock = bsock.get();
+
+  DeviceResource* elastic = dynamic_cast<DeviceResource*>(
+      my_config->GetResWithName(R_DEVICE, "elasticdev0002"));
+  ASSERT_NE(elastic, nullptr);
+  EXPECT_TRUE(elastic->elastic);
+  EXPECT_TRUE(elastic->retired);
+
+  EXPECT_CALL(*bsock, recv())
+      .WillOnce(BSOCK_RECV(bsock.get(),
+                           "use storage=sssss media_type=Elastic "
+                           "pool_name=ppppp pool_type=ptptp append=1 copy=0 "
+                           "stripe=0"))
+      .WillOnce(BSOCK_RECV(bsock.get(), "use device=elastic"))
+      .WillOnce(Return(BNET_EOD))  // end of device commands
+      .WillOnce(Return(BNET_EOD))  // end of storage command
+      .WillOnce(BSOCK_RECV(bsock.get(), VOLUME_INFO("vol1")))
+      .WillOnce(BSOCK_RECV(bsock.get(),
+                           "use storage=sssss media_type=Elastic "
+                           "pool_name=ppppp pool_type=ptptp append=1 copy=0 "
+                           "stripe=0"))
+      .WillOnce(BSOCK_RECV(bsock.get(), "use device=elastic"))
+      .WillOnce(Return(BNET_EOD))  // end of device commands
+      .WillOnce(Return(BNET_EOD))  // end of storage command
+      .WillOnce(BSOCK_RECV(bsock.get(), VOLUME_INFO("vol2")));
+  EXPECT_CALL(*bsock, send()).WillRepeatedly(Return(true));
+
+  bsock->recv();
+  ASSERT_EQ(use_cmd(job1->jcr), true);
+  ASSERT_STREQ(bsock->msg, "3000 OK use device device=elasticdev0001\n");
+  EXPECT_TRUE(elastic->retired);
+
+  bsock->recv();
+  ASSERT_EQ(use_cmd(job2->jcr), true);
+  ASSERT_STREQ(bsock->msg, "3000 OK use device device=elasticdev0002\n");
+  EXPECT_STREQ(job2->jcr->impl->dcr->VolumeName, "vol2");
+  EXPECT_FALSE(elastic->retired);
+
+  job1->jcr->impl->dcr->UnreserveDevice();
+  job2->jcr->impl->dcr->UnreserveDevice();
+}
+
+/*
+ * Test that an activated elastic device is retired once it was idle for
+ * its Retire Idle Time, but not while a job has it reserved
+ */
+TEST_F(ReservationTest, retire_idle_elastic_device)
+{
+  auto bsock = std::make_unique<BareosSocketMock>();
+  auto job1 = std::make_unique<TestJob>(111u);
+  auto job2 = std::make_unique<TestJob>(222u);
+  job1->jcr->dir_bsock = job2->jcr->dir_bsock = bsock.get();
+
+  DeviceResource* elastic = dynamic_cast<DeviceResource*>(
+      my_config->GetResWithName(R_DEVICE, "elasticdev0002"));
+  ASSERT_NE(elastic, nullptr);
+
+  EXPECT_CALL(*bsock, recv())
+      .WillOnce(BSOCK_RECV(bsock.get(),
+                           "use storage=sssss media_type=Elastic "
+                           "pool_name=ppppp pool_type=ptptp append=1 copy=0 "
+                           "stripe=0"))
+      .WillOnce(BSOCK_RECV(bsock.get(), "use device=elastic"))
+      .WillOnce(Return(BNET_EOD))  // end of device commands
+      .WillOnce(Return(BNET_EOD))  // end of storage command
+      .WillOnce(BSOCK_RECV(bsock.get(), VOLUME_INFO("vol1")))
+      .WillOnce(BSOCK_RECV(bsock.get(),
+                           "use storage=sssss media_type=Elastic "
+                           "pool_name=ppppp pool_type=ptptp append=1 copy=0 "
+                           "stripe=0"))
+      .WillOnce(BSOCK_RECV(bsock.get(), "use device=elastic"))
+      .WillOnce(Return(BNET_EOD))  // end of device commands
+      .WillOnce(Return(BNET_EOD))  // end of storage command
+      .WillOnce(BSOCK_RECV(bsock.get(), VOLUME_INFO("vol2")));
+  EXPECT_CALL(*bsock, send()).WillRepeatedly(Return(true));
+
+  bsock->recv();
+  ASSERT_EQ(use_cmd(job1->jcr), true);
+  bsock->recv();
+  ASSERT_EQ(use_cmd(job2->jcr), true);
+  ASSERT_STREQ(bsock->msg, "3000 OK use device device=elasticdev0002\n");
+  ASSERT_FALSE(elastic->retired);
+
+  /* Checks are at least a minute apart, start well after the last one */
+  time_t now = time(NULL) + 3600;
+  time_t idle_time = elastic->retire_idle_time;
+
+  RetireIdleElasticDevices(now);
+  RetireIdleElasticDevices(now + idle_time + 60);
+  EXPECT_FALSE(elastic->retired);
+
+  job2->jcr->impl->dcr->UnreserveDevice();
+  now += idle_time + 120;
+  RetireIdleElasticDevices(now);
+  EXPECT_FALSE(elastic->retired);
+  RetireIdleElasticDevices(now + 60);
+  EXPECT_FALSE(elastic->retired);
+  RetireIdleElasticDevices(now + idle_time);
+  EXPECT_TRUE(elastic->retired);
+
+  job1->jcr->impl->dcr->UnreserveDevice();
+}
@@ -0,0 +1,90 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "include/jcr.h"
+#include "include/streams.h"
+#include "findlib/find.h"
+
+#include <string>
+
+static std::string BlobRecord(int stream, const std::string& content)
+{
+  return AclXattrBlobHash(stream, content.data(), content.size()) + " " +
+         std::to_string(stream) + "\n" + content;
+}
+
+TEST(AclXattrBlobs, hash_depends_on_stream_and_content)
+{
+  std::string acl(200, 'a');
+
+  EXPECT_EQ(AclXattrBlobHash(STREAM_ACL_LINUX_ACCESS_ACL, acl.data(),
+                             acl.size()).size(),
+            64u);
+  EXPECT_EQ(
+      AclXattrBlobHash(STREAM_ACL_LINUX_ACCESS_ACL, acl.data(), acl.size()),
+      AclXattrBlobHash(STREAM_ACL_LINUX_ACCESS_ACL, acl.data(), acl.size()));
+  EXPECT_NE(
+      AclXattrBlobHash(STREAM_ACL_LINUX_ACCESS_ACL, acl.data(), acl.size()),
+      AclXattrBlobHash(STREAM_ACL_LINUX_DEFAULT_ACL, acl.data(), acl.size()));
+  EXPECT_NE(
+      AclXattrBlobHash(STREAM_ACL_LINUX_ACCESS_ACL, acl.data(), acl.size()),
+      AclXattrBlobHash(STREAM_ACL_LINUX_ACCESS_ACL, acl.data(),
+                       acl.size() - 1));
+}
+
+TEST(AclXattrBlobs, references_resolve_by_content_hash)
+{
+  AclXattrBlobStore store;
+  std::string first(200, 'a'), second(200, 'b');
+  std::string record = BlobRecord(STREAM_XATTR_LINUX, first);
+  int stream = 0;
+
+  ASSERT_TRUE(store.Add(record.data(), record.size()));
+  record = BlobRecord(STREAM_ACL_LINUX_ACCESS_ACL, second);
+  ASSERT_TRUE(store.Add(record.data(), record.size()));
+
+  std::string hash =
+      AclXattrBlobHash(STREAM_XATTR_LINUX, first.data(), first.size());
+  const std::string* blob = store.Lookup(hash.c_str(), &stream);
+  ASSERT_NE(blob, nullptr);
+  EXPECT_EQ(*blob, first);
+  EXPECT_EQ(stream, STREAM_XATTR_LINUX);
+
+  hash = AclXattrBlobHash(STREAM_XATTR_LINUX, second.data(), second.size());
+  EXPECT_EQ(store.Lookup(hash.c_str(), &stream), nullptr);
+}
+
+TEST(AclXattrBlobs, blob_not_matching_its_hash_is_rejected)
+{
+  AclXattrBlobStore store;
+  std::string record = BlobRecord(STREAM_XATTR_LINUX, std::string(200, 'a'));
+
+  record.back() = 'b';
+  EXPECT_FALSE(store.Add(record.data(), record.size()));
+  EXPECT_FALSE(store.Add("no newline", 10));
+}
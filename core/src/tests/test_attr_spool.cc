@@ -0,0 +1,193 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "lib/attr_spool.h"
+
+#include <string>
+#include <vector>
+
+static const char* kPrefix = "UpdCat Job=backup.2020-10-19_10.00.00_01 ";
+
+class AttrSpoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    fd_ = mkstemp(&filename_[0]);
+    ASSERT_NE(fd_, -1);
+    msg_ = GetPoolMemory(PM_MESSAGE);
+  }
+  void TearDown() override
+  {
+    FreePoolMemory(msg_);
+    close(fd_);
+    unlink(filename_.c_str());
+  }
+
+  /* A message like an attributes message, the path starts at the anchor */
+  static std::string Message(int i, int32_t* anchor)
+  {
+    std::string msg(kPrefix);
+    msg += std::to_string(i) + " 3 ";
+    *anchor = msg.size();
+    msg += "/srv/data/projects/dir" + std::to_string(i / 100) + "/file" +
+           std::to_string(i);
+    msg += '\0';
+    msg += "P0C AGD1 IG0 B Po Po A BAA I BfnHOd BfnHOd BfnHOd A A C";
+    return msg;
+  }
+
+  void Rewind() { ASSERT_EQ(lseek(fd_, 0, SEEK_SET), 0); }
+
+  std::vector<std::string> ReadAll(AttrSpoolReader& reader)
+  {
+    std::vector<std::string> messages;
+    int32_t message_length;
+    while (reader.Next(msg_, &message_length)) {
+      messages.emplace_back(msg_, message_length);
+    }
+    return messages;
+  }
+
+  std::string filename_{"/tmp/test_attr_spool.XXXXXX"};
+  int fd_{-1};
+  POOLMEM* msg_{nullptr};
+};
+
+TEST_F(AttrSpoolTest, RoundTrip)
+{
+  std::vector<std::string> messages;
+  AttrSpoolWriter writer(fd_);
+
+  for (int i = 0; i < 20000; i++) {
+    int32_t anchor;
+    messages.push_back(Message(i, &anchor));
+    ASSERT_TRUE(
+        writer.Append(messages.back().data(), messages.back().size(), anchor));
+  }
+  ASSERT_TRUE(writer.Flush());
+  EXPECT_LT(writer.StoredSize(), writer.PlainSize() / 4);
+
+  EXPECT_TRUE(IsCompressedAttrSpool(fd_));
+  Rewind();
+  AttrSpoolReader reader(fd_);
+  EXPECT_EQ(ReadAll(reader), messages);
+  EXPECT_FALSE(reader.Error());
+  EXPECT_EQ(reader.PlainSize(), writer.PlainSize());
+}
+
+TEST_F(AttrSpoolTest, MessageLargerThanSegment)
+{
+  std::vector<std::string> messages;
+  AttrSpoolWriter writer(fd_);
+
+  messages.emplace_back("short");
+  messages.emplace_back(3 * ATTR_SPOOL_SEGMENT_SIZE, 'x');
+  messages.emplace_back("short again");
+  for (auto& msg : messages) {
+    ASSERT_TRUE(writer.Append(msg.data(), msg.size(), 0));
+  }
+  ASSERT_TRUE(writer.Flush());
+
+  Rewind();
+  AttrSpoolReader reader(fd_);
+  EXPECT_EQ(ReadAll(reader), messages);
+  EXPECT_FALSE(reader.Error());
+}
+
+TEST_F(AttrSpoolTest, LimitHidesLaterMessages)
+{
+  AttrSpoolWriter writer(fd_);
+  uint64_t limit = 0;
+
+  for (int i = 0; i < 100; i++) {
+    int32_t anchor;
+    std::string msg = Message(i, &anchor);
+    ASSERT_TRUE(writer.Append(msg.data(), msg.size(), anchor));
+    if (i == 41) { limit = writer.PlainSize(); }
+  }
+  ASSERT_TRUE(writer.Flush());
+  ASSERT_TRUE(writer.SetLimit(limit));
+
+  Rewind();
+  AttrSpoolReader reader(fd_);
+  EXPECT_EQ(ReadAll(reader).size(), 42u);
+  EXPECT_FALSE(reader.Error());
+}
+
+TEST_F(AttrSpoolTest, DataEndIsInPlainBytes)
+{
+  AttrSpoolWriter writer(fd_);
+
+  for (int i = 0; i < 5000; i++) {
+    int32_t anchor;
+    std::string msg = Message(i, &anchor);
+    if (i == 4000) { writer.SetDataEnd(); }
+    ASSERT_TRUE(writer.Append(msg.data(), msg.size(), anchor));
+  }
+  ASSERT_TRUE(writer.Flush());
+
+  /* The stored size is much smaller than the data end, so it can't be used */
+  EXPECT_GT(writer.DataEnd(), writer.StoredSize());
+  ASSERT_TRUE(writer.SetLimit(writer.DataEnd()));
+
+  Rewind();
+  AttrSpoolReader reader(fd_);
+  EXPECT_EQ(ReadAll(reader).size(), 4000u);
+  EXPECT_FALSE(reader.Error());
+  EXPECT_EQ(reader.PlainSize(), writer.DataEnd());
+}
+
+TEST_F(AttrSpoolTest, PlainSpoolFileIsNotCompressed)
+{
+  EXPECT_FALSE(IsCompressedAttrSpool(fd_));
+
+  std::string msg = kPrefix;
+  int32_t pktsiz = htonl(msg.size());
+  ASSERT_EQ(write(fd_, &pktsiz, sizeof(pktsiz)), (ssize_t)sizeof(pktsiz));
+  ASSERT_EQ(write(fd_, msg.data(), msg.size()), (ssize_t)msg.size());
+
+  EXPECT_FALSE(IsCompressedAttrSpool(fd_));
+}
+
+TEST_F(AttrSpoolTest, CorruptSegmentIsAnError)
+{
+  AttrSpoolWriter writer(fd_);
+
+  for (int i = 0; i < 1000; i++) {
+    int32_t anchor;
+    std::string msg = Message(i, &anchor);
+    ASSERT_TRUE(writer.Append(msg.data(), msg.size(), anchor));
+  }
+  ASSERT_TRUE(writer.Flush());
+  ASSERT_EQ(ftruncate(fd_, writer.StoredSize() / 2), 0);
+
+  Rewind();
+  AttrSpoolReader reader(fd_);
+  ReadAll(reader);
+  EXPECT_TRUE(reader.Error());
+}
@@ -0,0 +1,151 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+static struct stat SampleStat()
+{
+  struct stat st;
+
+  memset(&st, 0, sizeof(st));
+  st.st_dev = 2049;
+  st.st_ino = 123456789;
+  st.st_mode = S_IFREG | 0644;
+  st.st_nlink = 2;
+  st.st_uid = 1000;
+  st.st_gid = 100;
+  st.st_rdev = 0;
+  st.st_size = 5000000000LL;
+  st.st_blksize = 4096;
+  st.st_blocks = 9765632;
+  st.st_mtime = 1600000000;
+  st.st_atime = 1600000127;
+  st.st_ctime = 1599999000;
+
+  return st;
+}
+
+TEST(attribs, compact_stat_roundtrip)
+{
+  struct stat in = SampleStat();
+  struct stat out;
+  int32_t LinkFI = 0;
+  char buf[256];
+
+  EncodeStatCompact(buf, &in, sizeof(in), 4711, STREAM_FILE_DATA);
+  ASSERT_TRUE(IsCompactStat(buf));
+
+  EXPECT_EQ(STREAM_FILE_DATA, DecodeStat(buf, &out, sizeof(out), &LinkFI));
+  EXPECT_EQ(4711, LinkFI);
+  EXPECT_EQ(in.st_dev, out.st_dev);
+  EXPECT_EQ(in.st_ino, out.st_ino);
+  EXPECT_EQ(in.st_mode, out.st_mode);
+  EXPECT_EQ(in.st_nlink, out.st_nlink);
+  EXPECT_EQ(in.st_uid, out.st_uid);
+  EXPECT_EQ(in.st_gid, out.st_gid);
+  EXPECT_EQ(in.st_size, out.st_size);
+  EXPECT_EQ(in.st_blksize, out.st_blksize);
+  EXPECT_EQ(in.st_blocks, out.st_blocks);
+  EXPECT_EQ(in.st_atime, out.st_atime);
+  EXPECT_EQ(in.st_mtime, out.st_mtime);
+  EXPECT_EQ(in.st_ctime, out.st_ctime);
+
+  EXPECT_EQ(4711, DecodeLinkFI(buf, &out, sizeof(out)));
+}
+
+TEST(attribs, compact_stat_is_smaller_and_has_no_zero_bytes)
+{
+  struct stat in = SampleStat();
+  char text[256], compact[256];
+
+  EncodeStat(text, &in, sizeof(in), 0, STREAM_FILE_DATA);
+  EncodeStatCompact(compact, &in, sizeof(in), 0, STREAM_FILE_DATA);
+
+  EXPECT_FALSE(IsCompactStat(text));
+  EXPECT_LT(strlen(compact), strlen(text));
+
+  /* all 16 fields must survive, so the string must not end early */
+  struct stat out;
+  int32_t LinkFI;
+  EXPECT_EQ(STREAM_FILE_DATA, DecodeStat(compact, &out, sizeof(out), &LinkFI));
+}
+
+TEST(attribs, compact_stat_extreme_values)
+{
+  struct stat in;
+  struct stat out;
+  int32_t LinkFI = 0;
+  char buf[256];
+
+  memset(&in, 0xff, sizeof(in));
+  in.st_mtime = -1;
+  in.st_atime = INT32_MAX;
+  in.st_ctime = INT32_MIN;
+
+  EncodeStatCompact(buf, &in, sizeof(in), -1, 0);
+  EXPECT_EQ(0, DecodeStat(buf, &out, sizeof(out), &LinkFI));
+  EXPECT_EQ(-1, LinkFI);
+  EXPECT_EQ(in.st_ino, out.st_ino);
+  EXPECT_EQ(in.st_size, out.st_size);
+  EXPECT_EQ(in.st_atime, out.st_atime);
+  EXPECT_EQ(in.st_mtime, out.st_mtime);
+  EXPECT_EQ(in.st_ctime, out.st_ctime);
+}
+
+TEST(attribs, compact_stat_converts_to_identical_text)
+{
+  struct stat in = SampleStat();
+  char text[256], compact[256];
+  POOLMEM* converted = GetPoolMemory(PM_NAME);
+
+  EncodeStat(text, &in, sizeof(in), 17, STREAM_SPARSE_DATA);
+  EncodeStatCompact(compact, &in, sizeof(in), 17, STREAM_SPARSE_DATA);
+
+  ASSERT_TRUE(CompactStatToText(compact, converted));
+  EXPECT_STREQ(text, converted);
+
+  EXPECT_FALSE(CompactStatToText(text, converted));
+
+  FreePoolMemory(converted);
+}
+
+TEST(attribs, truncated_compact_stat_is_rejected)
+{
+  struct stat in = SampleStat();
+  struct stat out;
+  int32_t LinkFI = 99;
+  char buf[256];
+  POOLMEM* converted = GetPoolMemory(PM_NAME);
+
+  EncodeStatCompact(buf, &in, sizeof(in), 5, STREAM_FILE_DATA);
+  buf[strlen(buf) / 2] = 0;
+
+  EXPECT_FALSE(CompactStatToText(buf, converted));
+  EXPECT_EQ(0, DecodeStat(buf, &out, sizeof(out), &LinkFI));
+  EXPECT_EQ(0, LinkFI);
+
+  FreePoolMemory(converted);
+}
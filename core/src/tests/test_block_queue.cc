@@ -0,0 +1,191 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#define STORAGE_DAEMON 1
+#include "include/jcr.h"
+#include "stored/stored.h"
+#include "stored/stored_globals.h"
+#include "stored/acquire.h"
+#include "stored/device_control_record.h"
+#include "stored/jcr_private.h"
+#include "stored/job.h"
+#include "stored/sd_device_control_record.h"
+
+#include <vector>
+
+using namespace storagedaemon;
+
+/*
+ * Device keeping the first data byte of every block written to it. After
+ * max_writes blocks it turns read-only, so the next write fails.
+ */
+class MemoryDevice : public Device {
+ public:
+  explicit MemoryDevice(int max_writes = -1) : max_writes_(max_writes)
+  {
+    errmsg = GetPoolMemory(PM_EMSG);
+    prt_name = GetPoolMemory(PM_NAME);
+    PmStrcpy(prt_name, "MemoryDevice");
+    device_resource = &resource_;
+    dev_type = DeviceType::B_FILE_DEV;
+    max_block_size = DEFAULT_BLOCK_SIZE;
+    fd_ = 0;
+    SetAppend();
+  }
+  ~MemoryDevice() { ClearOpened(); }
+
+  std::vector<char> written;
+
+ protected:
+  int d_ioctl(int, ioctl_req_t, char*) override { return -1; }
+  int d_open(const char*, int, int) override { return -1; }
+  int d_close(int) override { return 0; }
+  ssize_t d_read(int, void*, size_t) override { return -1; }
+  ssize_t d_write(int, const void* buffer, size_t count) override
+  {
+    written.push_back(((const char*)buffer)[WRITE_BLKHDR_LENGTH]);
+    if ((int)written.size() == max_writes_) { ClearAppend(); }
+    return count;
+  }
+  boffset_t d_lseek(DeviceControlRecord*, boffset_t, int) override
+  {
+    return 0;
+  }
+  bool d_truncate(DeviceControlRecord*) override { return true; }
+
+ private:
+  int max_writes_;
+  DeviceResource resource_;
+};
+
+class BlockQueueTest : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    jcr = NewStoredJcr();
+    jcr->setJobType(JT_SYSTEM);
+    jcr->setJobStatus(JS_Running);
+    dcr = new StorageDaemonDeviceControlRecord;
+  }
+  void TearDown() override
+  {
+    FreeDeviceControlRecord(dcr);
+    jcr->JobId = 0;
+    FreeJcr(jcr);
+  }
+
+  void UseDevice(Device* dev, uint32_t max_queued_blocks)
+  {
+    SetupNewDcrDevice(jcr, dcr, dev, nullptr);
+    dcr->max_queued_blocks = max_queued_blocks;
+  }
+
+  /* Fill the current block with data marked by marker and hand it over */
+  bool QueueBlock(char marker)
+  {
+    memset(dcr->block->bufp, marker, 100);
+    dcr->block->bufp += 100;
+    dcr->block->binbuf += 100;
+    return dcr->QueueBlockForWrite();
+  }
+
+  JobControlRecord* jcr{nullptr};
+  DeviceControlRecord* dcr{nullptr};
+};
+
+TEST_F(BlockQueueTest, writes_queued_blocks_in_order_when_full)
+{
+  MemoryDevice dev;
+  UseDevice(&dev, 3);
+
+  EXPECT_TRUE(QueueBlock('a'));
+  EXPECT_TRUE(QueueBlock('b'));
+  EXPECT_TRUE(dev.written.empty());
+  EXPECT_EQ(dcr->queued_blocks.size(), 2u);
+
+  EXPECT_TRUE(QueueBlock('c'));
+  EXPECT_EQ(dev.written, std::vector<char>({'a', 'b', 'c'}));
+  EXPECT_TRUE(dcr->queued_blocks.empty());
+
+  EXPECT_TRUE(QueueBlock('d'));
+  EXPECT_TRUE(dcr->WriteQueuedBlocks());
+  EXPECT_EQ(dev.written, std::vector<char>({'a', 'b', 'c', 'd'}));
+}
+
+TEST_F(BlockQueueTest, writes_right_away_without_queue)
+{
+  MemoryDevice dev;
+  UseDevice(&dev, 1);
+
+  EXPECT_TRUE(QueueBlock('a'));
+  EXPECT_EQ(dev.written, std::vector<char>({'a'}));
+  EXPECT_TRUE(dcr->queued_blocks.empty());
+}
+
+TEST_F(BlockQueueTest, write_error_fails_the_flush)
+{
+  MemoryDevice dev(2);
+  UseDevice(&dev, 4);
+
+  EXPECT_TRUE(QueueBlock('a'));
+  EXPECT_TRUE(QueueBlock('b'));
+  EXPECT_TRUE(QueueBlock('c'));
+  EXPECT_FALSE(QueueBlock('d'));
+  EXPECT_EQ(dev.written, std::vector<char>({'a', 'b'}));
+  EXPECT_TRUE(dcr->queued_blocks.empty());
+  EXPECT_TRUE(jcr->IsJobCanceled());
+}
+
+TEST_F(BlockQueueTest, switching_devices_flushes_the_queue)
+{
+  MemoryDevice old_dev, new_dev;
+  UseDevice(&old_dev, 4);
+
+  EXPECT_TRUE(QueueBlock('a'));
+  EXPECT_TRUE(QueueBlock('b'));
+  UseDevice(&new_dev, 4);
+
+  EXPECT_EQ(old_dev.written, std::vector<char>({'a', 'b'}));
+  EXPECT_TRUE(new_dev.written.empty());
+  EXPECT_TRUE(dcr->queued_blocks.empty());
+  EXPECT_FALSE(jcr->IsJobCanceled());
+}
+
+TEST_F(BlockQueueTest, switching_devices_fails_job_on_write_error)
+{
+  MemoryDevice old_dev(1), new_dev;
+  UseDevice(&old_dev, 4);
+
+  EXPECT_TRUE(QueueBlock('a'));
+  EXPECT_TRUE(QueueBlock('b'));
+  UseDevice(&new_dev, 4);
+
+  EXPECT_EQ(old_dev.written, std::vector<char>({'a'}));
+  EXPECT_TRUE(dcr->queued_blocks.empty());
+  EXPECT_TRUE(jcr->IsJobCanceled());
+}
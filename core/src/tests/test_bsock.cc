@@ -33,6 +33,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include <thread>
 #include <future>
@@ -62,6 +63,10 @@ class StorageResource;
 #define CONSOLEPASSWORD "secret"
 
 static std::string cipher_server, cipher_client;
+static bool tls_kernel_offload = false;
+static int bulk_messages = 0;
+
+#define BULK_MESSAGE_SIZE 65536
 
 static std::unique_ptr<directordaemon::ConsoleResource> dir_cons_config;
 static std::unique_ptr<directordaemon::DirectorResource> dir_dir_config;
@@ -102,6 +107,12 @@ static void clone_a_server_socket(BareosSocket* bs)
   bs2->close();
 
   bs->fsend("bareos-socket-1234567890");
+
+  std::vector<char> buffer(BULK_MESSAGE_SIZE);
+  for (int i = 0; i < bulk_messages; i++) {
+    std::fill(buffer.begin(), buffer.end(), (char)i);
+    bs->send(buffer.data(), buffer.size());
+  }
 }
 
 static void start_bareos_server(std::promise<bool>* promise,
@@ -116,6 +127,7 @@ static void start_bareos_server(std::promise<bool>* promise,
   if (newsockfd < 0) { return; }
 
   std::unique_ptr<BareosSocket> bs(create_new_bareos_socket(newsockfd));
+  bs->SetTlsKernelOffload(tls_kernel_offload);
 
   char* name = (char*)console_name.c_str();
   s_password* password = new (s_password);
@@ -176,6 +188,15 @@ static void clone_a_client_socket(std::shared_ptr<BareosSocket> UA_sock)
   UA_sock->recv();
   received_msg = UA_sock->msg;
   EXPECT_STREQ(orig_msg.c_str(), received_msg.c_str());
+
+  if (bulk_messages == 0) { return; }
+
+  std::vector<char> expected(BULK_MESSAGE_SIZE);
+  for (int i = 0; i < bulk_messages; i++) {
+    std::fill(expected.begin(), expected.end(), (char)i);
+    ASSERT_EQ(UA_sock->recv(), BULK_MESSAGE_SIZE);
+    ASSERT_EQ(memcmp(UA_sock->msg, expected.data(), BULK_MESSAGE_SIZE), 0);
+  }
 }
 
 #if CLIENT_AS_A_THREAD
@@ -202,6 +223,7 @@ static bool connect_to_server(std::string console_name,
 
   std::shared_ptr<BareosSocketTCP> UA_sock(new BareosSocketTCP);
   UA_sock->sleep_time_after_authentication_error = 0;
+  UA_sock->SetTlsKernelOffload(tls_kernel_offload);
   jcr.dir_bsock = UA_sock.get();
 
   bool success = false;
@@ -385,6 +407,43 @@ TEST(bsock, auth_works_with_tls_cert)
   EXPECT_TRUE(future.get());
 }
 
+TEST(bsock, transfer_works_with_tls_kernel_offload)
+{
+  uint16_t portnumber = create_unique_socket_number();
+
+  std::promise<bool> promise;
+  std::future<bool> future = promise.get_future();
+
+  client_cons_name = "clientname";
+  client_cons_password = "verysecretpassword";
+
+  server_cons_name = client_cons_name;
+  server_cons_password = client_cons_password;
+
+  InitForTest();
+
+  cons_dir_config->tls_enable_ = true;
+  dir_cons_config->tls_enable_ = true;
+
+  /* falls back to OpenSSL when the kernel has no tls support */
+  tls_kernel_offload = true;
+  bulk_messages = 1024;
+
+  std::thread server_thread(start_bareos_server, &promise, server_cons_name,
+                            server_cons_password, HOST, portnumber);
+
+  EXPECT_TRUE(connect_to_server(client_cons_name, client_cons_password, HOST,
+                                portnumber));
+
+  server_thread.join();
+
+  tls_kernel_offload = false;
+  bulk_messages = 0;
+
+  EXPECT_TRUE(cipher_server == cipher_client);
+  EXPECT_TRUE(future.get());
+}
+
 class BareosSocketTCPMock : public BareosSocketTCP {
  public:
   BareosSocketTCPMock(std::string& t) : test_variable_(t) {}
@@ -0,0 +1,183 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "lib/bsock_striped.h"
+#include "lib/bsock_tcp.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define NUMBER_OF_CONNECTIONS 4
+#define NUMBER_OF_MESSAGES 3000
+
+struct ConnectionPair {
+  BareosSocket* client{nullptr};
+  BareosSocket* server{nullptr};
+};
+
+static BareosSocket* NewSocket(int fd)
+{
+  BareosSocket* bs = new BareosSocketTCP;
+
+  bs->fd_ = fd;
+  bs->SetWho(strdup("test"));
+  return bs;
+}
+
+/* Connect two sockets over the loopback interface on a free port. */
+static ConnectionPair Connect()
+{
+  ConnectionPair pair;
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+  int listen_fd, client_fd, server_fd;
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  EXPECT_EQ(bind(listen_fd, (struct sockaddr*)&address, sizeof(address)), 0);
+  EXPECT_EQ(listen(listen_fd, 1), 0);
+  EXPECT_EQ(getsockname(listen_fd, (struct sockaddr*)&address, &length), 0);
+
+  client_fd = socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_EQ(connect(client_fd, (struct sockaddr*)&address, sizeof(address)),
+            0);
+  server_fd = accept(listen_fd, nullptr, nullptr);
+  EXPECT_GE(server_fd, 0);
+  close(listen_fd);
+
+  pair.client = NewSocket(client_fd);
+  pair.server = NewSocket(server_fd);
+  return pair;
+}
+
+static int32_t MessageLength(int i) { return (i * 7919) % 70000; }
+
+class StripedSocket : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    for (int i = 0; i < NUMBER_OF_CONNECTIONS; i++) {
+      ConnectionPair pair = Connect();
+      if (i == 0) {
+        client_control.reset(pair.client);
+        server_control.reset(pair.server);
+      } else {
+        client_stripes.push_back(pair.client);
+        server_stripes.push_back(pair.server);
+      }
+    }
+  }
+
+  std::unique_ptr<BareosSocket> client_control;
+  std::unique_ptr<BareosSocket> server_control;
+  std::vector<BareosSocket*> client_stripes;
+  std::vector<BareosSocket*> server_stripes;
+};
+
+TEST_F(StripedSocket, delivers_messages_in_order)
+{
+  std::unique_ptr<BareosSocketStriped> receiver(new BareosSocketStriped(
+      nullptr, server_control.get(), server_stripes, false));
+  int errors = 0;
+
+  std::thread reader([&]() {
+    for (int i = 0; i < NUMBER_OF_MESSAGES; i++) {
+      int32_t n = receiver->recv();
+
+      if (i % 100 == 99) {
+        if (n != BNET_SIGNAL || receiver->message_length != BNET_EOD) {
+          errors++;
+        }
+        continue;
+      }
+      if (n != MessageLength(i)) {
+        errors++;
+        continue;
+      }
+      for (int32_t j = 0; j < n; j++) {
+        if (receiver->msg[j] != (char)(i + j)) {
+          errors++;
+          break;
+        }
+      }
+    }
+    if (!receiver->Finish()) { errors++; }
+  });
+
+  std::unique_ptr<BareosSocketStriped> sender(new BareosSocketStriped(
+      nullptr, client_control.get(), client_stripes, true));
+  BareosSocket* bs = sender.get();
+  EXPECT_EQ(sender->NumberOfStripes(), NUMBER_OF_CONNECTIONS);
+
+  for (int i = 0; i < NUMBER_OF_MESSAGES; i++) {
+    if (i % 100 == 99) {
+      EXPECT_TRUE(bs->signal(BNET_EOD));
+      continue;
+    }
+    sender->msg = CheckPoolMemorySize(sender->msg, MessageLength(i));
+    for (int32_t j = 0; j < MessageLength(i); j++) {
+      sender->msg[j] = (char)(i + j);
+    }
+    sender->message_length = MessageLength(i);
+    EXPECT_TRUE(sender->send());
+  }
+  EXPECT_TRUE(sender->Finish());
+  reader.join();
+  EXPECT_EQ(errors, 0);
+
+  /* The control connection is used unstriped afterwards. */
+  EXPECT_TRUE(client_control->fsend("after striping"));
+  EXPECT_GT(server_control->recv(), 0);
+  EXPECT_STREQ(server_control->msg, "after striping");
+}
+
+TEST_F(StripedSocket, reports_lost_connections)
+{
+  std::unique_ptr<BareosSocketStriped> receiver(new BareosSocketStriped(
+      nullptr, server_control.get(), server_stripes, false));
+  std::unique_ptr<BareosSocketStriped> sender(new BareosSocketStriped(
+      nullptr, client_control.get(), client_stripes, true));
+  BareosSocket* bs = sender.get();
+  int32_t n;
+
+  for (int i = 0; i < 10; i++) { EXPECT_TRUE(bs->fsend("message %d", i)); }
+
+  /* Dropping the sender without finishing closes the other connections. */
+  sender.reset();
+
+  do {
+    n = receiver->recv();
+  } while (n > 0);
+  EXPECT_EQ(n, BNET_HARDEOF);
+  EXPECT_TRUE(receiver->IsError());
+  receiver->Abort();
+}
@@ -0,0 +1,227 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "stored/stored.h"
+#include "stored/match_bsr.h"
+#include "lib/parse_bsr.h"
+
+#include <fstream>
+#include <string>
+
+using namespace storagedaemon;
+
+static const char* kVolumeName = "Full-0001";
+
+class BsrMatch : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    bstrncpy(volrec_.VolumeName, kVolumeName, sizeof(volrec_.VolumeName));
+  }
+  void TearDown() override
+  {
+    if (bsr_) { libbareos::FreeBsr(bsr_); }
+    unlink(filename_.c_str());
+  }
+
+  BootStrapRecord* Parse(const std::string& content)
+  {
+    std::ofstream out(filename_);
+    out << content;
+    out.close();
+    bsr_ = libbareos::parse_bsr(nullptr, const_cast<char*>(filename_.c_str()));
+    return bsr_;
+  }
+
+  int Match(uint32_t sesstime, uint32_t sessid, int32_t FileIndex)
+  {
+    DeviceRecord rec;
+    rec.VolSessionTime = sesstime;
+    rec.VolSessionId = sessid;
+    rec.FileIndex = FileIndex;
+    return MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr);
+  }
+
+  std::string filename_{"test_bsr_match." + std::to_string(getpid()) + ".bsr"};
+  BootStrapRecord* bsr_{nullptr};
+  Volume_Label volrec_;
+  Session_Label sessrec_;
+};
+
+static std::string BsrHeader(uint32_t sesstime, uint32_t sessid)
+{
+  return std::string("Volume=\"") + kVolumeName + "\"\n" +
+         "MediaType=\"File\"\n" +
+         "VolSessionId=" + std::to_string(sessid) + "\n" +
+         "VolSessionTime=" + std::to_string(sesstime) + "\n";
+}
+
+TEST_F(BsrMatch, unsorted_and_overlapping_ranges)
+{
+  ASSERT_NE(Parse(BsrHeader(100, 1) +
+                  "FileIndex=20-25\nFileIndex=1-3\nFileIndex=2-5\n"
+                  "FileIndex=7\nFileIndex=8-9\n"),
+            nullptr);
+  ASSERT_NE(bsr_->findex_table, nullptr);
+  EXPECT_EQ(bsr_->findex_table->ranges.size(), 3u);
+
+  EXPECT_EQ(Match(100, 1, 1), 1);
+  EXPECT_EQ(Match(100, 1, 5), 1);
+  EXPECT_EQ(Match(100, 1, 6), 0);
+  EXPECT_EQ(Match(100, 1, 9), 1);
+  EXPECT_EQ(Match(100, 2, 10), 0);
+  EXPECT_EQ(Match(99, 1, 10), 0);
+  EXPECT_EQ(Match(100, 1, 25), 1);
+  EXPECT_FALSE(bsr_->done);
+  EXPECT_EQ(Match(100, 1, 26), -1);
+  EXPECT_TRUE(bsr_->done);
+}
+
+TEST_F(BsrMatch, ranges_behind_the_reader_are_done)
+{
+  ASSERT_NE(Parse(BsrHeader(100, 1) + "FileIndex=1-10\nFileIndex=20-30\n"),
+            nullptr);
+  EXPECT_EQ(Match(100, 1, 21), 1);
+  EXPECT_EQ(Match(100, 1, 5), 0);
+  EXPECT_EQ(Match(100, 1, 30), 1);
+}
+
+TEST_F(BsrMatch, done_bsrs_are_skipped)
+{
+  ASSERT_NE(Parse(BsrHeader(100, 1) + "FileIndex=1-2\n" + BsrHeader(100, 2) +
+                  "FileIndex=1-2\n"),
+            nullptr);
+  EXPECT_EQ(Match(100, 1, 1), 1);
+  EXPECT_EQ(Match(100, 1, 3), 0);
+  EXPECT_TRUE(bsr_->done);
+  EXPECT_EQ(Match(100, 2, 2), 1);
+  EXPECT_EQ(bsr_->first_active, bsr_->next);
+  EXPECT_EQ(Match(100, 2, 3), -1);
+}
+
+TEST_F(BsrMatch, shared_acl_xattr_blobs_of_unselected_files)
+{
+  ASSERT_NE(Parse(BsrHeader(100, 1) + "VolAddr=1000-2000\nFileIndex=5-6\n"),
+            nullptr);
+
+  DeviceRecord rec;
+  rec.VolSessionTime = 100;
+  rec.VolSessionId = 1;
+  rec.FileIndex = 2;
+  rec.File = 0;
+  rec.Block = 500;
+  rec.maskedStream = STREAM_ACL_XATTR_BLOB;
+  EXPECT_EQ(MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr), 1);
+  rec.maskedStream = STREAM_ACL_XATTR_REFERENCE;
+  EXPECT_EQ(MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr), 0);
+  rec.VolSessionId = 2;
+  rec.maskedStream = STREAM_ACL_XATTR_BLOB;
+  EXPECT_EQ(MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr), 0);
+  EXPECT_FALSE(bsr_->done);
+}
+
+TEST_F(BsrMatch, reposition_between_ranges_only_with_volume_index)
+{
+  ASSERT_NE(Parse(BsrHeader(100, 1) + "FileIndex=1-2\nFileIndex=20\n"),
+            nullptr);
+  bsr_->use_positioning = true;
+
+  DeviceRecord rec;
+  rec.VolSessionTime = 100;
+  rec.VolSessionId = 1;
+  rec.FileIndex = 5;
+  rec.Block = 1;
+  EXPECT_EQ(MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr), 0);
+  EXPECT_FALSE(bsr_->Reposition);
+
+  bsr_->use_volume_index = true;
+  rec.Block = 2;
+  EXPECT_EQ(MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr), 0);
+  EXPECT_TRUE(bsr_->Reposition);
+
+  /* only once per block */
+  bsr_->Reposition = false;
+  rec.FileIndex = 6;
+  EXPECT_EQ(MatchBsr(bsr_, &rec, &volrec_, &sessrec_, nullptr), 0);
+  EXPECT_FALSE(bsr_->Reposition);
+}
+
+TEST_F(BsrMatch, fast_block_rejection)
+{
+  ASSERT_NE(Parse(BsrHeader(100, 1) + "FileIndex=1\n" + BsrHeader(200, 7) +
+                  "FileIndex=1\n"),
+            nullptr);
+  ASSERT_TRUE(bsr_->use_fast_rejection);
+  ASSERT_NE(bsr_->session_index, nullptr);
+
+  DeviceBlock block{};
+  block.BlockVer = 2;
+  block.VolSessionTime = 100;
+  block.VolSessionId = 1;
+  EXPECT_EQ(MatchBsrBlock(bsr_, &block), 1);
+  block.VolSessionId = 7;
+  EXPECT_EQ(MatchBsrBlock(bsr_, &block), 0);
+  block.VolSessionTime = 200;
+  EXPECT_EQ(MatchBsrBlock(bsr_, &block), 1);
+  block.VolSessionTime = 300;
+  EXPECT_EQ(MatchBsrBlock(bsr_, &block), 0);
+}
+
+/*
+ * Synthetic restore of a long chain of small bsrs followed by every other
+ * file out of a large session, in the order the director writes them.
+ */
+TEST_F(BsrMatch, large_synthetic_bsr)
+{
+  const int32_t files = 2000000;
+  const uint32_t sessions = 5000;
+  std::string content;
+
+  for (uint32_t id = 2; id <= sessions; id++) {
+    content += BsrHeader(100, id) + "FileIndex=1-10\n";
+  }
+  content += BsrHeader(100, 1);
+  for (int32_t fi = 1; fi <= files; fi += 2) {
+    content += "FileIndex=" + std::to_string(fi) + "\n";
+  }
+
+  ASSERT_NE(Parse(content), nullptr);
+
+  int32_t matched = 0;
+  for (uint32_t id = 2; id <= sessions; id++) {
+    for (int32_t fi = 1; fi <= 11; fi++) {
+      if (Match(100, id, fi) == 1) { matched++; }
+    }
+  }
+  for (int32_t fi = 1; fi <= files; fi++) {
+    if (Match(100, 1, fi) == 1) { matched++; }
+  }
+
+  EXPECT_EQ(matched, files / 2 + (int32_t)(sessions - 1) * 10);
+  EXPECT_EQ(Match(100, 1, files + 1), -1);
+}
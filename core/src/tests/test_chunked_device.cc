@@ -0,0 +1,520 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "stored/stored.h"
+#include "stored/stored_globals.h"
+#include "stored/device_status_information.h"
+#include "stored/backends/chunked_device.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace storagedaemon;
+
+/*
+ * Chunked device storing its chunks as files in a local directory,
+ * standing in for an object store backend.
+ */
+class LocalChunkedDevice : public chunked_device {
+ public:
+  LocalChunkedDevice(const std::string& dir,
+                     uint8_t io_threads,
+                     uint8_t readahead,
+                     bool adaptive_uploads = false)
+      : dir_(dir)
+  {
+    errmsg = GetPoolMemory(PM_EMSG);
+    io_threads_ = io_threads;
+    readahead_chunks_ = readahead;
+    adaptive_uploads_ = adaptive_uploads;
+    chunk_size_ = DEFAULT_CHUNK_SIZE;
+    mkdir(dir_.c_str(), 0750);
+  }
+
+  ~LocalChunkedDevice() { CloseChunk(); }
+
+  std::atomic<int> uploads{0};
+  std::atomic<int> reads{0};
+  std::atomic<int> max_parallel_uploads{0};
+  std::atomic<int> max_parallel_reads{0};
+
+  /* When set uploaded chunks are thrown away instead of stored */
+  bool discard{false};
+
+  /*
+   * While the gate is closed uploads block in the backend, so the number of
+   * io-threads uploading at the same time can be looked at.
+   */
+  void CloseGate()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gate_closed_ = true;
+  }
+  void OpenGate()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gate_closed_ = false;
+    cv_.notify_all();
+  }
+
+  /* Wait until uploads are blocked at the closed gate */
+  bool WaitForBlockedUploads(int uploads)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(30),
+                        [&] { return blocked_uploads_ >= uploads; });
+  }
+  bool WaitForUploads(int count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(30),
+                        [&] { return uploads >= count; });
+  }
+  int BlockedUploads()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocked_uploads_;
+  }
+
+  /*
+   * Make the first reads ahead wait for each other, so they only get through
+   * when that many of them run at the same time.
+   */
+  void SetReadBarrier(int reads)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_barrier_ = reads;
+  }
+
+  bool Open(const char* volname, int flags)
+  {
+    bstrncpy(VolCatInfo.VolCatName, volname, sizeof(VolCatInfo.VolCatName));
+    return SetupChunk(volname, flags, 0640) == 0;
+  }
+  ssize_t Write(const void* buffer, size_t count)
+  {
+    return WriteChunked(0, buffer, count);
+  }
+  ssize_t Read(void* buffer, size_t count)
+  {
+    return ReadChunked(0, buffer, count);
+  }
+  bool Flush() { return WaitUntilChunksWritten(); }
+  int Close() { return CloseChunk(); }
+
+  std::string ChunkName(const char* volname, uint16_t chunk)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "%04d", chunk);
+    return dir_ + "/" + volname + "/" + name;
+  }
+
+ protected:
+  bool CheckRemote() override { return true; }
+  bool remote_chunked_volume_exists() override { return true; }
+
+  bool FlushRemoteChunk(chunk_io_request* request) override
+  {
+    bool ok = true;
+
+    /* Like the real backends, so WaitUntilChunksWritten() waits for us */
+    if (!SetInflightChunk(request)) { return false; }
+
+    int parallel = ++parallel_uploads_;
+    int max = max_parallel_uploads;
+    while (parallel > max &&
+           !max_parallel_uploads.compare_exchange_weak(max, parallel)) {}
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      blocked_uploads_++;
+      cv_.notify_all();
+      cv_.wait(lock, [this] { return !gate_closed_; });
+      blocked_uploads_--;
+    }
+
+    if (!discard) {
+      mkdir((dir_ + "/" + request->volname).c_str(), 0750);
+      std::ofstream out(ChunkName(request->volname, request->chunk),
+                        std::ios::binary | std::ios::trunc);
+      out.write(request->buffer, request->wbuflen);
+      ok = out.good();
+    }
+    parallel_uploads_--;
+    ClearInflightChunk(request);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      uploads++;
+      cv_.notify_all();
+    }
+
+    return ok;
+  }
+
+  bool ReadRemoteChunk(chunk_io_request* request) override
+  {
+    int parallel = ++parallel_reads_;
+    int max = max_parallel_reads;
+    while (parallel > max &&
+           !max_parallel_reads.compare_exchange_weak(max, parallel)) {}
+
+    if (request->readahead) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.notify_all();
+      if (read_barrier_ &&
+          cv_.wait_for(lock, std::chrono::seconds(30),
+                       [&] { return parallel_reads_ >= read_barrier_; })) {
+        read_barrier_ = 0;
+      }
+    }
+
+    std::ifstream in(ChunkName(request->volname, request->chunk),
+                     std::ios::binary);
+    if (!in) {
+      /* Like the real backends, reads ahead don't report errors */
+      if (!request->readahead) { dev_errno = EIO; }
+      parallel_reads_--;
+      return false;
+    }
+    in.read(request->buffer, request->wbuflen);
+    *request->rbuflen = in.gcount();
+    reads++;
+    parallel_reads_--;
+    return true;
+  }
+
+  ssize_t chunked_remote_volume_size() override
+  {
+    ssize_t size = 0;
+    struct stat st;
+
+    for (uint16_t chunk = 0; chunk < MAX_CHUNKS; chunk++) {
+      if (stat(ChunkName(getVolCatName(), chunk).c_str(), &st) != 0) { break; }
+      size += st.st_size;
+    }
+    return size;
+  }
+
+  bool TruncateRemoteChunkedVolume(DeviceControlRecord* dcr) override
+  {
+    return true;
+  }
+
+  int d_open(const char* pathname, int flags, int mode) override { return -1; }
+  int d_close(int fd) override { return -1; }
+  int d_ioctl(int fd, ioctl_req_t request, char* mt = NULL) override
+  {
+    return -1;
+  }
+  boffset_t d_lseek(DeviceControlRecord* dcr,
+                    boffset_t offset,
+                    int whence) override
+  {
+    return -1;
+  }
+  ssize_t d_read(int fd, void* buffer, size_t count) override { return -1; }
+  ssize_t d_write(int fd, const void* buffer, size_t count) override
+  {
+    return -1;
+  }
+  bool d_truncate(DeviceControlRecord* dcr) override { return true; }
+
+ private:
+  std::string dir_;
+  std::atomic<int> parallel_uploads_{0};
+  std::atomic<int> parallel_reads_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool gate_closed_{false};
+  int blocked_uploads_{0};
+  int read_barrier_{0};
+};
+
+class ChunkedDevice : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    char tmpl[] = "/tmp/test_chunked_device.XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    dir_ = tmpl;
+    me = new StorageResource;
+    me->working_directory = strdup(dir_.c_str());
+  }
+  void TearDown() override
+  {
+    free(me->working_directory);
+    me->working_directory = nullptr;
+    delete me;
+    me = nullptr;
+    std::string cmd = "rm -rf " + dir_;
+    EXPECT_EQ(system(cmd.c_str()), 0);
+  }
+
+  static std::vector<char> Pattern(size_t size)
+  {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; i++) { data[i] = (char)(i * 7 + i / 4096); }
+    return data;
+  }
+
+  void WriteVolume(LocalChunkedDevice& dev,
+                   const char* volname,
+                   const std::vector<char>& data)
+  {
+    ASSERT_TRUE(dev.Open(volname, O_CREAT | O_RDWR));
+    for (size_t done = 0; done < data.size(); done += 64 * 1024) {
+      size_t len = std::min<size_t>(64 * 1024, data.size() - done);
+      ASSERT_EQ(dev.Write(data.data() + done, len), (ssize_t)len);
+    }
+    ASSERT_TRUE(dev.Flush());
+    ASSERT_EQ(dev.Close(), 0);
+  }
+
+  /*
+   * Open a volume on a discarding device and wait until the first chunk
+   * created by the open is uploaded, so it can't collide with the one
+   * written next.
+   */
+  void OpenDiscarding(LocalChunkedDevice& dev, const char* volname)
+  {
+    dev.discard = true;
+    ASSERT_TRUE(dev.Open(volname, O_CREAT | O_RDWR));
+    ASSERT_TRUE(dev.WaitForUploads(1));
+  }
+
+  /* Write full chunks, the last one stays in the chunk buffer */
+  void WriteChunks(LocalChunkedDevice& dev, int chunks)
+  {
+    std::vector<char> data(64 * 1024, 'x');
+
+    for (size_t done = 0; done < (size_t)chunks * DEFAULT_CHUNK_SIZE;
+         done += data.size()) {
+      ASSERT_EQ(dev.Write(data.data(), data.size()), (ssize_t)data.size());
+    }
+  }
+
+  std::string dir_;
+};
+
+static std::string Status(chunked_device& dev)
+{
+  DeviceStatusInformation dst;
+  dst.status = GetPoolMemory(PM_MESSAGE);
+  dev.DeviceStatus(&dst);
+  std::string status(dst.status);
+  FreePoolMemory(dst.status);
+  return status;
+}
+
+TEST_F(ChunkedDevice, readahead_returns_same_data)
+{
+  auto data = Pattern(5 * DEFAULT_CHUNK_SIZE + 12345);
+  {
+    LocalChunkedDevice writer(dir_ + "/store", 0, 0);
+    WriteVolume(writer, "Vol-0001", data);
+  }
+
+  LocalChunkedDevice reader(dir_ + "/store", 3, 3);
+  ASSERT_TRUE(reader.Open("Vol-0001", O_RDONLY));
+
+  std::vector<char> back(data.size() + 1000);
+  size_t done = 0;
+  ssize_t len;
+  while ((len = reader.Read(back.data() + done, 64 * 1024)) > 0) {
+    done += len;
+  }
+  ASSERT_EQ(done, data.size());
+  back.resize(done);
+  EXPECT_TRUE(back == data);
+
+  std::string status = Status(reader);
+  EXPECT_NE(status.find("Read ahead: 3 chunks, 5 hits"), std::string::npos)
+      << status;
+  EXPECT_EQ(reader.reads, 6);
+  EXPECT_EQ(reader.Close(), 0);
+}
+
+TEST_F(ChunkedDevice, reads_ahead_in_parallel_on_the_io_threads)
+{
+  auto data = Pattern(8 * DEFAULT_CHUNK_SIZE);
+  {
+    LocalChunkedDevice writer(dir_ + "/store", 0, 0);
+    WriteVolume(writer, "Vol-0002", data);
+  }
+
+  /*
+   * The first three reads ahead only get through when they run at the
+   * same time, so this hangs (and times out) if they are serialized.
+   */
+  LocalChunkedDevice reader(dir_ + "/store", 3, 3);
+  reader.SetReadBarrier(3);
+  ASSERT_TRUE(reader.Open("Vol-0002", O_RDONLY));
+
+  std::vector<char> back(data.size());
+  size_t done = 0;
+  ssize_t len;
+  while (done < back.size() &&
+         (len = reader.Read(back.data() + done, back.size() - done)) > 0) {
+    done += len;
+  }
+  EXPECT_TRUE(back == data);
+  EXPECT_EQ(reader.max_parallel_reads, 3);
+  EXPECT_EQ(reader.Close(), 0);
+}
+
+TEST_F(ChunkedDevice, all_io_threads_upload_by_default)
+{
+  LocalChunkedDevice dev(dir_ + "/store", 4, 0);
+
+  OpenDiscarding(dev, "Vol-0003");
+  dev.CloseGate();
+  WriteChunks(dev, 6);
+  EXPECT_TRUE(dev.WaitForBlockedUploads(4));
+  dev.OpenGate();
+
+  /* The chunk opened and the six written, the last one by the close */
+  EXPECT_EQ(dev.Close(), 0);
+  EXPECT_TRUE(dev.WaitForUploads(7));
+  EXPECT_EQ(dev.max_parallel_uploads, 4);
+
+  std::string status = Status(dev);
+  EXPECT_NE(status.find("Upload concurrency: 4 of 4"), std::string::npos)
+      << status;
+}
+
+TEST_F(ChunkedDevice, adaptive_uploads_start_with_half_the_io_threads)
+{
+  LocalChunkedDevice dev(dir_ + "/store", 4, 0, true);
+
+  OpenDiscarding(dev, "Vol-0004");
+  dev.CloseGate();
+  WriteChunks(dev, 6);
+  EXPECT_TRUE(dev.WaitForBlockedUploads(2));
+
+  /*
+   * The other io-threads wait for an upload slot, no sample window has
+   * been completed so nothing may raise the concurrency.
+   */
+  Bmicrosleep(0, 100000);
+  EXPECT_EQ(dev.BlockedUploads(), 2);
+  EXPECT_EQ(dev.max_parallel_uploads, 2);
+  dev.OpenGate();
+
+  /* The chunk opened and the six written, the last one by the close */
+  EXPECT_EQ(dev.Close(), 0);
+  EXPECT_TRUE(dev.WaitForUploads(7));
+}
+
+TEST_F(ChunkedDevice, uploads_with_adaptive_concurrency)
+{
+  auto data = Pattern(24 * DEFAULT_CHUNK_SIZE);
+  LocalChunkedDevice dev(dir_ + "/store", 4, 0, true);
+
+  WriteVolume(dev, "Vol-0005", data);
+  EXPECT_GE(dev.uploads, 24);
+  EXPECT_GE(dev.max_parallel_uploads, 1);
+  EXPECT_LE(dev.max_parallel_uploads, 4);
+
+  std::string status = Status(dev);
+  EXPECT_NE(status.find("Upload concurrency: "), std::string::npos) << status;
+  EXPECT_NE(status.find("Uploaded chunks: "), std::string::npos) << status;
+
+  LocalChunkedDevice reader(dir_ + "/store", 0, 0);
+  ASSERT_TRUE(reader.Open("Vol-0005", O_RDONLY));
+  std::vector<char> back(data.size());
+  size_t done = 0;
+  ssize_t len;
+  while (done < back.size() &&
+         (len = reader.Read(back.data() + done, back.size() - done)) > 0) {
+    done += len;
+  }
+  EXPECT_TRUE(back == data);
+}
+
+/*
+ * Feed the tuner rounds of uploads that all take latency(concurrency)
+ * usec and finish at the same time, on a virtual clock.
+ */
+template <typename Latency>
+static uint8_t Tune(UploadConcurrencyTuner& tuner, int rounds, Latency latency)
+{
+  btime_t now = 0;
+
+  for (int round = 0; round < rounds; round++) {
+    uint8_t concurrency = tuner.Concurrency();
+    btime_t elapsed = latency(concurrency);
+
+    now += elapsed;
+    for (uint8_t i = 0; i < concurrency; i++) {
+      tuner.Sample(DEFAULT_CHUNK_SIZE, elapsed, now, true);
+    }
+  }
+  return tuner.Concurrency();
+}
+
+TEST(UploadConcurrencyTuner, raises_concurrency_while_uploads_scale)
+{
+  UploadConcurrencyTuner tuner(2, 4);
+
+  /*
+   * With a constant latency per upload more uploads at the same time give
+   * more throughput, so the concurrency grows up to all io-threads.
+   */
+  EXPECT_EQ(Tune(tuner, 40, [](uint8_t) { return 100000; }), 4);
+}
+
+TEST(UploadConcurrencyTuner, lowers_concurrency_when_latency_rises)
+{
+  UploadConcurrencyTuner tuner(2, 4);
+
+  /*
+   * On a saturated store the latency grows faster than the number of
+   * uploads at the same time, so the concurrency goes down to one.
+   */
+  EXPECT_EQ(Tune(tuner, 40, [](uint8_t n) { return 60000 * n * n; }), 1);
+}
+
+TEST(UploadConcurrencyTuner, only_grows_with_a_backlog)
+{
+  UploadConcurrencyTuner tuner(2, 4);
+  btime_t now = 0;
+
+  for (int round = 0; round < 40; round++) {
+    now += 100000;
+    for (int i = 0; i < 2; i++) {
+      EXPECT_FALSE(tuner.Sample(DEFAULT_CHUNK_SIZE, 100000, now, false));
+    }
+  }
+  EXPECT_EQ(tuner.Concurrency(), 2);
+}
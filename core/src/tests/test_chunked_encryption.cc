@@ -0,0 +1,323 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "lib/alist.h"
+#include "lib/crypto.h"
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const crypto_cipher_t chunked_ciphers[] = {
+    CRYPTO_CIPHER_AES_128_GCM, CRYPTO_CIPHER_AES_256_GCM,
+    CRYPTO_CIPHER_CHACHA20_POLY1305};
+
+static std::vector<uint8_t> TestData(size_t length, int seed)
+{
+  std::vector<uint8_t> data(length);
+
+  for (size_t i = 0; i < length; i++) {
+    data[i] = (uint8_t)(i * 13 + seed);
+  }
+  return data;
+}
+
+static CRYPTO_SESSION* NewSession(crypto_cipher_t cipher)
+{
+  alist* pubkeys = new alist(1, not_owned_by_alist);
+  CRYPTO_SESSION* session = crypto_session_new(cipher, pubkeys);
+
+  delete pubkeys;
+  return session;
+}
+
+static std::vector<uint8_t> Seal(CIPHER_CONTEXT* ctx,
+                                 const std::vector<uint8_t>& data)
+{
+  std::vector<uint8_t> chunk(data.size() + CRYPTO_AEAD_OVERHEAD);
+  uint32_t written = 0;
+
+  EXPECT_TRUE(CryptoCipherSealChunk(ctx, data.data(), data.size(),
+                                    chunk.data(), &written));
+  EXPECT_EQ(written, chunk.size());
+  return chunk;
+}
+
+static bool Open(CIPHER_CONTEXT* ctx,
+                 const std::vector<uint8_t>& chunk,
+                 std::vector<uint8_t>& data)
+{
+  uint32_t written = 0;
+
+  data.resize(chunk.size());
+  if (!CryptoCipherOpenChunk(ctx, chunk.data(), chunk.size(), data.data(),
+                             &written)) {
+    return false;
+  }
+  data.resize(written);
+  return true;
+}
+
+static std::vector<uint8_t> SealFinal(CIPHER_CONTEXT* ctx)
+{
+  std::vector<uint8_t> chunk(CRYPTO_AEAD_OVERHEAD);
+  uint32_t written = 0;
+
+  EXPECT_TRUE(CryptoCipherFinalize(ctx, chunk.data(), &written));
+  EXPECT_EQ(written, chunk.size());
+  return chunk;
+}
+
+TEST(chunked_encryption, chunks_decrypt_in_order)
+{
+  for (crypto_cipher_t cipher : chunked_ciphers) {
+    CRYPTO_SESSION* session = NewSession(cipher);
+    uint32_t blocksize, written;
+    std::vector<std::vector<uint8_t>> chunks;
+    std::vector<uint8_t> data;
+
+    ASSERT_NE(session, nullptr) << cipher;
+    CIPHER_CONTEXT* encrypt = crypto_cipher_new(session, true, &blocksize);
+    CIPHER_CONTEXT* decrypt = crypto_cipher_new(session, false, &blocksize);
+    ASSERT_NE(encrypt, nullptr);
+    ASSERT_NE(decrypt, nullptr);
+    EXPECT_TRUE(CryptoCipherIsChunked(encrypt));
+    EXPECT_EQ(blocksize, 1u);
+
+    for (int i = 0; i < 8; i++) {
+      chunks.push_back(Seal(encrypt, TestData((i + 1) * 9000, i)));
+    }
+    chunks.push_back(SealFinal(encrypt));
+
+    for (int i = 0; i < 8; i++) {
+      ASSERT_TRUE(Open(decrypt, chunks[i], data)) << cipher;
+      EXPECT_EQ(data, TestData((i + 1) * 9000, i));
+    }
+    ASSERT_TRUE(Open(decrypt, chunks[8], data)) << cipher;
+    EXPECT_TRUE(data.empty());
+    EXPECT_TRUE(CryptoCipherFinalize(decrypt, NULL, &written));
+
+    CryptoCipherFree(encrypt);
+    CryptoCipherFree(decrypt);
+    CryptoSessionFree(session);
+  }
+}
+
+TEST(chunked_encryption, detects_reordered_chunks)
+{
+  for (crypto_cipher_t cipher : chunked_ciphers) {
+    CRYPTO_SESSION* session = NewSession(cipher);
+    uint32_t blocksize;
+    std::vector<std::vector<uint8_t>> chunks;
+    std::vector<uint8_t> data;
+
+    ASSERT_NE(session, nullptr) << cipher;
+    CIPHER_CONTEXT* encrypt = crypto_cipher_new(session, true, &blocksize);
+    CIPHER_CONTEXT* decrypt = crypto_cipher_new(session, false, &blocksize);
+    for (int i = 0; i < 3; i++) {
+      chunks.push_back(Seal(encrypt, TestData(1000, i)));
+    }
+
+    /* Swapped */
+    EXPECT_FALSE(Open(decrypt, chunks[1], data)) << cipher;
+    ASSERT_TRUE(Open(decrypt, chunks[0], data)) << cipher;
+
+    /* Duplicated */
+    EXPECT_FALSE(Open(decrypt, chunks[0], data)) << cipher;
+
+    /* Dropped */
+    EXPECT_FALSE(Open(decrypt, chunks[2], data)) << cipher;
+    EXPECT_TRUE(Open(decrypt, chunks[1], data)) << cipher;
+    EXPECT_TRUE(Open(decrypt, chunks[2], data)) << cipher;
+
+    CryptoCipherFree(encrypt);
+    CryptoCipherFree(decrypt);
+    CryptoSessionFree(session);
+  }
+}
+
+TEST(chunked_encryption, detects_truncated_stream)
+{
+  for (crypto_cipher_t cipher : chunked_ciphers) {
+    CRYPTO_SESSION* session = NewSession(cipher);
+    uint32_t blocksize, written;
+    std::vector<std::vector<uint8_t>> chunks;
+    std::vector<uint8_t> data;
+
+    ASSERT_NE(session, nullptr) << cipher;
+    CIPHER_CONTEXT* encrypt = crypto_cipher_new(session, true, &blocksize);
+    CIPHER_CONTEXT* decrypt = crypto_cipher_new(session, false, &blocksize);
+    for (int i = 0; i < 3; i++) {
+      chunks.push_back(Seal(encrypt, TestData(1000, i)));
+    }
+    std::vector<uint8_t> final_chunk = SealFinal(encrypt);
+
+    /* Nothing can be sealed after the final chunk */
+    std::vector<uint8_t> plain = TestData(10, 0);
+    std::vector<uint8_t> late(plain.size() + CRYPTO_AEAD_OVERHEAD);
+    EXPECT_FALSE(CryptoCipherSealChunk(encrypt, plain.data(), plain.size(),
+                                       late.data(), &written));
+
+    /* An empty data chunk cannot pass as the final chunk */
+    EXPECT_FALSE(CryptoCipherSealChunk(encrypt, plain.data(), 0, late.data(),
+                                       &written));
+
+    for (int i = 0; i < 2; i++) {
+      ASSERT_TRUE(Open(decrypt, chunks[i], data)) << cipher;
+    }
+    EXPECT_FALSE(CryptoCipherFinalize(decrypt, NULL, &written)) << cipher;
+
+    /* The final chunk only opens at the end of the stream */
+    EXPECT_FALSE(Open(decrypt, final_chunk, data)) << cipher;
+    ASSERT_TRUE(Open(decrypt, chunks[2], data)) << cipher;
+    ASSERT_TRUE(Open(decrypt, final_chunk, data)) << cipher;
+    EXPECT_TRUE(CryptoCipherFinalize(decrypt, NULL, &written)) << cipher;
+
+    /* Nothing opens after the final chunk */
+    EXPECT_FALSE(Open(decrypt, chunks[0], data)) << cipher;
+
+    CryptoCipherFree(encrypt);
+    CryptoCipherFree(decrypt);
+    CryptoSessionFree(session);
+  }
+}
+
+TEST(chunked_encryption, nonces_are_unique)
+{
+  CRYPTO_SESSION* session = NewSession(CRYPTO_CIPHER_AES_128_GCM);
+  uint32_t blocksize;
+  std::set<std::string> nonces;
+  std::vector<uint8_t> data = TestData(100, 1);
+
+  ASSERT_NE(session, nullptr);
+  CIPHER_CONTEXT* first = crypto_cipher_new(session, true, &blocksize);
+  CIPHER_CONTEXT* second = crypto_cipher_new(session, true, &blocksize);
+  for (int i = 0; i < 1000; i++) {
+    std::vector<uint8_t> a = Seal(first, data);
+    std::vector<uint8_t> b = Seal(second, data);
+
+    nonces.insert(std::string(a.begin(), a.begin() + CRYPTO_AEAD_NONCE_SIZE));
+    nonces.insert(std::string(b.begin(), b.begin() + CRYPTO_AEAD_NONCE_SIZE));
+  }
+  EXPECT_EQ(nonces.size(), 2000u);
+
+  CryptoCipherFree(first);
+  CryptoCipherFree(second);
+  CryptoSessionFree(session);
+}
+
+TEST(chunked_encryption, detects_modified_data)
+{
+  for (crypto_cipher_t cipher : chunked_ciphers) {
+    CRYPTO_SESSION* session = NewSession(cipher);
+    uint32_t blocksize;
+    std::vector<uint8_t> data;
+
+    ASSERT_NE(session, nullptr) << cipher;
+    CIPHER_CONTEXT* encrypt = crypto_cipher_new(session, true, &blocksize);
+    CIPHER_CONTEXT* decrypt = crypto_cipher_new(session, false, &blocksize);
+    std::vector<uint8_t> chunk = Seal(encrypt, TestData(5000, 3));
+
+    for (size_t pos : {(size_t)0, (size_t)CRYPTO_AEAD_NONCE_SIZE + 100,
+                       chunk.size() - 1}) {
+      std::vector<uint8_t> modified = chunk;
+
+      modified[pos] ^= 0x40;
+      EXPECT_FALSE(Open(decrypt, modified, data)) << cipher << " " << pos;
+    }
+
+    chunk.resize(CRYPTO_AEAD_OVERHEAD - 1);
+    EXPECT_FALSE(Open(decrypt, chunk, data));
+
+    CryptoCipherFree(encrypt);
+    CryptoCipherFree(decrypt);
+    CryptoSessionFree(session);
+  }
+}
+
+TEST(chunked_encryption, contexts_work_in_parallel)
+{
+  CRYPTO_SESSION* session = NewSession(CRYPTO_CIPHER_AES_256_GCM);
+  std::vector<std::vector<std::vector<uint8_t>>> chunks(4);
+  std::vector<std::thread> threads;
+  std::vector<int> errors(4);
+  std::vector<uint8_t> data;
+  uint32_t blocksize;
+
+  ASSERT_NE(session, nullptr);
+
+  /* Every thread seals a stream of its own context of the same session. */
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      uint32_t size;
+      CIPHER_CONTEXT* ctx = crypto_cipher_new(session, true, &size);
+
+      for (int i = 0; i < 16; i++) {
+        std::vector<uint8_t> plain = TestData(65536, t * 16 + i);
+        std::vector<uint8_t> chunk(plain.size() + CRYPTO_AEAD_OVERHEAD);
+        uint32_t written = 0;
+
+        if (!CryptoCipherSealChunk(ctx, plain.data(), plain.size(),
+                                   chunk.data(), &written)) {
+          errors[t]++;
+        }
+        chunks[t].push_back(chunk);
+      }
+      CryptoCipherFree(ctx);
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  EXPECT_EQ(errors, std::vector<int>(4));
+
+  for (int t = 0; t < 4; t++) {
+    CIPHER_CONTEXT* decrypt = crypto_cipher_new(session, false, &blocksize);
+    for (int i = 0; i < 16; i++) {
+      ASSERT_TRUE(Open(decrypt, chunks[t][i], data));
+      EXPECT_EQ(data, TestData(65536, t * 16 + i));
+    }
+    CryptoCipherFree(decrypt);
+  }
+  CryptoSessionFree(session);
+}
+
+TEST(chunked_encryption, stream_ciphers_are_not_chunked)
+{
+  CRYPTO_SESSION* session = NewSession(CRYPTO_CIPHER_AES_128_CBC);
+  uint32_t blocksize;
+  uint8_t buf[64]{};
+  uint32_t written;
+
+  ASSERT_NE(session, nullptr);
+  CIPHER_CONTEXT* ctx = crypto_cipher_new(session, true, &blocksize);
+  ASSERT_NE(ctx, nullptr);
+  EXPECT_FALSE(CryptoCipherIsChunked(ctx));
+  EXPECT_FALSE(CryptoCipherSealChunk(ctx, buf, 8, buf + 8, &written));
+  CryptoCipherFree(ctx);
+  CryptoSessionFree(session);
+}
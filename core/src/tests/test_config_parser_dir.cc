@@ -30,6 +30,8 @@
 #include "dird/dird_globals.h"
 #include "dird/dird_conf.h"
 
+#include <fstream>
+
 namespace directordaemon {
 
 TEST(ConfigParser_Dir, bareos_configparser_tests)
@@ -68,4 +70,173 @@ TEST(ConfigParser_Dir, runscript_test)
   CloseMemoryPool(); /* release free memory in pool */
 }
 
+/*
+ * Generate a director configuration with many clients and two jobs per
+ * client, resembling the configuration of a large deployment.
+ */
+static void GenerateLargeDirConfig(const std::string& filename, int clients)
+{
+  std::ofstream out(filename);
+
+  out << "Director {\n  Name = bareos-dir\n  Password = \"secret\"\n"
+         "  QueryFile = /dev/null\n  Messages = Standard\n}\n"
+         "Catalog {\n  Name = MyCatalog\n  dbdriver = postgresql\n"
+         "  dbname = bareos\n}\n"
+         "Messages {\n  Name = Standard\n  console = all\n}\n"
+         "Pool {\n  Name = Full\n  Pool Type = Backup\n}\n"
+         "Storage {\n  Name = File\n  Address = localhost\n"
+         "  Password = \"secret\"\n  Device = FileStorage\n"
+         "  Media Type = File\n}\n"
+         "FileSet {\n  Name = LinuxAll\n  Include {\n    File = /\n  }\n}\n"
+         "JobDefs {\n  Name = DefaultJob\n  Type = Backup\n"
+         "  Level = Incremental\n  FileSet = LinuxAll\n  Storage = File\n"
+         "  Messages = Standard\n  Pool = Full\n}\n";
+
+  for (int i = 0; i < clients; i++) {
+    out << "Client {\n  Name = client" << i << "-fd\n  Address = client" << i
+        << ".example.com\n  Password = \"secret\"\n}\n";
+    for (int j = 0; j < 2; j++) {
+      out << "Job {\n  Name = job" << i << "-" << j
+          << "\n  JobDefs = DefaultJob\n  Client = client" << i << "-fd\n}\n";
+    }
+  }
+}
+
+/*
+ * Temporary directory holding a single configuration file, both are
+ * removed when it goes out of scope.
+ */
+class TemporaryConfigFile {
+ public:
+  TemporaryConfigFile()
+  {
+    char tmpl[] = "/tmp/test_config_parser_dir.XXXXXX";
+
+    if (mkdtemp(tmpl)) {
+      dir_ = tmpl;
+      filename_ = dir_ + "/bareos-dir.conf";
+    }
+  }
+  ~TemporaryConfigFile()
+  {
+    if (!dir_.empty()) {
+      unlink(filename_.c_str());
+      rmdir(dir_.c_str());
+    }
+  }
+
+  bool Created() const { return !dir_.empty(); }
+  const std::string& Filename() const { return filename_; }
+
+ private:
+  std::string dir_;
+  std::string filename_;
+};
+
+TEST(ConfigParser_Dir, large_generated_config)
+{
+  const int clients = 8000;
+  TemporaryConfigFile config_file;
+  ASSERT_TRUE(config_file.Created());
+  const std::string& filename = config_file.Filename();
+
+  OSDependentInit();
+  InitMsg(NULL, NULL); /* initialize message handler */
+
+  GenerateLargeDirConfig(filename, clients);
+
+  my_config = InitDirConfig(filename.c_str(), M_ERROR_TERM);
+  ASSERT_TRUE(my_config->ParseConfig());
+
+  for (int i = 0; i < clients; i++) {
+    std::string client = "client" + std::to_string(i) + "-fd";
+    std::string job = "job" + std::to_string(i) + "-1";
+
+    ClientResource* client_resource =
+        (ClientResource*)my_config->GetResWithName(R_CLIENT, client.c_str());
+    ASSERT_NE(client_resource, nullptr);
+    JobResource* job_resource =
+        (JobResource*)my_config->GetResWithName(R_JOB, job.c_str());
+    ASSERT_NE(job_resource, nullptr);
+    EXPECT_EQ(job_resource->client, client_resource);
+  }
+  EXPECT_EQ(my_config->GetResWithName(R_JOB, "job0-2"), nullptr);
+
+  delete my_config;
+
+  TermMsg();         /* Terminate message handler */
+  CloseMemoryPool(); /* release free memory in pool */
+}
+
+/*
+ * Free resources saved by SaveResources(), like the director does with the
+ * configuration that is replaced by a reload.
+ */
+static void FreeSavedResources(BareosResource** res)
+{
+  int num = my_config->r_last_ - my_config->r_first_ + 1;
+
+  for (int i = 0; i < num; i++) {
+    my_config->FreeResourceCb_(res[i], my_config->r_first_ + i);
+  }
+  free(res);
+}
+
+TEST(ConfigParser_Dir, name_index_follows_reload)
+{
+  TemporaryConfigFile config_file;
+  ASSERT_TRUE(config_file.Created());
+  const std::string& filename = config_file.Filename();
+
+  OSDependentInit();
+  InitMsg(NULL, NULL); /* initialize message handler */
+
+  GenerateLargeDirConfig(filename, 4);
+  my_config = InitDirConfig(filename.c_str(), M_ERROR_TERM);
+  ASSERT_TRUE(my_config->ParseConfig());
+  ClientResource* old_client =
+      (ClientResource*)my_config->GetResWithName(R_CLIENT, "client3-fd");
+  ASSERT_NE(old_client, nullptr);
+
+  /*
+   * Reload with less clients, as ReloadConfig() does.
+   */
+  BareosResource** prev_config = my_config->SaveResources();
+  EXPECT_EQ(my_config->GetResWithName(R_CLIENT, "client3-fd"), nullptr);
+
+  GenerateLargeDirConfig(filename, 2);
+  ASSERT_TRUE(my_config->ParseConfig());
+  EXPECT_EQ(my_config->GetResWithName(R_CLIENT, "client3-fd"), nullptr);
+  EXPECT_EQ(my_config->GetResWithName(R_JOB, "job2-0"), nullptr);
+  ClientResource* new_client =
+      (ClientResource*)my_config->GetResWithName(R_CLIENT, "client1-fd");
+  ASSERT_NE(new_client, nullptr);
+  JobResource* job = (JobResource*)my_config->GetResWithName(R_JOB, "job1-0");
+  ASSERT_NE(job, nullptr);
+  EXPECT_EQ(job->client, new_client);
+
+  /*
+   * Reset to the previous configuration, as a failed reload does.
+   */
+  BareosResource** temp_config = my_config->SaveResources();
+  my_config->RestoreResources(prev_config);
+  EXPECT_EQ(my_config->GetResWithName(R_CLIENT, "client3-fd"), old_client);
+  EXPECT_NE(my_config->GetResWithName(R_CLIENT, "client1-fd"), new_client);
+  EXPECT_NE(my_config->GetResWithName(R_JOB, "job2-0"), nullptr);
+  FreeSavedResources(temp_config);
+
+  /*
+   * Removed resources are no longer found, the others still are.
+   */
+  EXPECT_TRUE(my_config->RemoveResource(R_JOB, "job2-0"));
+  EXPECT_EQ(my_config->GetResWithName(R_JOB, "job2-0"), nullptr);
+  EXPECT_NE(my_config->GetResWithName(R_JOB, "job2-1"), nullptr);
+  EXPECT_NE(my_config->GetResWithName(R_JOB, "job3-0"), nullptr);
+
+  delete my_config;
+
+  TermMsg();         /* Terminate message handler */
+  CloseMemoryPool(); /* release free memory in pool */
+}
+
 }  // namespace directordaemon
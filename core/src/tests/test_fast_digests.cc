@@ -0,0 +1,201 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "lib/blake3.h"
+#include "lib/crypto.h"
+#include "lib/xxh3.h"
+
+#include <string>
+#include <vector>
+
+struct DigestVector {
+  size_t length;
+  const char* blake3;
+  const char* xxh128;
+};
+
+/* Reference digests of TestData(length), computed with the reference BLAKE3
+ * implementation and with XXH3_128bits() of libxxhash. */
+static const DigestVector vectors[] = {
+    {0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
+     "99aa06d3014798d86001c324468d497f"},
+    {1, "e1e0e81d6ea39b0cf8b86ffd440921011f57400cbc3f76a8a171906a9b8d7505",
+     "22bbb76b211a39ba13e608bc156defed"},
+    {3, "e0d4b43e2edcbbbea40da6029dfa51b9153089348acfc9042b3d45ee13d017aa",
+     "ce31763cbf8245a5a9088dda485b481c"},
+    {4, "32c138c3c2ecc5d803ca85e6831f4731829ff4919df4e30c0e479ccc51f6877b",
+     "47197970590746b1788a609154b0fe20"},
+    {8, "dac9fccdf4419d302834af2e1c6da429fbfc6c54bccc01dff9bd2ae86d57feae",
+     "e3bc8a5f461715553cd024e3d63a1588"},
+    {9, "c129227fe50d0967252ee68671537d0c34026bcd11caa7a2097bc609e8b25358",
+     "c72c88247a9a56d7eafab1c7f123109f"},
+    {16, "f521f3c48127fb7879faeeeb8b7e4283cc7765b58ada8884f1ac724bb5a0cc7a",
+     "ce0b9647ab24f88460d75c5e47d40a24"},
+    {17, "5feec107ee7ae481c9846c23a247e0a92cc293bec365d3429a059f283a21ddc9",
+     "bfd327edcc2fbd12eeed7654312a26d7"},
+    {64, "5be24e499b8524251b3c29a2bf64c6311f06d1ed45b6dbd0fc7969ca1d40a8a1",
+     "fed953fe6a8b2b63aa549d72c69cd267"},
+    {128, "40b4379f467b50fbdc82b8fce0eb3bec0c15bce6fc89d2eba1f8a5c1d037accd",
+     "1b1962a096bac78bc580008b6c92ac53"},
+    {129, "ccb3df3331b4b0a061b7fb23841e1967819c4745df9d9a9ce37c364ca6e4e6cb",
+     "293e4968c4619023bd91ce7ace4d385b"},
+    {240, "e260d6053d8145076ebef85044566ea7ffacb938dd266a29a1b68ca72388262a",
+     "ad46c1021b076bc704e0b5f034bee80b"},
+    {241, "936ce25f88768acdc0384f1daa05d5938a9b57ca22dd6885238170d47df37621",
+     "ac6c3492c3d6b45d8beadd3a8874fe17"},
+    {1023, "b16a55436c00d72a5bbdeae4b0cfb08c88a9cf5aad4de867a4fd0f4526afa8c7",
+     "dedd3c0d6bceed34d26986a0b85dcc44"},
+    {1024, "e3f027f2c0380f4ee59b4213e5bbfc65e5158b27196bb5ea63453a2cbc47a888",
+     "18bc0eaca9a336369b81661c641c72b1"},
+    {1025, "afd7cf3dec77579ce5aaab21256350d354ca4caaef56e897405771d6bb4c0c93",
+     "bf447251cfa98d7c806c2072ed713576"},
+    {4096, "9e3a7ccd40e77a7060d87c025e1a98d250a2911c7c3e5c2f0d99f1232701750e",
+     "1546867423105cd5d7428746842be37e"},
+    {4097, "dc0106879b10043942fec7a334f9b54c8c775fdbb60f90904b513a20370ba5dc",
+     "895472d9c4a4a7d2a51ead018cadb378"},
+    {5000, "99dac71e48bb629da58fe862e286769ac5a0debf976c22bdba71cd34e4c25aa6",
+     "c98ae385d09887cc799aaddd7339581d"},
+    {100000,
+     "3ad0da002894d959d7df8c82686e875fc23a0291d0f869594e9335844a7002cf",
+     "d9e155dd16e141d00c056f6fcc340974"},
+};
+
+static std::vector<uint8_t> TestData(size_t length)
+{
+  std::vector<uint8_t> data(length);
+
+  for (size_t i = 0; i < length; i++) { data[i] = (uint8_t)(i * 7 + 3); }
+  return data;
+}
+
+static std::string Hex(const uint8_t* digest, size_t length)
+{
+  std::string hex;
+  char buf[3];
+
+  for (size_t i = 0; i < length; i++) {
+    snprintf(buf, sizeof(buf), "%02x", digest[i]);
+    hex += buf;
+  }
+  return hex;
+}
+
+static std::string Blake3(const std::vector<uint8_t>& data, size_t piece)
+{
+  BLAKE3_CTX ctx;
+  uint8_t digest[BLAKE3_DIGEST_LENGTH];
+
+  Blake3Init(&ctx);
+  for (size_t pos = 0; pos < data.size(); pos += piece) {
+    Blake3Update(&ctx, data.data() + pos,
+                 std::min(piece, data.size() - pos));
+  }
+  Blake3Final(&ctx, digest);
+  return Hex(digest, sizeof(digest));
+}
+
+static std::string Xxh128(const std::vector<uint8_t>& data, size_t piece)
+{
+  XXH128_CTX ctx;
+  uint8_t digest[XXH128_DIGEST_LENGTH];
+
+  Xxh128Init(&ctx);
+  for (size_t pos = 0; pos < data.size(); pos += piece) {
+    Xxh128Update(&ctx, data.data() + pos, std::min(piece, data.size() - pos));
+  }
+  Xxh128Final(&ctx, digest);
+  return Hex(digest, sizeof(digest));
+}
+
+TEST(fast_digests, blake3_known_answer)
+{
+  BLAKE3_CTX ctx;
+  uint8_t digest[BLAKE3_DIGEST_LENGTH];
+
+  Blake3Init(&ctx);
+  Blake3Update(&ctx, "abc", 3);
+  Blake3Final(&ctx, digest);
+  EXPECT_EQ(Hex(digest, sizeof(digest)),
+            "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+}
+
+TEST(fast_digests, blake3_matches_reference)
+{
+  for (const auto& v : vectors) {
+    std::vector<uint8_t> data = TestData(v.length);
+
+    EXPECT_EQ(Blake3(data, v.length + 1), v.blake3) << v.length;
+    EXPECT_EQ(Blake3(data, 1), v.blake3) << v.length;
+    EXPECT_EQ(Blake3(data, 1000), v.blake3) << v.length;
+    EXPECT_EQ(Blake3(data, 65536), v.blake3) << v.length;
+  }
+}
+
+TEST(fast_digests, xxh128_matches_reference)
+{
+  for (const auto& v : vectors) {
+    std::vector<uint8_t> data = TestData(v.length);
+
+    EXPECT_EQ(Xxh128(data, v.length + 1), v.xxh128) << v.length;
+    EXPECT_EQ(Xxh128(data, 1), v.xxh128) << v.length;
+    EXPECT_EQ(Xxh128(data, 100), v.xxh128) << v.length;
+    EXPECT_EQ(Xxh128(data, 65536), v.xxh128) << v.length;
+  }
+}
+
+TEST(fast_digests, available_through_the_crypto_api)
+{
+  std::vector<uint8_t> data = TestData(5000);
+  uint8_t md[CRYPTO_DIGEST_MAX_SIZE];
+  uint32_t size;
+  DIGEST* digest;
+
+  digest = crypto_digest_new(nullptr, CRYPTO_DIGEST_BLAKE3);
+  ASSERT_NE(digest, nullptr);
+  EXPECT_TRUE(CryptoDigestUpdate(digest, data.data(), 3000));
+  EXPECT_TRUE(CryptoDigestUpdate(digest, data.data() + 3000, 2000));
+  size = sizeof(md);
+  EXPECT_TRUE(CryptoDigestFinalize(digest, md, &size));
+  EXPECT_EQ(Hex(md, size), Blake3(data, data.size()));
+  EXPECT_STREQ(crypto_digest_name(digest), "BLAKE3");
+  CryptoDigestFree(digest);
+
+  digest = crypto_digest_new(nullptr, CRYPTO_DIGEST_XXH128);
+  ASSERT_NE(digest, nullptr);
+  EXPECT_TRUE(CryptoDigestUpdate(digest, data.data(), data.size()));
+  size = sizeof(md);
+  EXPECT_TRUE(CryptoDigestFinalize(digest, md, &size));
+  EXPECT_EQ(Hex(md, size), Xxh128(data, data.size()));
+  EXPECT_STREQ(crypto_digest_name(digest), "XXH128");
+  CryptoDigestFree(digest);
+
+  EXPECT_EQ(CryptoDigestStreamType(STREAM_BLAKE3_DIGEST),
+            CRYPTO_DIGEST_BLAKE3);
+  EXPECT_EQ(CryptoDigestStreamType(STREAM_XXH128_DIGEST),
+            CRYPTO_DIGEST_XXH128);
+}
@@ -0,0 +1,166 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "dird/file_index_cache.h"
+
+#include <string>
+#include <vector>
+
+using namespace directordaemon;
+
+static JobFileRecord Record(const char* path,
+                            const char* name,
+                            int32_t FileIndex,
+                            int32_t DeltaSeq = 0)
+{
+  JobFileRecord r;
+
+  r.path = path;
+  r.name = name;
+  r.FileIndex = FileIndex;
+  r.DeltaSeq = DeltaSeq;
+  r.lstat = std::string("lstat-") + name + "-" + std::to_string(FileIndex);
+  r.fhinfo = FileIndex * 10;
+  r.fhnode = -FileIndex;
+  return r;
+}
+
+struct Row {
+  std::string path, name, FileIndex, JobId, lstat, DeltaSeq, fhinfo, fhnode;
+};
+
+static int CollectRows(void* ctx, int num_fields, char** row)
+{
+  std::vector<Row>* rows = static_cast<std::vector<Row>*>(ctx);
+
+  EXPECT_EQ(num_fields, 8);
+  rows->push_back(
+      Row{row[0], row[1], row[2], row[3], row[4], row[5], row[6], row[7]});
+
+  /* Like insert_tree_node() the handler may modify the strings. */
+  row[0][0] = '\0';
+  return 0;
+}
+
+TEST(file_index_cache, saves_and_loads_an_index)
+{
+  std::string filename = std::string(TEST_TEMP_DIR) + "/test.1.findex";
+  std::vector<JobFileRecord> records{
+      Record("/b/", "file", 3), Record("/a/", "", 1),
+      Record("/a/", "z", 2), Record("/a/", "y", 4)};
+  JobFileIndex index, loaded;
+
+  ASSERT_TRUE(index.Build(1, 1000, 4, records));
+  ASSERT_TRUE(index.Save(filename.c_str()));
+
+  EXPECT_FALSE(loaded.Load(filename.c_str(), 1, 1001, 4));
+  EXPECT_FALSE(loaded.Load(filename.c_str(), 1, 1000, 5));
+  EXPECT_FALSE(loaded.Load(filename.c_str(), 2, 1000, 4));
+  ASSERT_TRUE(loaded.Load(filename.c_str(), 1, 1000, 4));
+
+  ASSERT_EQ(loaded.size(), 4u);
+  EXPECT_EQ(loaded.JobId(), 1u);
+  EXPECT_EQ(loaded.JobTDate(), 1000);
+  EXPECT_STREQ(loaded.Path(0), "/a/");
+  EXPECT_STREQ(loaded.Name(0), "");
+  EXPECT_STREQ(loaded.Name(1), "y");
+  EXPECT_STREQ(loaded.Name(2), "z");
+  EXPECT_STREQ(loaded.Path(3), "/b/");
+  EXPECT_EQ(loaded.FileIndex(3), 3);
+  EXPECT_STREQ(loaded.LStat(3), "lstat-file-3");
+  EXPECT_EQ(loaded.Fhinfo(3), 30);
+  EXPECT_EQ(loaded.Fhnode(3), -3);
+
+  unlink(filename.c_str());
+}
+
+TEST(file_index_cache, rejects_damaged_files)
+{
+  std::string filename = std::string(TEST_TEMP_DIR) + "/test.2.findex";
+  std::vector<JobFileRecord> records{Record("/a/", "x", 1)};
+  JobFileIndex index, loaded;
+  FILE* fp;
+
+  ASSERT_TRUE(index.Build(2, 1000, 1, records));
+  ASSERT_TRUE(index.Save(filename.c_str()));
+  ASSERT_EQ(truncate(filename.c_str(), 60), 0);
+  EXPECT_FALSE(loaded.Load(filename.c_str(), 2, 1000, 1));
+
+  fp = fopen(filename.c_str(), "w");
+  ASSERT_NE(fp, nullptr);
+  fputs("garbage", fp);
+  fclose(fp);
+  EXPECT_FALSE(loaded.Load(filename.c_str(), 2, 1000, 1));
+
+  unlink(filename.c_str());
+  EXPECT_FALSE(loaded.Load(filename.c_str(), 2, 1000, 1));
+}
+
+TEST(file_index_cache, merge_selects_most_recent_versions)
+{
+  std::vector<JobFileRecord> full{Record("/a/", "", 1), Record("/a/", "x", 2),
+                                  Record("/a/", "y", 3),
+                                  Record("/a/", "db", 4)};
+  std::vector<JobFileRecord> incr1{Record("/a/", "x", 1),
+                                   Record("/a/", "db", 2, 1)};
+  std::vector<JobFileRecord> incr2{Record("/a/", "y", 0),
+                                   Record("/a/", "db", 1, 2),
+                                   Record("/b/", "new", 2)};
+  JobFileIndex i1, i2, i3;
+  std::vector<Row> rows;
+
+  ASSERT_TRUE(i1.Build(10, 100, 4, full));
+  ASSERT_TRUE(i2.Build(11, 200, 2, incr1));
+  ASSERT_TRUE(i3.Build(12, 300, 3, incr2));
+
+  MergeJobFileIndexes({&i1, &i2, &i3}, CollectRows, &rows);
+
+  /* Ordered by job and FileIndex, y was deleted by the last job. */
+  ASSERT_EQ(rows.size(), 6u);
+  EXPECT_EQ(rows[0].JobId, "10");
+  EXPECT_EQ(rows[0].path, "/a/");
+  EXPECT_EQ(rows[0].name, "");
+  EXPECT_EQ(rows[1].JobId, "10");
+  EXPECT_EQ(rows[1].name, "db");
+  EXPECT_EQ(rows[1].DeltaSeq, "0");
+  EXPECT_EQ(rows[2].JobId, "11");
+  EXPECT_EQ(rows[2].name, "x");
+  EXPECT_EQ(rows[2].FileIndex, "1");
+  EXPECT_EQ(rows[2].lstat, "lstat-x-1");
+  EXPECT_EQ(rows[3].JobId, "11");
+  EXPECT_EQ(rows[3].name, "db");
+  EXPECT_EQ(rows[3].DeltaSeq, "1");
+  EXPECT_EQ(rows[4].JobId, "12");
+  EXPECT_EQ(rows[4].name, "db");
+  EXPECT_EQ(rows[4].DeltaSeq, "2");
+  EXPECT_EQ(rows[5].JobId, "12");
+  EXPECT_EQ(rows[5].path, "/b/");
+  EXPECT_EQ(rows[5].name, "new");
+  EXPECT_EQ(rows[5].fhinfo, "20");
+  EXPECT_EQ(rows[5].fhnode, "-2");
+}
@@ -26,6 +26,7 @@
 #include "include/bareos.h"
 #endif
 
+#include "cats/cats.h"
 #include "dird/bsr.h"
 
 #include <algorithm>
@@ -210,3 +211,100 @@ TEST(fileindex_list, gap_list_duplicates_random_order)
   std::shuffle(fileIds.begin(), fileIds.end(), std::default_random_engine{});
   EXPECT_EQ(ToBsrStringLocal(fileIds), ToBsrStringBareos(fileIds));
 }
+
+static void AddVolume(RestoreBootstrapRecord* bsr,
+                      const char* VolumeName,
+                      uint64_t StartAddr,
+                      uint64_t EndAddr,
+                      uint32_t FirstIndex,
+                      uint32_t LastIndex)
+{
+  VolumeParameters vp{};
+
+  bstrncpy(vp.VolumeName, VolumeName, sizeof(vp.VolumeName));
+  vp.StartAddr = StartAddr;
+  vp.EndAddr = EndAddr;
+  vp.FirstIndex = FirstIndex;
+  vp.LastIndex = LastIndex;
+  bsr->VolParams = (VolumeParameters*)realloc(
+      bsr->VolParams, (bsr->VolCount + 1) * sizeof(VolumeParameters));
+  bsr->VolParams[bsr->VolCount++] = vp;
+}
+
+TEST(fileindex_list, read_plan_merges_adjacent_jobmedia)
+{
+  RestoreBootstrapRecord full(1), inc1(2);
+
+  full.fi->AddAll();
+  AddVolume(&full, "A", 0, 100, 1, 50);
+  AddVolume(&full, "A", 101, 200, 50, 100);
+  AddVolume(&full, "B", 0, 100, 100, 150);
+  inc1.fi->Add(3);
+  AddVolume(&inc1, "A", 300, 400, 1, 10);
+  AddVolume(&inc1, "A", 401, 450, 11, 20);
+
+  auto plan = PlanBsrReads({&full, &inc1});
+  ASSERT_EQ(plan.size(), 3);
+
+  EXPECT_EQ(plan[0].bsr, &full);
+  EXPECT_EQ(plan[0].StartAddr, 0);
+  EXPECT_EQ(plan[0].EndAddr, 200);
+  EXPECT_EQ(plan[0].FirstIndex, 1);
+  EXPECT_EQ(plan[0].LastIndex, 100);
+  EXPECT_STREQ(full.VolParams[plan[1].VolIndex].VolumeName, "B");
+  EXPECT_EQ(plan[1].bsr, &full);
+  EXPECT_TRUE(plan[1].continued);
+  EXPECT_EQ(plan[2].bsr, &inc1);
+  EXPECT_EQ(plan[2].EndAddr, 400);
+  EXPECT_FALSE(plan[2].continued);
+
+  /* second JobMedia of inc1 holds no selected file */
+  EXPECT_EQ(inc1.VolParams[1].VolumeName[0], 0);
+}
+
+TEST(fileindex_list, read_plan_keeps_job_order_across_volumes)
+{
+  RestoreBootstrapRecord inc1(1), inc2(2), inc3(3);
+
+  inc1.fi->AddAll();
+  AddVolume(&inc1, "I1", 0, 100, 1, 10);
+  inc2.fi->AddAll();
+  AddVolume(&inc2, "I2", 0, 100, 1, 10);
+  inc3.fi->AddAll();
+  AddVolume(&inc3, "I1", 200, 300, 1, 10);
+
+  auto plan = PlanBsrReads({&inc1, &inc2, &inc3});
+  ASSERT_EQ(plan.size(), 3);
+
+  EXPECT_EQ(plan[0].bsr, &inc1);
+  EXPECT_EQ(plan[1].bsr, &inc2);
+  EXPECT_EQ(plan[2].bsr, &inc3);
+}
+
+TEST(fileindex_list, read_plan_follows_volume_addresses_across_jobs)
+{
+  RestoreBootstrapRecord full(1), inc1(2), inc2(3);
+
+  /* inc1 ran while full was writing, its data is between full's parts */
+  full.fi->Add(5);
+  full.fi->Add(25);
+  AddVolume(&full, "A", 0, 100, 1, 10);
+  AddVolume(&full, "A", 150, 250, 11, 20);
+  AddVolume(&full, "A", 500, 600, 21, 30);
+  inc1.fi->AddAll();
+  AddVolume(&inc1, "A", 300, 400, 1, 10);
+  inc2.fi->AddAll();
+  AddVolume(&inc2, "B", 0, 100, 1, 10);
+
+  auto plan = PlanBsrReads({&full, &inc1, &inc2});
+  ASSERT_EQ(plan.size(), 4);
+
+  EXPECT_EQ(plan[0].bsr, &full);
+  EXPECT_EQ(plan[0].StartAddr, 0);
+  EXPECT_EQ(plan[1].bsr, &inc1);
+  EXPECT_EQ(plan[1].StartAddr, 300);
+  EXPECT_EQ(plan[2].bsr, &full);
+  EXPECT_EQ(plan[2].StartAddr, 500);
+  EXPECT_EQ(plan[2].FirstIndex, 21);
+  EXPECT_EQ(plan[3].bsr, &inc2);
+}
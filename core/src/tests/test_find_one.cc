@@ -0,0 +1,115 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "include/jcr.h"
+#include "findlib/find.h"
+#include "findlib/find_one.h"
+
+#include <fstream>
+#include <map>
+#include <string>
+
+static std::string root;
+static std::map<std::string, int> found;
+static std::map<std::string, std::string> contents;
+static int relative_entries;
+
+static int SaveFile(JobControlRecord* jcr, FindFilesPacket* ff, bool top_level)
+{
+  std::string name(ff->fname);
+
+  found[name.substr(root.size())] = ff->type;
+  if (ff->dir_fd >= 0) {
+    relative_entries++;
+    EXPECT_EQ(name.substr(name.size() - strlen(ff->dir_relname)),
+              ff->dir_relname);
+  }
+
+  if (ff->type == FT_REG) {
+    char buf[256];
+    ssize_t len;
+
+    binit(&ff->bfd);
+    EXPECT_GE(BopenAt(&ff->bfd, ff->dir_fd, ff->dir_relname, ff->fname,
+                      O_RDONLY, 0, 0),
+              0);
+    len = bread(&ff->bfd, buf, sizeof(buf));
+    EXPECT_GT(len, 0);
+    contents[name.substr(root.size())] = std::string(buf, len);
+    EXPECT_FALSE(HasFileChanged(jcr, ff));
+    bclose(&ff->bfd);
+  }
+
+  return 1;
+}
+
+static void WriteFile(const std::string& path, const std::string& data)
+{
+  std::ofstream out(path);
+  out << data;
+}
+
+TEST(FindOne, traverses_tree_relative_to_directories)
+{
+  char tmpl[] = "/tmp/test_find_one.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpl), nullptr);
+  root = tmpl;
+
+  ASSERT_EQ(mkdir((root + "/a").c_str(), 0750), 0);
+  ASSERT_EQ(mkdir((root + "/a/b").c_str(), 0750), 0);
+  ASSERT_EQ(mkdir((root + "/a/b/c").c_str(), 0750), 0);
+  ASSERT_EQ(mkdir((root + "/a/empty").c_str(), 0750), 0);
+  WriteFile(root + "/a/b/c/deep", "deep file");
+  WriteFile(root + "/top", "top file");
+  ASSERT_EQ(symlink("top", (root + "/a/link").c_str()), 0);
+
+  JobControlRecord jcr;
+  FindFilesPacket* ff = init_find_files();
+  std::string top = root + "/";
+
+  EXPECT_EQ(FindOneFile(&jcr, ff, SaveFile, const_cast<char*>(top.c_str()),
+                        (dev_t)-1, true),
+            1);
+  EXPECT_EQ(ff->dir_fd, -1);
+
+  EXPECT_EQ(found["/a/b/c/deep"], FT_REG);
+  EXPECT_EQ(found["/top"], FT_REG);
+  EXPECT_EQ(found["/a/link"], FT_LNK);
+  EXPECT_EQ(found["/a/b/c"], FT_DIREND);
+  EXPECT_EQ(found["/a/empty"], FT_DIREND);
+  EXPECT_EQ(contents["/a/b/c/deep"], "deep file");
+  EXPECT_EQ(contents["/top"], "top file");
+
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+  EXPECT_GT(relative_entries, 0);
+#endif
+
+  TermFindFiles(ff);
+  std::string cmd = "rm -rf " + root;
+  EXPECT_EQ(system(cmd.c_str()), 0);
+}
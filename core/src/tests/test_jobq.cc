@@ -0,0 +1,155 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "dird/dird_globals.h"
+#include "dird/dird_conf.h"
+#include "dird/jcr_private.h"
+#include "dird/job.h"
+#include "dird/jobq.h"
+#define DIRECTOR_DAEMON
+#include "include/jcr.h"
+#include "lib/parse_conf.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace directordaemon;
+
+namespace directordaemon {
+bool DoReloadConfig() { return false; }
+}  // namespace directordaemon
+
+static std::atomic<int> jobs_started{0};
+static std::atomic<bool> jobs_may_end{false};
+
+static void* RunJob(void* arg)
+{
+  JobControlRecord* jcr = (JobControlRecord*)arg;
+
+  jobs_started++;
+  while (!jobs_may_end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  jcr->setJobStatus(JS_Terminated);
+
+  return NULL;
+}
+
+static bool WaitForJobsStarted(int count, std::chrono::milliseconds timeout)
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (jobs_started < count) {
+    if (std::chrono::steady_clock::now() > deadline) { return false; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
+static JobControlRecord* NewTestJcr(JobResource* job)
+{
+  JobControlRecord* jcr = NewDirectorJcr();
+
+  jcr->impl->res.job = job;
+  jcr->setJobType(JT_BACKUP);
+  jcr->setJobStatus(JS_WaitJobRes);
+  jcr->JobPriority = job->Priority;
+
+  return jcr;
+}
+
+/*
+ * Wait until the job queue skipped a waiting job more than skipped times.
+ */
+static bool WaitForSkipped(jobq_t* jq,
+                           uint64_t skipped,
+                           jobq_statistics_t* stats)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+  do {
+    JobqGetStatistics(jq, stats);
+    if (stats->acquire_skipped > skipped) { return true; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  } while (std::chrono::steady_clock::now() < deadline);
+
+  return false;
+}
+
+TEST(jobq, raised_limit_lets_waiting_job_start)
+{
+  jobq_t jq;
+
+  InitMsg(NULL, NULL);
+  OSDependentInit();
+
+  std::string path_to_config_file =
+      std::string(RELATIVE_PROJECT_SOURCE_DIR "/configs/scheduler-hourly");
+  my_config = InitDirConfig(path_to_config_file.c_str(), M_ERROR_TERM);
+  ASSERT_TRUE(my_config);
+  ASSERT_TRUE(my_config->ParseConfig());
+
+  JobResource* job = (JobResource*)my_config->GetResWithName(
+      R_JOB, "backup-bareos-fd");
+  ASSERT_NE(job, nullptr);
+  job->MaxConcurrentJobs = 1;
+
+  ASSERT_EQ(JobqInit(&jq, 2, RunJob), 0);
+  ASSERT_EQ(JobqAdd(&jq, NewTestJcr(job)), 0);
+  ASSERT_EQ(JobqAdd(&jq, NewTestJcr(job)), 0);
+  EXPECT_TRUE(WaitForJobsStarted(1, std::chrono::seconds(5)));
+
+  /*
+   * The second job waits for the job resource and is skipped while the
+   * resource releases no slot, even after the limit was raised.
+   */
+  jobq_statistics_t stats;
+  ASSERT_TRUE(WaitForSkipped(&jq, 0, &stats));
+
+  P(jq.mutex);
+  job->MaxConcurrentJobs = 2;
+  V(jq.mutex);
+
+  ASSERT_TRUE(WaitForSkipped(&jq, stats.acquire_skipped, &stats));
+  EXPECT_EQ(stats.jobs_started, 1u);
+  EXPECT_EQ(stats.waiting, 1);
+  EXPECT_EQ(jobs_started, 1);
+
+  /*
+   * A changed limit makes the job queue look at the waiting job at once.
+   */
+  JobqResourcesChanged(&jq);
+  EXPECT_TRUE(WaitForJobsStarted(2, std::chrono::seconds(30)));
+
+  jobs_may_end = true;
+  EXPECT_EQ(JobqDestroy(&jq), 0);
+  delete my_config;
+}
@@ -1,7 +1,7 @@
 /*
    BAREOS® - Backup Archiving REcovery Open Sourced
 
-   Copyright (C) 2018-2019 Bareos GmbH & Co. KG
+   Copyright (C) 2018-2020 Bareos GmbH & Co. KG
 
    This program is Free Software; you can redistribute it and/or
    modify it under the terms of version three of the GNU Affero General Public
@@ -26,6 +26,180 @@
 #include "include/bareos.h"
 #endif
 
+#define NEED_JANSSON_NAMESPACE 1
 #include "lib/output_formatter.h"
 
+#include <string>
+
 TEST(output_formatter, constructor_destructor) {}
+
+struct CollectedOutput {
+  std::string output;
+  size_t messages = 0;
+  size_t max_message_length = 0;
+  bool keep = true;
+};
+
+static bool CollectOutput(void* ctx, const char* msg)
+{
+  CollectedOutput* collected = (CollectedOutput*)ctx;
+  size_t length = strlen(msg);
+
+  if (collected->keep) { collected->output += msg; }
+  collected->messages++;
+  if (length > collected->max_message_length) {
+    collected->max_message_length = length;
+  }
+  return true;
+}
+
+/*
+ * Generate a listing the way the director generates "llist jobs".
+ */
+static void GenerateListing(OutputFormatter& send, int rows, bool result = true)
+{
+  send.ObjectKeyValue("Header", "%s: ", "list of jobs", "%s\n");
+  send.ArrayStart("jobs");
+  for (int i = 0; i < rows; i++) {
+    send.ObjectStart();
+    send.ObjectKeyValue("JobId", "%s: ", i, "%d\n");
+    send.ObjectKeyValue("Name", "%s: ", "backup \"job\"\n", "%s");
+    send.ObjectKeyValueBool("Enabled", (i % 2) == 0);
+    send.ObjectStart("stats");
+    send.ObjectKeyValue("JobFiles", "%s: ", i * 10, "%d\n");
+    send.ObjectEnd("stats");
+    send.ObjectEnd();
+  }
+  send.ArrayEnd("jobs");
+  send.ObjectKeyValue("Rows", "%s: ", rows, "%d\n");
+  send.FinalizeResult(result);
+}
+
+static std::string PlainListing(int api_mode, int rows, CollectedOutput& out)
+{
+  OutputFormatter send(CollectOutput, &out, nullptr, nullptr, api_mode);
+
+  GenerateListing(send, rows);
+
+  return out.output;
+}
+
+/*
+ * Without API mode 2 the result is plain text, the JSON streaming
+ * doesn't apply to it.
+ */
+TEST(output_formatter, plain_listing)
+{
+  const std::string expected =
+      "Header: list of jobs\n"
+      "JobId: 0\nName: backup \"job\"\nJobFiles: 0\n"
+      "JobId: 1\nName: backup \"job\"\nJobFiles: 10\n"
+      "Rows: 2\n";
+
+  for (int api_mode : {API_MODE_OFF, API_MODE_ON}) {
+    CollectedOutput collected;
+
+    EXPECT_EQ(PlainListing(api_mode, 2, collected), expected);
+    EXPECT_EQ(collected.messages, 3u);
+  }
+}
+
+/*
+ * A large plain listing is not kept in memory either, every entry is sent
+ * when it is complete.
+ */
+TEST(output_formatter, plain_large_listing)
+{
+  const int rows = 100000;
+  CollectedOutput collected;
+
+  collected.keep = false;
+  PlainListing(API_MODE_OFF, rows, collected);
+
+  EXPECT_EQ(collected.messages, (size_t)rows + 1);
+  EXPECT_LT(collected.max_message_length, 100u);
+}
+
+#if HAVE_JANSSON
+
+static std::string Listing(int rows, int stream_min_rows, bool compact,
+                           bool result = true)
+{
+  CollectedOutput collected;
+  OutputFormatter send(CollectOutput, &collected, nullptr, nullptr,
+                       API_MODE_JSON);
+
+  send.SetCompact(compact);
+  send.SetJsonStreamMinRows(stream_min_rows);
+  send.AddLimitFilterTuple(rows);
+  GenerateListing(send, rows, result);
+  EXPECT_FALSE(send.IsJsonStreaming());
+  if (stream_min_rows > 0 && rows >= stream_min_rows) {
+    EXPECT_GT(collected.messages, 0u);
+  } else {
+    EXPECT_EQ(collected.messages, 1u);
+  }
+
+  return collected.output;
+}
+
+static void ExpectSameJson(const std::string& a, const std::string& b)
+{
+  json_t* json_a = json_loads(a.c_str(), 0, nullptr);
+  json_t* json_b = json_loads(b.c_str(), 0, nullptr);
+
+  ASSERT_NE(json_a, nullptr) << a;
+  ASSERT_NE(json_b, nullptr) << b;
+  EXPECT_TRUE(json_equal(json_a, json_b));
+#if JANSSON_VERSION_HEX >= 0x020800
+  /*
+   * Object keys keep their order, so even the formatting is identical.
+   */
+  EXPECT_EQ(a, b);
+#endif
+  json_decref(json_a);
+  json_decref(json_b);
+}
+
+TEST(output_formatter, json_streamed_result_matches_buffered_result)
+{
+  for (bool compact : {false, true}) {
+    for (int rows : {0, 1, 3, 10}) {
+      ExpectSameJson(Listing(rows, 0, compact), Listing(rows, 3, compact));
+    }
+  }
+}
+
+TEST(output_formatter, json_streamed_result_with_error)
+{
+  std::string output = Listing(10, 3, false, false);
+  json_t* json = json_loads(output.c_str(), 0, nullptr);
+
+  ASSERT_NE(json, nullptr) << output;
+  json_t* jobs = json_object_get(json_object_get(json, "result"), "jobs");
+  ASSERT_NE(jobs, nullptr);
+  EXPECT_EQ(json_array_size(jobs), 10u);
+  EXPECT_NE(json_object_get(json, "error"), nullptr);
+  json_decref(json);
+}
+
+/*
+ * A large listing is not kept in memory, it is sent in chunks of about
+ * OF_JSON_STREAM_BUFFER_SIZE.
+ */
+TEST(output_formatter, json_streaming_large_listing)
+{
+  const int rows = 1000000;
+  CollectedOutput collected;
+  OutputFormatter send(CollectOutput, &collected, nullptr, nullptr,
+                       API_MODE_JSON);
+
+  collected.keep = false;
+  send.SetCompact(true);
+
+  GenerateListing(send, rows);
+
+  EXPECT_GT(collected.messages, (size_t)rows / 1000);
+  EXPECT_LT(collected.max_message_length, 2 * OF_JSON_STREAM_BUFFER_SIZE);
+}
+#endif
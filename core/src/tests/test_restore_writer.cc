@@ -0,0 +1,156 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation, which is
+   listed in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "filed/filed.h"
+#include "filed/restore_writer.h"
+#include "include/jcr.h"
+#include "lib/attr.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace filedaemon;
+
+class RestoreWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override;
+  void TearDown() override;
+
+  RestoreWriteTask* NewTask(const std::string& name);
+  std::string Content(const std::string& name);
+
+  std::shared_ptr<JobControlRecord> jcr;
+  Attributes* attr{nullptr};
+  std::string dir;
+};
+
+void RestoreWriterTest::SetUp()
+{
+  char tmpl[] = "/tmp/restore_writer_test.XXXXXX";
+
+  ASSERT_NE(mkdtemp(tmpl), nullptr);
+  dir = tmpl;
+
+  jcr = std::make_shared<JobControlRecord>();
+  InitJcr(jcr, nullptr);
+  attr = new_attr(jcr.get());
+}
+
+void RestoreWriterTest::TearDown()
+{
+  FreeAttr(attr);
+  jcr.reset();
+  std::string cmd = "rm -rf " + dir;
+  EXPECT_EQ(system(cmd.c_str()), 0);
+}
+
+RestoreWriteTask* RestoreWriterTest::NewTask(const std::string& name)
+{
+  memset(&attr->statp, 0, sizeof(attr->statp));
+  attr->statp.st_mode = S_IFREG | 0640;
+  attr->statp.st_uid = getuid();
+  attr->statp.st_gid = getgid();
+  attr->statp.st_mtime = attr->statp.st_atime = 1000000000;
+  attr->type = FT_REG;
+  attr->stream = STREAM_UNIX_ATTRIBUTES;
+  attr->data_stream = STREAM_FILE_DATA;
+  PmStrcpy(attr->ofname, (dir + "/" + name).c_str());
+  attr->fname = attr->ofname;
+
+  return new RestoreWriteTask(attr);
+}
+
+std::string RestoreWriterTest::Content(const std::string& name)
+{
+  std::ifstream file(dir + "/" + name);
+  std::stringstream content;
+
+  content << file.rdbuf();
+  return content.str();
+}
+
+TEST_F(RestoreWriterTest, creates_files_with_their_data)
+{
+  RestoreWriterPool pool(jcr.get(), REPLACE_ALWAYS, 4);
+
+  for (int i = 0; i < 100; i++) {
+    std::string name = "sub" + std::to_string(i % 3) + "/file" +
+                       std::to_string(i);
+    std::string data = "content of " + name;
+    RestoreWriteTask* task = NewTask(name);
+
+    task->Append(0, data.c_str(), data.size());
+    pool.Submit(task);
+  }
+  pool.Drain();
+
+  EXPECT_EQ(pool.TakeFailedFiles(), 0u);
+  EXPECT_EQ(pool.NextCompleted(), nullptr);
+  for (int i = 0; i < 100; i++) {
+    std::string name = "sub" + std::to_string(i % 3) + "/file" +
+                       std::to_string(i);
+    struct stat st;
+
+    EXPECT_EQ(Content(name), "content of " + name);
+    ASSERT_EQ(stat((dir + "/" + name).c_str(), &st), 0);
+    EXPECT_EQ(st.st_mode & 07777, 0640u);
+    EXPECT_EQ(st.st_mtime, 1000000000);
+  }
+}
+
+TEST_F(RestoreWriterTest, writes_sparse_chunks_at_their_offset)
+{
+  RestoreWriterPool pool(jcr.get(), REPLACE_ALWAYS, 2);
+  RestoreWriteTask* task = NewTask("sparse");
+
+  task->Append(0, "abc", 3);
+  task->Append(3, "def", 3);
+  task->Append(10, "xyz", 3);
+  EXPECT_EQ(task->size(), 9u);
+  pool.Submit(task);
+  pool.Drain();
+
+  EXPECT_EQ(Content("sparse"), std::string("abcdef\0\0\0\0xyz", 13));
+}
+
+TEST_F(RestoreWriterTest, restores_the_same_name_in_order)
+{
+  RestoreWriterPool pool(jcr.get(), REPLACE_ALWAYS, 4);
+
+  for (int i = 0; i < 20; i++) {
+    std::string data = "version " + std::to_string(i);
+    RestoreWriteTask* task = NewTask("file");
+
+    pool.WaitFor(task->ofname().c_str());
+    task->Append(0, data.c_str(), data.size());
+    pool.Submit(task);
+  }
+  pool.Drain();
+
+  EXPECT_EQ(Content("file"), "version 19");
+}
@@ -0,0 +1,138 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "filed/filed.h"
+#include "filed/jcr_private.h"
+#include "filed/verify.h"
+#include "findlib/find.h"
+#include "include/jcr.h"
+
+#include "bsock_mock.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace filedaemon;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+class VerifyDigestTest : public ::testing::Test {
+ protected:
+  void SetUp() override;
+  void TearDown() override;
+
+  /* Run VerifyFile() for all files, returns what was sent to the Director */
+  std::vector<std::string> Verify(int nr_threads);
+
+  std::shared_ptr<JobControlRecord> jcr;
+  std::vector<std::string> files;
+  std::string dir;
+};
+
+void VerifyDigestTest::SetUp()
+{
+  char tmpl[] = "/tmp/verify_digest_test.XXXXXX";
+
+  ASSERT_NE(mkdtemp(tmpl), nullptr);
+  dir = tmpl;
+
+  /* Sizes around the read buffer size and a few empty files */
+  for (int i = 0; i < 60; i++) {
+    std::string name = dir + "/file" + std::to_string(i);
+    std::ofstream file(name, std::ios::binary);
+    size_t size = (i % 5) * (DEFAULT_NETWORK_BUFFER_SIZE / 2) + i;
+
+    for (size_t j = 0; j < size; j++) { file.put((char)(i * 31 + j)); }
+    files.push_back(name);
+  }
+
+  jcr = std::make_shared<JobControlRecord>();
+  InitJcr(jcr, nullptr);
+  jcr->impl = new JobControlRecordPrivate;
+  jcr->impl->last_fname = GetPoolMemory(PM_FNAME);
+  jcr->setJobType(JT_VERIFY);
+}
+
+void VerifyDigestTest::TearDown()
+{
+  FreePoolMemory(jcr->impl->last_fname);
+  delete jcr->impl;
+  jcr->impl = nullptr;
+  jcr->dir_bsock = nullptr;
+  jcr.reset();
+  std::string cmd = "rm -rf " + dir;
+  EXPECT_EQ(system(cmd.c_str()), 0);
+}
+
+std::vector<std::string> VerifyDigestTest::Verify(int nr_threads)
+{
+  std::vector<std::string> sent;
+  NiceMock<BareosSocketMock> dir_bsock;
+
+  ON_CALL(dir_bsock, send()).WillByDefault(Invoke([&dir_bsock, &sent]() {
+    sent.emplace_back(dir_bsock.msg, dir_bsock.message_length);
+    return true;
+  }));
+  jcr->dir_bsock = &dir_bsock;
+  jcr->JobFiles = 0;
+  jcr->JobBytes = 0;
+
+  if (nr_threads > 0) { StartVerifyDigestThreads(jcr.get(), nr_threads); }
+  for (auto& name : files) {
+    FindFilesPacket ff_pkt;
+
+    ff_pkt.fname = const_cast<char*>(name.c_str());
+    ff_pkt.link = ff_pkt.fname;
+    ff_pkt.type = FT_REG;
+    EXPECT_EQ(lstat(name.c_str(), &ff_pkt.statp), 0);
+    /* Reading the file in an earlier pass may have changed its atime */
+    ff_pkt.statp.st_atime = 0;
+    SetBit(FO_SHA256, ff_pkt.flags);
+    bstrncpy(ff_pkt.VerifyOpts, "pins5", sizeof(ff_pkt.VerifyOpts));
+    EXPECT_EQ(VerifyFile(jcr.get(), &ff_pkt, true), 1);
+  }
+  EXPECT_TRUE(StopVerifyDigestThreads(jcr.get(), true));
+  jcr->dir_bsock = nullptr;
+
+  return sent;
+}
+
+TEST_F(VerifyDigestTest, pool_sends_what_the_serial_path_sends)
+{
+  std::vector<std::string> serial = Verify(0);
+  uint64_t serial_bytes = jcr->JobBytes;
+
+  ASSERT_EQ(serial.size(), 2 * files.size());
+  EXPECT_GT(serial_bytes, 0u);
+
+  for (int nr_threads : {1, 4}) {
+    EXPECT_EQ(Verify(nr_threads), serial);
+    EXPECT_EQ(jcr->JobBytes, serial_bytes);
+  }
+}
@@ -0,0 +1,307 @@
+/*
+   BAREOS® - Backup Archiving REcovery Open Sourced
+
+   Copyright (C) 2020-2020 Bareos GmbH & Co. KG
+
+   This program is Free Software; you can redistribute it and/or
+   modify it under the terms of version three of the GNU Affero General Public
+   License as published by the Free Software Foundation and included
+   in the file LICENSE.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+*/
+#if defined(HAVE_MINGW)
+#include "include/bareos.h"
+#include "gtest/gtest.h"
+#else
+#include "gtest/gtest.h"
+#include "include/bareos.h"
+#endif
+
+#include "stored/stored.h"
+#include "stored/volume_index.h"
+#include "lib/parse_bsr.h"
+
+#include <fstream>
+#include <string>
+
+using namespace storagedaemon;
+
+static const char* kVolumeName = "Full-0001";
+
+class VolumeIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    ASSERT_NE(mkdtemp(&directory_[0]), nullptr);
+
+    index_.volume_name = kVolumeName;
+    index_.clean = true;
+    index_.eod_addr = 1000000;
+    index_.blocks = 16;
+    index_.files = 0;
+    index_.AddSession(Session(100, 1, 11, 64512, 300000));
+    index_.AddSession(Session(100, 2, 12, 129024, 600000));
+    index_.AddSession(Session(100, 3, 13, 600001, 999999));
+  }
+  void TearDown() override
+  {
+    if (bsr_) { libbareos::FreeBsr(bsr_); }
+    unlink(bsr_filename_.c_str());
+    RemoveVolumeIndex(directory_.c_str(), kVolumeName);
+    rmdir(directory_.c_str());
+  }
+
+  static VolumeIndexSession Session(uint32_t sesstime,
+                                    uint32_t sessid,
+                                    uint32_t jobid,
+                                    uint64_t start,
+                                    uint64_t end)
+  {
+    VolumeIndexSession session;
+    session.VolSessionTime = sesstime;
+    session.VolSessionId = sessid;
+    session.JobId = jobid;
+    session.start_addr = start;
+    session.end_addr = end;
+    return session;
+  }
+
+  BootStrapRecord* Parse(const std::string& content)
+  {
+    std::ofstream out(bsr_filename_);
+    out << content;
+    out.close();
+    bsr_ = libbareos::parse_bsr(nullptr,
+                                const_cast<char*>(bsr_filename_.c_str()));
+    return bsr_;
+  }
+
+  std::string directory_{"volume_index_test.XXXXXX"};
+  std::string bsr_filename_{"test_volume_index." + std::to_string(getpid()) +
+                            ".bsr"};
+  BootStrapRecord* bsr_{nullptr};
+  VolumeIndex index_;
+};
+
+static std::string BsrHeader(const char* volume_name)
+{
+  return std::string("Volume=\"") + volume_name + "\"\nMediaType=\"File\"\n";
+}
+
+TEST_F(VolumeIndexTest, save_and_load)
+{
+  VolumeIndex index;
+
+  EXPECT_FALSE(LoadVolumeIndex(directory_.c_str(), kVolumeName, index));
+  ASSERT_TRUE(SaveVolumeIndex(directory_.c_str(), index_));
+  ASSERT_TRUE(LoadVolumeIndex(directory_.c_str(), kVolumeName, index));
+
+  EXPECT_EQ(index.volume_name, kVolumeName);
+  EXPECT_TRUE(index.clean);
+  EXPECT_EQ(index.eod_addr, 1000000u);
+  EXPECT_EQ(index.blocks, 16u);
+  ASSERT_EQ(index.sessions.size(), 3u);
+  EXPECT_EQ(index.sessions[1].VolSessionId, 2u);
+  EXPECT_EQ(index.sessions[1].JobId, 12u);
+  EXPECT_EQ(index.sessions[1].start_addr, 129024u);
+  EXPECT_EQ(index.sessions[1].end_addr, 600000u);
+}
+
+TEST_F(VolumeIndexTest, large_addresses_survive)
+{
+  VolumeIndex index;
+
+  index_.eod_addr = 0x1234567890ull;
+  index_.AddSession(Session(100, 4, 14, 0x1000000000ull, 0x1234567890ull));
+  ASSERT_TRUE(SaveVolumeIndex(directory_.c_str(), index_));
+  ASSERT_TRUE(LoadVolumeIndex(directory_.c_str(), kVolumeName, index));
+  EXPECT_EQ(index.eod_addr, 0x1234567890ull);
+  EXPECT_EQ(index.sessions.back().start_addr, 0x1000000000ull);
+}
+
+TEST_F(VolumeIndexTest, index_of_other_volume_is_rejected)
+{
+  VolumeIndex index;
+  std::string path = directory_ + "/Full-0002.idx";
+
+  ASSERT_TRUE(SaveVolumeIndex(directory_.c_str(), index_));
+  ASSERT_EQ(rename((directory_ + "/" + kVolumeName + ".idx").c_str(),
+                   path.c_str()),
+            0);
+  EXPECT_FALSE(LoadVolumeIndex(directory_.c_str(), "Full-0002", index));
+  unlink(path.c_str());
+}
+
+TEST_F(VolumeIndexTest, sessions_written_in_parts_are_merged)
+{
+  index_.AddSession(Session(100, 1, 11, 700000, 800000));
+  index_.AddSession(Session(100, 1, 11, 10000, 20000));
+
+  ASSERT_EQ(index_.sessions.size(), 3u);
+  EXPECT_EQ(index_.sessions[0].start_addr, 10000u);
+  EXPECT_EQ(index_.sessions[0].end_addr, 800000u);
+}
+
+TEST_F(VolumeIndexTest, start_of_selected_sessions)
+{
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=3\nVolSessionTime=100\nFileIndex=1-5\n" +
+                  BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\nFileIndex=1-5\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 129024u);
+}
+
+TEST_F(VolumeIndexTest, start_of_selected_jobid)
+{
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) + "JobId=13\n"), nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 600001u);
+}
+
+TEST_F(VolumeIndexTest, bsrs_of_other_volumes_are_ignored)
+{
+  ASSERT_NE(Parse(BsrHeader("Full-0002") + "FileIndex=1-5\n" +
+                  BsrHeader(kVolumeName) + "JobId=12-13\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 129024u);
+}
+
+TEST_F(VolumeIndexTest, whole_volume_without_session_selection)
+{
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) + "FileIndex=1-5\n"), nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 0u);
+}
+
+TEST_F(VolumeIndexTest, whole_volume_for_unknown_session)
+{
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) + "JobId=13\n" +
+                  BsrHeader(kVolumeName) + "JobId=99\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 0u);
+}
+
+static VolumeIndexBlock Block(uint32_t sessid,
+                              int32_t first_index,
+                              int32_t last_index,
+                              uint64_t addr)
+{
+  VolumeIndexBlock entry;
+  entry.VolSessionTime = 100;
+  entry.VolSessionId = sessid;
+  entry.FirstIndex = first_index;
+  entry.LastIndex = last_index;
+  entry.addr = addr;
+  return entry;
+}
+
+static void AddBlocks(const std::string& directory)
+{
+  AppendVolumeBlockIndex(directory.c_str(), kVolumeName,
+                         {Block(2, 1, 10, 129024), Block(1, 1, 3, 150000)});
+  AppendVolumeBlockIndex(directory.c_str(), kVolumeName,
+                         {Block(2, 10, 25, 200000), Block(2, 25, 40, 300000),
+                          Block(2, 41, 50, 400000)});
+}
+
+TEST_F(VolumeIndexTest, block_index_save_and_load)
+{
+  AddBlocks(directory_);
+
+  /* a line cut short by a crash */
+  std::ofstream out(directory_ + "/" + kVolumeName + ".blk", std::ios::app);
+  out << "Block 2 100 51 60 5000";
+  out.close();
+
+  ASSERT_TRUE(LoadVolumeBlockIndex(directory_.c_str(), index_));
+  ASSERT_EQ(index_.block_index.size(), 5u);
+  EXPECT_EQ(index_.block_index[0].VolSessionId, 1u);
+  EXPECT_EQ(index_.block_index[1].addr, 129024u);
+  EXPECT_EQ(index_.block_index[4].FirstIndex, 41);
+  EXPECT_EQ(index_.block_index[4].LastIndex, 50);
+  EXPECT_EQ(index_.block_index[4].addr, 400000u);
+}
+
+TEST_F(VolumeIndexTest, start_at_block_before_first_wanted_file)
+{
+  AddBlocks(directory_);
+  ASSERT_TRUE(LoadVolumeBlockIndex(directory_.c_str(), index_));
+
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\nFileIndex=30-35\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 300000u);
+  libbareos::FreeBsr(bsr_);
+
+  /* file 41 may continue from the block before */
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\nFileIndex=41\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 300000u);
+}
+
+TEST_F(VolumeIndexTest, volume_address_is_not_moved_backwards)
+{
+  AddBlocks(directory_);
+  ASSERT_TRUE(LoadVolumeBlockIndex(directory_.c_str(), index_));
+
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\n"
+                  "VolAddr=350000-500000\nFileIndex=30\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 350000u);
+}
+
+TEST_F(VolumeIndexTest, earliest_bsr_limits_the_start)
+{
+  AddBlocks(directory_);
+  ASSERT_TRUE(LoadVolumeBlockIndex(directory_.c_str(), index_));
+
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\nFileIndex=45\n" +
+                  BsrHeader(kVolumeName) +
+                  "VolSessionId=1\nVolSessionTime=100\nFileIndex=2-3\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 150000u);
+}
+
+TEST_F(VolumeIndexTest, start_at_blob_block_of_the_session)
+{
+  VolumeIndexBlock blob = Block(2, 12, 14, 250000);
+  VolumeIndexBlock other_session = Block(1, 2, 2, 160000);
+
+  blob.acl_xattr_blob = true;
+  other_session.acl_xattr_blob = true;
+  AddBlocks(directory_);
+  AppendVolumeBlockIndex(directory_.c_str(), kVolumeName,
+                         {blob, other_session});
+
+  ASSERT_TRUE(LoadVolumeBlockIndex(directory_.c_str(), index_));
+  ASSERT_EQ(index_.block_index.size(), 7u);
+  ASSERT_EQ(index_.blob_blocks.size(), 2u);
+  EXPECT_TRUE(index_.blob_blocks[1].acl_xattr_blob);
+
+  /* a later file of the session may reference the blob at 250000 */
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\nFileIndex=45\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 250000u);
+
+  /* the blob block was read already */
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_, 260000), 400000u);
+  libbareos::FreeBsr(bsr_);
+
+  /* the blob is not needed before its file */
+  ASSERT_NE(Parse(BsrHeader(kVolumeName) +
+                  "VolSessionId=2\nVolSessionTime=100\nFileIndex=5\n"),
+            nullptr);
+  EXPECT_EQ(GetVolumeIndexStartAddr(index_, bsr_), 129024u);
+}